@@ -1,8 +1,10 @@
 #ifndef DEFINES_H
 #define DEFINES_H
+#include <vector>
+// HEADLESS builds (batch runs) have no window nor Vulkan
+#ifndef HEADLESS
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
-#include <vector>
 
 //---------------------------------//
 //------- VULKAN PARAMETERS -------//
@@ -23,6 +25,7 @@ const std::vector<const char*> instanceExtensions = {
 
 
 const int MAX_FRAMES_IN_FLIGHT = 2;
+#endif// HEADLESS
 
 
 //---------------------------------//
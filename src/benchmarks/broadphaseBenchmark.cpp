@@ -0,0 +1,109 @@
+//--------------------------------------------------
+// Robot Simulator
+// broadphaseBenchmark.cpp
+// Date: 2020-11-05
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+// Pair generation time against body count (100 to 50k bodies)
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "simulator/physics/bodyStore.h"
+#include "simulator/physics/broadphase/sweepAndPrune.h"
+#include "simulator/physics/broadphase/aabbTreeBroadphase.h"
+
+struct Result
+{
+	double firstUpdateMs;
+	double updateMs;
+	size_t pairs;
+};
+
+static Result runBroadphase(Broadphase* broadphase, BodyStore* store, float movingRatio, int steps)
+{
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> jitter(-0.05f, 0.05f);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	std::vector<BodyStore::BodyId> moving;
+	for(uint32_t i=0; i<store->size(); i++)
+	{
+		if(unit(rng) < movingRatio)
+			moving.push_back(store->getId(i));
+		broadphase->addBody(store->getId(i));
+	}
+
+	Result result;
+	auto begin = std::chrono::steady_clock::now();
+	broadphase->update();
+	auto end = std::chrono::steady_clock::now();
+	result.firstUpdateMs = std::chrono::duration<double, std::milli>(end-begin).count();
+
+	double total = 0;
+	size_t pairs = 0;
+	for(int s=0; s<steps; s++)
+	{
+		for(auto id : moving)
+			store->setPosition(id, store->getPosition(id)+glm::vec3(jitter(rng), jitter(rng), jitter(rng)));
+
+		begin = std::chrono::steady_clock::now();
+		broadphase->update();
+		end = std::chrono::steady_clock::now();
+		total += std::chrono::duration<double, std::milli>(end-begin).count();
+		pairs += broadphase->getPairs().size();
+	}
+	result.updateMs = total/steps;
+	result.pairs = pairs/steps;
+	return result;
+}
+
+static void fillStore(BodyStore* store, int count)
+{
+	std::mt19937 rng(count);
+	// Flat arena with constant density: 8 units of area per unit box
+	const float side = std::sqrt(count*8.0f);
+	std::uniform_real_distribution<float> position(-side*0.5f, side*0.5f);
+	std::uniform_real_distribution<float> height(0.5f, 3.0f);
+
+	for(int i=0; i<count; i++)
+	{
+		BodyStore::BodyState state;
+		state.position = {position(rng), height(rng), position(rng)};
+		state.halfExtents = {0.5f, 0.5f, 0.5f};
+		store->add(nullptr, state);
+	}
+}
+
+int main()
+{
+	const int counts[] = {100, 500, 1000, 5000, 10000, 50000};
+	const float movingRatios[] = {0.05f, 1.0f};
+	const int steps = 50;
+
+	printf("%-20s %-10s %-8s %-14s %-14s %-10s\n", "broadphase", "bodies", "moving", "first (ms)", "update (ms)", "pairs");
+	for(float movingRatio : movingRatios)
+	{
+		for(int count : counts)
+		{
+			for(int type=0; type<2; type++)
+			{
+				BodyStore store;
+				fillStore(&store, count);
+				Broadphase* broadphase;
+				if(type == 0)
+					broadphase = new SweepAndPrune(&store);
+				else
+					broadphase = new AabbTreeBroadphase(&store);
+
+				Result r = runBroadphase(broadphase, &store, movingRatio, steps);
+				printf("%-20s %-10d %-8.2f %-14.3f %-14.3f %-10zu\n", broadphase->getType().c_str(),
+						count, movingRatio, r.firstUpdateMs, r.updateMs, r.pairs);
+				delete broadphase;
+			}
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,93 @@
+//--------------------------------------------------
+// Robot Simulator
+// raycastBenchmark.cpp
+// Date: 2020-11-22
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+// Rays per second of single raycasts against batched ray packets
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "simulator/physics/physicsEngine.h"
+
+static void buildScene(PhysicsEngine* engine, std::vector<ObjectPhysics*>& objects, int bodyCount)
+{
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+	std::uniform_real_distribution<float> angle(0.0f, 180.0f);
+	std::uniform_real_distribution<float> size(0.2f, 1.5f);
+
+	const ShapeType types[] = {ShapeType::BOX, ShapeType::SPHERE, ShapeType::CYLINDER};
+	for(int i=0; i<bodyCount; i++)
+	{
+		ObjectPhysics* object = new ObjectPhysics({position(random), position(random), position(random)}, {angle(random), angle(random), angle(random)}, 0);
+		object->setShapeType(types[i%3]);
+		object->setHalfExtents({size(random), size(random), size(random)});
+		engine->addObjectPhysics(object);
+		objects.push_back(object);
+	}
+}
+
+// Rays fanning out from the origin like a rotating range sensor
+static std::vector<PhysicsEngine::Ray> buildRays(int rayCount)
+{
+	std::vector<PhysicsEngine::Ray> rays(rayCount);
+	const int rings = 16;
+	const int perRing = rayCount/rings;
+	for(int i=0; i<rayCount; i++)
+	{
+		const float azimuth = glm::radians(360.0f*(i%perRing)/perRing);
+		const float elevation = glm::radians(-15.0f + 30.0f*(i/perRing)/rings);
+		rays[i].origin = glm::vec3(0.0f);
+		rays[i].direction = glm::vec3(std::cos(elevation)*std::cos(azimuth), std::sin(elevation), std::cos(elevation)*std::sin(azimuth));
+		rays[i].maxDistance = 100.0f;
+	}
+	return rays;
+}
+
+int main()
+{
+	const int bodyCounts[] = {1000, 10000, 50000};
+	const int rayCount = 16*2048;
+	const int repeats = 10;
+
+	printf("%-10s %-16s %-16s %-10s %-10s\n", "bodies", "single (Mray/s)", "batch (Mray/s)", "speedup", "hits");
+	for(int bodyCount : bodyCounts)
+	{
+		PhysicsEngine engine;
+		std::vector<ObjectPhysics*> objects;
+		buildScene(&engine, objects, bodyCount);
+		engine.stepPhysics(0.016f);
+
+		const std::vector<PhysicsEngine::Ray> rays = buildRays(rayCount);
+		std::vector<PhysicsEngine::RayResult> results;
+
+		int hits = 0;
+		auto begin = std::chrono::steady_clock::now();
+		for(int r=0; r<repeats; r++)
+			for(const auto& ray : rays)
+			{
+				PhysicsEngine::RayResult result;
+				hits += engine.raycast(ray.origin, ray.direction, result, ray.maxDistance);
+			}
+		auto end = std::chrono::steady_clock::now();
+		const double singleSeconds = std::chrono::duration<double>(end-begin).count();
+
+		begin = std::chrono::steady_clock::now();
+		for(int r=0; r<repeats; r++)
+			engine.raycastBatch(rays, results);
+		end = std::chrono::steady_clock::now();
+		const double batchSeconds = std::chrono::duration<double>(end-begin).count();
+
+		const double totalRays = (double)rayCount*repeats;
+		printf("%-10d %-16.2f %-16.2f %-10.2f %-10d\n", bodyCount,
+				totalRays/singleSeconds*1e-6, totalRays/batchSeconds*1e-6, singleSeconds/batchSeconds, hits/repeats);
+
+		for(auto object : objects)
+			delete object;
+	}
+
+	return 0;
+}
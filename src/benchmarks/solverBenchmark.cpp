@@ -0,0 +1,95 @@
+//--------------------------------------------------
+// Robot Simulator
+// solverBenchmark.cpp
+// Date: 2020-11-20
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+// Step time and scaling efficiency of the parallel island solver from 1 to N threads
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include "simulator/physics/physicsEngine.h"
+
+enum class Layout
+{
+	// Many independent stacks (small islands)
+	STACKS,
+	// One wide pile where every box touches its neighbors (single colored island)
+	PILE
+};
+
+static void buildScene(PhysicsEngine* engine, std::vector<ObjectPhysics*>& objects, Layout layout)
+{
+	ObjectPhysics* ground = new ObjectPhysics({0,-1,0}, {0,0,0}, 0);
+	ground->setHalfExtents({1000, 1, 1000});
+	engine->addObjectPhysics(ground);
+	objects.push_back(ground);
+
+	const int side = 32;
+	const int layers = 4;
+	const float spacing = layout == Layout::STACKS ? 3.0f : 0.99f;
+	for(int x=0; x<side; x++)
+		for(int z=0; z<side; z++)
+			for(int y=0; y<layers; y++)
+			{
+				glm::vec3 position = {(x-side/2)*spacing, 0.5f+y*0.99f, (z-side/2)*spacing};
+				ObjectPhysics* box = new ObjectPhysics(position, {0,0,0}, 1);
+				box->setHalfExtents({0.5f, 0.5f, 0.5f});
+				engine->addObjectPhysics(box);
+				objects.push_back(box);
+			}
+}
+
+static double runScene(Layout layout, int threadCount, int steps)
+{
+	PhysicsEngine engine;
+	engine.setThreadCount(threadCount);
+	// Sleeping would remove the work being measured
+	engine.setSleepingEnabled(false);
+
+	std::vector<ObjectPhysics*> objects;
+	buildScene(&engine, objects, layout);
+
+	// Let the contacts settle before measuring
+	for(int i=0; i<20; i++)
+		engine.stepPhysics(0.016f);
+
+	auto begin = std::chrono::steady_clock::now();
+	for(int i=0; i<steps; i++)
+		engine.stepPhysics(0.016f);
+	auto end = std::chrono::steady_clock::now();
+
+	for(auto object : objects)
+		delete object;
+	return std::chrono::duration<double, std::milli>(end-begin).count()/steps;
+}
+
+int main()
+{
+	const int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+	const int steps = 100;
+	std::vector<int> threadCounts;
+	for(int threads=1; threads<maxThreads; threads*=2)
+		threadCounts.push_back(threads);
+	threadCounts.push_back(maxThreads);
+
+	const Layout layouts[] = {Layout::STACKS, Layout::PILE};
+	const char* sceneNames[] = {"stacks", "pile"};
+	printf("%-10s %-10s %-14s %-10s %-10s\n", "scene", "threads", "step (ms)", "speedup", "efficiency");
+	for(int s=0; s<2; s++)
+	{
+		double serialMs = 0;
+		for(int threads : threadCounts)
+		{
+			const double ms = runScene(layouts[s], threads, steps);
+			if(threads == 1)
+				serialMs = ms;
+			const double speedup = serialMs/ms;
+			printf("%-10s %-10d %-14.3f %-10.2f %-10.2f\n", sceneNames[s], threads, ms, speedup, speedup/threads);
+		}
+	}
+
+	return 0;
+}
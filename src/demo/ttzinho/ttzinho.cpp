@@ -7,27 +7,65 @@
 #include "ttzinho.h"
 #include "simulator/objects/basic/box.h"
 #include "simulator/objects/basic/importedObject.h"
+#include "simulator/objects/basic/sphere.h"
 #include "simulator/objects/others/displays/displayTFT144.h"
+#include "simulator/objects/sensors/lidar/lidar.h"
 #include "simulator/physics/constraints/hingeConstraint.h"
+#include "simulator/physics/constraints/fixedConstraint.h"
 #include "simulator/helpers/log.h"
 
 Ttzinho::Ttzinho()
 {
 	_object = new Box("Ttzinho", {0,0.06,0}, {0,0,0}, {0.18, 0.01,0.05}, 0.1f, {0,0,0.8});
-	ImportedObject* wheelL = new ImportedObject("Wheel left", "wheel", {0.2,0.06,0}, {0,0,90}, {1,1,1}, 0.1f);
-	ImportedObject* wheelR = new ImportedObject("Wheel right", "wheel", {0.2,0.12,0}, {0,0,-90}, {1,1,1}, 0.1f);
+	ImportedObject* wheelL = new ImportedObject("Wheel left", "wheel", {0.2,0.06,0}, {0,0,90}, {1,1,1}, 0.1f, ShapeType::CYLINDER);
+	ImportedObject* wheelR = new ImportedObject("Wheel right", "wheel", {0.2,0.12,0}, {0,0,-90}, {1,1,1}, 0.1f, ShapeType::CYLINDER);
+	// Small and fast, could pass through thin obstacles
+	wheelL->getObjectPhysics()->setCcdEnabled(true);
+	wheelR->getObjectPhysics()->setCcdEnabled(true);
 	DisplayTFT144* display = new DisplayTFT144("Display", {0.0, 0.2, 0.0});
 
-	_object->addChild(wheelL, new HingeConstraint({0.2,0,0}, {0,0,90}));
-	_object->addChild(wheelR, new HingeConstraint({-0.2,0,0}, {0,0,-90}));
-	_object->addChild(display, new HingeConstraint({-0.2,0,0}, {0,0,-90}));
+	// Wheel motors in speed control (stopped), limited like the real DC motors
+	_motorL = new HingeConstraint({0.2,0,0}, {0,0,90});
+	_motorR = new HingeConstraint({-0.2,0,0}, {0,0,-90});
+	for(auto motor : {_motorL, _motorR})
+	{
+		motor->setMotorLimits(0.2f, 30.0f);
+		motor->setMotorVelocity(0.0f);
+	}
+	_object->addChild(wheelL, _motorL);
+	_object->addChild(wheelR, _motorR);
+	_object->addChild(display, new FixedConstraint({0,0.14,0}, {0,0,0}));
+
+	// Front and back caster balls keep the body level (it would spin around the wheel axis)
+	for(float z : {0.04f, -0.04f})
+	{
+		Sphere* caster = new Sphere("Caster", {0,0.015,z}, {0,0,0}, 0.015f, 0.01f, {0.2,0.2,0.2});
+		caster->getObjectPhysics()->setFriction(0.0f);
+		_object->addChild(caster, new FixedConstraint({0,-0.045,z}, {0,0,0}));
+	}
+
+	// 2D lidar on top of the body (mount pose relative to the body)
+	_lidar = new Lidar("Lidar", {0.0, 0.04, 0.0});
+	Lidar::Config config;
+	config.channels = 1;
+	config.columns = 360;
+	config.maxRange = 12.0f;
+	_lidar->setConfig(config);
+	_object->addChild(_lidar, nullptr);
 }
 
 Ttzinho::~Ttzinho()
 {
-	if(_object != nullptr)
-	{
-		delete _object;
-		_object = nullptr;
-	}
+	// The objects are deleted by the scene (addComplexObject)
+	_object = nullptr;
+	_motorL = nullptr;
+	_motorR = nullptr;
+	_lidar = nullptr;
+}
+
+void Ttzinho::setWheelVelocities(float left, float right)
+{
+	// The right hinge is mirrored
+	_motorL->setMotorVelocity(left);
+	_motorR->setMotorVelocity(-right);
 }
@@ -10,6 +10,8 @@
 #include <string>
 #include <vector>
 #include "simulator/object.h"
+#include "simulator/physics/constraints/hingeConstraint.h"
+#include "simulator/objects/sensors/lidar/lidar.h"
 
 class Ttzinho
 {
@@ -19,9 +21,20 @@ class Ttzinho
 
 		void run();
 		Object* getObject() const { return _object; }
+		Lidar* getLidar() const { return _lidar; }
+		// Wheel speeds of the last step (rad/s)
+		float getWheelVelocityLeft() const { return _motorL->getAngularVelocity(); }
+		float getWheelVelocityRight() const { return -_motorR->getAngularVelocity(); }
+
+		//---------- Setters ----------//
+		// Wheel speed targets (rad/s), limited by the motors. Equal speeds drive straight.
+		void setWheelVelocities(float left, float right);
 
 	private:
 		Object* _object;
+		HingeConstraint* _motorL;
+		HingeConstraint* _motorR;
+		Lidar* _lidar;
 };
 
 #endif// TTZINHO_H
@@ -0,0 +1,116 @@
+#include <cstdio>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <random>
+#include <chrono>
+#include "simulator/headlessSimulator.h"
+#include "simulator/vectorEnvironment.h"
+
+static void printUsage(const char* name)
+{
+	printf("Usage: %s [options]\n", name);
+	printf("  --duration <s>           Simulated time (default 10)\n");
+	printf("  --timestep <s>           Physics step (default 0.001)\n");
+	printf("  --threads <n>            Physics threads, 0 uses all the cores (default 1)\n");
+	printf("  --deterministic          Bit-exact run, the state hash is reproducible\n");
+	printf("  --wheels <left> <right>  Robot wheel speeds (rad/s)\n");
+	printf("  --output <file>          Write the metrics as JSON\n");
+	printf("  --envs <n>               Step n arenas with random actions (vector environment throughput)\n");
+}
+
+// Environment steps per second of a vector environment driven by random wheel speeds
+static void runEnvironments(const HeadlessSimulator::Config& config, int envCount)
+{
+	VectorEnvironment::Config envConfig;
+	envConfig.envCount = envCount;
+	envConfig.timeStep = config.timeStep;
+	envConfig.threadCount = config.threadCount;
+	envConfig.deterministic = config.deterministic;
+	VectorEnvironment environment(envConfig);
+
+	const float envStepTime = envConfig.timeStep*envConfig.frameSkip;
+	const int steps = std::max((int)(config.duration/envStepTime + 0.5f), 0);
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> wheelVelocity(-30.0f, 30.0f);
+
+	uint64_t episodes = 0;
+	const auto begin = std::chrono::steady_clock::now();
+	for(int i=0; i<steps; i++)
+	{
+		float* actions = environment.getActions();
+		for(int a=0; a<envCount*VectorEnvironment::ACTION_SIZE; a++)
+			actions[a] = wheelVelocity(random);
+		environment.step();
+		for(int env=0; env<envCount; env++)
+			episodes += environment.getDones()[env];
+	}
+	const double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+	const uint64_t envSteps = environment.getTotalSteps();
+	printf("%d environments, %llu environment steps (%.3f s each) in %.3f s\n",
+			envCount, (unsigned long long)envSteps, envStepTime, wallTime);
+	printf("%.0f environment steps/s, %.1fx real time per environment, %llu episodes ended\n",
+			wallTime > 0 ? envSteps/wallTime : 0.0, wallTime > 0 ? steps*envStepTime/wallTime : 0.0,
+			(unsigned long long)episodes);
+}
+
+int main(int argc, char** argv)
+{
+	HeadlessSimulator::Config config;
+	std::string output;
+	int envCount = 0;
+
+	for(int i=1; i<argc; i++)
+	{
+		const char* arg = argv[i];
+		const int remaining = argc-1-i;
+		if(strcmp(arg, "--duration") == 0 && remaining >= 1)
+			config.duration = atof(argv[++i]);
+		else if(strcmp(arg, "--timestep") == 0 && remaining >= 1)
+			config.timeStep = atof(argv[++i]);
+		else if(strcmp(arg, "--threads") == 0 && remaining >= 1)
+			config.threadCount = atoi(argv[++i]);
+		else if(strcmp(arg, "--deterministic") == 0)
+			config.deterministic = true;
+		else if(strcmp(arg, "--wheels") == 0 && remaining >= 2)
+		{
+			config.wheelVelocityLeft = atof(argv[++i]);
+			config.wheelVelocityRight = atof(argv[++i]);
+		}
+		else if(strcmp(arg, "--output") == 0 && remaining >= 1)
+			output = argv[++i];
+		else if(strcmp(arg, "--envs") == 0 && remaining >= 1)
+			envCount = atoi(argv[++i]);
+		else
+		{
+			printUsage(argv[0]);
+			return strcmp(arg, "--help") == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+
+	if(config.duration < 0 || config.timeStep <= 0)
+	{
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if(envCount > 0)
+	{
+		runEnvironments(config, envCount);
+		return EXIT_SUCCESS;
+	}
+
+	HeadlessSimulator sim(config);
+	const HeadlessSimulator::Metrics metrics = sim.run();
+	HeadlessSimulator::printMetrics(metrics);
+
+	if(!output.empty() && !HeadlessSimulator::writeMetrics(metrics, output))
+	{
+		fprintf(stderr, "Could not write %s\n", output.c_str());
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
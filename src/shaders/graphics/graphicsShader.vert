@@ -6,10 +6,14 @@
 
 layout(binding = 0) readonly uniform UniformBufferObjectStruct { UniformBufferObject Camera; };
 layout(binding = 1) readonly buffer MaterialArray { Material[] Materials; };
-layout(push_constant) uniform ObjectInfo {
-  mat4 modelView;
-  vec3 color;
-} objectInfo;
+// Grouped by mesh, each mesh is one instanced draw (gl_InstanceIndex includes the first instance)
+struct RasterInstance
+{
+	mat4 modelMatrix;
+	mat4 normalMatrix;
+	vec4 color;
+};
+layout(binding = 3) readonly buffer RasterInstanceArray { RasterInstance[] Instances; };
 
 layout(location = 0) in vec3 InPosition;
 layout(location = 1) in vec3 InNormal;
@@ -30,15 +34,16 @@ out gl_PerVertex
 void main() 
 {
 	Material m = Materials[InMaterialIndex];
+	RasterInstance instance = Instances[gl_InstanceIndex];
 
-	FragPos = vec3(objectInfo.modelView * vec4(InPosition, 1.0));
-	FragNormal = vec3(transpose(inverse(objectInfo.modelView)) * vec4(InNormal, 1.0));
+	FragPos = vec3(instance.modelMatrix * vec4(InPosition, 1.0));
+	FragNormal = vec3(instance.normalMatrix * vec4(InNormal, 1.0));
 
-    gl_Position = Camera.projection * Camera.modelView * objectInfo.modelView * vec4(InPosition, 1.0);
-	if(objectInfo.color.x + objectInfo.color.y + objectInfo.color.z == 0)
+    gl_Position = Camera.projection * Camera.modelView * instance.modelMatrix * vec4(InPosition, 1.0);
+	if(instance.color.x + instance.color.y + instance.color.z == 0)
     	FragColor = m.diffuse.xyz;
 	else
-    	FragColor = objectInfo.color;
+    	FragColor = instance.color.xyz;
 
 	FragTexCoord = InTexCoord;
 	FragMaterialIndex = InMaterialIndex;
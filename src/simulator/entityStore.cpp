@@ -0,0 +1,327 @@
+//--------------------------------------------------
+// Robot Simulator
+// entityStore.cpp
+// Date: 2020-12-07
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#include "entityStore.h"
+#include <algorithm>
+#include <numeric>
+
+namespace
+{
+	glm::mat4 composeWorld(glm::vec3 position, glm::quat orientation, glm::vec3 scale)
+	{
+		glm::mat4 world = glm::mat4_cast(orientation);
+		world[0] *= scale.x;
+		world[1] *= scale.y;
+		world[2] *= scale.z;
+		world[3] = glm::vec4(position, 1.0f);
+		return world;
+	}
+}
+
+EntityStore::EntityStore():
+	_orderDirty(false)
+{
+}
+
+EntityStore::~EntityStore()
+{
+}
+
+EntityStore::EntityId EntityStore::create(Object* object)
+{
+	EntityId id;
+	if(!_freeIds.empty())
+	{
+		id = _freeIds.back();
+		_freeIds.pop_back();
+	}
+	else
+	{
+		id = (EntityId)_idToIndex.size();
+		_idToIndex.push_back(0);
+	}
+
+	_idToIndex[id] = size();
+	_indexToId.push_back(id);
+	_objects.push_back(object);
+	_masks.push_back(0);
+	_transformFlags.push_back(0);
+	_transforms.emplace_back();
+	_meshes.emplace_back();
+	_colors.emplace_back();
+	_bodies.emplace_back();
+	_hierarchies.emplace_back();
+	_parentIndices.push_back((uint32_t)INVALID_ID);
+	_childCounts.push_back(0);
+
+	return id;
+}
+
+void EntityStore::destroy(EntityId id)
+{
+	if(!isValid(id))
+		return;
+
+	const uint32_t index = _idToIndex[id];
+	const uint32_t last = size()-1;
+	const EntityId parent = _hierarchies[index].parent;
+	if(parent != INVALID_ID && isValid(parent))
+		_childCounts[_idToIndex[parent]]--;
+	const bool hasChildren = _childCounts[index] > 0;
+
+	// Move last entity to the removed row
+	forEachArray([index, last](auto& array)
+	{
+		array[index] = array[last];
+		array.pop_back();
+	});
+	if(index < size())
+	{
+		_idToIndex[_indexToId[index]] = index;
+		// Still after its parent (the last row has no children when the order is valid)
+		const uint32_t parentIndex = _parentIndices[index];
+		if(!_orderDirty && ((parentIndex != INVALID_ID && parentIndex > index) || _childCounts[index] > 0))
+			_orderDirty = true;
+	}
+
+	_idToIndex[id] = INVALID_ID;
+	_freeIds.push_back(id);
+
+	// The children become roots now, before the id is reused
+	if(hasChildren)
+		sortHierarchy();
+}
+
+//---------- Transforms ----------//
+void EntityStore::setParent(EntityId id, EntityId parent)
+{
+	const uint32_t index = _idToIndex[id];
+	// No cycles
+	for(EntityId ancestor = parent; ancestor != INVALID_ID && isValid(ancestor); ancestor = getParent(ancestor))
+		if(ancestor == id)
+			return;
+
+	const EntityId oldParent = _hierarchies[index].parent;
+	if(oldParent != INVALID_ID && isValid(oldParent))
+		_childCounts[_idToIndex[oldParent]]--;
+
+	if(parent != INVALID_ID && isValid(parent))
+	{
+		_childCounts[_idToIndex[parent]]++;
+		_hierarchies[index].parent = parent;
+		_masks[index] |= Hierarchy::MASK;
+		if(_orderDirty || _idToIndex[parent] > index)
+			_orderDirty = true;
+		else
+			_parentIndices[index] = _idToIndex[parent];
+	}
+	else
+	{
+		_hierarchies[index].parent = INVALID_ID;
+		_masks[index] &= ~Hierarchy::MASK;
+		_parentIndices[index] = INVALID_ID;
+	}
+
+	// Same world pose under the new parent
+	if(_orderDirty)
+		sortHierarchy();
+	updateLocalPose(_idToIndex[id]);
+}
+
+void EntityStore::setWorldTransform(EntityId id, glm::vec3 position, glm::quat orientation, glm::vec3 scale)
+{
+	const uint32_t index = _idToIndex[id];
+	Transform& transform = _transforms[index];
+	transform.worldPosition = position;
+	transform.worldOrientation = orientation;
+	transform.scale = scale;
+	transform.world = composeWorld(position, orientation, scale);
+	transform.worldIT = glm::transpose(glm::inverse(transform.world));
+	_masks[index] |= Transform::MASK;
+	if(_orderDirty)
+		sortHierarchy();
+	updateLocalPose(_idToIndex[id]);
+	_transformFlags[_idToIndex[id]] |= LOCAL_DIRTY;
+}
+
+void EntityStore::setWorldPosition(EntityId id, glm::vec3 position)
+{
+	if(_orderDirty)
+		sortHierarchy();
+	const uint32_t index = _idToIndex[id];
+	_transforms[index].worldPosition = position;
+	updateLocalPose(index);
+	_transformFlags[index] |= LOCAL_DIRTY | MOVED;
+}
+
+void EntityStore::setWorldOrientation(EntityId id, glm::quat orientation)
+{
+	if(_orderDirty)
+		sortHierarchy();
+	const uint32_t index = _idToIndex[id];
+	_transforms[index].worldOrientation = orientation;
+	updateLocalPose(index);
+	_transformFlags[index] |= LOCAL_DIRTY | MOVED;
+}
+
+void EntityStore::setPhysicsPose(EntityId id, const glm::mat4& pose)
+{
+	const uint32_t index = _idToIndex[id];
+	Transform& transform = _transforms[index];
+
+	// Sleeping and static bodies keep their pose
+	glm::mat4 world = pose;
+	world[0] *= transform.scale.x;
+	world[1] *= transform.scale.y;
+	world[2] *= transform.scale.z;
+	if(world == transform.world)
+		return;
+
+	transform.world = world;
+	transform.worldPosition = glm::vec3(pose[3]);
+	transform.worldOrientation = glm::quat_cast(glm::mat3(pose));
+	_transformFlags[index] |= WORLD_SET;
+}
+
+void EntityStore::updateTransforms()
+{
+	if(_orderDirty)
+		sortHierarchy();
+	_movedBodies.clear();
+	_changedEntities.clear();
+
+	const uint32_t n = size();
+	for(uint32_t i=0; i<n; i++)
+	{
+		// Parent rows are before, their flags are already the result of this pass
+		const uint32_t parent = _parentIndices[i];
+		const uint8_t parentFlags = parent != INVALID_ID ? _transformFlags[parent] : 0;
+		const uint8_t flags = _transformFlags[i];
+		if(flags == 0 && !(parentFlags & CHANGED))
+			continue;
+
+		Transform& transform = _transforms[i];
+		const bool physics = (_masks[i] & PhysicsBody::MASK) != 0;
+		const bool moved = (flags & MOVED) || (parentFlags & SUBTREE_MOVED);
+		bool changed = false;
+		if((flags & LOCAL_DIRTY) || moved || (!physics && (parentFlags & CHANGED)))
+		{
+			// From the local pose (the user pose wins over the physics pose)
+			if(parent != INVALID_ID)
+			{
+				const Transform& parentTransform = _transforms[parent];
+				transform.worldOrientation = parentTransform.worldOrientation*transform.orientation;
+				transform.worldPosition = parentTransform.worldPosition + parentTransform.worldOrientation*transform.position;
+			}
+			else
+			{
+				transform.worldOrientation = transform.orientation;
+				transform.worldPosition = transform.position;
+			}
+			transform.world = composeWorld(transform.worldPosition, transform.worldOrientation, transform.scale);
+			changed = true;
+
+			if(physics && moved)
+				_movedBodies.push_back(_indexToId[i]);
+		}
+		else
+		{
+			// Simulated pose (already in world), the local pose relative to the moving parent
+			// is kept for the next user move
+			changed = (flags & WORLD_SET) != 0;
+			if(changed || (parentFlags & CHANGED))
+				updateLocalPose(i);
+		}
+
+		if(changed)
+		{
+			transform.worldIT = glm::transpose(glm::inverse(transform.world));
+			_changedEntities.push_back(_indexToId[i]);
+		}
+		_transformFlags[i] = (changed ? CHANGED : 0) | (moved ? SUBTREE_MOVED : 0);
+	}
+}
+
+void EntityStore::updateLocalPose(uint32_t index)
+{
+	Transform& transform = _transforms[index];
+	const uint32_t parent = _parentIndices[index];
+	if(parent == INVALID_ID)
+	{
+		transform.position = transform.worldPosition;
+		transform.orientation = transform.worldOrientation;
+		return;
+	}
+
+	const Transform& parentTransform = _transforms[parent];
+	const glm::quat inverse = glm::conjugate(parentTransform.worldOrientation);
+	transform.orientation = inverse*transform.worldOrientation;
+	transform.position = inverse*(transform.worldPosition - parentTransform.worldPosition);
+}
+
+void EntityStore::sortHierarchy()
+{
+	const uint32_t n = size();
+
+	// Depth of each row (entities whose parent was destroyed become roots)
+	std::vector<uint32_t> depth(n, (uint32_t)INVALID_ID);
+	for(uint32_t i=0; i<n; i++)
+	{
+		EntityId parent = _hierarchies[i].parent;
+		if(parent != INVALID_ID && !isValid(parent))
+		{
+			_hierarchies[i].parent = INVALID_ID;
+			_masks[i] &= ~Hierarchy::MASK;
+			_transforms[i].position = _transforms[i].worldPosition;
+			_transforms[i].orientation = _transforms[i].worldOrientation;
+		}
+	}
+	for(uint32_t i=0; i<n; i++)
+	{
+		// Walk up to a row with a known depth
+		uint32_t row = i;
+		uint32_t steps = 0;
+		while(depth[row] == INVALID_ID && _hierarchies[row].parent != INVALID_ID)
+		{
+			row = _idToIndex[_hierarchies[row].parent];
+			steps++;
+		}
+		uint32_t rowDepth = depth[row] == INVALID_ID ? 0 : depth[row];
+		depth[row] = rowDepth;
+
+		// And down again
+		row = i;
+		for(uint32_t s=steps; s>0; s--)
+		{
+			depth[row] = rowDepth + s;
+			row = _idToIndex[_hierarchies[row].parent];
+		}
+	}
+
+	// Stable, the rows of the same depth keep their order
+	std::vector<uint32_t> order(n);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&depth](uint32_t a, uint32_t b){ return depth[a] < depth[b]; });
+
+	forEachArray([&order, n](auto& array)
+	{
+		auto sorted = array;
+		for(uint32_t i=0; i<n; i++)
+			sorted[i] = array[order[i]];
+		array.swap(sorted);
+	});
+	for(uint32_t i=0; i<n; i++)
+		_idToIndex[_indexToId[i]] = i;
+	std::fill(_childCounts.begin(), _childCounts.end(), 0);
+	for(uint32_t i=0; i<n; i++)
+	{
+		const EntityId parent = _hierarchies[i].parent;
+		_parentIndices[i] = parent != INVALID_ID ? _idToIndex[parent] : INVALID_ID;
+		if(parent != INVALID_ID)
+			_childCounts[_parentIndices[i]]++;
+	}
+	_orderDirty = false;
+}
@@ -0,0 +1,218 @@
+//--------------------------------------------------
+// Robot Simulator
+// entityStore.h
+// Date: 2020-12-07
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef ENTITY_STORE_H
+#define ENTITY_STORE_H
+
+#include <vector>
+#include <cstdint>
+#include "glm.h"
+#include <glm/gtc/quaternion.hpp>
+#include "physics/bodyStore.h"
+
+class Object;
+class ObjectPhysics;
+
+// Components of the scene objects in dense arrays, one row per entity (same layout as
+// the BodyStore: stable ids, dense rows that are swap-removed). Each row has a mask of
+// the components it has, the per-frame passes iterate the rows with forEach instead of
+// asking every object what it is.
+//
+// The transforms form a hierarchy: the parents are always in rows before their children
+// (the rows are sorted breadth-first when a change breaks it), so updateTransforms finds
+// every world transform in one pass. Only the rows that were changed, and their
+// subtrees, are recomputed.
+class EntityStore
+{
+	public:
+		typedef uint32_t EntityId;
+		static const EntityId INVALID_ID = 0xFFFFFFFF;
+
+		//---------- Components ----------//
+		// Written through the setters below (they mark the rows to update)
+		struct Transform
+		{
+			static const uint32_t MASK = 1<<0;
+			// Relative to the parent (world for the roots)
+			glm::vec3 position = {0,0,0};
+			glm::quat orientation = {1,0,0,0};
+			// Size of the entity, not inherited by the children
+			glm::vec3 scale = {1,1,1};
+			// Cached by updateTransforms
+			glm::vec3 worldPosition = {0,0,0};
+			glm::quat worldOrientation = {1,0,0,0};
+			// Model matrix (with the scale) and its inverse transpose (normals)
+			glm::mat4 world = glm::mat4(1.0f);
+			glm::mat4 worldIT = glm::mat4(1.0f);
+		};
+
+		// Range of the model in the scene vertex/index buffers
+		struct RenderMesh
+		{
+			static const uint32_t MASK = 1<<1;
+			int modelIndex = -1;
+			uint32_t vertexOffset = 0;
+			uint32_t indexOffset = 0;
+			uint32_t indexCount = 0;
+			// Element of the scene instance buffer (INVALID_ID until the buffers are created)
+			uint32_t instance = INVALID_ID;
+		};
+
+		struct Color
+		{
+			static const uint32_t MASK = 1<<2;
+			// Zero uses the material color
+			glm::vec3 value = {0,0,0};
+		};
+
+		struct PhysicsBody
+		{
+			static const uint32_t MASK = 1<<3;
+			ObjectPhysics* body = nullptr;
+			BodyStore::BodyId id = BodyStore::INVALID_ID;
+		};
+
+		// Set with setParent
+		struct Hierarchy
+		{
+			static const uint32_t MASK = 1<<4;
+			EntityId parent = INVALID_ID;
+		};
+
+		EntityStore();
+		~EntityStore();
+
+		// The object is the facade of the entity (not owned)
+		EntityId create(Object* object);
+		void destroy(EntityId id);
+		bool isValid(EntityId id) const { return id < _idToIndex.size() && _idToIndex[id] != INVALID_ID; }
+
+		template <typename T>
+		void add(EntityId id, const T& component)
+		{
+			const uint32_t index = _idToIndex[id];
+			getArray<T>()[index] = component;
+			_masks[index] |= T::MASK;
+		}
+
+		template <typename T>
+		void remove(EntityId id) { _masks[_idToIndex[id]] &= ~T::MASK; }
+
+		template <typename T>
+		bool has(EntityId id) const { return (_masks[_idToIndex[id]] & T::MASK) != 0; }
+
+		template <typename T>
+		T& get(EntityId id) { return getArray<T>()[_idToIndex[id]]; }
+
+		template <typename T>
+		const T& get(EntityId id) const { return const_cast<EntityStore*>(this)->getArray<T>()[_idToIndex[id]]; }
+
+		//---------- Transforms ----------//
+		// The world pose of the entity is kept
+		void setParent(EntityId id, EntityId parent);
+		EntityId getParent(EntityId id) const { return _hierarchies[_idToIndex[id]].parent; }
+		// World pose of an entity that was just created (computed immediately)
+		void setWorldTransform(EntityId id, glm::vec3 position, glm::quat orientation, glm::vec3 scale);
+		// Move the entity and its subtree (the physics bodies of the subtree are teleported,
+		// see getMovedBodies)
+		void setWorldPosition(EntityId id, glm::vec3 position);
+		void setWorldOrientation(EntityId id, glm::quat orientation);
+		// World pose simulated by the physics engine, the children without physics follow it
+		void setPhysicsPose(EntityId id, const glm::mat4& pose);
+		// World transforms of the changed rows and their subtrees
+		void updateTransforms();
+		// Entities with physics moved by the last updateTransforms because they (or some
+		// ancestor) were moved with setWorldPosition/setWorldOrientation
+		const std::vector<EntityId>& getMovedBodies() const { return _movedBodies; }
+		// Entities whose world transform was recomputed by the last updateTransforms
+		const std::vector<EntityId>& getChangedEntities() const { return _changedEntities; }
+
+		// Calls f(id, components&...) for every entity with all the components, in row order
+		template <typename... T, typename F>
+		void forEach(F f)
+		{
+			const uint32_t mask = (T::MASK | ... | 0u);
+			const uint32_t n = size();
+			for(uint32_t i=0; i<n; i++)
+				if((_masks[i] & mask) == mask)
+					f(_indexToId[i], getArray<T>()[i]...);
+		}
+
+		//---------- Getters ----------//
+		uint32_t size() const { return (uint32_t)_indexToId.size(); }
+		uint32_t getIndex(EntityId id) const { return _idToIndex[id]; }
+		EntityId getId(uint32_t index) const { return _indexToId[index]; }
+		Object* getObject(EntityId id) const { return _objects[_idToIndex[id]]; }
+
+	private:
+		enum TransformFlags : uint8_t
+		{
+			// Set between the passes
+			// Local pose set by the user
+			LOCAL_DIRTY = 1<<0,
+			// World pose set by the physics
+			WORLD_SET = 1<<1,
+			// Moved by the user with its subtree
+			MOVED = 1<<2,
+			// Result of the last pass (read by the children)
+			CHANGED = 1<<3,
+			SUBTREE_MOVED = 1<<4
+		};
+
+		template <typename T>
+		std::vector<T>& getArray();
+
+		// Rows in breadth-first order of the trees, and their parent rows
+		void sortHierarchy();
+		// Local pose from the world pose and the parent world pose
+		void updateLocalPose(uint32_t index);
+
+		template <typename F>
+		void forEachArray(F f)
+		{
+			f(_indexToId);
+			f(_objects);
+			f(_masks);
+			f(_transformFlags);
+			f(_transforms);
+			f(_meshes);
+			f(_colors);
+			f(_bodies);
+			f(_hierarchies);
+			f(_parentIndices);
+			f(_childCounts);
+		}
+
+		// Id -> row (INVALID_ID when destroyed)
+		std::vector<uint32_t> _idToIndex;
+		std::vector<EntityId> _freeIds;
+
+		// One entry per row
+		std::vector<EntityId> _indexToId;
+		std::vector<Object*> _objects;
+		std::vector<uint32_t> _masks;
+		std::vector<uint8_t> _transformFlags;
+		std::vector<Transform> _transforms;
+		std::vector<RenderMesh> _meshes;
+		std::vector<Color> _colors;
+		std::vector<PhysicsBody> _bodies;
+		std::vector<Hierarchy> _hierarchies;
+		// Row of the parent (INVALID_ID for the roots), valid when the order is not dirty
+		std::vector<uint32_t> _parentIndices;
+		// Children of the row (a destroyed parent breaks the order)
+		std::vector<uint32_t> _childCounts;
+		bool _orderDirty;
+		std::vector<EntityId> _movedBodies;
+		std::vector<EntityId> _changedEntities;
+};
+
+template <> inline std::vector<EntityStore::Transform>& EntityStore::getArray() { return _transforms; }
+template <> inline std::vector<EntityStore::RenderMesh>& EntityStore::getArray() { return _meshes; }
+template <> inline std::vector<EntityStore::Color>& EntityStore::getArray() { return _colors; }
+template <> inline std::vector<EntityStore::PhysicsBody>& EntityStore::getArray() { return _bodies; }
+template <> inline std::vector<EntityStore::Hierarchy>& EntityStore::getArray() { return _hierarchies; }
+
+#endif// ENTITY_STORE_H
@@ -0,0 +1,132 @@
+//--------------------------------------------------
+// Robot Simulator
+// headlessSimulator.cpp
+// Date: 2020-12-01
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#include "headlessSimulator.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include "objects/basic/box.h"
+#include "objects/basic/cylinder.h"
+#include "objects/basic/sphere.h"
+#include "objects/sensors/lidar/lidar.h"
+
+HeadlessSimulator::HeadlessSimulator(Config config):
+	_config(config)
+{
+	_scene = new Scene();
+	PhysicsEngine* engine = _scene->getPhysicsEngine();
+	engine->setFixedTimeStep(_config.timeStep);
+	engine->setThreadCount(_config.threadCount);
+	engine->setDeterministic(_config.deterministic);
+
+	// Same world as the simulator window
+	Box* ground = new Box("Ground", {0,-1,0}, {0,0,0}, {200, 2, 200}, 0.0f, {0.8,0.8,0.8});
+	Cylinder* test1 = new Cylinder("Cylinder", {0,1,0}, {0,0,0}, {0.5, 0.5,0.5}, 1.1f, {0.8,0.8,0.8});
+	Sphere* test2 = new Sphere("Sphere", {0,0.5,0}, {0,0,0}, 0.2, 1.1f, {0.8,0.5,0.2});
+	test2->getObjectPhysics()->setCcdEnabled(true);
+	_ttzinho = new Ttzinho();
+
+	_scene->addObject((Object*)ground);
+	_scene->addComplexObject(_ttzinho->getObject());
+	_scene->addObject((Object*)test1);
+	_scene->addObject((Object*)test2);
+	_scene->linkObjects();
+
+	_ttzinho->setWheelVelocities(_config.wheelVelocityLeft, _config.wheelVelocityRight);
+}
+
+HeadlessSimulator::~HeadlessSimulator()
+{
+	if(_scene != nullptr)
+	{
+		delete _scene;
+		_scene = nullptr;
+	}
+
+	if(_ttzinho != nullptr)
+	{
+		delete _ttzinho;
+		_ttzinho = nullptr;
+	}
+}
+
+HeadlessSimulator::Metrics HeadlessSimulator::run()
+{
+	typedef std::chrono::steady_clock Clock;
+	PhysicsEngine* engine = _scene->getPhysicsEngine();
+	const ObjectPhysics* robot = _ttzinho->getObject()->getObjectPhysics();
+	const float dt = _config.timeStep;
+
+	Metrics metrics;
+	metrics.steps = (uint64_t)std::max(std::llround(_config.duration/dt), 0ll);
+	metrics.bodyCount = engine->getBodyStore()->size();
+	metrics.robotStart = robot->getPosition();
+
+	uint64_t contacts = 0;
+	const Clock::time_point begin = Clock::now();
+	for(uint64_t i=0; i<metrics.steps; i++)
+	{
+		const Clock::time_point stepBegin = Clock::now();
+		_scene->stepPhysics(dt);
+		const double stepTime = std::chrono::duration<double>(Clock::now() - stepBegin).count();
+
+		metrics.maxStepTime = std::max(metrics.maxStepTime, stepTime);
+		contacts += engine->getContactManifolds().size();
+	}
+	metrics.wallTime = std::chrono::duration<double>(Clock::now() - begin).count();
+
+	metrics.simulatedTime = metrics.steps*(double)dt;
+	if(metrics.wallTime > 0)
+		metrics.realTimeFactor = metrics.simulatedTime/metrics.wallTime;
+	if(metrics.steps > 0)
+	{
+		metrics.meanStepTime = metrics.wallTime/metrics.steps;
+		metrics.meanContacts = contacts/(double)metrics.steps;
+	}
+	for(auto object : _scene->getObjects())
+		if(object->getType() == "Lidar")
+			metrics.lidarScans += ((Lidar*)object)->getScanIndex();
+	metrics.robotEnd = robot->getPosition();
+	metrics.stateHash = engine->computeStateHash();
+	return metrics;
+}
+
+bool HeadlessSimulator::writeMetrics(const Metrics& metrics, const std::string& fileName)
+{
+	FILE* file = fopen(fileName.c_str(), "w");
+	if(file == nullptr)
+		return false;
+
+	fprintf(file, "{\n");
+	fprintf(file, "\t\"steps\": %llu,\n", (unsigned long long)metrics.steps);
+	fprintf(file, "\t\"simulatedTime\": %.9g,\n", metrics.simulatedTime);
+	fprintf(file, "\t\"wallTime\": %.9g,\n", metrics.wallTime);
+	fprintf(file, "\t\"realTimeFactor\": %.9g,\n", metrics.realTimeFactor);
+	fprintf(file, "\t\"meanStepTime\": %.9g,\n", metrics.meanStepTime);
+	fprintf(file, "\t\"maxStepTime\": %.9g,\n", metrics.maxStepTime);
+	fprintf(file, "\t\"bodyCount\": %u,\n", metrics.bodyCount);
+	fprintf(file, "\t\"meanContacts\": %.9g,\n", metrics.meanContacts);
+	fprintf(file, "\t\"lidarScans\": %llu,\n", (unsigned long long)metrics.lidarScans);
+	fprintf(file, "\t\"robotStart\": [%.9g, %.9g, %.9g],\n", metrics.robotStart.x, metrics.robotStart.y, metrics.robotStart.z);
+	fprintf(file, "\t\"robotEnd\": [%.9g, %.9g, %.9g],\n", metrics.robotEnd.x, metrics.robotEnd.y, metrics.robotEnd.z);
+	fprintf(file, "\t\"stateHash\": \"%016llx\"\n", (unsigned long long)metrics.stateHash);
+	fprintf(file, "}\n");
+	return fclose(file) == 0;
+}
+
+void HeadlessSimulator::printMetrics(const Metrics& metrics)
+{
+	printf("Simulated %.3f s (%llu steps) in %.3f s: %.1fx real time\n",
+			metrics.simulatedTime, (unsigned long long)metrics.steps, metrics.wallTime, metrics.realTimeFactor);
+	printf("Step time: mean %.2f us, max %.2f us\n", metrics.meanStepTime*1e6, metrics.maxStepTime*1e6);
+	printf("Bodies %u, mean contacts %.1f, lidar scans %llu\n",
+			metrics.bodyCount, metrics.meanContacts, (unsigned long long)metrics.lidarScans);
+	printf("Robot (%.3f, %.3f, %.3f) -> (%.3f, %.3f, %.3f)\n",
+			metrics.robotStart.x, metrics.robotStart.y, metrics.robotStart.z,
+			metrics.robotEnd.x, metrics.robotEnd.y, metrics.robotEnd.z);
+	printf("State hash %016llx\n", (unsigned long long)metrics.stateHash);
+}
@@ -0,0 +1,69 @@
+//--------------------------------------------------
+// Robot Simulator
+// headlessSimulator.h
+// Date: 2020-12-01
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef HEADLESS_SIMULATOR_H
+#define HEADLESS_SIMULATOR_H
+
+#include <string>
+#include <vector>
+#include "scene.h"
+#include "demo/ttzinho/ttzinho.h"
+
+// Simulation without window nor Vulkan (built with HEADLESS). The scene is
+// stepped as fast as the CPU allows for a simulated duration and the run is
+// summarized in a few metrics, for parameter sweeps on machines without GPU.
+class HeadlessSimulator
+{
+	public:
+		struct Config
+		{
+			// Simulated time (s)
+			float duration = 10.0f;
+			float timeStep = 0.001f;
+			// Physics threads of this run (sweeps usually run one process per core)
+			int threadCount = 1;
+			bool deterministic = false;
+			// Wheel speed targets of the robot (rad/s)
+			float wheelVelocityLeft = 0.0f;
+			float wheelVelocityRight = 0.0f;
+		};
+
+		struct Metrics
+		{
+			uint64_t steps = 0;
+			double simulatedTime = 0.0;
+			double wallTime = 0.0;
+			// Simulated seconds per wall clock second
+			double realTimeFactor = 0.0;
+			double meanStepTime = 0.0;
+			double maxStepTime = 0.0;
+			uint32_t bodyCount = 0;
+			double meanContacts = 0.0;
+			uint64_t lidarScans = 0;
+			glm::vec3 robotStart = {0,0,0};
+			glm::vec3 robotEnd = {0,0,0};
+			uint64_t stateHash = 0;
+		};
+
+		HeadlessSimulator(Config config);
+		~HeadlessSimulator();
+
+		Metrics run();
+		// One JSON object per run (easy to gather from many runs)
+		static bool writeMetrics(const Metrics& metrics, const std::string& fileName);
+		static void printMetrics(const Metrics& metrics);
+
+		//---------- Getters ----------//
+		Scene* getScene() const { return _scene; }
+		Config getConfig() const { return _config; }
+
+	private:
+		Config _config;
+		Scene* _scene;
+		Ttzinho* _ttzinho;
+};
+
+#endif// HEADLESS_SIMULATOR_H
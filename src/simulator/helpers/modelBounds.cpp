@@ -0,0 +1,62 @@
+//--------------------------------------------------
+// Robot Simulator
+// modelBounds.cpp
+// Date: 2020-12-12
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#include "modelBounds.h"
+#include <fstream>
+#include <sstream>
+#include <limits>
+#include "log.h"
+
+std::mutex ModelBounds::_mutex;
+std::map<std::string, glm::vec3> ModelBounds::_halfExtents;
+
+bool ModelBounds::getHalfExtents(const std::string& modelName, glm::vec3& halfExtents)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto it = _halfExtents.find(modelName);
+	if(it != _halfExtents.end())
+	{
+		halfExtents = it->second;
+		return true;
+	}
+
+	const std::string modelPath = "assets/models/"+modelName+"/"+modelName+".obj";
+	std::ifstream file(modelPath);
+	if(!file.is_open())
+	{
+		Log::warning("ModelBounds", "Failed to open " + modelPath);
+		return false;
+	}
+
+	// Only the positions ("v x y z")
+	glm::vec3 min(std::numeric_limits<float>::max());
+	glm::vec3 max(-std::numeric_limits<float>::max());
+	bool hasVertex = false;
+	std::string line;
+	while(std::getline(file, line))
+	{
+		if(line.size() < 2 || line[0] != 'v' || (line[1] != ' ' && line[1] != '\t'))
+			continue;
+
+		std::istringstream stream(line.substr(2));
+		glm::vec3 position;
+		if(!(stream >> position.x >> position.y >> position.z))
+			continue;
+		min = glm::min(min, position);
+		max = glm::max(max, position);
+		hasVertex = true;
+	}
+
+	if(!hasVertex)
+	{
+		Log::warning("ModelBounds", "No vertices in " + modelPath);
+		return false;
+	}
+
+	halfExtents = (max - min)*0.5f;
+	_halfExtents[modelName] = halfExtents;
+	return true;
+}
@@ -0,0 +1,29 @@
+//--------------------------------------------------
+// Robot Simulator
+// modelBounds.h
+// Date: 2020-12-12
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef MODEL_BOUNDS_H
+#define MODEL_BOUNDS_H
+
+#include <string>
+#include <map>
+#include <mutex>
+#include "glm.h"
+
+// Axis aligned bounds of the model files, read from the vertex positions of the obj (no
+// Model is loaded, also used by the headless build). Cached per file, thread-safe.
+class ModelBounds
+{
+	public:
+		// Half size of the bounds of assets/models/<name>/<name>.obj, false if it can't be read
+		static bool getHalfExtents(const std::string& modelName, glm::vec3& halfExtents);
+
+	private:
+		static std::mutex _mutex;
+		// Not cached when the file can't be read
+		static std::map<std::string, glm::vec3> _halfExtents;
+};
+
+#endif// MODEL_BOUNDS_H
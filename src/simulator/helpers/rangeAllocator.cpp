@@ -0,0 +1,99 @@
+//--------------------------------------------------
+// Robot Simulator
+// rangeAllocator.cpp
+// Date: 2020-12-09
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#include "rangeAllocator.h"
+#include <iterator>
+
+RangeAllocator::RangeAllocator(uint32_t capacity):
+	_capacity(0), _allocatedCount(0)
+{
+	grow(capacity);
+}
+
+RangeAllocator::~RangeAllocator()
+{
+}
+
+uint32_t RangeAllocator::allocate(uint32_t count)
+{
+	if(count == 0)
+		return INVALID_OFFSET;
+
+	for(auto it = _freeRanges.begin(); it != _freeRanges.end(); it++)
+	{
+		if(it->second < count)
+			continue;
+
+		const uint32_t offset = it->first;
+		const uint32_t remaining = it->second - count;
+		_freeRanges.erase(it);
+		if(remaining > 0)
+			_freeRanges[offset + count] = remaining;
+		_allocatedCount += count;
+		return offset;
+	}
+	return INVALID_OFFSET;
+}
+
+void RangeAllocator::free(uint32_t offset, uint32_t count)
+{
+	if(count == 0 || offset == INVALID_OFFSET)
+		return;
+	_allocatedCount -= count;
+
+	// Merge with the next free range
+	auto next = _freeRanges.find(offset + count);
+	if(next != _freeRanges.end())
+	{
+		count += next->second;
+		_freeRanges.erase(next);
+	}
+
+	// And with the previous one
+	auto it = _freeRanges.lower_bound(offset);
+	if(it != _freeRanges.begin())
+	{
+		auto prev = std::prev(it);
+		if(prev->first + prev->second == offset)
+		{
+			prev->second += count;
+			return;
+		}
+	}
+	_freeRanges[offset] = count;
+}
+
+void RangeAllocator::grow(uint32_t capacity)
+{
+	if(capacity <= _capacity)
+		return;
+
+	const uint32_t oldCapacity = _capacity;
+	_capacity = capacity;
+	// The new elements are free (merged with a free range at the end)
+	_allocatedCount += capacity - oldCapacity;
+	free(oldCapacity, capacity - oldCapacity);
+}
+
+void RangeAllocator::clear()
+{
+	_freeRanges.clear();
+	_allocatedCount = 0;
+	if(_capacity > 0)
+		_freeRanges[0] = _capacity;
+}
+
+uint32_t RangeAllocator::getUsedEnd() const
+{
+	if(_freeRanges.empty())
+		return _capacity;
+
+	// Free range that reaches the end of the block
+	const auto last = std::prev(_freeRanges.end());
+	if(last->first + last->second == _capacity)
+		return last->first;
+	return _capacity;
+}
@@ -0,0 +1,46 @@
+//--------------------------------------------------
+// Robot Simulator
+// rangeAllocator.h
+// Date: 2020-12-09
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef RANGE_ALLOCATOR_H
+#define RANGE_ALLOCATOR_H
+
+#include <map>
+#include <cstdint>
+
+// Ranges of elements inside a bigger block (e.g. the meshes inside the scene vertex buffer).
+// The free ranges are kept sorted by offset, allocate takes the first one that fits and free
+// merges the range with its free neighbours. Only the bookkeeping, the block memory is
+// managed by the user.
+class RangeAllocator
+{
+	public:
+		static const uint32_t INVALID_OFFSET = 0xFFFFFFFF;
+
+		RangeAllocator(uint32_t capacity=0);
+		~RangeAllocator();
+
+		// First element of the range, INVALID_OFFSET if no free range fits
+		uint32_t allocate(uint32_t count);
+		void free(uint32_t offset, uint32_t count);
+		// More elements at the end of the block (the allocated ranges don't move)
+		void grow(uint32_t capacity);
+		void clear();
+
+		//---------- Getters ----------//
+		uint32_t getCapacity() const { return _capacity; }
+		uint32_t getAllocatedCount() const { return _allocatedCount; }
+		// End of the last allocated range
+		uint32_t getUsedEnd() const;
+		uint32_t getFreeRangeCount() const { return (uint32_t)_freeRanges.size(); }
+
+	private:
+		// Offset -> count
+		std::map<uint32_t, uint32_t> _freeRanges;
+		uint32_t _capacity;
+		uint32_t _allocatedCount;
+};
+
+#endif// RANGE_ALLOCATOR_H
@@ -0,0 +1,155 @@
+//--------------------------------------------------
+// Robot Simulator
+// threadPool.cpp
+// Date: 2020-11-20
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#include "threadPool.h"
+#include <algorithm>
+
+// Pool and queue of the worker running on this thread
+static thread_local const ThreadPool* currentPool = nullptr;
+static thread_local int currentIndex = 0;
+
+ThreadPool::ThreadPool(int threadCount):
+	_queuedTasks(0), _running(true)
+{
+	if(threadCount <= 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	// Queue 0 belongs to the threads calling parallelFor
+	for(int i=0; i<threadCount; i++)
+		_workers.push_back(new Worker());
+	for(int i=1; i<threadCount; i++)
+		_threads.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+		_running = false;
+	}
+	_sleepCondition.notify_all();
+
+	for(auto& thread : _threads)
+		thread.join();
+	_threads.clear();
+
+	for(auto worker : _workers)
+	{
+		if(worker != nullptr)
+		{
+			delete worker;
+			worker = nullptr;
+		}
+	}
+	_workers.clear();
+}
+
+void ThreadPool::parallelFor(uint32_t count, uint32_t grainSize, const RangeFunction& function)
+{
+	if(count == 0)
+		return;
+
+	grainSize = std::max(grainSize, 1u);
+	const uint32_t threadCount = (uint32_t)_workers.size();
+	if(threadCount == 1 || count <= grainSize)
+	{
+		function(0, count);
+		return;
+	}
+
+	// A few chunks per thread so the stealing can balance uneven work
+	uint32_t chunkCount = std::min((count+grainSize-1)/grainSize, threadCount*4);
+	const uint32_t chunkSize = (count+chunkCount-1)/chunkCount;
+	chunkCount = (count+chunkSize-1)/chunkSize;
+
+	std::atomic<uint32_t> pending(chunkCount);
+	const int index = getCurrentIndex();
+	for(uint32_t c=0; c<chunkCount; c++)
+	{
+		Task task = {&function, c*chunkSize, std::min(count, (c+1)*chunkSize), &pending};
+		Worker* worker = _workers[(index+c)%threadCount];
+		std::lock_guard<std::mutex> lock(worker->mutex);
+		worker->tasks.push_back(task);
+	}
+	_queuedTasks += chunkCount;
+	{
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+	}
+	_sleepCondition.notify_all();
+
+	// Help until every chunk of this loop is done
+	Task task;
+	while(pending.load(std::memory_order_acquire) > 0)
+	{
+		if(popTask(index, task) || stealTask(index, task))
+			runTask(task);
+		else
+			std::this_thread::yield();
+	}
+}
+
+void ThreadPool::workerLoop(int index)
+{
+	currentPool = this;
+	currentIndex = index;
+
+	Task task;
+	while(true)
+	{
+		if(popTask(index, task) || stealTask(index, task))
+		{
+			runTask(task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(_sleepMutex);
+		_sleepCondition.wait(lock, [this]{ return _queuedTasks.load() > 0 || !_running; });
+		if(!_running)
+			return;
+	}
+}
+
+bool ThreadPool::popTask(int index, Task& task)
+{
+	Worker* worker = _workers[index];
+	std::lock_guard<std::mutex> lock(worker->mutex);
+	if(worker->tasks.empty())
+		return false;
+
+	task = worker->tasks.back();
+	worker->tasks.pop_back();
+	_queuedTasks--;
+	return true;
+}
+
+bool ThreadPool::stealTask(int index, Task& task)
+{
+	const int threadCount = (int)_workers.size();
+	for(int i=1; i<threadCount; i++)
+	{
+		Worker* worker = _workers[(index+i)%threadCount];
+		std::lock_guard<std::mutex> lock(worker->mutex);
+		if(worker->tasks.empty())
+			continue;
+
+		task = worker->tasks.front();
+		worker->tasks.pop_front();
+		_queuedTasks--;
+		return true;
+	}
+	return false;
+}
+
+void ThreadPool::runTask(const Task& task)
+{
+	(*task.function)(task.begin, task.end);
+	task.pending->fetch_sub(1, std::memory_order_release);
+}
+
+int ThreadPool::getCurrentIndex() const
+{
+	return currentPool == this ? currentIndex : 0;
+}
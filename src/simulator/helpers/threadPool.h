@@ -0,0 +1,69 @@
+//--------------------------------------------------
+// Robot Simulator
+// threadPool.h
+// Date: 2020-11-20
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+// Work-stealing thread pool used for data parallel loops.
+// Each worker has its own deque: the owner pops from the back and idle
+// workers steal from the front. The thread calling parallelFor helps
+// with the work until its loop is finished, so nested calls do not deadlock.
+class ThreadPool
+{
+	public:
+		typedef std::function<void(uint32_t begin, uint32_t end)> RangeFunction;
+
+		// threadCount includes the calling thread (0 uses all the cores)
+		ThreadPool(int threadCount=0);
+		~ThreadPool();
+
+		// Split [0, count) in chunks of at least grainSize and run them on the workers
+		void parallelFor(uint32_t count, uint32_t grainSize, const RangeFunction& function);
+
+		//---------- Getters ----------//
+		int getThreadCount() const { return (int)_workers.size(); }
+
+	private:
+		struct Task
+		{
+			const RangeFunction* function;
+			uint32_t begin;
+			uint32_t end;
+			std::atomic<uint32_t>* pending;
+		};
+
+		struct Worker
+		{
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+
+		void workerLoop(int index);
+		bool popTask(int index, Task& task);
+		bool stealTask(int index, Task& task);
+		void runTask(const Task& task);
+		// Worker queue of the current thread (external threads share queue 0)
+		int getCurrentIndex() const;
+
+		std::vector<Worker*> _workers;
+		std::vector<std::thread> _threads;
+
+		std::mutex _sleepMutex;
+		std::condition_variable _sleepCondition;
+		std::atomic<int> _queuedTasks;
+		bool _running;
+};
+
+#endif// THREAD_POOL_H
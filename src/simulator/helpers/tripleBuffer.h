@@ -0,0 +1,55 @@
+//--------------------------------------------------
+// Robot Simulator
+// tripleBuffer.h
+// Date: 2020-11-30
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single producer/single consumer exchange of the latest value.
+// The writer fills its buffer and publishes it, the reader always gets the
+// last published buffer. Neither side waits for the other: the third buffer
+// is the one waiting to be read, swapped atomically by both sides.
+template <typename T>
+class TripleBuffer
+{
+	public:
+		TripleBuffer():
+			_middle(1), _write(0), _read(2)
+		{
+		}
+
+		//---------- Writer ----------//
+		T& getWriteBuffer() { return _buffers[_write]; }
+		// The write buffer becomes the latest value, the writer continues in another buffer
+		void publish()
+		{
+			_write = _middle.exchange(_write | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+		}
+
+		//---------- Reader ----------//
+		// Latest published value (the same buffer until a newer one is published)
+		const T& read()
+		{
+			if(_middle.load(std::memory_order_relaxed) & FRESH)
+				_read = _middle.exchange(_read, std::memory_order_acq_rel) & INDEX_MASK;
+			return _buffers[_read];
+		}
+		bool hasNewValue() const { return (_middle.load(std::memory_order_relaxed) & FRESH) != 0; }
+
+	private:
+		static const uint8_t INDEX_MASK = 3;
+		static const uint8_t FRESH = 4;
+
+		T _buffers[3];
+		// Index of the buffer between the writer and the reader, FRESH if it was not read yet
+		std::atomic<uint8_t> _middle;
+		uint8_t _write;
+		uint8_t _read;
+};
+
+#endif// TRIPLE_BUFFER_H
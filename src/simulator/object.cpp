@@ -6,6 +6,7 @@
 //--------------------------------------------------
 #include "object.h"
 #include <iostream>
+#include <cmath>
 
 int Object::_qtyIds = 0;
 Object::Object(std::string name, glm::vec3 position, glm::vec3 rotation, glm::vec3 scale, float mass):
@@ -14,11 +15,13 @@ Object::Object(std::string name, glm::vec3 position, glm::vec3 rotation, glm::ve
 	_id = _qtyIds++;
 
 	_physics = nullptr;
-	_model = nullptr;
 
 	_static = _mass > 0;
 	_parent = nullptr;
 	_parentConstraint = nullptr;
+	_color = {0,0,0};
+	_entities = nullptr;
+	_entity = EntityStore::INVALID_ID;
 }
 
 Object::~Object()
@@ -29,12 +32,6 @@ Object::~Object()
 		_physics = nullptr;
 	}
 
-	if(_model != nullptr)
-	{
-		delete _model;
-		_model = nullptr;
-	}
-
 	if(_parentConstraint != nullptr)
 	{
 		delete _parentConstraint;
@@ -42,29 +39,45 @@ Object::~Object()
 	}
 }
 
+glm::vec3 Object::getPosition() const
+{
+	if(_entities != nullptr)
+		return _entities->get<EntityStore::Transform>(_entity).worldPosition;
+	return _position;
+}
+
 glm::vec3 Object::getRotation()
 {
-	if(_physics != nullptr)
+	if(_entities != nullptr)
+	{
+		_rotation = glm::degrees(glm::eulerAngles(_entities->get<EntityStore::Transform>(_entity).worldOrientation));
+	}
+	else if(_physics != nullptr)
 	{
-		_rotation = glm::vec3(0,0,0);//_physics->getRotation();
+		_rotation = glm::degrees(glm::eulerAngles(_physics->getOrientation()));
 	}
 	return _rotation;
 }
 
 glm::mat4 Object::getModelMat()
 {
-	if(_physics != nullptr)
+	if(_entities != nullptr)
 	{
-		_position = _physics->getPosition();
-		_rotation = glm::vec3(0,0,0);//_physics->getRotation();
+		// Cached by the scene once per frame (see Scene::updatePhysics)
+		return _entities->get<EntityStore::Transform>(_entity).world;
 	}
 
 	glm::mat4 mat = glm::mat4(1);
-	
-	mat = glm::translate(mat, _position);
-	//mat = glm::rotate(mat, glm::radians(_rotation.z), glm::vec3(0, 0, 1));
-	//mat = glm::rotate(mat, glm::radians(_rotation.y), glm::vec3(0, 1, 0));
-	//mat = glm::rotate(mat, glm::radians(_rotation.x), glm::vec3(1, 0, 0));
+	if(_physics != nullptr)
+	{
+		mat = _physics->getRenderTransform();
+		_position = glm::vec3(mat[3]);
+	}
+	else
+	{
+		mat = glm::translate(mat, _position);
+		mat = mat*glm::mat4_cast(glm::quat(glm::radians(_rotation)));
+	}
 	mat = glm::scale(mat, _scale);
 	
 	return mat;
@@ -72,12 +85,12 @@ glm::mat4 Object::getModelMat()
 
 void Object::setPosition(glm::vec3 position)
 {
-	for(auto child : _children)
+	if(_entities != nullptr)
 	{
-		glm::vec3 translate = position - _position;
-		glm::vec3 childPos = child->getPosition();
-		childPos += translate;
-		child->setPosition(childPos);
+		// The children follow in the next transform update (see Scene::updatePhysics)
+		if(position != getPosition())
+			_entities->setWorldPosition(_entity, position);
+		return;
 	}
 
 	_position = position;
@@ -87,17 +100,26 @@ void Object::setPosition(glm::vec3 position)
 
 void Object::setRotation(glm::vec3 rotation)
 {
-	for(auto child : _children)
+	_rotation = rotation;
+	const glm::quat orientation = glm::quat(glm::radians(rotation));
+	if(_entities != nullptr)
 	{
-		glm::vec3 rot = rotation - _rotation;
-		glm::vec3 childRot = child->getRotation();
-		childRot += rot;
-		child->setRotation(childRot);
+		// Same orientation from other angles (the user interface sets it every frame)
+		const glm::quat current = _entities->get<EntityStore::Transform>(_entity).worldOrientation;
+		if(std::abs(glm::dot(orientation, current)) < 1.0f - 1e-6f)
+			_entities->setWorldOrientation(_entity, orientation);
+		return;
 	}
 
-	_rotation = rotation;
-	//if(_physics!=nullptr)
-	//	_physics->setRotation(rotation);
+	if(_physics!=nullptr)
+		_physics->setOrientation(orientation);
+}
+
+void Object::setEntity(EntityStore* entities, EntityStore::EntityId entity)
+{
+	_entities = entities;
+	_entity = entity;
+	_entities->setWorldTransform(_entity, _position, glm::quat(glm::radians(_rotation)), _scale);
 }
 
 void Object::setStatic(bool stat)
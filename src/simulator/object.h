@@ -11,20 +11,29 @@
 #include <vector>
 #include "physics/objectPhysics.h"
 #include "physics/constraints/constraint.h"
-#include "vulkan/model.h"
+#include "entityStore.h"
+#ifndef HEADLESS
+#include "vulkan/modelRegistry.h"
+#else
+// No models without Vulkan (see HeadlessSimulator)
+class Model;
+#endif
 
+// Facade of a scene entity: the scene copies the object into the EntityStore when it is
+// added, the per-frame passes only read the store (see Scene::updatePhysics)
 class Object
 {
 	public:
 		Object(std::string name, glm::vec3 position = {0,0,0}, glm::vec3 rotation = {0,0,0}, glm::vec3 scale = {1,1,1}, float mass = 1.0f);
-		~Object();
+		virtual ~Object();
 
 		void addChild(Object* child, Constraint* constraint);
 		void removeChild(Object* child);
 
 		//---------- Getters ----------//
 		ObjectPhysics* getObjectPhysics() const { return _physics; }
-		glm::vec3 getPosition() const { return _position; }
+		// World pose
+		glm::vec3 getPosition() const;
 		glm::vec3 getRotation();
 		glm::mat4 getModelMat();
 		std::string getType() const { return _type; }
@@ -32,14 +41,30 @@ class Object
 		int getId() const { return _id; }
 		bool getStatic() const { return _static; }
 		Object* getParent() const { return _parent; }
-		std::vector<Object*> getChildren() const { return _children; }
+		const std::vector<Object*>& getChildren() const { return _children; }
 		Constraint* getParentConstraint() const { return _parentConstraint; }
-		Model* getModel() const { return _model; }
+#ifndef HEADLESS
+		// Shared with the objects of the same model, nullptr until the object is added to a scene
+		Model* getModel() const { return _model.get(); }
+#endif
+		// File of the model (empty if the object is not rendered)
+		std::string getModelName() const { return _modelName; }
+		// Zero uses the material color of the model
+		glm::vec3 getColor() const { return _color; }
+		EntityStore::EntityId getEntity() const { return _entity; }
 
 		//---------- Setters ----------//
+		// World pose, the children keep their pose relative to the object once it is in a
+		// scene (before, only the object moves)
 		void setPosition(glm::vec3 position);
 		void setRotation(glm::vec3 rotation);
 		void setStatic(bool stat);
+		// Called by the scene (after the parent entity is set), the transform is read from the entity from now on
+		void setEntity(EntityStore* entities, EntityStore::EntityId entity);
+#ifndef HEADLESS
+		// Set by the scene when the object is added (model of getModelName)
+		void setModel(ModelRegistry::Handle model) { _model = model; }
+#endif
 
 	protected:
 		void setParent(Object* parent) { _parent = parent; };
@@ -58,9 +83,16 @@ class Object
 		ObjectPhysics* _physics;
 		bool _static;
 
-		Model* _model;
+		std::string _modelName;
+		glm::vec3 _color;
 
 	private:
+#ifndef HEADLESS
+		ModelRegistry::Handle _model;
+#endif
+		EntityStore* _entities;
+		EntityStore::EntityId _entity;
+
 		Object* _parent;
 		Constraint* _parentConstraint;
 		std::vector<Object*> _children;
@@ -7,11 +7,14 @@
 #include "box.h"
 
 Box::Box(std::string name, glm::vec3 position, glm::vec3 rotation, glm::vec3 size, float mass, glm::vec3 color):
-	Object(name, position, rotation, size, mass), _color(color)
+	Object(name, position, rotation, size, mass)
 {
+	_color = color;
 	_type = "Box";
-	_model = new Model("box");
+	_modelName = "box";
 	_physics = new ObjectPhysics(_position, _rotation, mass);
+	_physics->setHalfExtents(size*0.5f);
+	_physics->setShapeType(ShapeType::BOX);
 }
 
 Box::~Box()
@@ -7,11 +7,14 @@
 #include "cylinder.h"
 
 Cylinder::Cylinder(std::string name, glm::vec3 position, glm::vec3 rotation, glm::vec3 scale, float mass, glm::vec3 color):
-	Object(name, position, rotation, scale, mass), _color(color)
+	Object(name, position, rotation, scale, mass)
 {
+	_color = color;
 	_type = "Cylinder";
-	_model = new Model("cylinder");
+	_modelName = "cylinder";
 	_physics = new ObjectPhysics(_position, _rotation, mass);
+	_physics->setHalfExtents(scale*0.5f);
+	_physics->setShapeType(ShapeType::CYLINDER);
 }
 
 Cylinder::~Cylinder()
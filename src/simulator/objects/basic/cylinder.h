@@ -7,20 +7,12 @@
 #ifndef CYLINDER_H
 #define CYLINDER_H
 #include "../../object.h"
-#include "../../vulkan/model.h"
 
 class Cylinder : public Object
 {
 	public:
 		Cylinder(std::string name, glm::vec3 position = {0,0,0}, glm::vec3 rotation = {0,0,0}, glm::vec3 scale = {0,0,0}, float mass = 1.0f, glm::vec3 color = {1,1,1});
 		~Cylinder();
-
-		//---------- Getters ----------//
-		glm::vec3 getColor() const { return _color; };
-
-	private:
-		glm::vec3 _color;
-
 };
 
 #endif// CYLINDER_H
@@ -5,13 +5,19 @@
 // By Breno Cunha Queiroz
 //--------------------------------------------------
 #include "importedObject.h"
+#include "simulator/helpers/modelBounds.h"
 
-ImportedObject::ImportedObject(std::string name, std::string fileName, glm::vec3 position, glm::vec3 rotation, glm::vec3 scale, float mass):
+ImportedObject::ImportedObject(std::string name, std::string fileName, glm::vec3 position, glm::vec3 rotation, glm::vec3 scale, float mass, ShapeType shape):
 	Object(name, position, rotation, scale, mass)
 {
 	_type = "ImportedObject";
-	_model = new Model(fileName);
+	_modelName = fileName;
 	_physics = new ObjectPhysics(_position, _rotation, mass);
+	// Bounds of the model file (a unit model if it can't be read)
+	glm::vec3 halfExtents(0.5f);
+	ModelBounds::getHalfExtents(fileName, halfExtents);
+	_physics->setHalfExtents(halfExtents*scale);
+	_physics->setShapeType(shape);
 }
 
 ImportedObject::~ImportedObject()
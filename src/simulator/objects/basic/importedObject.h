@@ -8,7 +8,6 @@
 #define IMPORTED_OBJECT_H
 
 #include "../../object.h"
-#include "../../vulkan/model.h"
 
 class ImportedObject : public Object
 {
@@ -16,7 +15,7 @@ class ImportedObject : public Object
 		ImportedObject(
 				std::string name, std::string fileName, 
 				glm::vec3 position = {0,0,0}, glm::vec3 rotation = {0,0,0}, glm::vec3 scale = {0,0,0}, 
-				float mass = 1.0f);
+				float mass = 1.0f, ShapeType shape = ShapeType::BOX);
 		~ImportedObject();
 
 	private:
@@ -7,11 +7,14 @@
 #include "plane.h"
 
 Plane::Plane(std::string name, glm::vec3 position, glm::vec3 rotation, glm::vec2 size, float mass, glm::vec3 color):
-	Object(name, position, rotation, {size.x,1,size.y}, mass), _size(size), _color(color)
+	Object(name, position, rotation, {size.x,1,size.y}, mass), _size(size)
 {
+	_color = color;
 	_type = "Plane";
-	_model = new Model("plane");
+	_modelName = "plane";
 	_physics = new ObjectPhysics(_position, _rotation, mass);
+	_physics->setHalfExtents({size.x*0.5f, 0, size.y*0.5f});
+	_physics->setShapeType(ShapeType::PLANE);
 }
 
 Plane::~Plane()
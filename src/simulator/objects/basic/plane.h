@@ -14,12 +14,8 @@ class Plane : public Object
 		Plane(std::string name, glm::vec3 position = {0,0,0}, glm::vec3 rotation = {0,0,0}, glm::vec2 size = {1,1}, float mass = 1.0f, glm::vec3 color = {1,1,1});
 		~Plane();
 
-		//---------- Getters ----------//
-		glm::vec3 getColor() const { return _color; };
-
 	private:
 		glm::vec2 _size;
-		glm::vec3 _color;
 };
 
 #endif// PLANE_H
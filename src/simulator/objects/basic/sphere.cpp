@@ -7,11 +7,14 @@
 #include "sphere.h"
 
 Sphere::Sphere(std::string name, glm::vec3 position, glm::vec3 rotation, float radius, float mass, glm::vec3 color):
-	Object(name, position, rotation, {radius*2, radius*2, radius*2}, mass), _color(color)
+	Object(name, position, rotation, {radius*2, radius*2, radius*2}, mass)
 {
+	_color = color;
 	_type = "Sphere";
-	_model = new Model("sphere");
+	_modelName = "sphere";
 	_physics = new ObjectPhysics(_position, _rotation, mass);
+	_physics->setHalfExtents({radius, radius, radius});
+	_physics->setShapeType(ShapeType::SPHERE);
 }
 
 Sphere::~Sphere()
@@ -6,18 +6,20 @@
 //--------------------------------------------------
 #include "displayTFT144.h"
 #include "simulator/objects/basic/plane.h"
-#include "simulator/physics/constraints/hingeConstraint.h"
+#include "simulator/physics/constraints/fixedConstraint.h"
 
 DisplayTFT144::DisplayTFT144(std::string name, glm::vec3 position, glm::vec3 rotation):
 	Object(name, position, rotation, {1,1,1})
 {
 	_type = "Display";
-	_model = new Model("box");
+	_modelName = "box";
 	_physics = new ObjectPhysics(_position, _rotation, 0.2);
+	// Collides as the 1.44" module
+	_physics->setHalfExtents({0.02f, 0.02f, 0.0025f});
 
 	Plane* plane = new Plane("Screen", {0,0.251,0}, {0,0,0}, {0.1, 0.1}, 0.01f, {0,0,0.8});
 
-	addChild(plane, new HingeConstraint({0.2,0,0}, {0,0,90}));
+	addChild(plane, new FixedConstraint({0,0.251,0}, {0,0,0}));
 }
 
 DisplayTFT144::~DisplayTFT144()
@@ -0,0 +1,188 @@
+//--------------------------------------------------
+// Robot Simulator
+// lidar.cpp
+// Date: 2020-11-23
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#include "lidar.h"
+#include <algorithm>
+#include <cmath>
+
+Lidar::Lidar(std::string name, glm::vec3 position, glm::vec3 rotation):
+	Object(name, position, rotation, {0.1,0.07,0.1}, 0.0f),
+	_mountBody(nullptr), _writeScan(0), _scanCount(0), _scanIndex(0), _column(0), _columnAccumulator(0), _time(0)
+{
+	_type = "Lidar";
+	_modelName = "cylinder";
+
+	_mountPosition = position;
+	_mountOrientation = glm::angleAxis(glm::radians(rotation.z), glm::vec3(0,0,1))*
+		glm::angleAxis(glm::radians(rotation.y), glm::vec3(0,1,0))*
+		glm::angleAxis(glm::radians(rotation.x), glm::vec3(1,0,0));
+	_worldPosition = _mountPosition;
+	_worldOrientation = _mountOrientation;
+
+	setConfig(Config());
+}
+
+Lidar::~Lidar()
+{
+
+}
+
+void Lidar::setConfig(Config config)
+{
+	config.channels = std::max(config.channels, 1);
+	config.columns = std::max(config.columns, 1);
+	config.bufferSize = std::max(config.bufferSize, 1);
+	config.minRange = glm::max(config.minRange, 0.0f);
+	config.maxRange = glm::max(config.maxRange, config.minRange);
+	_config = config;
+
+	const int channels = _config.channels;
+	const int columns = _config.columns;
+	const uint32_t pointsPerScan = channels*columns;
+
+	// Column major so each batch is a contiguous slice of the scan
+	_beamDirections.resize(pointsPerScan);
+	for(int column=0; column<columns; column++)
+	{
+		const float azimuth = glm::radians(360.0f*column/columns);
+		for(int channel=0; channel<channels; channel++)
+		{
+			const float t = channels > 1 ? channel/float(channels-1) : 0.5f;
+			const float elevation = glm::radians(_config.minElevation + (_config.maxElevation-_config.minElevation)*t);
+			_beamDirections[column*channels + channel] = glm::vec3(
+					std::cos(elevation)*std::cos(azimuth),
+					std::sin(elevation),
+					std::cos(elevation)*std::sin(azimuth));
+		}
+	}
+
+	_ranges.assign(pointsPerScan*_config.bufferSize, 0.0f);
+	_points.assign(pointsPerScan*_config.bufferSize, glm::vec3(0));
+	_scans.resize(_config.bufferSize);
+	for(int i=0; i<_config.bufferSize; i++)
+	{
+		_scans[i].timestamp = 0;
+		_scans[i].ranges = &_ranges[i*pointsPerScan];
+		_scans[i].points = &_points[i*pointsPerScan];
+		_scans[i].pointCount = pointsPerScan;
+	}
+
+	// A whole rotation is the largest batch
+	_rays.reserve(pointsPerScan);
+	_results.reserve(pointsPerScan);
+
+	_writeScan = 0;
+	_scanCount = 0;
+	_column = 0;
+	_columnAccumulator = 0;
+}
+
+void Lidar::reset()
+{
+	_writeScan = 0;
+	_scanCount = 0;
+	_column = 0;
+	_columnAccumulator = 0;
+	_time = 0;
+}
+
+const Lidar::Scan* Lidar::getScan(int age) const
+{
+	if(age < 0 || age >= _scanCount)
+		return nullptr;
+
+	const int size = _config.bufferSize;
+	return &_scans[(_writeScan-1-age+2*size)%size];
+}
+
+void Lidar::update(PhysicsEngine* physicsEngine, float dt)
+{
+	if(physicsEngine == nullptr || dt <= 0)
+		return;
+
+	updatePose();
+	_time += dt;
+
+	// Columns swept since the last update, more than one rotation would
+	// only overwrite itself
+	_columnAccumulator += dt*_config.rate*_config.columns;
+	int count = (int)_columnAccumulator;
+	_columnAccumulator -= count;
+	count = std::min(count, _config.columns);
+
+	while(count > 0)
+	{
+		const int batch = std::min(count, _config.columns-_column);
+		castColumns(physicsEngine, _column, batch);
+		_column += batch;
+		count -= batch;
+
+		if(_column == _config.columns)
+		{
+			finishScan();
+			_column = 0;
+		}
+	}
+}
+
+void Lidar::updatePose()
+{
+	if(_mountBody != nullptr)
+	{
+		const glm::quat orientation = _mountBody->getOrientation();
+		_worldPosition = _mountBody->getPosition() + orientation*_mountPosition;
+		_worldOrientation = orientation*_mountOrientation;
+	}
+	else
+	{
+		_worldPosition = _mountPosition;
+		_worldOrientation = _mountOrientation;
+	}
+}
+
+void Lidar::castColumns(PhysicsEngine* physicsEngine, int first, int count)
+{
+	const int channels = _config.channels;
+	const uint32_t firstBeam = first*channels;
+	const uint32_t beamCount = count*channels;
+
+	// Rays start at the minimum range so the robot body is not seen
+	_rays.resize(beamCount);
+	for(uint32_t i=0; i<beamCount; i++)
+	{
+		const glm::vec3 direction = _worldOrientation*_beamDirections[firstBeam+i];
+		_rays[i].origin = _worldPosition + direction*_config.minRange;
+		_rays[i].direction = direction;
+		_rays[i].maxDistance = _config.maxRange-_config.minRange;
+	}
+
+	physicsEngine->raycastBatch(_rays, _results);
+
+	const uint32_t offset = _writeScan*_scans[_writeScan].pointCount + firstBeam;
+	float* ranges = &_ranges[offset];
+	glm::vec3* points = &_points[offset];
+	for(uint32_t i=0; i<beamCount; i++)
+	{
+		if(_results[i].hit)
+		{
+			ranges[i] = _results[i].distance+_config.minRange;
+			points[i] = _beamDirections[firstBeam+i]*ranges[i];
+		}
+		else
+		{
+			ranges[i] = 0.0f;
+			points[i] = glm::vec3(0);
+		}
+	}
+}
+
+void Lidar::finishScan()
+{
+	_scans[_writeScan].timestamp = _time;
+	_writeScan = (_writeScan+1)%_config.bufferSize;
+	_scanCount = std::min(_scanCount+1, _config.bufferSize);
+	_scanIndex++;
+}
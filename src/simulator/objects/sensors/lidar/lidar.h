@@ -0,0 +1,116 @@
+//--------------------------------------------------
+// Robot Simulator
+// lidar.h
+// Date: 2020-11-23
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef LIDAR_H
+#define LIDAR_H
+
+#include <string>
+#include <vector>
+#include "simulator/object.h"
+#include "simulator/physics/physicsEngine.h"
+
+// Rotating lidar. Every update fires the columns swept since the last one as a
+// single batched raycast, and finished scans are written to a ring buffer.
+// The sensor frame has +Y as the rotation axis and azimuth 0 along +X.
+//
+// If the lidar is mounted on a body (setMountBody, done by the scene for a child of an
+// object with physics), the position and rotation are the mount pose relative to it,
+// otherwise they are world space.
+class Lidar : public Object
+{
+	public:
+		struct Config
+		{
+			// Vertical beams (1 for a 2D lidar)
+			int channels = 16;
+			// Beams per rotation for each channel
+			int columns = 1800;
+			// Vertical field of view (degrees), channels are evenly spaced
+			float minElevation = -15.0f;
+			float maxElevation = 15.0f;
+			// Range (m), beams without a return report 0
+			float minRange = 0.1f;
+			float maxRange = 100.0f;
+			// Rotations per second
+			float rate = 10.0f;
+			// Scans kept in the ring buffer
+			int bufferSize = 4;
+		};
+
+		struct Scan
+		{
+			// Simulation time when the rotation ended (s)
+			float timestamp;
+			// Channel major within each column: index = column*channels + channel
+			const float* ranges;
+			// Hit points in the sensor frame at the time of each column
+			const glm::vec3* points;
+			uint32_t pointCount;
+		};
+
+		Lidar(std::string name, glm::vec3 position = {0,0,0}, glm::vec3 rotation = {0,0,0});
+		~Lidar();
+
+		// Cast the beams swept during dt
+		void update(PhysicsEngine* physicsEngine, float dt);
+		// Drops the scans and restarts the rotation (keeps the buffers)
+		void reset();
+
+		//---------- Getters ----------//
+		Config getConfig() const { return _config; }
+		// Completed scans currently in the buffer
+		int getScanCount() const { return _scanCount; }
+		// Age 0 is the latest completed scan (nullptr if there is none)
+		const Scan* getScan(int age = 0) const;
+		// Total number of completed scans
+		uint64_t getScanIndex() const { return _scanIndex; }
+		float getPointsPerSecond() const { return _config.channels*_config.columns*_config.rate; }
+		// Relative to the mount body (world space if there is none)
+		glm::vec3 getMountPosition() const { return _mountPosition; }
+		glm::quat getMountOrientation() const { return _mountOrientation; }
+		glm::vec3 getWorldPosition() const { return _worldPosition; }
+		glm::quat getWorldOrientation() const { return _worldOrientation; }
+
+		//---------- Setters ----------//
+		// Allocates the scan buffers and restarts the rotation
+		void setConfig(Config config);
+		// Body the lidar follows (nullptr for a world space lidar)
+		void setMountBody(const ObjectPhysics* body) { _mountBody = body; }
+
+	private:
+		void updatePose();
+		void castColumns(PhysicsEngine* physicsEngine, int first, int count);
+		void finishScan();
+
+		Config _config;
+		const ObjectPhysics* _mountBody;
+		glm::vec3 _mountPosition;
+		glm::quat _mountOrientation;
+		glm::vec3 _worldPosition;
+		glm::quat _worldOrientation;
+
+		// Beam directions in the sensor frame
+		std::vector<glm::vec3> _beamDirections;
+
+		// Ring buffer (preallocated, bufferSize scans of channels*columns points)
+		std::vector<Scan> _scans;
+		std::vector<float> _ranges;
+		std::vector<glm::vec3> _points;
+		int _writeScan;
+		int _scanCount;
+		uint64_t _scanIndex;
+
+		// Current rotation
+		int _column;
+		float _columnAccumulator;
+		float _time;
+
+		// Batch sent to the physics engine
+		std::vector<PhysicsEngine::Ray> _rays;
+		std::vector<PhysicsEngine::RayResult> _results;
+};
+
+#endif// LIDAR_H
@@ -0,0 +1,68 @@
+//--------------------------------------------------
+// Robot Simulator
+// aabb.h
+// Date: 2020-11-05
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef AABB_H
+#define AABB_H
+
+#include <utility>
+#include "glm.h"
+
+// Axis aligned bounding box
+struct Aabb
+{
+	glm::vec3 min = {0,0,0};
+	glm::vec3 max = {0,0,0};
+
+	bool overlaps(const Aabb& other) const
+	{
+		return min.x <= other.max.x && max.x >= other.min.x &&
+			min.y <= other.max.y && max.y >= other.min.y &&
+			min.z <= other.max.z && max.z >= other.min.z;
+	}
+
+	bool contains(const Aabb& other) const
+	{
+		return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+			max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z;
+	}
+
+	glm::vec3 getCenter() const { return (min+max)*0.5f; }
+	glm::vec3 getExtents() const { return max-min; }
+
+	float getSurfaceArea() const
+	{
+		glm::vec3 d = max-min;
+		return 2.0f*(d.x*d.y + d.y*d.z + d.z*d.x);
+	}
+
+	// Slab test, invDirection = 1/direction
+	bool raycast(glm::vec3 origin, glm::vec3 invDirection, float maxT, float& tEnter) const
+	{
+		float tMin = 0.0f;
+		float tMax = maxT;
+		for(int axis=0; axis<3; axis++)
+		{
+			float t1 = (min[axis] - origin[axis])*invDirection[axis];
+			float t2 = (max[axis] - origin[axis])*invDirection[axis];
+			if(t1 > t2)
+				std::swap(t1, t2);
+			// NaN (origin on the slab with a parallel ray) is ignored by the comparisons
+			tMin = t1 > tMin ? t1 : tMin;
+			tMax = t2 < tMax ? t2 : tMax;
+			if(tMin > tMax)
+				return false;
+		}
+		tEnter = tMin;
+		return true;
+	}
+
+	static Aabb merge(const Aabb& a, const Aabb& b)
+	{
+		return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+	}
+};
+
+#endif// AABB_H
@@ -0,0 +1,931 @@
+//--------------------------------------------------
+// Robot Simulator
+// articulation.cpp
+// Date: 2020-11-25
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#include "articulation.h"
+#include <cmath>
+#include <utility>
+#include <algorithm>
+#include "../solver/contactSolver.h"
+
+typedef Articulation::SpatialVector SpatialVector;
+typedef Articulation::SpatialInertia SpatialInertia;
+
+//---------- Spatial algebra ----------//
+static const SpatialVector ZERO = {glm::vec3(0), glm::vec3(0)};
+
+static SpatialVector add(const SpatialVector& a, const SpatialVector& b) { return {a.angular+b.angular, a.linear+b.linear}; }
+static SpatialVector scale(const SpatialVector& a, float s) { return {a.angular*s, a.linear*s}; }
+// Motion vector times force vector (power)
+static float dot(const SpatialVector& m, const SpatialVector& f) { return glm::dot(m.angular, f.angular) + glm::dot(m.linear, f.linear); }
+// Motion cross motion
+static SpatialVector crossMotion(const SpatialVector& v, const SpatialVector& m)
+{
+	return {glm::cross(v.angular, m.angular), glm::cross(v.angular, m.linear) + glm::cross(v.linear, m.angular)};
+}
+// Motion cross force
+static SpatialVector crossForce(const SpatialVector& v, const SpatialVector& f)
+{
+	return {glm::cross(v.angular, f.angular) + glm::cross(v.linear, f.linear), glm::cross(v.angular, f.linear)};
+}
+static SpatialVector multiply(const SpatialInertia& I, const SpatialVector& m)
+{
+	return {I.A*m.angular + I.B*m.linear, glm::transpose(I.B)*m.angular + I.C*m.linear};
+}
+static SpatialInertia add(const SpatialInertia& a, const SpatialInertia& b) { return {a.A+b.A, a.B+b.B, a.C+b.C}; }
+// a*b^T
+static glm::mat3 outer(glm::vec3 a, glm::vec3 b) { return glm::mat3(a*b.x, a*b.y, a*b.z); }
+// I - U*U^T*invD
+static SpatialInertia subtractOuter(const SpatialInertia& I, const SpatialVector& U, float invD)
+{
+	return {I.A - outer(U.angular, U.angular)*invD, I.B - outer(U.angular, U.linear)*invD, I.C - outer(U.linear, U.linear)*invD};
+}
+// skew(c)*v = cross(c, v)
+static glm::mat3 skew(glm::vec3 c)
+{
+	return glm::mat3(glm::vec3(0, c.z, -c.y), glm::vec3(-c.z, 0, c.x), glm::vec3(c.y, -c.x, 0));
+}
+static glm::mat3 diagonal(glm::vec3 d)
+{
+	return glm::mat3(glm::vec3(d.x, 0, 0), glm::vec3(0, d.y, 0), glm::vec3(0, 0, d.z));
+}
+// I*x = b (Gaussian elimination with partial pivoting)
+static SpatialVector solve(const SpatialInertia& I, const SpatialVector& b)
+{
+	float m[6][7];
+	const glm::mat3 blocks[2][2] = {{I.A, I.B}, {glm::transpose(I.B), I.C}};
+	for(int r=0; r<6; r++)
+	{
+		for(int c=0; c<6; c++)
+			m[r][c] = blocks[r/3][c/3][c%3][r%3];
+		m[r][6] = r < 3 ? b.angular[r] : b.linear[r-3];
+	}
+
+	for(int col=0; col<6; col++)
+	{
+		int pivot = col;
+		for(int r=col+1; r<6; r++)
+			if(std::fabs(m[r][col]) > std::fabs(m[pivot][col]))
+				pivot = r;
+		if(std::fabs(m[pivot][col]) < 1e-12f)
+			return ZERO;
+		if(pivot != col)
+			for(int c=col; c<7; c++)
+				std::swap(m[col][c], m[pivot][c]);
+
+		for(int r=col+1; r<6; r++)
+		{
+			const float factor = m[r][col]/m[col][col];
+			for(int c=col; c<7; c++)
+				m[r][c] -= factor*m[col][c];
+		}
+	}
+
+	float x[6];
+	for(int r=5; r>=0; r--)
+	{
+		float sum = m[r][6];
+		for(int c=r+1; c<6; c++)
+			sum -= m[r][c]*x[c];
+		x[r] = sum/m[r][r];
+	}
+	return {{x[0], x[1], x[2]}, {x[3], x[4], x[5]}};
+}
+// Inverse of a symmetric spatial matrix (column by column)
+static SpatialInertia inverse(const SpatialInertia& I)
+{
+	SpatialInertia result;
+	for(int c=0; c<3; c++)
+	{
+		SpatialVector unit = ZERO;
+		unit.angular[c] = 1.0f;
+		const SpatialVector angular = solve(I, unit);
+		unit = ZERO;
+		unit.linear[c] = 1.0f;
+		const SpatialVector linear = solve(I, unit);
+		result.A[c] = angular.angular;
+		result.B[c] = linear.angular;
+		result.C[c] = linear.linear;
+	}
+	return result;
+}
+
+//---------- Articulation ----------//
+Articulation::Articulation(ObjectPhysics* root):
+	_bodyStore(nullptr), _jointMotors(nullptr), _selfCollision(false), _origin(0)
+{
+	Link link = {};
+	link.body = root;
+	link.id = BodyStore::INVALID_ID;
+	link.motorId = JointMotors::INVALID_ID;
+	link.parent = -1;
+	link.type = JointType::FIXED;
+	link.jointRotation = glm::quat(1,0,0,0);
+	link.axis = {0,1,0};
+	_links.push_back(link);
+}
+
+Articulation::~Articulation()
+{
+}
+
+int Articulation::addLink(ObjectPhysics* body, int parent, JointType type, glm::vec3 position, glm::quat rotation, glm::vec3 axis)
+{
+	if(body == nullptr || parent < 0 || parent >= (int)_links.size())
+		return -1;
+
+	Link link = {};
+	link.body = body;
+	link.id = BodyStore::INVALID_ID;
+	link.motorId = JointMotors::INVALID_ID;
+	link.parent = parent;
+	link.type = type;
+	link.jointPosition = position;
+	link.jointRotation = rotation;
+	link.axis = glm::normalize(axis);
+	_links.push_back(link);
+	return (int)_links.size()-1;
+}
+
+void Articulation::attach(BodyStore* bodyStore, JointMotors* jointMotors)
+{
+	_bodyStore = bodyStore;
+	_jointMotors = jointMotors;
+	for(uint32_t i=0; i<_links.size(); i++)
+	{
+		Link& link = _links[i];
+		link.id = link.body->getId();
+		_bodyStore->setArticulated(link.id, true);
+		if(_jointMotors != nullptr && link.motorEnabled)
+			link.motorId = _jointMotors->add(this, (int)i, link.motor);
+	}
+
+	updateLinkPoses(true);
+	updateKinematics();
+	// Joint inertias for the motors of the first step
+	updateArticulatedInertias();
+	readRootVelocity();
+	updateLinkVelocities();
+	writeLinkVelocities();
+}
+
+void Articulation::detach()
+{
+	for(auto& link : _links)
+	{
+		if(_bodyStore != nullptr && link.body->isAttached())
+			_bodyStore->setArticulated(link.id, false);
+		if(_jointMotors != nullptr)
+			_jointMotors->remove(link.motorId);
+		link.id = BodyStore::INVALID_ID;
+		link.motorId = JointMotors::INVALID_ID;
+	}
+	_bodyStore = nullptr;
+	_jointMotors = nullptr;
+	_manifoldIndices.clear();
+	_contactRows.clear();
+}
+
+int Articulation::getDofCount() const
+{
+	int count = 0;
+	for(const auto& link : _links)
+		if(link.type == JointType::REVOLUTE)
+			count++;
+	return count;
+}
+
+glm::vec3 Articulation::getJointAxis(int link) const
+{
+	const Link& l = _links[link];
+	return l.body->getOrientation()*l.axis;
+}
+
+bool Articulation::isAwake() const
+{
+	for(const auto& link : _links)
+		if(_bodyStore->getInverseMass(link.id) > 0 && _bodyStore->isAwake(link.id))
+			return true;
+	return false;
+}
+
+int Articulation::findLink(BodyStore::BodyId id) const
+{
+	for(uint32_t i=0; i<_links.size(); i++)
+		if(_links[i].id == id)
+			return (int)i;
+	return -1;
+}
+
+void Articulation::updateKinematics()
+{
+	_origin = _bodyStore->getPosition(_links[0].id);
+	for(uint32_t i=0; i<_links.size(); i++)
+	{
+		Link& link = _links[i];
+		const glm::mat3& rotation = _bodyStore->getRotationMatrix(link.id);
+		link.com = _bodyStore->getPosition(link.id) - _origin;
+
+		// Rigid body inertia about the origin (parallel axis theorem)
+		const float inverseMass = _bodyStore->getInverseMass(link.id);
+		if(inverseMass > 0)
+		{
+			const float mass = 1.0f/inverseMass;
+			const glm::vec3 inverseInertia = _bodyStore->getLocalInverseInertia(link.id);
+			const glm::vec3 inertia = {
+				inverseInertia.x > 0 ? 1.0f/inverseInertia.x : 0.0f,
+				inverseInertia.y > 0 ? 1.0f/inverseInertia.y : 0.0f,
+				inverseInertia.z > 0 ? 1.0f/inverseInertia.z : 0.0f};
+			const glm::vec3 c = link.com;
+			link.inertia.A = rotation*diagonal(inertia)*glm::transpose(rotation) + (diagonal(glm::vec3(glm::dot(c, c))) - outer(c, c))*mass;
+			link.inertia.B = skew(c)*mass;
+			link.inertia.C = diagonal(glm::vec3(mass));
+		}
+		else
+			link.inertia = {glm::mat3(0.0f), glm::mat3(0.0f), glm::mat3(0.0f)};
+
+		// Rotation about the axis through the link origin
+		if(link.type == JointType::REVOLUTE)
+		{
+			const glm::vec3 axis = rotation*link.axis;
+			link.S = {axis, glm::cross(link.com, axis)};
+		}
+		else
+			link.S = ZERO;
+	}
+}
+
+void Articulation::readRootVelocity()
+{
+	// The origin is the root center of mass
+	Link& root = _links[0];
+	root.v = isFixedBase() ? ZERO : SpatialVector{_bodyStore->getAngularVelocity(root.id), _bodyStore->getVelocity(root.id)};
+}
+
+void Articulation::updateLinkVelocities()
+{
+	// The root velocity is set by the caller
+	for(uint32_t i=1; i<_links.size(); i++)
+	{
+		Link& link = _links[i];
+		link.v = add(_links[link.parent].v, scale(link.S, link.qd));
+	}
+}
+
+void Articulation::writeLinkVelocities()
+{
+	for(const auto& link : _links)
+	{
+		if(_bodyStore->getInverseMass(link.id) <= 0)
+			continue;
+
+		// Velocity of the center of mass from the velocity of the point at the origin
+		const uint32_t index = _bodyStore->getIndex(link.id);
+		_bodyStore->setVelocityByIndex(index, link.v.linear + glm::cross(link.v.angular, link.com));
+		_bodyStore->setAngularVelocityByIndex(index, link.v.angular);
+	}
+}
+
+void Articulation::updateLinkPoses(bool teleport)
+{
+	Link& root = _links[0];
+	root.position = _bodyStore->getPosition(root.id);
+	root.orientation = _bodyStore->getOrientation(root.id);
+	for(uint32_t i=1; i<_links.size(); i++)
+	{
+		Link& link = _links[i];
+		const Link& parent = _links[link.parent];
+		link.position = parent.position + parent.orientation*link.jointPosition;
+		link.orientation = glm::normalize(parent.orientation*link.jointRotation*glm::angleAxis(link.q, link.axis));
+
+		if(teleport)
+			_bodyStore->teleport(link.id, link.position, link.orientation);
+		else
+		{
+			const uint32_t index = _bodyStore->getIndex(link.id);
+			_bodyStore->setPositionByIndex(index, link.position);
+			_bodyStore->setOrientationByIndex(index, link.orientation);
+		}
+	}
+}
+
+void Articulation::updateArticulatedInertias()
+{
+	for(auto& link : _links)
+		link.IA = link.inertia;
+
+	// From the leaves to the root, the joint motion is projected out of the child inertia
+	for(int i=(int)_links.size()-1; i>0; i--)
+	{
+		Link& link = _links[i];
+		SpatialInertia Ia = link.IA;
+		link.U = ZERO;
+		link.invD = 0.0f;
+		if(link.type == JointType::REVOLUTE)
+		{
+			link.U = multiply(link.IA, link.S);
+			const float D = dot(link.S, link.U);
+			link.invD = D > 1e-12f ? 1.0f/D : 0.0f;
+			Ia = subtractOuter(Ia, link.U, link.invD);
+		}
+		_links[link.parent].IA = add(_links[link.parent].IA, Ia);
+	}
+
+	if(!isFixedBase())
+		_rootInverse = inverse(_links[0].IA);
+}
+
+void Articulation::propagateForces(bool biasForces)
+{
+	const int n = (int)_links.size();
+
+	// Velocity dependent terms (the velocities were propagated from the root)
+	for(int i=0; i<n; i++)
+	{
+		Link& link = _links[i];
+		link.pA = scale(link.externalForce, -1.0f);
+		link.c = ZERO;
+		if(biasForces)
+		{
+			link.pA = add(link.pA, crossForce(link.v, multiply(link.inertia, link.v)));
+			if(i > 0)
+				link.c = crossMotion(link.v, scale(link.S, link.qd));
+		}
+	}
+
+	// Articulated bias forces, from the leaves to the root
+	for(int i=n-1; i>0; i--)
+	{
+		Link& link = _links[i];
+		SpatialVector pa = link.pA;
+		link.u = 0.0f;
+		if(link.type == JointType::REVOLUTE)
+		{
+			link.u = link.jointForce - dot(link.S, link.pA);
+			pa = add(pa, scale(link.U, link.u*link.invD));
+		}
+		// Projected articulated inertia times the bias acceleration
+		if(biasForces)
+			pa = add(pa, add(multiply(link.IA, link.c), scale(link.U, -dot(link.c, link.U)*link.invD)));
+		_links[link.parent].pA = add(_links[link.parent].pA, pa);
+	}
+
+	// Accelerations, from the root to the leaves
+	Link& root = _links[0];
+	root.a = isFixedBase() ? ZERO : multiply(_rootInverse, scale(root.pA, -1.0f));
+	root.qdd = 0.0f;
+	for(int i=1; i<n; i++)
+	{
+		Link& link = _links[i];
+		const SpatialVector a = add(_links[link.parent].a, link.c);
+		link.qdd = link.type == JointType::REVOLUTE ? (link.u - dot(a, link.U))*link.invD : 0.0f;
+		link.a = add(a, scale(link.S, link.qdd));
+	}
+}
+
+void Articulation::clearForces()
+{
+	for(auto& link : _links)
+	{
+		link.externalForce = ZERO;
+		link.jointForce = 0.0f;
+	}
+}
+
+void Articulation::integrateVelocities(float dt)
+{
+	if(_bodyStore == nullptr)
+		return;
+
+	// Sleeping trees are at rest
+	if(!isAwake())
+	{
+		for(auto& link : _links)
+		{
+			link.qd = 0.0f;
+			link.torque = 0.0f;
+		}
+		return;
+	}
+
+	// The link forces (gravity, springs, ...) are applied here instead of by the store
+	updateKinematics();
+	for(auto& link : _links)
+	{
+		const glm::vec3 force = _bodyStore->getForceAccum(link.id);
+		const glm::vec3 torque = _bodyStore->getTorqueAccum(link.id);
+		link.externalForce = {torque + glm::cross(link.com, force), force};
+		link.jointForce = link.torque;
+		link.torque = 0.0f;
+		_bodyStore->clearForceAccum(link.id);
+	}
+
+	readRootVelocity();
+	updateLinkVelocities();
+	updateArticulatedInertias();
+	propagateForces(true);
+
+	// The origin is the root center of mass, so the classical acceleration is a + w x v
+	Link& root = _links[0];
+	if(!isFixedBase())
+	{
+		const glm::vec3 w = root.v.angular;
+		const glm::vec3 v = root.v.linear;
+		root.v = {w + root.a.angular*dt, v + (root.a.linear + glm::cross(w, v))*dt};
+	}
+	for(auto& link : _links)
+		link.qd += link.qdd*dt;
+
+	updateLinkVelocities();
+	writeLinkVelocities();
+}
+
+void Articulation::solveContacts(const std::vector<ContactManifold>& manifolds, const ContactSolver* solver, float dt)
+{
+	_contactRows.clear();
+	if(_bodyStore == nullptr || _manifoldIndices.empty() || dt <= 0 || !isAwake())
+		return;
+
+	// The poses did not change since integrateVelocities (the store only damped the velocities)
+	updateKinematics();
+	updateArticulatedInertias();
+	readRootVelocity();
+	updateLinkVelocities();
+
+	for(uint32_t index : _manifoldIndices)
+		addContactRows(manifolds[index], solver, dt);
+	if(_contactRows.empty())
+		return;
+
+	buildDelassus(_contactRows);
+	_rowVelocity.resize(_contactRows.size());
+	for(uint32_t i=0; i<_contactRows.size(); i++)
+		_rowVelocity[i] = rowVelocity(_contactRows[i], 1) - rowVelocity(_contactRows[i], 0);
+	solveRows(_contactRows, solver->getIterations());
+
+	applyRows(_contactRows);
+	Link& root = _links[0];
+	if(!isFixedBase())
+		root.v = add(root.v, root.a);
+	for(auto& link : _links)
+		link.qd += link.qdd;
+	updateLinkVelocities();
+	writeLinkVelocities();
+
+	for(const auto& delta : _bodyDeltas)
+	{
+		_bodyStore->setVelocityByIndex(delta.index, _bodyStore->getVelocityByIndex(delta.index) + delta.velocity);
+		_bodyStore->setAngularVelocityByIndex(delta.index, _bodyStore->getAngularVelocityByIndex(delta.index) + delta.angularVelocity);
+	}
+}
+
+void Articulation::integratePositions(float dt)
+{
+	if(_bodyStore == nullptr || !isAwake())
+		return;
+
+	// The root was integrated by the store
+	for(auto& link : _links)
+		link.q += link.qd*dt;
+	updateLinkPoses(false);
+}
+
+void Articulation::solveContactPositions(const ContactSolver* solver, float dt)
+{
+	if(_bodyStore == nullptr || _contactRows.empty() || dt <= 0 ||
+			solver->getPositionCorrection() != ContactSolver::PositionCorrection::SPLIT_IMPULSE)
+		return;
+
+	// Normal rows only, the pseudo velocities are discarded after the step
+	_positionRows.clear();
+	bool penetrating = false;
+	for(const auto& row : _contactRows)
+	{
+		if(&row != &_contactRows[row.normalRow])
+			continue;
+		_positionRows.push_back(row);
+		ContactRow& positionRow = _positionRows.back();
+		positionRow.normalRow = (int)_positionRows.size()-1;
+		positionRow.bias = solver->getBaumgarte()/dt*glm::max(row.penetration-solver->getLinearSlop(), 0.0f);
+		positionRow.impulse = 0.0f;
+		penetrating = penetrating || positionRow.bias > 0;
+	}
+	if(!penetrating)
+		return;
+
+	updateKinematics();
+	updateArticulatedInertias();
+	buildDelassus(_positionRows);
+	_rowVelocity.assign(_positionRows.size(), 0.0f);
+	solveRows(_positionRows, solver->getPositionIterations());
+	applyRows(_positionRows);
+
+	const Link& root = _links[0];
+	if(!isFixedBase())
+	{
+		const uint32_t index = _bodyStore->getIndex(root.id);
+		const glm::quat q = _bodyStore->getOrientationByIndex(index);
+		_bodyStore->setPositionByIndex(index, _bodyStore->getPositionByIndex(index) + root.a.linear*dt);
+		_bodyStore->setOrientationByIndex(index, glm::normalize(q + glm::quat(0, root.a.angular*(0.5f*dt))*q));
+	}
+	for(auto& link : _links)
+		link.q += link.qdd*dt;
+	updateLinkPoses(false);
+
+	for(const auto& delta : _bodyDeltas)
+	{
+		const glm::quat q = _bodyStore->getOrientationByIndex(delta.index);
+		_bodyStore->setPositionByIndex(delta.index, _bodyStore->getPositionByIndex(delta.index) + delta.velocity*dt);
+		_bodyStore->setOrientationByIndex(delta.index, glm::normalize(q + glm::quat(0, delta.angularVelocity*(0.5f*dt))*q));
+	}
+}
+
+void Articulation::addContactRows(const ContactManifold& manifold, const ContactSolver* solver, float dt)
+{
+	ContactRow row = {};
+	row.link[0] = findLink(manifold.a);
+	row.link[1] = findLink(manifold.b);
+	row.index[0] = _bodyStore->getIndex(manifold.a);
+	row.index[1] = _bodyStore->getIndex(manifold.b);
+	const float* friction = _bodyStore->getFrictions();
+	const float* restitution = _bodyStore->getRestitutions();
+	row.friction = std::sqrt(friction[row.index[0]]*friction[row.index[1]]);
+	const float e = glm::max(restitution[row.index[0]], restitution[row.index[1]]);
+	const glm::vec3 positionA = _bodyStore->getPositionByIndex(row.index[0]);
+	const glm::vec3 positionB = _bodyStore->getPositionByIndex(row.index[1]);
+
+	// Friction directions, the first one follows the sliding velocity at the first point (as the contact solver)
+	glm::vec3 tangent[2];
+	row.r[0] = manifold.points[0].position - positionA;
+	row.r[1] = manifold.points[0].position - positionB;
+	for(int d=0; d<3; d++)
+	{
+		row.direction = glm::vec3(0);
+		row.direction[d] = 1.0f;
+		tangent[0][d] = rowVelocity(row, 1) - rowVelocity(row, 0);
+	}
+	tangent[0] -= manifold.normal*glm::dot(tangent[0], manifold.normal);
+	const float slip = glm::length(tangent[0]);
+	if(slip > 1e-3f)
+		tangent[0] /= slip;
+	else
+		tangent[0] = glm::normalize(glm::abs(manifold.normal.x) < 0.57f ?
+				glm::cross(manifold.normal, glm::vec3(1,0,0)) : glm::cross(manifold.normal, glm::vec3(0,1,0)));
+	tangent[1] = glm::cross(manifold.normal, tangent[0]);
+
+	for(int p=0; p<manifold.pointCount; p++)
+	{
+		row.r[0] = manifold.points[p].position - positionA;
+		row.r[1] = manifold.points[p].position - positionB;
+		row.penetration = manifold.points[p].penetration;
+		row.normalRow = (int)_contactRows.size();
+		row.impulse = 0.0f;
+
+		// Restitution only for impacts, resting contacts would jitter
+		row.direction = manifold.normal;
+		const float vn = rowVelocity(row, 1) - rowVelocity(row, 0);
+		row.bias = vn < -solver->getRestitutionThreshold() ? -e*vn : 0.0f;
+		if(solver->getPositionCorrection() == ContactSolver::PositionCorrection::BAUMGARTE)
+			row.bias = glm::max(row.bias, solver->getBaumgarte()/dt*glm::max(row.penetration-solver->getLinearSlop(), 0.0f));
+		_contactRows.push_back(row);
+
+		row.bias = 0.0f;
+		for(int t=0; t<2; t++)
+		{
+			row.direction = tangent[t];
+			_contactRows.push_back(row);
+		}
+	}
+}
+
+float Articulation::rowVelocity(const ContactRow& row, int side) const
+{
+	if(row.link[side] >= 0)
+	{
+		const Link& link = _links[row.link[side]];
+		return glm::dot(row.direction, link.v.linear + glm::cross(link.v.angular, link.com + row.r[side]));
+	}
+	const uint32_t index = row.index[side];
+	const glm::vec3 velocity = _bodyStore->getVelocityByIndex(index) + glm::cross(_bodyStore->getAngularVelocityByIndex(index), row.r[side]);
+	return glm::dot(row.direction, velocity);
+}
+
+void Articulation::buildDelassus(const std::vector<ContactRow>& rows)
+{
+	const int k = (int)rows.size();
+	_delassus.assign(k*k, 0.0f);
+	const float* inverseMass = _bodyStore->getInverseMasses();
+
+	for(int j=0; j<k; j++)
+	{
+		const ContactRow& rowJ = rows[j];
+
+		// Response of the tree to a unit impulse of the row (one pass per row)
+		if(rowJ.link[0] >= 0 || rowJ.link[1] >= 0)
+		{
+			clearForces();
+			for(int side=0; side<2; side++)
+			{
+				if(rowJ.link[side] < 0)
+					continue;
+				Link& link = _links[rowJ.link[side]];
+				const glm::vec3 force = side == 0 ? -rowJ.direction : rowJ.direction;
+				link.externalForce = add(link.externalForce, {glm::cross(link.com + rowJ.r[side], force), force});
+			}
+			propagateForces(false);
+
+			for(int i=0; i<k; i++)
+			{
+				const ContactRow& rowI = rows[i];
+				float response = 0.0f;
+				for(int side=0; side<2; side++)
+				{
+					if(rowI.link[side] < 0)
+						continue;
+					const Link& link = _links[rowI.link[side]];
+					const float velocity = glm::dot(rowI.direction, link.a.linear + glm::cross(link.a.angular, link.com + rowI.r[side]));
+					response += side == 0 ? -velocity : velocity;
+				}
+				_delassus[j*k+i] += response;
+			}
+
+			// Self contacts between links that the joints keep rigidly together (sibling
+			// links of a floating base pushed apart) cannot be solved, only rounding errors
+			// are left in their diagonal and the impulses would blow up
+			if(rowJ.link[0] >= 0 && rowJ.link[1] >= 0 && _delassus[j*k+j] < 1e-4f*sideResponse(rowJ, 1))
+				_delassus[j*k+j] = 0.0f;
+		}
+
+		// Free bodies outside of the articulation
+		for(int sideJ=0; sideJ<2; sideJ++)
+		{
+			const uint32_t index = rowJ.index[sideJ];
+			if(rowJ.link[sideJ] >= 0 || inverseMass[index] <= 0)
+				continue;
+			const glm::vec3 force = sideJ == 0 ? -rowJ.direction : rowJ.direction;
+			const glm::vec3 velocity = force*inverseMass[index];
+			const glm::vec3 angularVelocity = _bodyStore->getInverseInertiaWorldByIndex(index)*glm::cross(rowJ.r[sideJ], force);
+
+			for(int i=0; i<k; i++)
+				for(int sideI=0; sideI<2; sideI++)
+				{
+					const ContactRow& rowI = rows[i];
+					if(rowI.link[sideI] >= 0 || rowI.index[sideI] != index)
+						continue;
+					const float response = glm::dot(rowI.direction, velocity + glm::cross(angularVelocity, rowI.r[sideI]));
+					_delassus[j*k+i] += sideI == 0 ? -response : response;
+				}
+		}
+	}
+}
+
+float Articulation::sideResponse(const ContactRow& row, int side)
+{
+	clearForces();
+	Link& link = _links[row.link[side]];
+	link.externalForce = {glm::cross(link.com + row.r[side], row.direction), row.direction};
+	propagateForces(false);
+	return glm::dot(row.direction, link.a.linear + glm::cross(link.a.angular, link.com + row.r[side]));
+}
+
+void Articulation::solveRows(std::vector<ContactRow>& rows, int iterations)
+{
+	const int k = (int)rows.size();
+	auto apply = [&](int j, float delta)
+	{
+		rows[j].impulse += delta;
+		const float* column = &_delassus[j*k];
+		float* velocity = _rowVelocity.data();
+		for(int i=0; i<k; i++)
+			velocity[i] += column[i]*delta;
+	};
+
+	for(int iteration=0; iteration<iterations; iteration++)
+	{
+		for(int n=0; n<k; n++)
+		{
+			if(rows[n].normalRow != n)
+				continue;
+
+			// Friction first, the non-penetration is more important and is solved last
+			if(n+2 < k && rows[n+1].normalRow == n)
+			{
+				const int t0 = n+1;
+				const int t1 = n+2;
+				float new0 = rows[t0].impulse;
+				float new1 = rows[t1].impulse;
+				if(_delassus[t0*k+t0] > 1e-9f)
+					new0 -= _rowVelocity[t0]/_delassus[t0*k+t0];
+				if(_delassus[t1*k+t1] > 1e-9f)
+					new1 -= _rowVelocity[t1]/_delassus[t1*k+t1];
+
+				// Project the accumulated impulse onto the friction cone
+				const float maxFriction = rows[n].friction*rows[n].impulse;
+				const float length2 = new0*new0 + new1*new1;
+				if(length2 > maxFriction*maxFriction)
+				{
+					const float scale = length2 > 0 ? maxFriction/std::sqrt(length2) : 0.0f;
+					new0 *= scale;
+					new1 *= scale;
+				}
+				apply(t0, new0 - rows[t0].impulse);
+				apply(t1, new1 - rows[t1].impulse);
+			}
+
+			if(_delassus[n*k+n] <= 1e-9f)
+				continue;
+			const float newImpulse = glm::max(rows[n].impulse - (_rowVelocity[n] - rows[n].bias)/_delassus[n*k+n], 0.0f);
+			apply(n, newImpulse - rows[n].impulse);
+		}
+	}
+}
+
+void Articulation::applyRows(const std::vector<ContactRow>& rows)
+{
+	const float* inverseMass = _bodyStore->getInverseMasses();
+	clearForces();
+	_bodyDeltas.clear();
+	for(const auto& row : rows)
+	{
+		if(row.impulse == 0.0f)
+			continue;
+		for(int side=0; side<2; side++)
+		{
+			const glm::vec3 force = row.direction*(side == 0 ? -row.impulse : row.impulse);
+			if(row.link[side] >= 0)
+			{
+				Link& link = _links[row.link[side]];
+				link.externalForce = add(link.externalForce, {glm::cross(link.com + row.r[side], force), force});
+				continue;
+			}
+
+			const uint32_t index = row.index[side];
+			if(inverseMass[index] <= 0)
+				continue;
+			auto it = std::find_if(_bodyDeltas.begin(), _bodyDeltas.end(), [index](const BodyDelta& delta){ return delta.index == index; });
+			if(it == _bodyDeltas.end())
+				it = _bodyDeltas.insert(_bodyDeltas.end(), {index, glm::vec3(0), glm::vec3(0)});
+			it->velocity += force*inverseMass[index];
+			it->angularVelocity += _bodyStore->getInverseInertiaWorldByIndex(index)*glm::cross(row.r[side], force);
+		}
+	}
+	propagateForces(false);
+}
+
+void Articulation::saveState(StateSnapshot& snapshot) const
+{
+	for(const auto& link : _links)
+	{
+		snapshot.write(link.q);
+		snapshot.write(link.qd);
+		snapshot.write(link.torque);
+		snapshot.write(link.motorEnabled);
+		snapshot.write(link.motor);
+		snapshot.write(link.motorId);
+	}
+}
+
+void Articulation::restoreState(StateSnapshot::Reader& reader)
+{
+	for(auto& link : _links)
+	{
+		reader.read(link.q);
+		reader.read(link.qd);
+		reader.read(link.torque);
+		reader.read(link.motorEnabled);
+		reader.read(link.motor);
+		reader.read(link.motorId);
+	}
+}
+
+void Articulation::forwardDynamics(const std::vector<float>& torques, std::vector<float>& accelerations, glm::vec3 gravity)
+{
+	accelerations.assign(_links.size(), 0.0f);
+	if(_bodyStore == nullptr)
+		return;
+
+	updateKinematics();
+	for(uint32_t i=0; i<_links.size(); i++)
+	{
+		Link& link = _links[i];
+		const glm::vec3 weight = link.inertia.C*gravity;
+		link.externalForce = {glm::cross(link.com, weight), weight};
+		link.jointForce = i < torques.size() ? torques[i] : 0.0f;
+	}
+
+	readRootVelocity();
+	updateLinkVelocities();
+	updateArticulatedInertias();
+	propagateForces(true);
+	for(uint32_t i=1; i<_links.size(); i++)
+		accelerations[i] = _links[i].qdd;
+}
+
+void Articulation::inverseDynamics(const std::vector<float>& accelerations, std::vector<float>& torques, glm::vec3 gravity)
+{
+	torques.assign(_links.size(), 0.0f);
+	if(_bodyStore == nullptr)
+		return;
+
+	updateKinematics();
+	readRootVelocity();
+	updateLinkVelocities();
+
+	// Gravity as an upward acceleration of the root
+	Link& root = _links[0];
+	root.a = {glm::vec3(0), -gravity};
+	root.pA = ZERO;
+	for(uint32_t i=1; i<_links.size(); i++)
+	{
+		Link& link = _links[i];
+		const float qdd = link.type == JointType::REVOLUTE && i < accelerations.size() ? accelerations[i] : 0.0f;
+		link.a = add(add(_links[link.parent].a, scale(link.S, qdd)), crossMotion(link.v, scale(link.S, link.qd)));
+		// Net force of the link
+		link.pA = add(multiply(link.inertia, link.a), crossForce(link.v, multiply(link.inertia, link.v)));
+	}
+
+	for(int i=(int)_links.size()-1; i>0; i--)
+	{
+		Link& link = _links[i];
+		torques[i] = dot(link.S, link.pA);
+		Link& parent = _links[link.parent];
+		parent.pA = add(parent.pA, link.pA);
+	}
+}
+
+void Articulation::setJointPosition(int link, float position)
+{
+	if(_links[link].type != JointType::REVOLUTE)
+		return;
+	_links[link].q = position;
+	if(_bodyStore != nullptr)
+		updateLinkPoses(true);
+}
+
+void Articulation::setJointVelocity(int link, float velocity)
+{
+	if(_links[link].type != JointType::REVOLUTE)
+		return;
+	_links[link].qd = velocity;
+	if(_bodyStore == nullptr)
+		return;
+
+	updateKinematics();
+	readRootVelocity();
+	updateLinkVelocities();
+	writeLinkVelocities();
+	_bodyStore->requestWake(_links[link].id);
+}
+
+void Articulation::translate(glm::vec3 offset)
+{
+	if(_bodyStore == nullptr || isFixedBase())
+		return;
+	const uint32_t index = _bodyStore->getIndex(_links[0].id);
+	_bodyStore->setPositionByIndex(index, _bodyStore->getPositionByIndex(index) + offset);
+	updateLinkPoses(false);
+}
+
+void Articulation::addJointTorque(int link, float torque, bool wake)
+{
+	if(_links[link].type != JointType::REVOLUTE)
+		return;
+	_links[link].torque += torque;
+	if(_bodyStore != nullptr && wake)
+		_bodyStore->requestWake(_links[link].id);
+}
+
+void Articulation::setJointMotor(int link, const JointMotors::Motor& motor)
+{
+	Link& l = _links[link];
+	if(l.type != JointType::REVOLUTE)
+		return;
+	l.motor = motor;
+	l.motorEnabled = true;
+	if(_jointMotors == nullptr)
+		return;
+
+	if(_jointMotors->isValid(l.motorId))
+		_jointMotors->setMotor(l.motorId, motor);
+	else
+		l.motorId = _jointMotors->add(this, link, motor);
+	// New targets wake the tree
+	_bodyStore->requestWake(l.id);
+}
+
+void Articulation::removeJointMotor(int link)
+{
+	Link& l = _links[link];
+	l.motorEnabled = false;
+	if(_jointMotors != nullptr)
+		_jointMotors->remove(l.motorId);
+	l.motorId = JointMotors::INVALID_ID;
+}
+
+float Articulation::getJointMotorTorque(int link) const
+{
+	const Link& l = _links[link];
+	return _jointMotors != nullptr && _jointMotors->isValid(l.motorId) ? _jointMotors->getTorque(l.motorId) : 0.0f;
+}
@@ -0,0 +1,240 @@
+//--------------------------------------------------
+// Robot Simulator
+// articulation.h
+// Date: 2020-11-25
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef ARTICULATION_H
+#define ARTICULATION_H
+
+#include <vector>
+#include "glm.h"
+#include "../bodyStore.h"
+#include "../objectPhysics.h"
+#include "../colliders/contactManifold.h"
+#include "jointMotors.h"
+
+class ContactSolver;
+
+// Tree of bodies connected by joints, simulated in reduced (joint) coordinates
+// with the Featherstone articulated body algorithm. The cost is linear in the
+// number of links and the joints do not drift apart. The root is a dynamic body
+// (floating base) or a static one (fixed base).
+//
+// Every link is still a body of the BodyStore, so it collides and is drawn as
+// usual. The contact solver skips the contacts of the links, they are solved by
+// the articulation in joint space: the response of the whole tree to an impulse
+// on a link (Delassus operator) is found with the impulse form of the same
+// algorithm, one pass per contact row.
+//
+// Spatial vectors are in world coordinates about the root position (angular part first).
+class Articulation
+{
+	public:
+		enum class JointType
+		{
+			// Welded to the parent (0 dof)
+			FIXED,
+			// Rotation about the joint axis (1 dof)
+			REVOLUTE
+		};
+
+		struct SpatialVector
+		{
+			glm::vec3 angular;
+			glm::vec3 linear;
+		};
+
+		// Symmetric 6x6 matrix [A B; B^T C]
+		struct SpatialInertia
+		{
+			glm::mat3 A;
+			glm::mat3 B;
+			glm::mat3 C;
+		};
+
+		Articulation(ObjectPhysics* root);
+		~Articulation();
+
+		// The joint frame (relative to the parent body) is the frame of the child body at
+		// joint position 0, the axis is in the joint frame. Children must be dynamic bodies
+		// and parents must be added before their children. Returns the link index.
+		int addLink(ObjectPhysics* body, int parent, JointType type, glm::vec3 position, glm::quat rotation, glm::vec3 axis = {0,1,0});
+
+		// Called by the physics engine, the links are moved to the joint positions
+		// and the joint motors are added to the motor store
+		void attach(BodyStore* bodyStore, JointMotors* jointMotors = nullptr);
+		void detach();
+		// Step hooks (see PhysicsEngine::stepPhysics)
+		// Joint space velocity update, uses and clears the forces of the links
+		void integrateVelocities(float dt);
+		// Manifolds (index in the narrowphase list) with some link, collected every step
+		void clearManifolds() { _manifoldIndices.clear(); }
+		void addManifold(uint32_t index) { _manifoldIndices.push_back(index); }
+		// Contacts of the links (same parameters as the contact solver)
+		void solveContacts(const std::vector<ContactManifold>& manifolds, const ContactSolver* solver, float dt);
+		// Joint positions and link poses from the integrated root
+		void integratePositions(float dt);
+		// Split impulse position correction of the contacts of the last solve
+		void solveContactPositions(const ContactSolver* solver, float dt);
+		// Joint states and motors (the link poses are saved by the store)
+		void saveState(StateSnapshot& snapshot) const;
+		void restoreState(StateSnapshot::Reader& reader);
+
+		// One entry per link (the root and fixed joints are 0)
+		// Joint accelerations produced by the joint torques and gravity (the state does not change)
+		void forwardDynamics(const std::vector<float>& torques, std::vector<float>& accelerations, glm::vec3 gravity);
+		// Joint torques that produce the joint accelerations with the root held still (recursive Newton-Euler)
+		void inverseDynamics(const std::vector<float>& accelerations, std::vector<float>& torques, glm::vec3 gravity);
+
+		//---------- Getters ----------//
+		int getLinkCount() const { return (int)_links.size(); }
+		int getDofCount() const;
+		ObjectPhysics* getLinkBody(int link) const { return _links[link].body; }
+		int getParent(int link) const { return _links[link].parent; }
+		JointType getJointType(int link) const { return _links[link].type; }
+		float getJointPosition(int link) const { return _links[link].q; }
+		float getJointVelocity(int link) const { return _links[link].qd; }
+		// World space axis of a revolute joint
+		glm::vec3 getJointAxis(int link) const;
+		// Inverse of the joint inertia seen by the joint torque in the last step
+		float getJointInverseInertia(int link) const { return _links[link].invD; }
+		bool hasJointMotor(int link) const { return _links[link].motorEnabled; }
+		const JointMotors::Motor& getJointMotor(int link) const { return _links[link].motor; }
+		// Torque applied by the motor in the last step
+		float getJointMotorTorque(int link) const;
+		bool isFixedBase() const { return _links[0].body->getInverseMass() <= 0; }
+		bool isAttached() const { return _bodyStore != nullptr; }
+		bool isSelfCollisionEnabled() const { return _selfCollision; }
+
+		//---------- Setters ----------//
+		// The links are moved outside of the simulation
+		void setJointPosition(int link, float position);
+		void setJointVelocity(int link, float velocity);
+		// Moves the whole tree (floating base only), used to undo motion after contact
+		void translate(glm::vec3 offset);
+		// Accumulated until the next step
+		void addJointTorque(int link, float torque, bool wake = true);
+		// Motor of a revolute joint, kept when the articulation is detached
+		void setJointMotor(int link, const JointMotors::Motor& motor);
+		void removeJointMotor(int link);
+		// Contacts between links that are not connected by a joint (off by default, robot
+		// models usually overlap their links). Set before adding the articulation to the engine.
+		void setSelfCollisionEnabled(bool selfCollision) { _selfCollision = selfCollision; }
+
+	private:
+		struct Link
+		{
+			ObjectPhysics* body;
+			BodyStore::BodyId id;
+			int parent;
+			JointType type;
+			// Joint frame in the parent frame, axis in the joint frame
+			glm::vec3 jointPosition;
+			glm::quat jointRotation;
+			glm::vec3 axis;
+			// Joint state
+			float q;
+			float qd;
+			float torque;
+			// Joint motor (id in the motor store while attached)
+			bool motorEnabled;
+			JointMotors::Motor motor;
+			JointMotors::MotorId motorId;
+
+			// Scratch of the current pass (spatial quantities about the origin)
+			glm::vec3 com;
+			SpatialInertia inertia;
+			SpatialVector S;
+			SpatialVector v;
+			SpatialVector c;
+			SpatialVector a;
+			SpatialVector externalForce;
+			float jointForce;
+			SpatialInertia IA;
+			SpatialVector pA;
+			SpatialVector U;
+			float invD;
+			float u;
+			float qdd;
+			// Pose written to the store
+			glm::vec3 position;
+			glm::quat orientation;
+		};
+
+		// Impulse along the direction on the body B (and the opposite on A)
+		struct ContactRow
+		{
+			// Link of each body (-1 outside of the articulation) and dense index
+			int link[2];
+			uint32_t index[2];
+			// Contact point relative to the center of mass of each body
+			glm::vec3 r[2];
+			glm::vec3 direction;
+			// Normal row of the contact point (itself for normal rows)
+			int normalRow;
+			float friction;
+			float bias;
+			float penetration;
+			float impulse;
+		};
+
+		// Velocity change of a body outside of the articulation
+		struct BodyDelta
+		{
+			uint32_t index;
+			glm::vec3 velocity;
+			glm::vec3 angularVelocity;
+		};
+
+		// Some dynamic link is awake
+		bool isAwake() const;
+		int findLink(BodyStore::BodyId id) const;
+		// Origin, inertia and motion subspace of the links from the store poses
+		void updateKinematics();
+		void readRootVelocity();
+		void updateLinkVelocities();
+		void writeLinkVelocities();
+		// Link poses from the root pose and the joint positions
+		void updateLinkPoses(bool teleport);
+
+		// Articulated body algorithm in two passes, the articulated inertias only depend on the poses
+		void updateArticulatedInertias();
+		// Result in Link::qdd and Link::a from the external and joint forces. Without the bias
+		// forces, the forces can be impulses and the result is the velocity change.
+		void propagateForces(bool biasForces);
+		void clearForces();
+
+		// Normal and friction rows of the contact points
+		void addContactRows(const ContactManifold& manifold, const ContactSolver* solver, float dt);
+		// Velocity of the body of the side (0 A, 1 B) at the contact point along the row
+		float rowVelocity(const ContactRow& row, int side) const;
+		// Dense response of the rows to the row impulses (J*M^-1*J^T)
+		void buildDelassus(const std::vector<ContactRow>& rows);
+		// Velocity change of one side of a self contact for a unit impulse on that side only
+		float sideResponse(const ContactRow& row, int side);
+		// Projected Gauss-Seidel from the row velocities in _rowVelocity
+		void solveRows(std::vector<ContactRow>& rows, int iterations);
+		// Joint space change of the row impulses (Link::a of the root and Link::qdd), the
+		// changes of the bodies outside of the articulation go to _bodyDeltas
+		void applyRows(const std::vector<ContactRow>& rows);
+
+		BodyStore* _bodyStore;
+		JointMotors* _jointMotors;
+		bool _selfCollision;
+		std::vector<Link> _links;
+		glm::vec3 _origin;
+		// Inverse of the articulated inertia of a floating root
+		SpatialInertia _rootInverse;
+		std::vector<uint32_t> _manifoldIndices;
+
+		// Contact scratch
+		std::vector<ContactRow> _contactRows;
+		std::vector<ContactRow> _positionRows;
+		// Column major (the solver adds whole columns to the row velocities)
+		std::vector<float> _delassus;
+		std::vector<float> _rowVelocity;
+		std::vector<BodyDelta> _bodyDeltas;
+};
+
+#endif// ARTICULATION_H
@@ -0,0 +1,239 @@
+//--------------------------------------------------
+// Robot Simulator
+// jointMotors.cpp
+// Date: 2020-11-28
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#include "jointMotors.h"
+#include <algorithm>
+#if defined(__AVX__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+#include "articulation.h"
+
+JointMotors::JointMotors()
+{
+
+}
+
+JointMotors::~JointMotors()
+{
+
+}
+
+JointMotors::MotorId JointMotors::add(Articulation* articulation, int link, const Motor& motor)
+{
+	if(articulation == nullptr || link <= 0 || link >= articulation->getLinkCount() ||
+			articulation->getJointType(link) != Articulation::JointType::REVOLUTE)
+		return INVALID_ID;
+
+	MotorId id;
+	if(!_freeIds.empty())
+	{
+		id = _freeIds.back();
+		_freeIds.pop_back();
+	}
+	else
+	{
+		id = (MotorId)_idToIndex.size();
+		_idToIndex.push_back(0);
+	}
+
+	_idToIndex[id] = size();
+	_indexToId.push_back(id);
+	_articulations.push_back(articulation);
+	_links.push_back(link);
+	_motors.push_back(motor);
+	for(auto array : {&_targetPosition, &_targetVelocity, &_feedforward, &_stiffness, &_damping, &_maxTorque, &_maxVelocity, &_torque})
+		array->push_back(0.0f);
+	updateParameters(size()-1);
+	return id;
+}
+
+void JointMotors::remove(MotorId id)
+{
+	if(!isValid(id))
+		return;
+
+	// Swap with the last motor
+	const uint32_t index = _idToIndex[id];
+	const uint32_t last = size()-1;
+	const MotorId lastId = _indexToId[last];
+	_articulations[index] = _articulations[last];
+	_links[index] = _links[last];
+	_motors[index] = _motors[last];
+	for(auto array : {&_targetPosition, &_targetVelocity, &_feedforward, &_stiffness, &_damping, &_maxTorque, &_maxVelocity, &_torque})
+		(*array)[index] = (*array)[last];
+	_indexToId[index] = lastId;
+	_idToIndex[lastId] = index;
+
+	_articulations.pop_back();
+	_links.pop_back();
+	_motors.pop_back();
+	for(auto array : {&_targetPosition, &_targetVelocity, &_feedforward, &_stiffness, &_damping, &_maxTorque, &_maxVelocity, &_torque})
+		array->pop_back();
+	_indexToId.pop_back();
+	_idToIndex[id] = INVALID_ID;
+	_freeIds.push_back(id);
+}
+
+void JointMotors::setMotor(MotorId id, const Motor& motor)
+{
+	if(!isValid(id))
+		return;
+	_motors[_idToIndex[id]] = motor;
+	updateParameters(_idToIndex[id]);
+}
+
+void JointMotors::updateParameters(uint32_t index)
+{
+	const Motor& motor = _motors[index];
+	const bool position = motor.mode == Mode::POSITION;
+	const bool velocity = position || motor.mode == Mode::VELOCITY;
+	_stiffness[index] = position ? std::max(motor.stiffness, 0.0f) : 0.0f;
+	_damping[index] = velocity ? std::max(motor.damping, 0.0f) : 0.0f;
+	_maxVelocity[index] = std::max(motor.maxVelocity, 0.0f);
+	_maxTorque[index] = std::max(motor.maxTorque, 0.0f);
+	// A target beyond the speed limit would fight the limit
+	_targetVelocity[index] = std::min(std::max(motor.targetVelocity, -_maxVelocity[index]), _maxVelocity[index]);
+	_targetPosition[index] = motor.targetPosition;
+	_feedforward[index] = motor.torque;
+}
+
+void JointMotors::update(float dt)
+{
+	const uint32_t n = size();
+	if(n == 0 || dt <= 0)
+		return;
+
+	// Gather the joint state
+	for(auto array : {&_q, &_qd, &_inverseInertia})
+		array->resize(n);
+	for(uint32_t k=0; k<n; k++)
+	{
+		const Articulation* articulation = _articulations[k];
+		const int link = _links[k];
+		_q[k] = articulation->getJointPosition(link);
+		_qd[k] = articulation->getJointVelocity(link);
+		_inverseInertia[k] = articulation->getJointInverseInertia(link);
+	}
+
+	pdKernel(_q.data(), _qd.data(), _inverseInertia.data(), _targetPosition.data(), _targetVelocity.data(),
+			_feedforward.data(), _stiffness.data(), _damping.data(), _maxTorque.data(), _maxVelocity.data(),
+			dt, _torque.data(), n);
+
+	// Scatter, sleeping articulations ignore the torques (the targets wake them when changed)
+	for(uint32_t k=0; k<n; k++)
+		if(_articulations[k]->isAttached())
+			_articulations[k]->addJointTorque(_links[k], _torque[k], false);
+}
+
+//---------- Kernels ----------//
+void JointMotors::pdKernel(const float* q, const float* qd, const float* inverseInertia,
+		const float* targetPosition, const float* targetVelocity, const float* feedforward,
+		const float* stiffness, const float* damping, const float* maxTorque, const float* maxVelocity,
+		float dt, float* torque, uint32_t n)
+{
+	// tau = (kp*(q* - q - qd*dt) + kd*(qd* - qd))/(1 + (kd + kp*dt)*dt/I) + feedforward,
+	// then the torque is limited so that the next velocity stays under the speed limit
+	// (when the joint inertia is known) and finally by the effort limit
+	uint32_t i = 0;
+#if defined(__AVX__)
+	const __m256 vdt = _mm256_set1_ps(dt);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 big = _mm256_set1_ps(FLT_MAX);
+	for(; i+8<=n; i+=8)
+	{
+		const __m256 x = _mm256_loadu_ps(&q[i]);
+		const __m256 v = _mm256_loadu_ps(&qd[i]);
+		const __m256 kp = _mm256_loadu_ps(&stiffness[i]);
+		const __m256 kd = _mm256_loadu_ps(&damping[i]);
+		const __m256 h = _mm256_mul_ps(vdt, _mm256_loadu_ps(&inverseInertia[i]));
+
+		const __m256 positionError = _mm256_sub_ps(_mm256_sub_ps(_mm256_loadu_ps(&targetPosition[i]), x), _mm256_mul_ps(v, vdt));
+		const __m256 velocityError = _mm256_sub_ps(_mm256_loadu_ps(&targetVelocity[i]), v);
+		const __m256 denominator = _mm256_add_ps(one, _mm256_mul_ps(_mm256_add_ps(kd, _mm256_mul_ps(kp, vdt)), h));
+		__m256 tau = _mm256_div_ps(_mm256_add_ps(_mm256_mul_ps(kp, positionError), _mm256_mul_ps(kd, velocityError)), denominator);
+		tau = _mm256_add_ps(tau, _mm256_loadu_ps(&feedforward[i]));
+
+		const __m256 known = _mm256_cmp_ps(h, zero, _CMP_GT_OQ);
+		const __m256 invH = _mm256_div_ps(one, _mm256_blendv_ps(one, h, known));
+		const __m256 vmax = _mm256_loadu_ps(&maxVelocity[i]);
+		const __m256 upper = _mm256_blendv_ps(big, _mm256_mul_ps(_mm256_sub_ps(vmax, v), invH), known);
+		const __m256 lower = _mm256_blendv_ps(_mm256_sub_ps(zero, big), _mm256_mul_ps(_mm256_sub_ps(_mm256_sub_ps(zero, vmax), v), invH), known);
+		tau = _mm256_max_ps(_mm256_min_ps(tau, upper), lower);
+
+		const __m256 effort = _mm256_loadu_ps(&maxTorque[i]);
+		tau = _mm256_max_ps(_mm256_min_ps(tau, effort), _mm256_sub_ps(zero, effort));
+		_mm256_storeu_ps(&torque[i], tau);
+	}
+#elif defined(__SSE4_1__)
+	const __m128 vdt = _mm_set1_ps(dt);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 big = _mm_set1_ps(FLT_MAX);
+	for(; i+4<=n; i+=4)
+	{
+		const __m128 x = _mm_loadu_ps(&q[i]);
+		const __m128 v = _mm_loadu_ps(&qd[i]);
+		const __m128 kp = _mm_loadu_ps(&stiffness[i]);
+		const __m128 kd = _mm_loadu_ps(&damping[i]);
+		const __m128 h = _mm_mul_ps(vdt, _mm_loadu_ps(&inverseInertia[i]));
+
+		const __m128 positionError = _mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(&targetPosition[i]), x), _mm_mul_ps(v, vdt));
+		const __m128 velocityError = _mm_sub_ps(_mm_loadu_ps(&targetVelocity[i]), v);
+		const __m128 denominator = _mm_add_ps(one, _mm_mul_ps(_mm_add_ps(kd, _mm_mul_ps(kp, vdt)), h));
+		__m128 tau = _mm_div_ps(_mm_add_ps(_mm_mul_ps(kp, positionError), _mm_mul_ps(kd, velocityError)), denominator);
+		tau = _mm_add_ps(tau, _mm_loadu_ps(&feedforward[i]));
+
+		const __m128 known = _mm_cmpgt_ps(h, zero);
+		const __m128 invH = _mm_div_ps(one, _mm_blendv_ps(one, h, known));
+		const __m128 vmax = _mm_loadu_ps(&maxVelocity[i]);
+		const __m128 upper = _mm_blendv_ps(big, _mm_mul_ps(_mm_sub_ps(vmax, v), invH), known);
+		const __m128 lower = _mm_blendv_ps(_mm_sub_ps(zero, big), _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(zero, vmax), v), invH), known);
+		tau = _mm_max_ps(_mm_min_ps(tau, upper), lower);
+
+		const __m128 effort = _mm_loadu_ps(&maxTorque[i]);
+		tau = _mm_max_ps(_mm_min_ps(tau, effort), _mm_sub_ps(zero, effort));
+		_mm_storeu_ps(&torque[i], tau);
+	}
+#endif
+
+	for(; i<n; i++)
+	{
+		const float h = dt*inverseInertia[i];
+		const float positionError = targetPosition[i] - q[i] - qd[i]*dt;
+		const float velocityError = targetVelocity[i] - qd[i];
+		float tau = (stiffness[i]*positionError + damping[i]*velocityError)/(1.0f + (damping[i] + stiffness[i]*dt)*h);
+		tau += feedforward[i];
+
+		if(h > 0)
+			tau = std::max(std::min(tau, (maxVelocity[i] - qd[i])/h), (-maxVelocity[i] - qd[i])/h);
+		torque[i] = std::max(std::min(tau, maxTorque[i]), -maxTorque[i]);
+	}
+}
+
+void JointMotors::saveState(StateSnapshot& snapshot) const
+{
+	snapshot.writeArray(_idToIndex);
+	snapshot.writeArray(_indexToId);
+	snapshot.writeArray(_freeIds);
+	snapshot.writeArray(_articulations);
+	snapshot.writeArray(_links);
+	snapshot.writeArray(_motors);
+	for(const auto* array : {&_targetPosition, &_targetVelocity, &_feedforward, &_stiffness, &_damping, &_maxTorque, &_maxVelocity, &_torque})
+		snapshot.writeArray(*array);
+}
+
+void JointMotors::restoreState(StateSnapshot::Reader& reader)
+{
+	reader.readArray(_idToIndex);
+	reader.readArray(_indexToId);
+	reader.readArray(_freeIds);
+	reader.readArray(_articulations);
+	reader.readArray(_links);
+	reader.readArray(_motors);
+	for(auto* array : {&_targetPosition, &_targetVelocity, &_feedforward, &_stiffness, &_damping, &_maxTorque, &_maxVelocity, &_torque})
+		reader.readArray(*array);
+}
@@ -0,0 +1,101 @@
+//--------------------------------------------------
+// Robot Simulator
+// jointMotors.h
+// Date: 2020-11-28
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef JOINT_MOTORS_H
+#define JOINT_MOTORS_H
+
+#include <vector>
+#include <cfloat>
+#include <cstdint>
+#include "../stateSnapshot.h"
+
+class Articulation;
+
+// Motors of the revolute joints of every articulation. The motor parameters
+// are stored in flat arrays and the PD torques of all the motors are computed
+// by one SIMD kernel per step (gather the joint state, compute, scatter the
+// joint torques), before the articulations integrate their velocities.
+//
+// The PD law is implicit in the joint velocity (stable PD): the torque takes
+// into account the velocity change it produces in the step, using the joint
+// inertia of the last step. Stiff gains stay stable at large time steps.
+class JointMotors
+{
+	public:
+		typedef uint32_t MotorId;
+		static const MotorId INVALID_ID = 0xFFFFFFFF;
+
+		enum class Mode
+		{
+			// Only the feedforward torque
+			TORQUE,
+			// Damping towards the target velocity
+			VELOCITY,
+			// Stiffness towards the target position and damping towards the target velocity
+			POSITION
+		};
+
+		struct Motor
+		{
+			Mode mode = Mode::TORQUE;
+			// Added to the PD torque in every mode
+			float torque = 0.0f;
+			float targetPosition = 0.0f;
+			float targetVelocity = 0.0f;
+			float stiffness = 10.0f;
+			float damping = 1.0f;
+			// Effort and joint speed limits
+			float maxTorque = FLT_MAX;
+			float maxVelocity = FLT_MAX;
+		};
+
+		JointMotors();
+		~JointMotors();
+
+		// Motor of a revolute joint of an attached articulation
+		MotorId add(Articulation* articulation, int link, const Motor& motor);
+		void remove(MotorId id);
+		void update(float dt);
+		// Motors and their targets (the controller state)
+		void saveState(StateSnapshot& snapshot) const;
+		void restoreState(StateSnapshot::Reader& reader);
+
+		//---------- Getters ----------//
+		uint32_t size() const { return (uint32_t)_indexToId.size(); }
+		bool isValid(MotorId id) const { return id < _idToIndex.size() && _idToIndex[id] != INVALID_ID; }
+		const Motor& getMotor(MotorId id) const { return _motors[_idToIndex[id]]; }
+		// Torque applied in the last step (after the limits)
+		float getTorque(MotorId id) const { return _torque[_idToIndex[id]]; }
+
+		//---------- Setters ----------//
+		void setMotor(MotorId id, const Motor& motor);
+
+	private:
+		// Gains and limits used by the kernel (the mode selects the gains)
+		void updateParameters(uint32_t index);
+
+		static void pdKernel(const float* q, const float* qd, const float* inverseInertia,
+				const float* targetPosition, const float* targetVelocity, const float* feedforward,
+				const float* stiffness, const float* damping, const float* maxTorque, const float* maxVelocity,
+				float dt, float* torque, uint32_t n);
+
+		std::vector<MotorId> _idToIndex;
+		std::vector<MotorId> _indexToId;
+		std::vector<MotorId> _freeIds;
+
+		std::vector<Articulation*> _articulations;
+		std::vector<int> _links;
+		std::vector<Motor> _motors;
+		// Kernel parameters
+		std::vector<float> _targetPosition, _targetVelocity, _feedforward;
+		std::vector<float> _stiffness, _damping, _maxTorque, _maxVelocity;
+		std::vector<float> _torque;
+
+		// Scratch (reused every step)
+		std::vector<float> _q, _qd, _inverseInertia;
+};
+
+#endif// JOINT_MOTORS_H
@@ -0,0 +1,636 @@
+//--------------------------------------------------
+// Robot Simulator
+// bodyStore.cpp
+// Date: 2020-11-02
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#include "bodyStore.h"
+#include "objectPhysics.h"
+#include <cmath>
+#include <utility>
+#include <algorithm>
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+BodyStore::BodyStore():
+	_dampingDt(-1.0f), _interpolationAlpha(1.0f), _activeCount(0), _ccdCount(0), _revision(0)
+{
+}
+
+BodyStore::~BodyStore()
+{
+	// Give the state back to the handles that are still alive
+	for(uint32_t i=0; i<size(); i++)
+	{
+		ObjectPhysics* owner = _owners[i];
+		if(owner != nullptr)
+			owner->detach(getState(_indexToId[i]));
+	}
+}
+
+BodyStore::BodyId BodyStore::add(ObjectPhysics* owner, const BodyState& state)
+{
+	BodyId id;
+	if(!_freeIds.empty())
+	{
+		id = _freeIds.back();
+		_freeIds.pop_back();
+	}
+	else
+	{
+		id = (BodyId)_idToIndex.size();
+		_idToIndex.push_back(0);
+	}
+
+	_idToIndex[id] = size();
+	_indexToId.push_back(id);
+	_owners.push_back(owner);
+
+	_posX.push_back(state.position.x);
+	_posY.push_back(state.position.y);
+	_posZ.push_back(state.position.z);
+	_velX.push_back(state.velocity.x);
+	_velY.push_back(state.velocity.y);
+	_velZ.push_back(state.velocity.z);
+	_accX.push_back(state.acceleration.x);
+	_accY.push_back(state.acceleration.y);
+	_accZ.push_back(state.acceleration.z);
+	_forceX.push_back(state.forceAccum.x);
+	_forceY.push_back(state.forceAccum.y);
+	_forceZ.push_back(state.forceAccum.z);
+	_angVelX.push_back(state.angularVelocity.x);
+	_angVelY.push_back(state.angularVelocity.y);
+	_angVelZ.push_back(state.angularVelocity.z);
+	_torqueX.push_back(state.torqueAccum.x);
+	_torqueY.push_back(state.torqueAccum.y);
+	_torqueZ.push_back(state.torqueAccum.z);
+	_inverseMass.push_back(state.inverseMass);
+	for(std::vector<float>* array : {&_invInertiaX, &_invInertiaY, &_invInertiaZ,
+			&_invInertiaXX, &_invInertiaXY, &_invInertiaXZ, &_invInertiaYY, &_invInertiaYZ, &_invInertiaZZ})
+		array->push_back(0.0f);
+	_damping.push_back(state.damping);
+	_dampingFactor.push_back(1.0f);
+	_dampingDt = -1.0f;
+	_halfX.push_back(state.halfExtents.x);
+	_halfY.push_back(state.halfExtents.y);
+	_halfZ.push_back(state.halfExtents.z);
+	_rotX.push_back(state.orientation.x);
+	_rotY.push_back(state.orientation.y);
+	_rotZ.push_back(state.orientation.z);
+	_rotW.push_back(state.orientation.w);
+	_shapeType.push_back(state.shapeType);
+	_friction.push_back(state.friction);
+	_restitution.push_back(state.restitution);
+	_articulated.push_back(0);
+	_ccd.push_back(state.ccd);
+	_ccdCount += state.ccd;
+	_prevPosX.push_back(state.position.x);
+	_prevPosY.push_back(state.position.y);
+	_prevPosZ.push_back(state.position.z);
+	_prevRotX.push_back(state.orientation.x);
+	_prevRotY.push_back(state.orientation.y);
+	_prevRotZ.push_back(state.orientation.z);
+	_prevRotW.push_back(state.orientation.w);
+	_rotation.push_back(glm::mat3_cast(state.orientation));
+	_transform.push_back(glm::mat4(1.0f));
+	updateInertia(size()-1);
+	updateTransform(size()-1);
+
+	// New dynamic bodies start awake
+	if(state.inverseMass > 0)
+	{
+		swapBodies(size()-1, _activeCount);
+		_activeCount++;
+	}
+
+	_addedIds.push_back(id);
+	_revision++;
+
+	return id;
+}
+
+void BodyStore::remove(BodyId id)
+{
+	uint32_t index = _idToIndex[id];
+	const uint32_t last = size()-1;
+	_ccdCount -= _ccd[index];
+
+	// Leave the active partition first
+	if(index < _activeCount)
+	{
+		swapBodies(index, _activeCount-1);
+		_activeCount--;
+		index = _activeCount;
+	}
+
+	// Move last body to the removed slot
+	forEachArray([index, last](auto& array)
+	{
+		array[index] = array[last];
+		array.pop_back();
+	});
+	_idToIndex[_indexToId[index]] = index;
+
+	_idToIndex[id] = INVALID_ID;
+	_pendingFreeIds.push_back(id);
+	_removedIds.push_back(id);
+	_revision++;
+}
+
+void BodyStore::clearEvents()
+{
+	_freeIds.insert(_freeIds.end(), _pendingFreeIds.begin(), _pendingFreeIds.end());
+	_pendingFreeIds.clear();
+	_addedIds.clear();
+	_removedIds.clear();
+	_teleportedIds.clear();
+	_wakeRequests.clear();
+}
+
+void BodyStore::swapBodies(uint32_t i, uint32_t j)
+{
+	if(i == j)
+		return;
+
+	forEachArray([i, j](auto& array)
+	{
+		std::swap(array[i], array[j]);
+	});
+	_idToIndex[_indexToId[i]] = i;
+	_idToIndex[_indexToId[j]] = j;
+}
+
+void BodyStore::wake(BodyId id)
+{
+	const uint32_t index = _idToIndex[id];
+	if(index < _activeCount || _inverseMass[index] <= 0)
+		return;
+
+	swapBodies(index, _activeCount);
+	_activeCount++;
+}
+
+void BodyStore::sleep(BodyId id)
+{
+	const uint32_t index = _idToIndex[id];
+	if(index >= _activeCount)
+		return;
+
+	// The pose is frozen, it should not keep interpolating
+	setVelocityByIndex(index, glm::vec3(0));
+	setAngularVelocityByIndex(index, glm::vec3(0));
+	snapPreviousState(index);
+	_dirtyTransforms.push_back(id);
+	swapBodies(index, _activeCount-1);
+	_activeCount--;
+}
+
+void BodyStore::setCcdEnabled(BodyId id, bool enabled)
+{
+	const uint32_t i = _idToIndex[id];
+	_ccdCount += (uint32_t)enabled - _ccd[i];
+	_ccd[i] = enabled;
+}
+
+void BodyStore::setInverseMass(BodyId id, float inverseMass)
+{
+	const bool wasDynamic = _inverseMass[_idToIndex[id]] > 0;
+	_inverseMass[_idToIndex[id]] = inverseMass;
+	updateInertia(_idToIndex[id]);
+	if(wasDynamic && inverseMass <= 0)
+		sleep(id);
+	else if(!wasDynamic && inverseMass > 0)
+		wake(id);
+}
+
+BodyStore::BodyState BodyStore::getState(BodyId id) const
+{
+	BodyState state;
+	state.position = getPosition(id);
+	state.velocity = getVelocity(id);
+	state.acceleration = getAcceleration(id);
+	state.forceAccum = getForceAccum(id);
+	state.angularVelocity = getAngularVelocity(id);
+	state.torqueAccum = getTorqueAccum(id);
+	state.inverseMass = getInverseMass(id);
+	state.damping = getDamping(id);
+	state.halfExtents = getHalfExtents(id);
+	state.orientation = getOrientation(id);
+	state.shapeType = getShapeType(id);
+	state.friction = getFriction(id);
+	state.restitution = getRestitution(id);
+	state.ccd = isCcdEnabled(id);
+	return state;
+}
+
+uint64_t BodyStore::computeStateHash() const
+{
+	// FNV-1a over the float bits, any change of a single bit changes the hash
+	uint64_t hash = 14695981039346656037ull;
+	auto add = [&hash](const void* data, size_t size)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		for(size_t i=0; i<size; i++)
+			hash = (hash ^ bytes[i])*1099511628211ull;
+	};
+
+	for(BodyId id=0; id<(BodyId)_idToIndex.size(); id++)
+	{
+		const uint32_t i = _idToIndex[id];
+		if(i == INVALID_ID)
+			continue;
+		const float state[13] = {_posX[i], _posY[i], _posZ[i], _rotX[i], _rotY[i], _rotZ[i], _rotW[i],
+			_velX[i], _velY[i], _velZ[i], _angVelX[i], _angVelY[i], _angVelZ[i]};
+		add(&id, sizeof(id));
+		add(state, sizeof(state));
+	}
+	return hash;
+}
+
+void BodyStore::saveState(StateSnapshot& snapshot) const
+{
+	forEachArray([&snapshot](const auto& array){ snapshot.writeArray(array); });
+	snapshot.writeArray(_idToIndex);
+	snapshot.writeArray(_freeIds);
+	snapshot.writeArray(_pendingFreeIds);
+	snapshot.writeArray(_dirtyTransforms);
+	snapshot.writeArray(_addedIds);
+	snapshot.writeArray(_removedIds);
+	snapshot.writeArray(_teleportedIds);
+	snapshot.writeArray(_wakeRequests);
+	snapshot.write(_activeCount);
+	snapshot.write(_ccdCount);
+	snapshot.write(_dampingDt);
+	snapshot.write(_interpolationAlpha);
+}
+
+void BodyStore::restoreState(StateSnapshot::Reader& reader)
+{
+	forEachArray([&reader](auto& array){ reader.readArray(array); });
+	reader.readArray(_idToIndex);
+	reader.readArray(_freeIds);
+	reader.readArray(_pendingFreeIds);
+	reader.readArray(_dirtyTransforms);
+	reader.readArray(_addedIds);
+	reader.readArray(_removedIds);
+	reader.readArray(_teleportedIds);
+	reader.readArray(_wakeRequests);
+	reader.read(_activeCount);
+	reader.read(_ccdCount);
+	reader.read(_dampingDt);
+	reader.read(_interpolationAlpha);
+}
+
+void BodyStore::savePreviousState()
+{
+	const uint32_t n = _activeCount;
+	std::copy(_posX.begin(), _posX.begin()+n, _prevPosX.begin());
+	std::copy(_posY.begin(), _posY.begin()+n, _prevPosY.begin());
+	std::copy(_posZ.begin(), _posZ.begin()+n, _prevPosZ.begin());
+	std::copy(_rotX.begin(), _rotX.begin()+n, _prevRotX.begin());
+	std::copy(_rotY.begin(), _rotY.begin()+n, _prevRotY.begin());
+	std::copy(_rotZ.begin(), _rotZ.begin()+n, _prevRotZ.begin());
+	std::copy(_rotW.begin(), _rotW.begin()+n, _prevRotW.begin());
+}
+
+void BodyStore::snapPreviousState(uint32_t i)
+{
+	_prevPosX[i] = _posX[i];
+	_prevPosY[i] = _posY[i];
+	_prevPosZ[i] = _posZ[i];
+	_prevRotX[i] = _rotX[i];
+	_prevRotY[i] = _rotY[i];
+	_prevRotZ[i] = _rotZ[i];
+	_prevRotW[i] = _rotW[i];
+}
+
+void BodyStore::updateInertia(uint32_t i)
+{
+	const float invMass = _inverseMass[i];
+	if(invMass <= 0)
+	{
+		_invInertiaX[i] = _invInertiaY[i] = _invInertiaZ[i] = 0.0f;
+		updateRotation(i);
+		return;
+	}
+
+	// Principal moments of solid shapes (times the inverse mass)
+	const glm::vec3 h = {_halfX[i], _halfY[i], _halfZ[i]};
+	glm::vec3 inertia;
+	switch(_shapeType[i])
+	{
+		case ShapeType::SPHERE:
+			inertia = glm::vec3(0.4f*h.x*h.x);
+			break;
+		case ShapeType::CYLINDER:
+		{
+			// Radius x, half height y, axis Y
+			const float side = (3.0f*h.x*h.x + 4.0f*h.y*h.y)/12.0f;
+			inertia = {side, 0.5f*h.x*h.x, side};
+			break;
+		}
+		default:
+			// Boxes (planes are thin boxes)
+			inertia = glm::vec3(h.y*h.y + h.z*h.z, h.x*h.x + h.z*h.z, h.x*h.x + h.y*h.y)/3.0f;
+			break;
+	}
+
+	// Degenerate axes do not rotate
+	_invInertiaX[i] = inertia.x > 0 ? invMass/inertia.x : 0.0f;
+	_invInertiaY[i] = inertia.y > 0 ? invMass/inertia.y : 0.0f;
+	_invInertiaZ[i] = inertia.z > 0 ? invMass/inertia.z : 0.0f;
+	updateRotation(i);
+}
+
+void BodyStore::updateRotation(uint32_t i)
+{
+	const glm::mat3 r = glm::mat3_cast(getOrientationByIndex(i));
+	_rotation[i] = r;
+
+	// R*diag(I^-1)*R^T, only the upper triangle is stored
+	const glm::vec3 d = {_invInertiaX[i], _invInertiaY[i], _invInertiaZ[i]};
+	const glm::vec3 row0 = {r[0][0], r[1][0], r[2][0]};
+	const glm::vec3 row1 = {r[0][1], r[1][1], r[2][1]};
+	const glm::vec3 row2 = {r[0][2], r[1][2], r[2][2]};
+	_invInertiaXX[i] = glm::dot(row0*d, row0);
+	_invInertiaXY[i] = glm::dot(row0*d, row1);
+	_invInertiaXZ[i] = glm::dot(row0*d, row2);
+	_invInertiaYY[i] = glm::dot(row1*d, row1);
+	_invInertiaYZ[i] = glm::dot(row1*d, row2);
+	_invInertiaZZ[i] = glm::dot(row2*d, row2);
+}
+
+void BodyStore::updateTransform(uint32_t i)
+{
+	const BodyId id = _indexToId[i];
+	glm::mat4 transform = glm::mat4_cast(getInterpolatedOrientation(id));
+	transform[3] = glm::vec4(getInterpolatedPosition(id), 1.0f);
+	_transform[i] = transform;
+}
+
+void BodyStore::updateTransforms()
+{
+	for(uint32_t i=0; i<_activeCount; i++)
+		updateTransform(i);
+
+	// Moved while asleep or static (may have been removed since)
+	for(BodyId id : _dirtyTransforms)
+		if(isValid(id) && _idToIndex[id] >= _activeCount)
+			updateTransform(_idToIndex[id]);
+	_dirtyTransforms.clear();
+}
+
+glm::vec3 BodyStore::getInterpolatedPosition(BodyId id) const
+{
+	const uint32_t i = _idToIndex[id];
+	const glm::vec3 previous = {_prevPosX[i], _prevPosY[i], _prevPosZ[i]};
+	const glm::vec3 current = {_posX[i], _posY[i], _posZ[i]};
+	return glm::mix(previous, current, _interpolationAlpha);
+}
+
+glm::quat BodyStore::getInterpolatedOrientation(BodyId id) const
+{
+	const uint32_t i = _idToIndex[id];
+	const glm::quat previous = glm::quat(_prevRotW[i], _prevRotX[i], _prevRotY[i], _prevRotZ[i]);
+	const glm::quat current = getOrientationByIndex(i);
+	if(previous == current)
+		return current;
+	return glm::slerp(previous, current, _interpolationAlpha);
+}
+
+void BodyStore::addForceToAll(glm::vec3 force)
+{
+	const uint32_t n = _activeCount;
+	for(uint32_t i=0; i<n; i++)
+	{
+		_forceX[i] += force.x;
+		_forceY[i] += force.y;
+		_forceZ[i] += force.z;
+	}
+}
+
+void BodyStore::updateDampingFactors(float dt)
+{
+	if(dt == _dampingDt)
+		return;
+
+	// powf is not vectorizable, so it is only computed when the timestep changes
+	for(uint32_t i=0; i<size(); i++)
+		_dampingFactor[i] = powf(_damping[i], dt);
+	_dampingDt = dt;
+}
+
+void BodyStore::integrateVelocities(float dt)
+{
+	updateDampingFactors(dt);
+
+	// Sleeping and static bodies are after the active partition
+	const uint32_t n = _activeCount;
+	uint32_t i = 0;
+
+	// Immovable bodies (inverseMass<=0) are masked out of the update
+#if defined(__AVX__)
+	const __m256 vdt = _mm256_set1_ps(dt);
+	const __m256 zero = _mm256_setzero_ps();
+	for(; i+8<=n; i+=8)
+	{
+		const __m256 invMass = _mm256_loadu_ps(&_inverseMass[i]);
+		const __m256 movable = _mm256_cmp_ps(invMass, zero, _CMP_GT_OQ);
+		const __m256 damp = _mm256_loadu_ps(&_dampingFactor[i]);
+
+		float* vel[3] = {&_velX[i], &_velY[i], &_velZ[i]};
+		float* acc[3] = {&_accX[i], &_accY[i], &_accZ[i]};
+		float* force[3] = {&_forceX[i], &_forceY[i], &_forceZ[i]};
+		for(int axis=0; axis<3; axis++)
+		{
+			const __m256 v = _mm256_loadu_ps(vel[axis]);
+			const __m256 a = _mm256_add_ps(_mm256_loadu_ps(acc[axis]), _mm256_mul_ps(_mm256_loadu_ps(force[axis]), invMass));
+			const __m256 newV = _mm256_mul_ps(_mm256_add_ps(v, _mm256_mul_ps(a, vdt)), damp);
+
+			_mm256_storeu_ps(vel[axis], _mm256_blendv_ps(v, newV, movable));
+			_mm256_storeu_ps(force[axis], zero);
+		}
+	}
+#elif defined(__SSE2__)
+	const __m128 vdt = _mm_set1_ps(dt);
+	const __m128 zero = _mm_setzero_ps();
+	for(; i+4<=n; i+=4)
+	{
+		const __m128 invMass = _mm_loadu_ps(&_inverseMass[i]);
+		const __m128 movable = _mm_cmpgt_ps(invMass, zero);
+		const __m128 damp = _mm_loadu_ps(&_dampingFactor[i]);
+
+		float* vel[3] = {&_velX[i], &_velY[i], &_velZ[i]};
+		float* acc[3] = {&_accX[i], &_accY[i], &_accZ[i]};
+		float* force[3] = {&_forceX[i], &_forceY[i], &_forceZ[i]};
+		for(int axis=0; axis<3; axis++)
+		{
+			const __m128 v = _mm_loadu_ps(vel[axis]);
+			const __m128 a = _mm_add_ps(_mm_loadu_ps(acc[axis]), _mm_mul_ps(_mm_loadu_ps(force[axis]), invMass));
+			const __m128 newV = _mm_mul_ps(_mm_add_ps(v, _mm_mul_ps(a, vdt)), damp);
+
+			// SSE2 has no blendv
+			_mm_storeu_ps(vel[axis], _mm_or_ps(_mm_and_ps(movable, newV), _mm_andnot_ps(movable, v)));
+			_mm_storeu_ps(force[axis], zero);
+		}
+	}
+#endif
+
+	// Remaining bodies
+	for(; i<n; i++)
+	{
+		const float invMass = _inverseMass[i];
+		if(invMass>0)
+		{
+			const float damp = _dampingFactor[i];
+			_velX[i] = (_velX[i] + (_accX[i] + _forceX[i]*invMass)*dt)*damp;
+			_velY[i] = (_velY[i] + (_accY[i] + _forceY[i]*invMass)*dt)*damp;
+			_velZ[i] = (_velZ[i] + (_accZ[i] + _forceZ[i]*invMass)*dt)*damp;
+		}
+
+		// Clear accumulator
+		_forceX[i] = _forceY[i] = _forceZ[i] = 0;
+	}
+
+	integrateAngularVelocities(dt);
+}
+
+void BodyStore::integrateAngularVelocities(float dt)
+{
+	// w += I^-1*torque*dt with the world inverse inertia, static bodies have a zero tensor
+	const uint32_t n = _activeCount;
+	uint32_t i = 0;
+
+#if defined(__AVX__)
+	const __m256 vdt = _mm256_set1_ps(dt);
+	const __m256 zero = _mm256_setzero_ps();
+	for(; i+8<=n; i+=8)
+	{
+		const __m256 damp = _mm256_loadu_ps(&_dampingFactor[i]);
+		const __m256 tx = _mm256_loadu_ps(&_torqueX[i]);
+		const __m256 ty = _mm256_loadu_ps(&_torqueY[i]);
+		const __m256 tz = _mm256_loadu_ps(&_torqueZ[i]);
+		const __m256 xx = _mm256_loadu_ps(&_invInertiaXX[i]);
+		const __m256 xy = _mm256_loadu_ps(&_invInertiaXY[i]);
+		const __m256 xz = _mm256_loadu_ps(&_invInertiaXZ[i]);
+		const __m256 yy = _mm256_loadu_ps(&_invInertiaYY[i]);
+		const __m256 yz = _mm256_loadu_ps(&_invInertiaYZ[i]);
+		const __m256 zz = _mm256_loadu_ps(&_invInertiaZZ[i]);
+
+		const __m256 ax = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(xx, tx), _mm256_mul_ps(xy, ty)), _mm256_mul_ps(xz, tz));
+		const __m256 ay = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(xy, tx), _mm256_mul_ps(yy, ty)), _mm256_mul_ps(yz, tz));
+		const __m256 az = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(xz, tx), _mm256_mul_ps(yz, ty)), _mm256_mul_ps(zz, tz));
+
+		float* w[3] = {&_angVelX[i], &_angVelY[i], &_angVelZ[i]};
+		const __m256 a[3] = {ax, ay, az};
+		for(int axis=0; axis<3; axis++)
+			_mm256_storeu_ps(w[axis], _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(w[axis]), _mm256_mul_ps(a[axis], vdt)), damp));
+
+		_mm256_storeu_ps(&_torqueX[i], zero);
+		_mm256_storeu_ps(&_torqueY[i], zero);
+		_mm256_storeu_ps(&_torqueZ[i], zero);
+	}
+#elif defined(__SSE2__)
+	const __m128 vdt = _mm_set1_ps(dt);
+	const __m128 zero = _mm_setzero_ps();
+	for(; i+4<=n; i+=4)
+	{
+		const __m128 damp = _mm_loadu_ps(&_dampingFactor[i]);
+		const __m128 tx = _mm_loadu_ps(&_torqueX[i]);
+		const __m128 ty = _mm_loadu_ps(&_torqueY[i]);
+		const __m128 tz = _mm_loadu_ps(&_torqueZ[i]);
+		const __m128 xx = _mm_loadu_ps(&_invInertiaXX[i]);
+		const __m128 xy = _mm_loadu_ps(&_invInertiaXY[i]);
+		const __m128 xz = _mm_loadu_ps(&_invInertiaXZ[i]);
+		const __m128 yy = _mm_loadu_ps(&_invInertiaYY[i]);
+		const __m128 yz = _mm_loadu_ps(&_invInertiaYZ[i]);
+		const __m128 zz = _mm_loadu_ps(&_invInertiaZZ[i]);
+
+		const __m128 ax = _mm_add_ps(_mm_add_ps(_mm_mul_ps(xx, tx), _mm_mul_ps(xy, ty)), _mm_mul_ps(xz, tz));
+		const __m128 ay = _mm_add_ps(_mm_add_ps(_mm_mul_ps(xy, tx), _mm_mul_ps(yy, ty)), _mm_mul_ps(yz, tz));
+		const __m128 az = _mm_add_ps(_mm_add_ps(_mm_mul_ps(xz, tx), _mm_mul_ps(yz, ty)), _mm_mul_ps(zz, tz));
+
+		float* w[3] = {&_angVelX[i], &_angVelY[i], &_angVelZ[i]};
+		const __m128 a[3] = {ax, ay, az};
+		for(int axis=0; axis<3; axis++)
+			_mm_storeu_ps(w[axis], _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(w[axis]), _mm_mul_ps(a[axis], vdt)), damp));
+
+		_mm_storeu_ps(&_torqueX[i], zero);
+		_mm_storeu_ps(&_torqueY[i], zero);
+		_mm_storeu_ps(&_torqueZ[i], zero);
+	}
+#endif
+
+	for(; i<n; i++)
+	{
+		const float tx = _torqueX[i], ty = _torqueY[i], tz = _torqueZ[i];
+		const float damp = _dampingFactor[i];
+		_angVelX[i] = (_angVelX[i] + (_invInertiaXX[i]*tx + _invInertiaXY[i]*ty + _invInertiaXZ[i]*tz)*dt)*damp;
+		_angVelY[i] = (_angVelY[i] + (_invInertiaXY[i]*tx + _invInertiaYY[i]*ty + _invInertiaYZ[i]*tz)*dt)*damp;
+		_angVelZ[i] = (_angVelZ[i] + (_invInertiaXZ[i]*tx + _invInertiaYZ[i]*ty + _invInertiaZZ[i]*tz)*dt)*damp;
+
+		_torqueX[i] = _torqueY[i] = _torqueZ[i] = 0;
+	}
+}
+
+void BodyStore::integratePositions(float dt)
+{
+	const uint32_t n = _activeCount;
+	uint32_t i = 0;
+
+#if defined(__AVX__)
+	const __m256 vdt = _mm256_set1_ps(dt);
+	const __m256 zero = _mm256_setzero_ps();
+	for(; i+8<=n; i+=8)
+	{
+		const __m256 movable = _mm256_cmp_ps(_mm256_loadu_ps(&_inverseMass[i]), zero, _CMP_GT_OQ);
+
+		float* pos[3] = {&_posX[i], &_posY[i], &_posZ[i]};
+		const float* vel[3] = {&_velX[i], &_velY[i], &_velZ[i]};
+		for(int axis=0; axis<3; axis++)
+		{
+			const __m256 p = _mm256_loadu_ps(pos[axis]);
+			const __m256 newP = _mm256_add_ps(p, _mm256_mul_ps(_mm256_loadu_ps(vel[axis]), vdt));
+			_mm256_storeu_ps(pos[axis], _mm256_blendv_ps(p, newP, movable));
+		}
+	}
+#elif defined(__SSE2__)
+	const __m128 vdt = _mm_set1_ps(dt);
+	const __m128 zero = _mm_setzero_ps();
+	for(; i+4<=n; i+=4)
+	{
+		const __m128 movable = _mm_cmpgt_ps(_mm_loadu_ps(&_inverseMass[i]), zero);
+
+		float* pos[3] = {&_posX[i], &_posY[i], &_posZ[i]};
+		const float* vel[3] = {&_velX[i], &_velY[i], &_velZ[i]};
+		for(int axis=0; axis<3; axis++)
+		{
+			const __m128 p = _mm_loadu_ps(pos[axis]);
+			const __m128 newP = _mm_add_ps(p, _mm_mul_ps(_mm_loadu_ps(vel[axis]), vdt));
+			_mm_storeu_ps(pos[axis], _mm_or_ps(_mm_and_ps(movable, newP), _mm_andnot_ps(movable, p)));
+		}
+	}
+#endif
+
+	for(; i<n; i++)
+	{
+		if(_inverseMass[i]>0)
+		{
+			_posX[i] += _velX[i]*dt;
+			_posY[i] += _velY[i]*dt;
+			_posZ[i] += _velZ[i]*dt;
+		}
+	}
+
+	// Orientation, q += 0.5*dt*(w,0)*q
+	for(i=0; i<n; i++)
+	{
+		const glm::vec3 w = getAngularVelocityByIndex(i);
+		if(_inverseMass[i] <= 0 || (w.x == 0 && w.y == 0 && w.z == 0))
+			continue;
+		glm::quat q = getOrientationByIndex(i);
+		q = glm::normalize(q + glm::quat(0, w*(0.5f*dt))*q);
+		setOrientationByIndex(i, q);
+	}
+}
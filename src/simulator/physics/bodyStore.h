@@ -0,0 +1,319 @@
+//--------------------------------------------------
+// Robot Simulator
+// bodyStore.h
+// Date: 2020-11-02
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef BODY_STORE_H
+#define BODY_STORE_H
+
+#include <vector>
+#include <cstdint>
+#include "glm.h"
+#include <glm/gtc/quaternion.hpp>
+#include "aabb.h"
+#include "stateSnapshot.h"
+#include "colliders/shape.h"
+
+class ObjectPhysics;
+
+// Structure-of-arrays storage for every rigid body registered in the physics engine.
+// Bodies are referenced by a stable id, the arrays are indexed by a dense index
+// that can change when other bodies are removed (swap-remove) or change partition.
+// Awake dynamic bodies are kept in [0, activeCount), sleeping and static bodies after them,
+// so the per-step kernels only touch the active set.
+class BodyStore
+{
+	public:
+		typedef uint32_t BodyId;
+		static const BodyId INVALID_ID = 0xFFFFFFFF;
+
+		// State used to create a body and to give it back to its handle
+		struct BodyState
+		{
+			glm::vec3 position = {0,0,0};
+			glm::vec3 velocity = {0,0,0};
+			glm::vec3 acceleration = {0,0,0};
+			glm::vec3 forceAccum = {0,0,0};
+			glm::vec3 angularVelocity = {0,0,0};
+			glm::vec3 torqueAccum = {0,0,0};
+			float inverseMass = 1.0f;
+			float damping = 0.99f;
+			// Local shape half extents (radius/half height for spheres and cylinders)
+			glm::vec3 halfExtents = {0.5f,0.5f,0.5f};
+			glm::quat orientation = {1,0,0,0};
+			ShapeType shapeType = ShapeType::BOX;
+			// Contact material
+			float friction = 0.5f;
+			float restitution = 0.0f;
+			// Continuous collision detection of fast motion
+			bool ccd = false;
+		};
+
+		BodyStore();
+		~BodyStore();
+
+		BodyId add(ObjectPhysics* owner, const BodyState& state);
+		void remove(BodyId id);
+		BodyState getState(BodyId id) const;
+		bool isValid(BodyId id) const { return id < _idToIndex.size() && _idToIndex[id] != INVALID_ID; }
+
+		// Bodies added/removed since the last clearEvents (used to keep the broadphase in sync)
+		const std::vector<BodyId>& getAddedIds() const { return _addedIds; }
+		const std::vector<BodyId>& getRemovedIds() const { return _removedIds; }
+		const std::vector<BodyId>& getTeleportedIds() const { return _teleportedIds; }
+		// Sleeping bodies that were touched by the user (forces, velocity, teleport)
+		const std::vector<BodyId>& getWakeRequests() const { return _wakeRequests; }
+		// Also makes the removed ids reusable (an id is never both removed and added)
+		void clearEvents();
+
+		// Move a dynamic body to/from the active partition
+		void wake(BodyId id);
+		void sleep(BodyId id);
+
+		// Integrate every body (SIMD kernels), the contact solver runs between both
+		void integrateVelocities(float dt);
+		void integratePositions(float dt);
+		void addForceToAll(glm::vec3 force);
+		// Copy the pose of the active bodies before a step (render interpolation)
+		void savePreviousState();
+		// Interpolated world transforms of the active bodies and of the bodies moved
+		// outside of the simulation (once per frame, after the interpolation alpha is set)
+		void updateTransforms();
+		// Hash of the raw bits of the dynamic state (pose and velocities) in id order
+		uint64_t computeStateHash() const;
+		// Every array as it is (the bodies must be the same when restoring, see getRevision)
+		void saveState(StateSnapshot& snapshot) const;
+		void restoreState(StateSnapshot::Reader& reader);
+
+		//---------- Getters ----------//
+		uint32_t size() const { return (uint32_t)_indexToId.size(); }
+		// Ids are smaller than the capacity (including the removed ones)
+		uint32_t getIdCapacity() const { return (uint32_t)_idToIndex.size(); }
+		uint32_t getActiveCount() const { return _activeCount; }
+		// Incremented when bodies are added or removed
+		uint64_t getRevision() const { return _revision; }
+		bool isAwake(BodyId id) const { return _idToIndex[id] < _activeCount; }
+		uint32_t getIndex(BodyId id) const { return _idToIndex[id]; }
+		BodyId getId(uint32_t index) const { return _indexToId[index]; }
+		ObjectPhysics* getOwner(uint32_t index) const { return _owners[index]; }
+
+		glm::vec3 getPosition(BodyId id) const { uint32_t i = _idToIndex[id]; return {_posX[i], _posY[i], _posZ[i]}; }
+		glm::vec3 getPositionByIndex(uint32_t i) const { return {_posX[i], _posY[i], _posZ[i]}; }
+		glm::vec3 getVelocity(BodyId id) const { uint32_t i = _idToIndex[id]; return {_velX[i], _velY[i], _velZ[i]}; }
+		glm::vec3 getVelocityByIndex(uint32_t i) const { return {_velX[i], _velY[i], _velZ[i]}; }
+		glm::vec3 getAcceleration(BodyId id) const { uint32_t i = _idToIndex[id]; return {_accX[i], _accY[i], _accZ[i]}; }
+		glm::vec3 getForceAccum(BodyId id) const { uint32_t i = _idToIndex[id]; return {_forceX[i], _forceY[i], _forceZ[i]}; }
+		glm::vec3 getAngularVelocity(BodyId id) const { return getAngularVelocityByIndex(_idToIndex[id]); }
+		glm::vec3 getAngularVelocityByIndex(uint32_t i) const { return {_angVelX[i], _angVelY[i], _angVelZ[i]}; }
+		glm::vec3 getTorqueAccum(BodyId id) const { uint32_t i = _idToIndex[id]; return {_torqueX[i], _torqueY[i], _torqueZ[i]}; }
+		// Inverse inertia around the principal (local) axes
+		glm::vec3 getLocalInverseInertia(BodyId id) const { uint32_t i = _idToIndex[id]; return {_invInertiaX[i], _invInertiaY[i], _invInertiaZ[i]}; }
+		glm::mat3 getInverseInertiaWorld(BodyId id) const { return getInverseInertiaWorldByIndex(_idToIndex[id]); }
+		glm::mat3 getInverseInertiaWorldByIndex(uint32_t i) const
+		{
+			return glm::mat3(
+					glm::vec3(_invInertiaXX[i], _invInertiaXY[i], _invInertiaXZ[i]),
+					glm::vec3(_invInertiaXY[i], _invInertiaYY[i], _invInertiaYZ[i]),
+					glm::vec3(_invInertiaXZ[i], _invInertiaYZ[i], _invInertiaZZ[i]));
+		}
+		// Cached with the orientation
+		const glm::mat3& getRotationMatrix(BodyId id) const { return _rotation[_idToIndex[id]]; }
+		// Interpolated world transform (see updateTransforms)
+		const glm::mat4& getTransform(BodyId id) const { return _transform[_idToIndex[id]]; }
+		float getInverseMass(BodyId id) const { return _inverseMass[_idToIndex[id]]; }
+		float getDamping(BodyId id) const { return _damping[_idToIndex[id]]; }
+		glm::vec3 getHalfExtents(BodyId id) const { uint32_t i = _idToIndex[id]; return {_halfX[i], _halfY[i], _halfZ[i]}; }
+		glm::quat getOrientation(BodyId id) const { return getOrientationByIndex(_idToIndex[id]); }
+		glm::quat getOrientationByIndex(uint32_t i) const { return glm::quat(_rotW[i], _rotX[i], _rotY[i], _rotZ[i]); }
+		float getFriction(BodyId id) const { return _friction[_idToIndex[id]]; }
+		float getRestitution(BodyId id) const { return _restitution[_idToIndex[id]]; }
+		bool isCcdEnabled(BodyId id) const { return _ccd[_idToIndex[id]] != 0; }
+		// Bodies with continuous collision detection
+		uint32_t getCcdCount() const { return _ccdCount; }
+		// Position at the start of the step
+		glm::vec3 getPreviousPositionByIndex(uint32_t i) const { return {_prevPosX[i], _prevPosY[i], _prevPosZ[i]}; }
+		ShapeType getShapeType(BodyId id) const { return _shapeType[_idToIndex[id]]; }
+		ShapeType getShapeTypeByIndex(uint32_t i) const { return _shapeType[i]; }
+		// Pose between the last two steps, used by the renderer
+		glm::vec3 getInterpolatedPosition(BodyId id) const;
+		glm::quat getInterpolatedOrientation(BodyId id) const;
+		float getInterpolationAlpha() const { return _interpolationAlpha; }
+		// World space collision shape
+		ShapeInstance getShapeInstanceByIndex(uint32_t i) const
+		{
+			return {_shapeType[i], {_halfX[i], _halfY[i], _halfZ[i]}, {_posX[i], _posY[i], _posZ[i]}, _rotation[i]};
+		}
+		Aabb getAabb(BodyId id) const { return getAabbByIndex(_idToIndex[id]); }
+		Aabb getAabbByIndex(uint32_t i) const
+		{
+			glm::vec3 extents = {_halfX[i], _halfY[i], _halfZ[i]};
+			// Spheres and cylinders only use halfX as the radius
+			if(_shapeType[i] == ShapeType::SPHERE)
+				extents = glm::vec3(_halfX[i]);
+			else if(_shapeType[i] == ShapeType::CYLINDER)
+				extents.z = _halfX[i];
+			// Rotated box extents: |R|*halfExtents (spheres are rotation invariant)
+			if(_shapeType[i] != ShapeType::SPHERE && _rotW[i] != 1.0f)
+			{
+				const glm::mat3& rotation = _rotation[i];
+				extents = glm::abs(rotation[0])*extents.x + glm::abs(rotation[1])*extents.y + glm::abs(rotation[2])*extents.z;
+			}
+			const glm::vec3 position = {_posX[i], _posY[i], _posZ[i]};
+			return {position-extents, position+extents};
+		}
+
+		// Raw arrays (indexed by dense index)
+		const float* getPositionX() const { return _posX.data(); }
+		const float* getPositionY() const { return _posY.data(); }
+		const float* getPositionZ() const { return _posZ.data(); }
+		const float* getVelocityX() const { return _velX.data(); }
+		const float* getVelocityY() const { return _velY.data(); }
+		const float* getVelocityZ() const { return _velZ.data(); }
+		const float* getAngularVelocityX() const { return _angVelX.data(); }
+		const float* getAngularVelocityY() const { return _angVelY.data(); }
+		const float* getAngularVelocityZ() const { return _angVelZ.data(); }
+		const float* getInverseMasses() const { return _inverseMass.data(); }
+		const float* getFrictions() const { return _friction.data(); }
+		const float* getRestitutions() const { return _restitution.data(); }
+		// Links of an articulation (their contacts are solved by the articulation)
+		const uint8_t* getArticulatedFlags() const { return _articulated.data(); }
+		const uint8_t* getCcdFlags() const { return _ccd.data(); }
+		// Force accumulators of the force kernels, only the active partition
+		// is integrated and cleared, so bodies after it must not be written
+		float* getForceX() { return _forceX.data(); }
+		float* getForceY() { return _forceY.data(); }
+		float* getForceZ() { return _forceZ.data(); }
+
+		//---------- Setters ----------//
+		void setPosition(BodyId id, glm::vec3 p) { uint32_t i = _idToIndex[id]; _posX[i] = p.x; _posY[i] = p.y; _posZ[i] = p.z; }
+		// Move the body outside of the simulation (recorded for the broadphase, not interpolated)
+		void teleport(BodyId id, glm::vec3 p) { setPosition(id, p); snapPreviousState(_idToIndex[id]); _teleportedIds.push_back(id); _dirtyTransforms.push_back(id); requestWake(id); }
+		void teleport(BodyId id, glm::vec3 p, glm::quat q) { setPosition(id, p); setOrientation(id, q); snapPreviousState(_idToIndex[id]); _teleportedIds.push_back(id); requestWake(id); }
+		void setVelocity(BodyId id, glm::vec3 v) { setVelocityByIndex(_idToIndex[id], v); requestWake(id); }
+		void setVelocityByIndex(uint32_t i, glm::vec3 v) { _velX[i] = v.x; _velY[i] = v.y; _velZ[i] = v.z; }
+		void setAngularVelocity(BodyId id, glm::vec3 w) { setAngularVelocityByIndex(_idToIndex[id], w); requestWake(id); }
+		void setAngularVelocityByIndex(uint32_t i, glm::vec3 w) { _angVelX[i] = w.x; _angVelY[i] = w.y; _angVelZ[i] = w.z; }
+		void setPositionByIndex(uint32_t i, glm::vec3 p) { _posX[i] = p.x; _posY[i] = p.y; _posZ[i] = p.z; }
+		void setAcceleration(BodyId id, glm::vec3 a) { uint32_t i = _idToIndex[id]; _accX[i] = a.x; _accY[i] = a.y; _accZ[i] = a.z; }
+		void addForce(BodyId id, glm::vec3 f) { uint32_t i = _idToIndex[id]; _forceX[i] += f.x; _forceY[i] += f.y; _forceZ[i] += f.z; requestWake(id); }
+		void addTorque(BodyId id, glm::vec3 t) { uint32_t i = _idToIndex[id]; _torqueX[i] += t.x; _torqueY[i] += t.y; _torqueZ[i] += t.z; requestWake(id); }
+		// Force applied at a world point, adds the torque around the center of mass
+		void addForceAtPoint(BodyId id, glm::vec3 f, glm::vec3 point) { addForce(id, f); addTorque(id, glm::cross(point-getPosition(id), f)); }
+		// Static bodies (inverseMass<=0) leave the active partition
+		void setInverseMass(BodyId id, float inverseMass);
+		void setDamping(BodyId id, float damping) { _damping[_idToIndex[id]] = damping; _dampingDt = -1.0f; }
+		void setHalfExtents(BodyId id, glm::vec3 h) { uint32_t i = _idToIndex[id]; _halfX[i] = h.x; _halfY[i] = h.y; _halfZ[i] = h.z; updateInertia(i); }
+		void setOrientation(BodyId id, glm::quat q) { setOrientationByIndex(_idToIndex[id], q); _dirtyTransforms.push_back(id); }
+		// Also updates the cached rotation matrix and world inertia
+		void setOrientationByIndex(uint32_t i, glm::quat q) { _rotX[i] = q.x; _rotY[i] = q.y; _rotZ[i] = q.z; _rotW[i] = q.w; updateRotation(i); }
+		void setFriction(BodyId id, float friction) { _friction[_idToIndex[id]] = friction; }
+		void setRestitution(BodyId id, float restitution) { _restitution[_idToIndex[id]] = restitution; }
+		void setCcdEnabled(BodyId id, bool enabled);
+		void setShapeType(BodyId id, ShapeType type) { _shapeType[_idToIndex[id]] = type; updateInertia(_idToIndex[id]); }
+		void setArticulated(BodyId id, bool articulated) { _articulated[_idToIndex[id]] = articulated; }
+		// The island of the body is woken in the next step
+		void requestWake(BodyId id) { if(_idToIndex[id] >= _activeCount) _wakeRequests.push_back(id); }
+		void clearForceAccum(BodyId id) { uint32_t i = _idToIndex[id]; _forceX[i] = _forceY[i] = _forceZ[i] = _torqueX[i] = _torqueY[i] = _torqueZ[i] = 0; }
+		// Fraction of the next step already accumulated (0 shows the previous pose, 1 the current one)
+		void setInterpolationAlpha(float alpha) { _interpolationAlpha = alpha; }
+
+	private:
+		void updateDampingFactors(float dt);
+		void swapBodies(uint32_t i, uint32_t j);
+		void snapPreviousState(uint32_t i);
+		void integrateAngularVelocities(float dt);
+		// Local inverse inertia from the shape and mass (solid bodies)
+		void updateInertia(uint32_t i);
+		// Rotation matrix and world inverse inertia from the orientation
+		void updateRotation(uint32_t i);
+		void updateTransform(uint32_t i);
+
+		// Every per body array (the callback must accept any vector type)
+		template <typename F>
+		void forEachArray(F f) { forEachArray(*this, f); }
+		template <typename F>
+		void forEachArray(F f) const { forEachArray(*this, f); }
+		template <typename S, typename F>
+		static void forEachArray(S& store, F f)
+		{
+			f(store._posX); f(store._posY); f(store._posZ);
+			f(store._velX); f(store._velY); f(store._velZ);
+			f(store._accX); f(store._accY); f(store._accZ);
+			f(store._forceX); f(store._forceY); f(store._forceZ);
+			f(store._angVelX); f(store._angVelY); f(store._angVelZ);
+			f(store._torqueX); f(store._torqueY); f(store._torqueZ);
+			f(store._inverseMass);
+			f(store._invInertiaX); f(store._invInertiaY); f(store._invInertiaZ);
+			f(store._invInertiaXX); f(store._invInertiaXY); f(store._invInertiaXZ);
+			f(store._invInertiaYY); f(store._invInertiaYZ); f(store._invInertiaZZ);
+			f(store._damping);
+			f(store._dampingFactor);
+			f(store._halfX); f(store._halfY); f(store._halfZ);
+			f(store._rotX); f(store._rotY); f(store._rotZ); f(store._rotW);
+			f(store._rotation);
+			f(store._transform);
+			f(store._shapeType);
+			f(store._friction); f(store._restitution);
+			f(store._articulated);
+			f(store._ccd);
+			f(store._prevPosX); f(store._prevPosY); f(store._prevPosZ);
+			f(store._prevRotX); f(store._prevRotY); f(store._prevRotZ); f(store._prevRotW);
+			f(store._owners);
+			f(store._indexToId);
+		}
+
+		// Dense arrays
+		std::vector<float> _posX, _posY, _posZ;
+		std::vector<float> _velX, _velY, _velZ;
+		std::vector<float> _accX, _accY, _accZ;
+		std::vector<float> _forceX, _forceY, _forceZ;
+		// Angular velocity and torque (world space)
+		std::vector<float> _angVelX, _angVelY, _angVelZ;
+		std::vector<float> _torqueX, _torqueY, _torqueZ;
+		std::vector<float> _inverseMass;
+		// Inverse inertia around the local axes, and the symmetric world tensor R*diag*R^T
+		std::vector<float> _invInertiaX, _invInertiaY, _invInertiaZ;
+		std::vector<float> _invInertiaXX, _invInertiaXY, _invInertiaXZ;
+		std::vector<float> _invInertiaYY, _invInertiaYZ, _invInertiaZZ;
+		std::vector<float> _damping;
+		// damping^dt, recomputed only when dt or some damping changes
+		std::vector<float> _dampingFactor;
+		float _dampingDt;
+		// Bounding box half extents
+		std::vector<float> _halfX, _halfY, _halfZ;
+		// Orientation quaternion
+		std::vector<float> _rotX, _rotY, _rotZ, _rotW;
+		// Rotation matrix of the orientation (updated with it)
+		std::vector<glm::mat3> _rotation;
+		// Interpolated world transform shown by the renderer
+		std::vector<glm::mat4> _transform;
+		// Bodies outside of the active partition whose transform must be updated
+		std::vector<BodyId> _dirtyTransforms;
+		std::vector<ShapeType> _shapeType;
+		std::vector<float> _friction;
+		std::vector<float> _restitution;
+		std::vector<uint8_t> _articulated;
+		std::vector<uint8_t> _ccd;
+		// Pose before the last step
+		std::vector<float> _prevPosX, _prevPosY, _prevPosZ;
+		std::vector<float> _prevRotX, _prevRotY, _prevRotZ, _prevRotW;
+		float _interpolationAlpha;
+
+		// Id <-> index mapping
+		std::vector<BodyId> _indexToId;
+		std::vector<ObjectPhysics*> _owners;
+		std::vector<uint32_t> _idToIndex;
+		std::vector<BodyId> _freeIds;
+		// Removed since the last clearEvents, free after it
+		std::vector<BodyId> _pendingFreeIds;
+		std::vector<BodyId> _addedIds;
+		std::vector<BodyId> _removedIds;
+		std::vector<BodyId> _teleportedIds;
+		std::vector<BodyId> _wakeRequests;
+		uint32_t _activeCount;
+		uint32_t _ccdCount;
+		uint64_t _revision;
+};
+
+#endif// BODY_STORE_H
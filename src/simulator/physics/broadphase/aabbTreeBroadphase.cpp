@@ -0,0 +1,185 @@
+//--------------------------------------------------
+// Robot Simulator
+// aabbTreeBroadphase.cpp
+// Date: 2020-11-08
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#include "aabbTreeBroadphase.h"
+
+AabbTreeBroadphase::AabbTreeBroadphase(BodyStore* bodyStore):
+	Broadphase(bodyStore), _movedCount(0), _margin(0.05f), _predictionTime(0.05f)
+{
+	_type = "AabbTreeBroadphase";
+}
+
+AabbTreeBroadphase::~AabbTreeBroadphase()
+{
+}
+
+void AabbTreeBroadphase::addBody(BodyStore::BodyId id)
+{
+	if(id >= _proxies.size())
+	{
+		_proxies.resize(id+1, DynamicAabbTree::NULL_NODE);
+		_moved.resize(id+1, false);
+	}
+	if(_proxies[id] != DynamicAabbTree::NULL_NODE)
+		return;
+
+	_proxies[id] = _tree.createProxy(computeFatAabb(_bodyStore->getIndex(id)), id);
+	markMoved(id);
+}
+
+void AabbTreeBroadphase::removeBody(BodyStore::BodyId id)
+{
+	if(id >= _proxies.size() || _proxies[id] == DynamicAabbTree::NULL_NODE)
+		return;
+
+	_tree.destroyProxy(_proxies[id]);
+	_proxies[id] = DynamicAabbTree::NULL_NODE;
+
+	// Remove the pairs with this body
+	for(size_t i=0; i<_pairs.size();)
+	{
+		if(_pairs[i].a == id || _pairs[i].b == id)
+		{
+			_pairKeys.erase(pairKey(_pairs[i].a, _pairs[i].b));
+			_pairs[i] = _pairs.back();
+			_pairs.pop_back();
+		}
+		else
+			i++;
+	}
+}
+
+void AabbTreeBroadphase::touchBody(BodyStore::BodyId id)
+{
+	if(id >= _proxies.size() || _proxies[id] == DynamicAabbTree::NULL_NODE)
+		return;
+
+	// Same rule as the awake bodies (restored snapshots touch every sleeping body)
+	const uint32_t index = _bodyStore->getIndex(id);
+	if(_tree.getFatAabb(_proxies[id]).contains(_bodyStore->getAabbByIndex(index)))
+		return;
+
+	_tree.moveProxy(_proxies[id], computeFatAabb(index));
+	markMoved(id);
+}
+
+void AabbTreeBroadphase::markMoved(BodyStore::BodyId id)
+{
+	if(_moved[id])
+		return;
+	_moved[id] = true;
+	_moveBuffer.push_back(id);
+}
+
+Aabb AabbTreeBroadphase::computeFatAabb(uint32_t index) const
+{
+	Aabb aabb = _bodyStore->getAabbByIndex(index);
+	aabb.min -= glm::vec3(_margin);
+	aabb.max += glm::vec3(_margin);
+
+	// Extend the box in the direction the body is moving
+	const glm::vec3 displacement = glm::vec3(
+			_bodyStore->getVelocityX()[index],
+			_bodyStore->getVelocityY()[index],
+			_bodyStore->getVelocityZ()[index])*_predictionTime;
+	aabb.min += glm::min(displacement, glm::vec3(0));
+	aabb.max += glm::max(displacement, glm::vec3(0));
+	return aabb;
+}
+
+void AabbTreeBroadphase::update()
+{
+	// Static and sleeping bodies only move when touched, the awake ones
+	// are reinserted only when the tight box leaves the fat box
+	const uint32_t n = _bodyStore->getActiveCount();
+	for(uint32_t i=0; i<n; i++)
+	{
+		const BodyStore::BodyId id = _bodyStore->getId(i);
+		const int proxy = _proxies[id];
+		if(_tree.getFatAabb(proxy).contains(_bodyStore->getAabbByIndex(i)))
+			continue;
+
+		_tree.moveProxy(proxy, computeFatAabb(i));
+		markMoved(id);
+	}
+	_movedCount = _moveBuffer.size();
+
+	removeStalePairs();
+	findNewPairs();
+
+	for(auto id : _moveBuffer)
+		_moved[id] = false;
+	_moveBuffer.clear();
+}
+
+void AabbTreeBroadphase::removeStalePairs()
+{
+	if(_moveBuffer.empty())
+		return;
+
+	// Only pairs with a moved body can stop overlapping
+	for(size_t i=0; i<_pairs.size();)
+	{
+		const Pair& pair = _pairs[i];
+		if((_moved[pair.a] || _moved[pair.b]) &&
+			!_tree.getFatAabb(_proxies[pair.a]).overlaps(_tree.getFatAabb(_proxies[pair.b])))
+		{
+			_pairKeys.erase(pairKey(pair.a, pair.b));
+			_pairs[i] = _pairs.back();
+			_pairs.pop_back();
+		}
+		else
+			i++;
+	}
+}
+
+void AabbTreeBroadphase::findNewPairs()
+{
+	for(auto id : _moveBuffer)
+	{
+		// Removed after being moved
+		if(_proxies[id] == DynamicAabbTree::NULL_NODE)
+			continue;
+
+		_tree.query(_tree.getFatAabb(_proxies[id]), [this, id](uint32_t other)
+		{
+			// When both moved the pair is found once, by the smaller id
+			if(other == id || (_moved[other] && other < id))
+				return true;
+			if(isStaticPair(id, other))
+				return true;
+
+			if(_pairKeys.insert(pairKey(id, other)).second)
+				_pairs.push_back(id < other ? Pair{id, other} : Pair{other, id});
+			return true;
+		});
+	}
+}
+
+void AabbTreeBroadphase::query(const Aabb& aabb, const std::function<bool(BodyStore::BodyId)>& callback) const
+{
+	_tree.query(aabb, [&callback](uint32_t id){ return callback(id); });
+}
+
+void AabbTreeBroadphase::raycast(glm::vec3 origin, glm::vec3 direction, float maxT,
+		const std::function<float(BodyStore::BodyId, float)>& callback) const
+{
+	_tree.raycast(origin, direction, maxT, [&callback](uint32_t id, float maxT){ return callback(id, maxT); });
+}
+
+void AabbTreeBroadphase::raycastBatch(const glm::vec3* origins, const glm::vec3* directions, const float* maxT, uint32_t count,
+		const std::function<float(BodyStore::BodyId, uint32_t, float)>& callback) const
+{
+	DynamicAabbTree::RayPacket packet;
+	for(uint32_t first=0; first<count; first+=DynamicAabbTree::PACKET_SIZE)
+	{
+		DynamicAabbTree::makePacket(origins+first, directions+first, maxT+first, count-first, packet);
+		_tree.raycastPacket(packet, [&callback, first](uint32_t id, uint32_t ray, float maxT)
+		{
+			return callback(id, first+ray, maxT);
+		});
+	}
+}
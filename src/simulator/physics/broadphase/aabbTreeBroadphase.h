@@ -0,0 +1,69 @@
+//--------------------------------------------------
+// Robot Simulator
+// aabbTreeBroadphase.h
+// Date: 2020-11-08
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef AABB_TREE_BROADPHASE_H
+#define AABB_TREE_BROADPHASE_H
+
+#include <unordered_set>
+#include "broadphase.h"
+#include "dynamicAabbTree.h"
+
+// Broadphase backed by a dynamic AABB tree with fat bounds.
+// Only bodies that leave their fat box are reinserted and queried,
+// the pair list is kept between steps.
+class AabbTreeBroadphase : public Broadphase
+{
+	public:
+		AabbTreeBroadphase(BodyStore* bodyStore);
+		~AabbTreeBroadphase();
+
+		void addBody(BodyStore::BodyId id) override;
+		void removeBody(BodyStore::BodyId id) override;
+		void touchBody(BodyStore::BodyId id) override;
+		void update() override;
+
+		void query(const Aabb& aabb, const std::function<bool(BodyStore::BodyId)>& callback) const override;
+		void raycast(glm::vec3 origin, glm::vec3 direction, float maxT,
+				const std::function<float(BodyStore::BodyId, float)>& callback) const override;
+		// Rays are traversed in SIMD packets (coherent rays share most of the traversal)
+		void raycastBatch(const glm::vec3* origins, const glm::vec3* directions, const float* maxT, uint32_t count,
+				const std::function<float(BodyStore::BodyId, uint32_t, float)>& callback) const override;
+
+		//---------- Getters ----------//
+		const DynamicAabbTree& getTree() const { return _tree; }
+		const Aabb& getFatAabb(BodyStore::BodyId id) const { return _tree.getFatAabb(_proxies[id]); }
+		size_t getMovedCount() const { return _movedCount; }
+
+		//---------- Setters ----------//
+		void setMargin(float margin) { _margin = margin; }
+		void setPredictionTime(float predictionTime) { _predictionTime = predictionTime; }
+
+	private:
+		Aabb computeFatAabb(uint32_t index) const;
+		void markMoved(BodyStore::BodyId id);
+		void removeStalePairs();
+		void findNewPairs();
+
+		static uint64_t pairKey(BodyStore::BodyId a, BodyStore::BodyId b)
+		{
+			return a < b ? ((uint64_t)a<<32)|b : ((uint64_t)b<<32)|a;
+		}
+
+		DynamicAabbTree _tree;
+		// Tree leaf of each body id
+		std::vector<int> _proxies;
+		// Bodies reinserted this step
+		std::vector<BodyStore::BodyId> _moveBuffer;
+		std::vector<bool> _moved;
+		size_t _movedCount;
+		std::unordered_set<uint64_t> _pairKeys;
+
+		// Fat box = tight box + margin + displacement in _predictionTime
+		float _margin;
+		float _predictionTime;
+};
+
+#endif// AABB_TREE_BROADPHASE_H
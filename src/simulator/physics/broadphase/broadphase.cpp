@@ -0,0 +1,23 @@
+//--------------------------------------------------
+// Robot Simulator
+// broadphase.cpp
+// Date: 2020-11-05
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#include "broadphase.h"
+
+Broadphase::Broadphase(BodyStore* bodyStore):
+	_type("Broadphase"), _bodyStore(bodyStore)
+{
+}
+
+Broadphase::~Broadphase()
+{
+}
+
+void Broadphase::raycastBatch(const glm::vec3* origins, const glm::vec3* directions, const float* maxT, uint32_t count,
+		const std::function<float(BodyStore::BodyId, uint32_t, float)>& callback) const
+{
+	for(uint32_t i=0; i<count; i++)
+		raycast(origins[i], directions[i], maxT[i], [&callback, i](BodyStore::BodyId id, float maxT){ return callback(id, i, maxT); });
+}
@@ -0,0 +1,62 @@
+//--------------------------------------------------
+// Robot Simulator
+// broadphase.h
+// Date: 2020-11-05
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include "../bodyStore.h"
+
+// Finds the pairs of bodies whose bounding boxes overlap
+class Broadphase
+{
+	public:
+		struct Pair
+		{
+			BodyStore::BodyId a;
+			BodyStore::BodyId b;
+		};
+
+		Broadphase(BodyStore* bodyStore);
+		virtual ~Broadphase();
+
+		virtual void addBody(BodyStore::BodyId id) = 0;
+		virtual void removeBody(BodyStore::BodyId id) = 0;
+		// Body moved by hand (not by the integrator)
+		virtual void touchBody(BodyStore::BodyId id) {}
+		// Update the body bounds and generate the pair list
+		virtual void update() = 0;
+
+		//---------- Scene queries ----------//
+		// Callback returns false to stop the query
+		virtual void query(const Aabb& aabb, const std::function<bool(BodyStore::BodyId)>& callback) const = 0;
+		// Callback returns the new maxT (0 stops the query)
+		virtual void raycast(glm::vec3 origin, glm::vec3 direction, float maxT,
+				const std::function<float(BodyStore::BodyId, float)>& callback) const = 0;
+		// Many rays at once, the callback also receives the ray index and returns the new maxT of that ray
+		// (by default every ray is traversed on its own)
+		virtual void raycastBatch(const glm::vec3* origins, const glm::vec3* directions, const float* maxT, uint32_t count,
+				const std::function<float(BodyStore::BodyId, uint32_t, float)>& callback) const;
+
+		//---------- Getters ----------//
+		std::string getType() const { return _type; };
+		const std::vector<Pair>& getPairs() const { return _pairs; }
+
+	protected:
+		// Pairs between two immovable bodies are never reported
+		bool isStaticPair(BodyStore::BodyId a, BodyStore::BodyId b) const
+		{
+			return _bodyStore->getInverseMass(a)<=0 && _bodyStore->getInverseMass(b)<=0;
+		}
+
+		std::string _type;
+		BodyStore* _bodyStore;
+		std::vector<Pair> _pairs;
+};
+
+#endif// BROADPHASE_H
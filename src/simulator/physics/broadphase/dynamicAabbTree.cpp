@@ -0,0 +1,386 @@
+//--------------------------------------------------
+// Robot Simulator
+// dynamicAabbTree.cpp
+// Date: 2020-11-08
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#include "dynamicAabbTree.h"
+#include <algorithm>
+#include <cmath>
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+const int DynamicAabbTree::NULL_NODE;
+const int DynamicAabbTree::PACKET_SIZE;
+
+DynamicAabbTree::DynamicAabbTree():
+	_root(NULL_NODE), _freeList(NULL_NODE)
+{
+}
+
+DynamicAabbTree::~DynamicAabbTree()
+{
+}
+
+int DynamicAabbTree::allocateNode()
+{
+	if(_freeList == NULL_NODE)
+	{
+		Node node;
+		node.parent = NULL_NODE;
+		node.height = -1;
+		_nodes.push_back(node);
+		_freeList = (int)_nodes.size()-1;
+	}
+
+	const int index = _freeList;
+	_freeList = _nodes[index].parent;
+	Node& node = _nodes[index];
+	node.parent = NULL_NODE;
+	node.child1 = NULL_NODE;
+	node.child2 = NULL_NODE;
+	node.height = 0;
+	node.userData = 0;
+	return index;
+}
+
+void DynamicAabbTree::freeNode(int node)
+{
+	_nodes[node].parent = _freeList;
+	_nodes[node].height = -1;
+	_freeList = node;
+}
+
+int DynamicAabbTree::createProxy(const Aabb& fatAabb, uint32_t userData)
+{
+	const int proxy = allocateNode();
+	_nodes[proxy].aabb = fatAabb;
+	_nodes[proxy].userData = userData;
+	insertLeaf(proxy);
+	return proxy;
+}
+
+void DynamicAabbTree::destroyProxy(int proxy)
+{
+	removeLeaf(proxy);
+	freeNode(proxy);
+}
+
+void DynamicAabbTree::moveProxy(int proxy, const Aabb& fatAabb)
+{
+	removeLeaf(proxy);
+	_nodes[proxy].aabb = fatAabb;
+	insertLeaf(proxy);
+}
+
+void DynamicAabbTree::insertLeaf(int leaf)
+{
+	if(_root == NULL_NODE)
+	{
+		_root = leaf;
+		_nodes[_root].parent = NULL_NODE;
+		return;
+	}
+
+	// Find the best sibling (surface area heuristic)
+	const Aabb leafAabb = _nodes[leaf].aabb;
+	int index = _root;
+	while(!_nodes[index].isLeaf())
+	{
+		const int child1 = _nodes[index].child1;
+		const int child2 = _nodes[index].child2;
+
+		const float area = _nodes[index].aabb.getSurfaceArea();
+		const float combinedArea = Aabb::merge(_nodes[index].aabb, leafAabb).getSurfaceArea();
+
+		// Cost of creating a new parent for this node and the new leaf
+		const float cost = 2.0f*combinedArea;
+		// Minimum cost of pushing the leaf further down the tree
+		const float inheritanceCost = 2.0f*(combinedArea - area);
+
+		auto descendCost = [&](int child)
+		{
+			const float newArea = Aabb::merge(leafAabb, _nodes[child].aabb).getSurfaceArea();
+			if(_nodes[child].isLeaf())
+				return newArea + inheritanceCost;
+			return newArea - _nodes[child].aabb.getSurfaceArea() + inheritanceCost;
+		};
+		const float cost1 = descendCost(child1);
+		const float cost2 = descendCost(child2);
+
+		if(cost < cost1 && cost < cost2)
+			break;
+
+		index = cost1 < cost2 ? child1 : child2;
+	}
+	const int sibling = index;
+
+	// Create a new parent
+	const int oldParent = _nodes[sibling].parent;
+	const int newParent = allocateNode();
+	_nodes[newParent].parent = oldParent;
+	_nodes[newParent].aabb = Aabb::merge(leafAabb, _nodes[sibling].aabb);
+	_nodes[newParent].height = _nodes[sibling].height + 1;
+	_nodes[newParent].child1 = sibling;
+	_nodes[newParent].child2 = leaf;
+	_nodes[sibling].parent = newParent;
+	_nodes[leaf].parent = newParent;
+
+	if(oldParent != NULL_NODE)
+	{
+		if(_nodes[oldParent].child1 == sibling)
+			_nodes[oldParent].child1 = newParent;
+		else
+			_nodes[oldParent].child2 = newParent;
+	}
+	else
+	{
+		_root = newParent;
+	}
+
+	refitFrom(_nodes[leaf].parent);
+}
+
+void DynamicAabbTree::removeLeaf(int leaf)
+{
+	if(leaf == _root)
+	{
+		_root = NULL_NODE;
+		return;
+	}
+
+	const int parent = _nodes[leaf].parent;
+	const int grandParent = _nodes[parent].parent;
+	const int sibling = _nodes[parent].child1 == leaf ? _nodes[parent].child2 : _nodes[parent].child1;
+
+	if(grandParent != NULL_NODE)
+	{
+		// Destroy parent and connect sibling to grandParent
+		if(_nodes[grandParent].child1 == parent)
+			_nodes[grandParent].child1 = sibling;
+		else
+			_nodes[grandParent].child2 = sibling;
+		_nodes[sibling].parent = grandParent;
+		freeNode(parent);
+
+		refitFrom(grandParent);
+	}
+	else
+	{
+		_root = sibling;
+		_nodes[sibling].parent = NULL_NODE;
+		freeNode(parent);
+	}
+}
+
+void DynamicAabbTree::refitFrom(int index)
+{
+	// Walk back up the tree fixing heights and AABBs
+	while(index != NULL_NODE)
+	{
+		index = balance(index);
+
+		const int child1 = _nodes[index].child1;
+		const int child2 = _nodes[index].child2;
+		_nodes[index].height = 1 + std::max(_nodes[child1].height, _nodes[child2].height);
+		_nodes[index].aabb = Aabb::merge(_nodes[child1].aabb, _nodes[child2].aabb);
+
+		index = _nodes[index].parent;
+	}
+}
+
+// Perform a left or right rotation if node A is imbalanced, returns the new subtree root
+int DynamicAabbTree::balance(int iA)
+{
+	Node& A = _nodes[iA];
+	if(A.isLeaf() || A.height < 2)
+		return iA;
+
+	const int iB = A.child1;
+	const int iC = A.child2;
+	Node& B = _nodes[iB];
+	Node& C = _nodes[iC];
+
+	const int heightBalance = C.height - B.height;
+
+	// Rotate C up
+	if(heightBalance > 1)
+	{
+		const int iF = C.child1;
+		const int iG = C.child2;
+		Node& F = _nodes[iF];
+		Node& G = _nodes[iG];
+
+		// Swap A and C
+		C.child1 = iA;
+		C.parent = A.parent;
+		A.parent = iC;
+
+		// A's old parent should point to C
+		if(C.parent != NULL_NODE)
+		{
+			if(_nodes[C.parent].child1 == iA)
+				_nodes[C.parent].child1 = iC;
+			else
+				_nodes[C.parent].child2 = iC;
+		}
+		else
+			_root = iC;
+
+		// Rotate
+		if(F.height > G.height)
+		{
+			C.child2 = iF;
+			A.child2 = iG;
+			G.parent = iA;
+			A.aabb = Aabb::merge(B.aabb, G.aabb);
+			C.aabb = Aabb::merge(A.aabb, F.aabb);
+			A.height = 1 + std::max(B.height, G.height);
+			C.height = 1 + std::max(A.height, F.height);
+		}
+		else
+		{
+			C.child2 = iG;
+			A.child2 = iF;
+			F.parent = iA;
+			A.aabb = Aabb::merge(B.aabb, F.aabb);
+			C.aabb = Aabb::merge(A.aabb, G.aabb);
+			A.height = 1 + std::max(B.height, F.height);
+			C.height = 1 + std::max(A.height, G.height);
+		}
+
+		return iC;
+	}
+
+	// Rotate B up
+	if(heightBalance < -1)
+	{
+		const int iD = B.child1;
+		const int iE = B.child2;
+		Node& D = _nodes[iD];
+		Node& E = _nodes[iE];
+
+		// Swap A and B
+		B.child1 = iA;
+		B.parent = A.parent;
+		A.parent = iB;
+
+		// A's old parent should point to B
+		if(B.parent != NULL_NODE)
+		{
+			if(_nodes[B.parent].child1 == iA)
+				_nodes[B.parent].child1 = iB;
+			else
+				_nodes[B.parent].child2 = iB;
+		}
+		else
+			_root = iB;
+
+		// Rotate
+		if(D.height > E.height)
+		{
+			B.child2 = iD;
+			A.child1 = iE;
+			E.parent = iA;
+			A.aabb = Aabb::merge(C.aabb, E.aabb);
+			B.aabb = Aabb::merge(A.aabb, D.aabb);
+			A.height = 1 + std::max(C.height, E.height);
+			B.height = 1 + std::max(A.height, D.height);
+		}
+		else
+		{
+			B.child2 = iE;
+			A.child1 = iD;
+			D.parent = iA;
+			A.aabb = Aabb::merge(C.aabb, D.aabb);
+			B.aabb = Aabb::merge(A.aabb, E.aabb);
+			A.height = 1 + std::max(C.height, D.height);
+			B.height = 1 + std::max(A.height, E.height);
+		}
+
+		return iB;
+	}
+
+	return iA;
+}
+
+void DynamicAabbTree::makePacket(const glm::vec3* origins, const glm::vec3* directions, const float* maxT, uint32_t count, RayPacket& packet)
+{
+	packet.count = std::min(count, (uint32_t)PACKET_SIZE);
+	for(uint32_t i=0; i<(uint32_t)PACKET_SIZE; i++)
+	{
+		if(i >= packet.count)
+		{
+			packet.originX[i] = packet.originY[i] = packet.originZ[i] = 0.0f;
+			packet.invDirectionX[i] = packet.invDirectionY[i] = packet.invDirectionZ[i] = 1.0f;
+			packet.maxT[i] = -1.0f;
+			continue;
+		}
+
+		// Zero components become tiny so that 0*inf never produces NaN in the slab test
+		glm::vec3 direction = directions[i];
+		for(int axis=0; axis<3; axis++)
+			if(std::abs(direction[axis]) < 1e-20f)
+				direction[axis] = std::copysign(1e-20f, direction[axis]);
+
+		packet.originX[i] = origins[i].x;
+		packet.originY[i] = origins[i].y;
+		packet.originZ[i] = origins[i].z;
+		packet.invDirectionX[i] = 1.0f/direction.x;
+		packet.invDirectionY[i] = 1.0f/direction.y;
+		packet.invDirectionZ[i] = 1.0f/direction.z;
+		packet.maxT[i] = maxT[i];
+	}
+}
+
+uint32_t DynamicAabbTree::packetTest(const Aabb& aabb, const RayPacket& packet)
+{
+#if defined(__AVX__)
+	const float* origin[3] = {packet.originX, packet.originY, packet.originZ};
+	const float* invDirection[3] = {packet.invDirectionX, packet.invDirectionY, packet.invDirectionZ};
+	__m256 tMin = _mm256_setzero_ps();
+	__m256 tMax = _mm256_load_ps(packet.maxT);
+	for(int axis=0; axis<3; axis++)
+	{
+		const __m256 o = _mm256_load_ps(origin[axis]);
+		const __m256 inv = _mm256_load_ps(invDirection[axis]);
+		const __m256 t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(aabb.min[axis]), o), inv);
+		const __m256 t2 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(aabb.max[axis]), o), inv);
+		tMin = _mm256_max_ps(tMin, _mm256_min_ps(t1, t2));
+		tMax = _mm256_min_ps(tMax, _mm256_max_ps(t1, t2));
+	}
+	return (uint32_t)_mm256_movemask_ps(_mm256_cmp_ps(tMin, tMax, _CMP_LE_OQ));
+#elif defined(__SSE2__)
+	const float* origin[3] = {packet.originX, packet.originY, packet.originZ};
+	const float* invDirection[3] = {packet.invDirectionX, packet.invDirectionY, packet.invDirectionZ};
+	uint32_t mask = 0;
+	for(int half=0; half<PACKET_SIZE; half+=4)
+	{
+		__m128 tMin = _mm_setzero_ps();
+		__m128 tMax = _mm_load_ps(packet.maxT+half);
+		for(int axis=0; axis<3; axis++)
+		{
+			const __m128 o = _mm_load_ps(origin[axis]+half);
+			const __m128 inv = _mm_load_ps(invDirection[axis]+half);
+			const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aabb.min[axis]), o), inv);
+			const __m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aabb.max[axis]), o), inv);
+			tMin = _mm_max_ps(tMin, _mm_min_ps(t1, t2));
+			tMax = _mm_min_ps(tMax, _mm_max_ps(t1, t2));
+		}
+		mask |= (uint32_t)_mm_movemask_ps(_mm_cmple_ps(tMin, tMax)) << half;
+	}
+	return mask;
+#else
+	uint32_t mask = 0;
+	for(int i=0; i<PACKET_SIZE; i++)
+	{
+		float tEnter;
+		const glm::vec3 origin = {packet.originX[i], packet.originY[i], packet.originZ[i]};
+		const glm::vec3 invDirection = {packet.invDirectionX[i], packet.invDirectionY[i], packet.invDirectionZ[i]};
+		if(packet.maxT[i] >= 0 && aabb.raycast(origin, invDirection, packet.maxT[i], tEnter))
+			mask |= 1u << i;
+	}
+	return mask;
+#endif
+}
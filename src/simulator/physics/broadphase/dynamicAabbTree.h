@@ -0,0 +1,219 @@
+//--------------------------------------------------
+// Robot Simulator
+// dynamicAabbTree.h
+// Date: 2020-11-08
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef DYNAMIC_AABB_TREE_H
+#define DYNAMIC_AABB_TREE_H
+
+#include <vector>
+#include <cstdint>
+#include "glm.h"
+#include "../aabb.h"
+
+// Bounding volume hierarchy of fattened AABBs.
+// Leaves are only reinserted when the tight box leaves the fat box,
+// and the tree is kept balanced with rotations after each insertion/removal.
+class DynamicAabbTree
+{
+	public:
+		static const int NULL_NODE = -1;
+		static const int PACKET_SIZE = 8;
+
+		// Rays traversed together (SoA so the node boxes are tested against every ray at once)
+		struct RayPacket
+		{
+			alignas(32) float originX[PACKET_SIZE];
+			alignas(32) float originY[PACKET_SIZE];
+			alignas(32) float originZ[PACKET_SIZE];
+			alignas(32) float invDirectionX[PACKET_SIZE];
+			alignas(32) float invDirectionY[PACKET_SIZE];
+			alignas(32) float invDirectionZ[PACKET_SIZE];
+			// Finished and unused rays have a negative maxT
+			alignas(32) float maxT[PACKET_SIZE];
+			uint32_t count;
+		};
+
+		DynamicAabbTree();
+		~DynamicAabbTree();
+
+		// Returns the leaf node, userData is usually the body id
+		int createProxy(const Aabb& fatAabb, uint32_t userData);
+		void destroyProxy(int proxy);
+		// Reinsert the leaf with a new fat box
+		void moveProxy(int proxy, const Aabb& fatAabb);
+
+		// Callback: bool(uint32_t userData), return false to stop the query
+		template <typename F>
+		void query(const Aabb& aabb, F callback) const;
+
+		// Callback: float(uint32_t userData, float maxT), returns the new maxT
+		// (0 stops the query, maxT continues without clipping)
+		template <typename F>
+		void raycast(glm::vec3 origin, glm::vec3 direction, float maxT, F callback) const;
+
+		// Callback: float(uint32_t userData, uint32_t ray, float maxT), returns the new maxT of the ray
+		// (0 stops the ray). A subtree is skipped only when no ray of the packet hits it.
+		template <typename F>
+		void raycastPacket(RayPacket& packet, F callback) const;
+
+		// Up to PACKET_SIZE rays (the directions do not need to be normalized)
+		static void makePacket(const glm::vec3* origins, const glm::vec3* directions, const float* maxT, uint32_t count, RayPacket& packet);
+		// Bit i is set when the ray i hits the box before its maxT
+		static uint32_t packetTest(const Aabb& aabb, const RayPacket& packet);
+
+		//---------- Getters ----------//
+		const Aabb& getFatAabb(int proxy) const { return _nodes[proxy].aabb; }
+		uint32_t getUserData(int proxy) const { return _nodes[proxy].userData; }
+		int getHeight() const { return _root == NULL_NODE ? 0 : _nodes[_root].height; }
+		int getRoot() const { return _root; }
+
+	private:
+		struct Node
+		{
+			Aabb aabb;
+			uint32_t userData;
+			// Parent when in the tree, next free node when in the free list
+			int parent;
+			int child1;
+			int child2;
+			// Leaf = 0, free node = -1
+			int height;
+
+			bool isLeaf() const { return child1 == NULL_NODE; }
+		};
+
+		// Nodes left to visit by a query. The balanced trees fit in the fixed array, a deeper
+		// (degenerate) tree spills to the heap. Local to the query, the queries run in parallel.
+		struct TraversalStack
+		{
+			static const int FIXED_SIZE = 256;
+			int fixed[FIXED_SIZE];
+			std::vector<int> overflow;
+			int count = 0;
+
+			void push(int node)
+			{
+				if(count < FIXED_SIZE)
+					fixed[count] = node;
+				else
+					overflow.push_back(node);
+				count++;
+			}
+			int pop()
+			{
+				count--;
+				if(count < FIXED_SIZE)
+					return fixed[count];
+				const int node = overflow.back();
+				overflow.pop_back();
+				return node;
+			}
+			bool empty() const { return count == 0; }
+		};
+
+		int allocateNode();
+		void freeNode(int node);
+		void insertLeaf(int leaf);
+		void removeLeaf(int leaf);
+		int balance(int node);
+		void refitFrom(int node);
+
+		std::vector<Node> _nodes;
+		int _root;
+		int _freeList;
+};
+
+template <typename F>
+void DynamicAabbTree::query(const Aabb& aabb, F callback) const
+{
+	if(_root == NULL_NODE)
+		return;
+
+	TraversalStack stack;
+	stack.push(_root);
+	while(!stack.empty())
+	{
+		const Node& node = _nodes[stack.pop()];
+		if(!node.aabb.overlaps(aabb))
+			continue;
+
+		if(node.isLeaf())
+		{
+			if(!callback(node.userData))
+				return;
+		}
+		else
+		{
+			stack.push(node.child1);
+			stack.push(node.child2);
+		}
+	}
+}
+
+template <typename F>
+void DynamicAabbTree::raycast(glm::vec3 origin, glm::vec3 direction, float maxT, F callback) const
+{
+	if(_root == NULL_NODE)
+		return;
+
+	const glm::vec3 invDirection = 1.0f/direction;
+	TraversalStack stack;
+	stack.push(_root);
+	while(!stack.empty())
+	{
+		const Node& node = _nodes[stack.pop()];
+		float tEnter;
+		if(!node.aabb.raycast(origin, invDirection, maxT, tEnter))
+			continue;
+
+		if(node.isLeaf())
+		{
+			const float t = callback(node.userData, maxT);
+			if(t <= 0)
+				return;
+			maxT = glm::min(maxT, t);
+		}
+		else
+		{
+			stack.push(node.child1);
+			stack.push(node.child2);
+		}
+	}
+}
+
+template <typename F>
+void DynamicAabbTree::raycastPacket(RayPacket& packet, F callback) const
+{
+	if(_root == NULL_NODE)
+		return;
+
+	TraversalStack stack;
+	stack.push(_root);
+	while(!stack.empty())
+	{
+		const Node& node = _nodes[stack.pop()];
+		uint32_t mask = packetTest(node.aabb, packet);
+		if(mask == 0)
+			continue;
+
+		if(node.isLeaf())
+		{
+			while(mask != 0)
+			{
+				const uint32_t ray = __builtin_ctz(mask);
+				mask &= mask-1;
+				const float t = callback(node.userData, ray, packet.maxT[ray]);
+				packet.maxT[ray] = t <= 0 ? -1.0f : glm::min(packet.maxT[ray], t);
+			}
+		}
+		else
+		{
+			stack.push(node.child1);
+			stack.push(node.child2);
+		}
+	}
+}
+
+#endif// DYNAMIC_AABB_TREE_H
@@ -0,0 +1,316 @@
+//--------------------------------------------------
+// Robot Simulator
+// sweepAndPrune.cpp
+// Date: 2020-11-05
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#include "sweepAndPrune.h"
+#include <algorithm>
+#include <numeric>
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+SweepAndPrune::SweepAndPrune(BodyStore* bodyStore):
+	Broadphase(bodyStore), _axis(0), _addedCount(0), _centerSum(0,0,0), _centerSquaredSum(0,0,0)
+{
+	_type = "SweepAndPrune";
+}
+
+SweepAndPrune::~SweepAndPrune()
+{
+}
+
+void SweepAndPrune::addBody(BodyStore::BodyId id)
+{
+	if(id >= _contains.size())
+		_contains.resize(id+1, false);
+	if(_contains[id])
+		return;
+	_contains[id] = true;
+
+	// Added at the end, the bounds are filled by the next update
+	_minKeys.push_back(0);
+	_maxKeys.push_back(0);
+	_minA.push_back(0);
+	_maxA.push_back(0);
+	_minB.push_back(0);
+	_maxB.push_back(0);
+	_ids.push_back(id);
+	_addedCount++;
+}
+
+void SweepAndPrune::removeBody(BodyStore::BodyId id)
+{
+	if(id >= _contains.size() || !_contains[id])
+		return;
+	_contains[id] = false;
+
+	for(size_t i=0; i<_ids.size(); i++)
+	{
+		if(_ids[i] == id)
+		{
+			// Erase keeps the remaining endpoints sorted
+			_minKeys.erase(_minKeys.begin()+i);
+			_maxKeys.erase(_maxKeys.begin()+i);
+			_minA.erase(_minA.begin()+i);
+			_maxA.erase(_maxA.begin()+i);
+			_minB.erase(_minB.begin()+i);
+			_maxB.erase(_maxB.begin()+i);
+			_ids.erase(_ids.begin()+i);
+			return;
+		}
+	}
+}
+
+Aabb SweepAndPrune::getProxyAabb(size_t i) const
+{
+	const int axisA = (_axis+1)%3;
+	const int axisB = (_axis+2)%3;
+
+	Aabb aabb;
+	aabb.min[_axis] = _minKeys[i];
+	aabb.max[_axis] = _maxKeys[i];
+	aabb.min[axisA] = _minA[i];
+	aabb.max[axisA] = _maxA[i];
+	aabb.min[axisB] = _minB[i];
+	aabb.max[axisB] = _maxB[i];
+	return aabb;
+}
+
+void SweepAndPrune::update()
+{
+	updateBounds();
+
+	// Insertion sort is only near-linear when the order is almost correct
+	if(_addedCount > _ids.size()/16)
+		fullSort();
+	_addedCount = 0;
+
+	chooseSweepAxis();
+	insertionSort();
+	sweep();
+}
+
+void SweepAndPrune::updateBounds()
+{
+	_centerSum = glm::vec3(0,0,0);
+	_centerSquaredSum = glm::vec3(0,0,0);
+
+	const int axisA = (_axis+1)%3;
+	const int axisB = (_axis+2)%3;
+	for(size_t i=0; i<_ids.size(); i++)
+	{
+		const Aabb aabb = _bodyStore->getAabb(_ids[i]);
+		_minKeys[i] = aabb.min[_axis];
+		_maxKeys[i] = aabb.max[_axis];
+		_minA[i] = aabb.min[axisA];
+		_maxA[i] = aabb.max[axisA];
+		_minB[i] = aabb.min[axisB];
+		_maxB[i] = aabb.max[axisB];
+
+		const glm::vec3 center = aabb.getCenter();
+		_centerSum += center;
+		_centerSquaredSum += center*center;
+	}
+}
+
+void SweepAndPrune::chooseSweepAxis()
+{
+	if(_ids.size() < 2)
+		return;
+
+	const float n = (float)_ids.size();
+	const glm::vec3 variance = _centerSquaredSum/n - (_centerSum/n)*(_centerSum/n);
+
+	int best = _axis;
+	for(int axis=0; axis<3; axis++)
+		if(variance[axis] > variance[best])
+			best = axis;
+
+	// Hysteresis to avoid full re-sorts when two axes have similar variance
+	if(best != _axis && variance[best] > 1.2f*variance[_axis])
+	{
+		_axis = best;
+		updateBounds();
+		fullSort();
+	}
+}
+
+void SweepAndPrune::insertionSort()
+{
+	const size_t n = _minKeys.size();
+	for(size_t i=1; i<n; i++)
+	{
+		const float key = _minKeys[i];
+		if(_minKeys[i-1] <= key)
+			continue;
+
+		const float maxKey = _maxKeys[i];
+		const float minA = _minA[i], maxA = _maxA[i];
+		const float minB = _minB[i], maxB = _maxB[i];
+		const BodyStore::BodyId id = _ids[i];
+		size_t j = i;
+		while(j>0 && _minKeys[j-1] > key)
+		{
+			_minKeys[j] = _minKeys[j-1];
+			_maxKeys[j] = _maxKeys[j-1];
+			_minA[j] = _minA[j-1];
+			_maxA[j] = _maxA[j-1];
+			_minB[j] = _minB[j-1];
+			_maxB[j] = _maxB[j-1];
+			_ids[j] = _ids[j-1];
+			j--;
+		}
+		_minKeys[j] = key;
+		_maxKeys[j] = maxKey;
+		_minA[j] = minA;
+		_maxA[j] = maxA;
+		_minB[j] = minB;
+		_maxB[j] = maxB;
+		_ids[j] = id;
+	}
+}
+
+void SweepAndPrune::fullSort()
+{
+	std::vector<uint32_t> order(_ids.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b){ return _minKeys[a] < _minKeys[b]; });
+
+	auto permute = [&order](auto& array)
+	{
+		auto sorted = array;
+		for(size_t i=0; i<order.size(); i++)
+			sorted[i] = array[order[i]];
+		array.swap(sorted);
+	};
+	permute(_minKeys);
+	permute(_maxKeys);
+	permute(_minA);
+	permute(_maxA);
+	permute(_minB);
+	permute(_maxB);
+	permute(_ids);
+}
+
+void SweepAndPrune::sweep()
+{
+	_pairs.clear();
+
+	const uint32_t n = (uint32_t)_ids.size();
+	for(uint32_t i=0; i<n; i++)
+	{
+		// Only the proxies that start before this one ends can overlap it
+		const float maxKey = _maxKeys[i];
+		uint32_t end = i+1;
+		while(end<n && _minKeys[end]<=maxKey)
+			end++;
+
+		testRange(i, i+1, end);
+	}
+}
+
+void SweepAndPrune::testRange(uint32_t i, uint32_t begin, uint32_t end)
+{
+	uint32_t j = begin;
+
+	auto addPair = [this, i](uint32_t j)
+	{
+		const BodyStore::BodyId idA = _ids[i];
+		const BodyStore::BodyId idB = _ids[j];
+		if(isStaticPair(idA, idB))
+			return;
+
+		if(idA < idB)
+			_pairs.push_back({idA, idB});
+		else
+			_pairs.push_back({idB, idA});
+	};
+
+	// Test the two other axes for 8 (AVX) or 4 (SSE) proxies at a time
+#if defined(__AVX__)
+	const __m256 minA = _mm256_set1_ps(_minA[i]), maxA = _mm256_set1_ps(_maxA[i]);
+	const __m256 minB = _mm256_set1_ps(_minB[i]), maxB = _mm256_set1_ps(_maxB[i]);
+	for(; j+8<=end; j+=8)
+	{
+		const __m256 overlapA = _mm256_and_ps(
+				_mm256_cmp_ps(minA, _mm256_loadu_ps(&_maxA[j]), _CMP_LE_OQ),
+				_mm256_cmp_ps(maxA, _mm256_loadu_ps(&_minA[j]), _CMP_GE_OQ));
+		const __m256 overlapB = _mm256_and_ps(
+				_mm256_cmp_ps(minB, _mm256_loadu_ps(&_maxB[j]), _CMP_LE_OQ),
+				_mm256_cmp_ps(maxB, _mm256_loadu_ps(&_minB[j]), _CMP_GE_OQ));
+
+		int mask = _mm256_movemask_ps(_mm256_and_ps(overlapA, overlapB));
+		while(mask)
+		{
+			addPair(j + __builtin_ctz(mask));
+			mask &= mask-1;
+		}
+	}
+#elif defined(__SSE2__)
+	const __m128 minA = _mm_set1_ps(_minA[i]), maxA = _mm_set1_ps(_maxA[i]);
+	const __m128 minB = _mm_set1_ps(_minB[i]), maxB = _mm_set1_ps(_maxB[i]);
+	for(; j+4<=end; j+=4)
+	{
+		const __m128 overlapA = _mm_and_ps(
+				_mm_cmple_ps(minA, _mm_loadu_ps(&_maxA[j])),
+				_mm_cmpge_ps(maxA, _mm_loadu_ps(&_minA[j])));
+		const __m128 overlapB = _mm_and_ps(
+				_mm_cmple_ps(minB, _mm_loadu_ps(&_maxB[j])),
+				_mm_cmpge_ps(maxB, _mm_loadu_ps(&_minB[j])));
+
+		int mask = _mm_movemask_ps(_mm_and_ps(overlapA, overlapB));
+		while(mask)
+		{
+			addPair(j + __builtin_ctz(mask));
+			mask &= mask-1;
+		}
+	}
+#endif
+
+	for(; j<end; j++)
+	{
+		const bool overlap = (_minA[i] <= _maxA[j]) & (_maxA[i] >= _minA[j]) &
+			(_minB[i] <= _maxB[j]) & (_maxB[i] >= _minB[j]);
+		if(overlap)
+			addPair(j);
+	}
+}
+
+void SweepAndPrune::query(const Aabb& aabb, const std::function<bool(BodyStore::BodyId)>& callback) const
+{
+	const int axisA = (_axis+1)%3;
+	const int axisB = (_axis+2)%3;
+
+	// Proxies starting after the query box ends can be skipped
+	const size_t end = std::upper_bound(_minKeys.begin(), _minKeys.end(), aabb.max[_axis]) - _minKeys.begin();
+	for(size_t i=0; i<end; i++)
+	{
+		if(_maxKeys[i] < aabb.min[_axis] ||
+			_minA[i] > aabb.max[axisA] || _maxA[i] < aabb.min[axisA] ||
+			_minB[i] > aabb.max[axisB] || _maxB[i] < aabb.min[axisB])
+			continue;
+
+		if(!callback(_ids[i]))
+			return;
+	}
+}
+
+void SweepAndPrune::raycast(glm::vec3 origin, glm::vec3 direction, float maxT,
+		const std::function<float(BodyStore::BodyId, float)>& callback) const
+{
+	// No hierarchy to traverse, every proxy is tested
+	const glm::vec3 invDirection = 1.0f/direction;
+	for(size_t i=0; i<_ids.size(); i++)
+	{
+		float tEnter;
+		if(!getProxyAabb(i).raycast(origin, invDirection, maxT, tEnter))
+			continue;
+
+		const float t = callback(_ids[i], maxT);
+		if(t <= 0)
+			return;
+		maxT = glm::min(maxT, t);
+	}
+}
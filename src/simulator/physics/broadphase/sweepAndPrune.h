@@ -0,0 +1,57 @@
+//--------------------------------------------------
+// Robot Simulator
+// sweepAndPrune.h
+// Date: 2020-11-05
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef SWEEP_AND_PRUNE_H
+#define SWEEP_AND_PRUNE_H
+
+#include "broadphase.h"
+
+// Incremental sort and sweep along the axis of greatest variance.
+// The sorted arrays are kept between steps, so coherent scenes are
+// re-sorted by insertion sort in near-linear time.
+class SweepAndPrune : public Broadphase
+{
+	public:
+		SweepAndPrune(BodyStore* bodyStore);
+		~SweepAndPrune();
+
+		void addBody(BodyStore::BodyId id) override;
+		void removeBody(BodyStore::BodyId id) override;
+		void update() override;
+
+		void query(const Aabb& aabb, const std::function<bool(BodyStore::BodyId)>& callback) const override;
+		void raycast(glm::vec3 origin, glm::vec3 direction, float maxT,
+				const std::function<float(BodyStore::BodyId, float)>& callback) const override;
+
+		//---------- Getters ----------//
+		int getSweepAxis() const { return _axis; }
+
+	private:
+		void updateBounds();
+		void chooseSweepAxis();
+		void insertionSort();
+		void fullSort();
+		void sweep();
+		void testRange(uint32_t i, uint32_t begin, uint32_t end);
+		Aabb getProxyAabb(size_t i) const;
+
+		// Endpoint arrays, all sorted by _minKeys (min endpoint on the sweep axis).
+		// A and B are the two other axes, tested only inside the sweep window.
+		std::vector<float> _minKeys, _maxKeys;
+		std::vector<float> _minA, _maxA;
+		std::vector<float> _minB, _maxB;
+		std::vector<BodyStore::BodyId> _ids;
+		// Indexed by body id
+		std::vector<bool> _contains;
+
+		int _axis;
+		// Proxies appended since the last update (unsorted)
+		size_t _addedCount;
+		glm::vec3 _centerSum;
+		glm::vec3 _centerSquaredSum;
+};
+
+#endif// SWEEP_AND_PRUNE_H
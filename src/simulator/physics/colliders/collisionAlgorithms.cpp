@@ -0,0 +1,543 @@
+//--------------------------------------------------
+// Robot Simulator
+// collisionAlgorithms.cpp
+// Date: 2020-11-12
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#include "collisionAlgorithms.h"
+#include "gjkEpa.h"
+#include <cfloat>
+#include <cmath>
+#include <utility>
+
+//---------------------------------------------//
+//------------------- Sphere ------------------//
+//---------------------------------------------//
+bool CollisionAlgorithms::sphereSphere(const ShapeInstance& a, const ShapeInstance& b, ContactManifold& manifold)
+{
+	const float ra = a.halfExtents.x;
+	const float rb = b.halfExtents.x;
+	const glm::vec3 d = b.position - a.position;
+	const float dist2 = glm::dot(d, d);
+	if(dist2 > (ra+rb)*(ra+rb))
+		return false;
+
+	const float dist = std::sqrt(dist2);
+	const float depth = ra + rb - dist;
+	manifold.normal = dist > 1e-6f ? d/dist : glm::vec3(0,1,0);
+	manifold.points[0] = {a.position + manifold.normal*(ra - depth*0.5f), depth, 0};
+	manifold.pointCount = 1;
+	return true;
+}
+
+bool CollisionAlgorithms::sphereBox(const ShapeInstance& a, const ShapeInstance& b, ContactManifold& manifold)
+{
+	const float radius = a.halfExtents.x;
+	const glm::vec3 h = b.halfExtents;
+
+	// Sphere center in the box space
+	const glm::vec3 local = glm::transpose(b.rotation)*(a.position - b.position);
+	glm::vec3 closest = glm::clamp(local, -h, h);
+
+	// Direction from the box surface to the sphere center
+	glm::vec3 normalLocal;
+	float depth;
+	if(closest.x != local.x || closest.y != local.y || closest.z != local.z)
+	{
+		const glm::vec3 diff = local - closest;
+		const float dist2 = glm::dot(diff, diff);
+		if(dist2 > radius*radius)
+			return false;
+		const float dist = std::sqrt(dist2);
+		normalLocal = diff/dist;
+		depth = radius - dist;
+	}
+	else
+	{
+		// Center inside the box, push through the nearest face
+		int axis = 0;
+		float minDist = h.x - glm::abs(local.x);
+		for(int i=1; i<3; i++)
+		{
+			const float dist = h[i] - glm::abs(local[i]);
+			if(dist < minDist)
+			{
+				minDist = dist;
+				axis = i;
+			}
+		}
+		const float side = local[axis] < 0 ? -1.0f : 1.0f;
+		normalLocal = glm::vec3(0);
+		normalLocal[axis] = side;
+		closest[axis] = side*h[axis];
+		depth = radius + minDist;
+	}
+
+	const glm::vec3 normal = b.rotation*normalLocal;
+	const glm::vec3 surface = b.position + b.rotation*closest;
+	manifold.normal = -normal;
+	manifold.points[0] = {surface - normal*(depth*0.5f), depth, 0};
+	manifold.pointCount = 1;
+	return true;
+}
+
+bool CollisionAlgorithms::spherePlane(const ShapeInstance& a, const ShapeInstance& b, ContactManifold& manifold)
+{
+	const float radius = a.halfExtents.x;
+	const glm::vec3 planeNormal = b.rotation[1];
+	const float dist = glm::dot(a.position - b.position, planeNormal);
+	const float depth = radius - dist;
+	if(depth < 0 || !insidePlane(b, a.position - planeNormal*dist))
+		return false;
+
+	manifold.normal = -planeNormal;
+	manifold.points[0] = {a.position - planeNormal*((radius+dist)*0.5f), depth, 0};
+	manifold.pointCount = 1;
+	return true;
+}
+
+//---------------------------------------------//
+//--------------------- Box -------------------//
+//---------------------------------------------//
+bool CollisionAlgorithms::boxBox(const ShapeInstance& a, const ShapeInstance& b, ContactManifold& manifold)
+{
+	const glm::vec3 d = b.position - a.position;
+	const glm::vec3 ha = a.halfExtents;
+	const glm::vec3 hb = b.halfExtents;
+
+	// absC[i][j] = |dot(Ua_i, Ub_j)| (epsilon avoids problems with parallel edges)
+	float absC[3][3];
+	for(int i=0; i<3; i++)
+		for(int j=0; j<3; j++)
+			absC[i][j] = glm::abs(glm::dot(a.rotation[i], b.rotation[j])) + 1e-6f;
+
+	float minPenetration = FLT_MAX;
+	int bestAxis = -1;
+	glm::vec3 normal;
+
+	// Axes 0-2: faces of A, 3-5: faces of B
+	for(int i=0; i<3; i++)
+	{
+		const float rb = hb.x*absC[i][0] + hb.y*absC[i][1] + hb.z*absC[i][2];
+		const float penetration = ha[i] + rb - glm::abs(glm::dot(d, a.rotation[i]));
+		if(penetration < 0)
+			return false;
+		if(penetration < minPenetration)
+		{
+			minPenetration = penetration;
+			bestAxis = i;
+			normal = a.rotation[i];
+		}
+	}
+	for(int j=0; j<3; j++)
+	{
+		const float ra = ha.x*absC[0][j] + ha.y*absC[1][j] + ha.z*absC[2][j];
+		const float penetration = ra + hb[j] - glm::abs(glm::dot(d, b.rotation[j]));
+		if(penetration < 0)
+			return false;
+		if(penetration < minPenetration)
+		{
+			minPenetration = penetration;
+			bestAxis = 3+j;
+			normal = b.rotation[j];
+		}
+	}
+
+	// Axes 6-14: edge cross products, only used when clearly better than the faces
+	for(int i=0; i<3; i++)
+	{
+		for(int j=0; j<3; j++)
+		{
+			glm::vec3 axis = glm::cross(a.rotation[i], b.rotation[j]);
+			const float length = glm::length(axis);
+			if(length < 1e-5f)
+				continue;
+			axis /= length;
+
+			const float ra = ha.x*glm::abs(glm::dot(a.rotation[0], axis)) + ha.y*glm::abs(glm::dot(a.rotation[1], axis)) + ha.z*glm::abs(glm::dot(a.rotation[2], axis));
+			const float rb = hb.x*glm::abs(glm::dot(b.rotation[0], axis)) + hb.y*glm::abs(glm::dot(b.rotation[1], axis)) + hb.z*glm::abs(glm::dot(b.rotation[2], axis));
+			const float penetration = ra + rb - glm::abs(glm::dot(d, axis));
+			if(penetration < 0)
+				return false;
+			if(penetration*1.05f + 1e-3f < minPenetration)
+			{
+				minPenetration = penetration;
+				bestAxis = 6 + i*3 + j;
+				normal = axis;
+			}
+		}
+	}
+
+	if(glm::dot(normal, d) < 0)
+		normal = -normal;
+	manifold.normal = normal;
+
+	ContactManifold::Candidates candidates;
+	if(bestAxis < 6)
+	{
+		// Face contact: clip the incident face against the reference face
+		const bool referenceIsA = bestAxis < 3;
+		const ShapeInstance& reference = referenceIsA ? a : b;
+		const ShapeInstance& incident = referenceIsA ? b : a;
+		const glm::vec3 referenceNormal = referenceIsA ? normal : -normal;
+		const int referenceAxis = bestAxis%3;
+		const glm::vec3 referenceCenter = reference.position + referenceNormal*reference.halfExtents[referenceAxis];
+
+		// Incident face is the most anti-parallel to the reference normal
+		int incidentAxis = 0;
+		float best = -1.0f;
+		for(int k=0; k<3; k++)
+		{
+			const float dp = glm::abs(glm::dot(incident.rotation[k], referenceNormal));
+			if(dp > best)
+			{
+				best = dp;
+				incidentAxis = k;
+			}
+		}
+		const float incidentSide = glm::dot(incident.rotation[incidentAxis], referenceNormal) > 0 ? -1.0f : 1.0f;
+		const glm::vec3 incidentCenter = incident.position + incident.rotation[incidentAxis]*(incidentSide*incident.halfExtents[incidentAxis]);
+		const int u = (incidentAxis+1)%3;
+		const int v = (incidentAxis+2)%3;
+		const glm::vec3 U = incident.rotation[u]*incident.halfExtents[u];
+		const glm::vec3 V = incident.rotation[v]*incident.halfExtents[v];
+
+		ClipVertex polygonA[8] = {
+			{incidentCenter+U+V, 0}, {incidentCenter-U+V, 1},
+			{incidentCenter-U-V, 2}, {incidentCenter+U-V, 3}};
+		ClipVertex polygonB[8];
+		int count = 4;
+
+		// Side planes of the reference face
+		ClipVertex* input = polygonA;
+		ClipVertex* output = polygonB;
+		uint32_t planeId = 0;
+		for(int k=1; k<3 && count>0; k++)
+		{
+			const int sideAxis = (referenceAxis+k)%3;
+			const glm::vec3 sideNormal = reference.rotation[sideAxis];
+			const float center = glm::dot(sideNormal, reference.position);
+			const float extent = reference.halfExtents[sideAxis];
+
+			count = clipPolygon(input, count, sideNormal, center+extent, planeId++, output);
+			std::swap(input, output);
+			count = clipPolygon(input, count, -sideNormal, -center+extent, planeId++, output);
+			std::swap(input, output);
+		}
+
+		const uint32_t referenceFace = referenceAxis*2 + (glm::dot(reference.rotation[referenceAxis], referenceNormal) > 0 ? 0 : 1);
+		const uint32_t incidentFace = incidentAxis*2 + (incidentSide > 0 ? 0 : 1);
+		const uint32_t faceId = ((referenceIsA ? 0 : 1)<<24) | (referenceFace<<20) | (incidentFace<<16);
+		for(int k=0; k<count; k++)
+		{
+			const glm::vec3 p = input[k].position;
+			const float depth = glm::dot(referenceCenter - p, referenceNormal);
+			if(depth >= 0)
+				candidates.add(p + referenceNormal*(depth*0.5f), depth, faceId | input[k].featureId);
+		}
+	}
+	else
+	{
+		// Edge-edge contact: closest points between the two edges
+		const int i = (bestAxis-6)/3;
+		const int j = (bestAxis-6)%3;
+		glm::vec3 pa = a.position;
+		glm::vec3 pb = b.position;
+		for(int k=0; k<3; k++)
+		{
+			if(k != i)
+				pa += a.rotation[k]*(glm::dot(a.rotation[k], normal) >= 0 ? ha[k] : -ha[k]);
+			if(k != j)
+				pb += b.rotation[k]*(glm::dot(b.rotation[k], normal) >= 0 ? -hb[k] : hb[k]);
+		}
+
+		const glm::vec3 da = a.rotation[i];
+		const glm::vec3 db = b.rotation[j];
+		const glm::vec3 r = pa - pb;
+		const float e = glm::dot(da, db);
+		const float f = glm::dot(db, r);
+		const float c = glm::dot(da, r);
+		const float denominator = 1.0f - e*e;
+		float s = denominator > 1e-6f ? (e*f - c)/denominator : 0.0f;
+		s = glm::clamp(s, -ha[i], ha[i]);
+		const float t = glm::clamp(e*s + f, -hb[j], hb[j]);
+
+		const glm::vec3 ca = pa + da*s;
+		const glm::vec3 cb = pb + db*t;
+		candidates.add((ca+cb)*0.5f, minPenetration, (2u<<24) | (uint32_t)bestAxis);
+	}
+
+	manifold.reduce(candidates);
+	return manifold.pointCount > 0;
+}
+
+bool CollisionAlgorithms::boxPlane(const ShapeInstance& a, const ShapeInstance& b, ContactManifold& manifold)
+{
+	const glm::vec3 planeNormal = b.rotation[1];
+	const float planeOffset = glm::dot(planeNormal, b.position);
+	const glm::vec3 h = a.halfExtents;
+
+	ContactManifold::Candidates candidates;
+	for(uint32_t k=0; k<8; k++)
+	{
+		const glm::vec3 corner = {k&1 ? h.x : -h.x, k&2 ? h.y : -h.y, k&4 ? h.z : -h.z};
+		const glm::vec3 vertex = a.position + a.rotation*corner;
+		const float depth = planeOffset - glm::dot(vertex, planeNormal);
+		if(depth >= 0 && insidePlane(b, vertex))
+			candidates.add(vertex + planeNormal*(depth*0.5f), depth, k);
+	}
+	if(candidates.count == 0)
+		return false;
+
+	manifold.normal = -planeNormal;
+	manifold.reduce(candidates);
+	return true;
+}
+
+//---------------------------------------------//
+//------------------ Cylinder -----------------//
+//---------------------------------------------//
+bool CollisionAlgorithms::cylinderPlane(const ShapeInstance& a, const ShapeInstance& b, ContactManifold& manifold)
+{
+	const glm::vec3 planeNormal = b.rotation[1];
+	const float planeOffset = glm::dot(planeNormal, b.position);
+	const glm::vec3 axis = a.rotation[1];
+	const float radius = a.halfExtents.x;
+	const float halfHeight = a.halfExtents.y;
+
+	// Rim direction that goes deeper into the plane
+	glm::vec3 w = glm::dot(planeNormal, axis)*axis - planeNormal;
+	const float length = glm::length(w);
+	w = length > 1e-4f ? w/length : a.rotation[0];
+	const glm::vec3 v = glm::cross(axis, w);
+
+	// Deepest rim point and three more at 90 degrees on each cap:
+	// one point when tilted, two when lying down and four when standing
+	const glm::vec3 rim[4] = {w, v, -w, -v};
+	ContactManifold::Candidates candidates;
+	for(uint32_t cap=0; cap<2; cap++)
+	{
+		const glm::vec3 center = a.position + axis*(cap == 0 ? halfHeight : -halfHeight);
+		for(uint32_t k=0; k<4; k++)
+		{
+			const glm::vec3 point = center + rim[k]*radius;
+			const float depth = planeOffset - glm::dot(point, planeNormal);
+			if(depth >= 0 && insidePlane(b, point))
+				candidates.add(point + planeNormal*(depth*0.5f), depth, cap*4 + k);
+		}
+	}
+	if(candidates.count == 0)
+		return false;
+
+	manifold.normal = -planeNormal;
+	manifold.reduce(candidates);
+	return true;
+}
+
+//---------------------------------------------//
+//------------------- Convex ------------------//
+//---------------------------------------------//
+bool CollisionAlgorithms::convexConvex(const ShapeInstance& a, const ShapeInstance& b, ContactManifold& manifold)
+{
+	GjkEpa::Result result;
+	if(!GjkEpa::penetration(a, b, result))
+		return false;
+
+	const glm::vec3 normal = result.normal;
+	manifold.normal = normal;
+
+	glm::vec3 featureA[8];
+	glm::vec3 featureB[8];
+	const int countA = getSupportFeature(a, normal, featureA);
+	const int countB = getSupportFeature(b, -normal, featureB);
+
+	ContactManifold::Candidates candidates;
+	if(countA >= 2 && countB >= 2 && (countA >= 3 || countB >= 3))
+	{
+		// Face against face/edge: clip the incident feature against the reference face
+		const bool referenceIsA = countA >= countB;
+		const glm::vec3* reference = referenceIsA ? featureA : featureB;
+		const glm::vec3* incident = referenceIsA ? featureB : featureA;
+		const int referenceCount = referenceIsA ? countA : countB;
+		int count = referenceIsA ? countB : countA;
+		const glm::vec3 referenceNormal = referenceIsA ? normal : -normal;
+
+		ClipVertex polygonA[16];
+		ClipVertex polygonB[16];
+		for(int k=0; k<count; k++)
+			polygonA[k] = {incident[k], (uint32_t)k};
+
+		glm::vec3 centroid = glm::vec3(0);
+		for(int k=0; k<referenceCount; k++)
+			centroid += reference[k];
+		centroid /= (float)referenceCount;
+
+		ClipVertex* input = polygonA;
+		ClipVertex* output = polygonB;
+		for(int k=0; k<referenceCount && count>0; k++)
+		{
+			const glm::vec3 p0 = reference[k];
+			const glm::vec3 p1 = reference[(k+1)%referenceCount];
+			glm::vec3 sideNormal = glm::cross(p1-p0, referenceNormal);
+			if(glm::dot(sideNormal, centroid-p0) > 0)
+				sideNormal = -sideNormal;
+
+			count = clipPolygon(input, count, sideNormal, glm::dot(sideNormal, p0), k, output);
+			std::swap(input, output);
+		}
+
+		for(int k=0; k<count; k++)
+		{
+			const glm::vec3 p = input[k].position;
+			const float depth = glm::dot(reference[0] - p, referenceNormal);
+			if(depth >= 0)
+				candidates.add(p + referenceNormal*(depth*0.5f), depth, input[k].featureId);
+		}
+	}
+
+	// Vertex or edge contacts use the EPA witness points
+	if(candidates.count == 0)
+		candidates.add((result.pointA + result.pointB)*0.5f, result.depth, 0);
+
+	manifold.reduce(candidates);
+	return true;
+}
+
+int CollisionAlgorithms::getSupportFeature(const ShapeInstance& shape, glm::vec3 direction, glm::vec3 feature[8])
+{
+	// Directions closer than ~3 degrees to a face are treated as parallel
+	const float epsilon = 0.05f;
+	direction = glm::normalize(direction);
+	const glm::vec3 local = glm::transpose(shape.rotation)*direction;
+	const glm::vec3 h = shape.halfExtents;
+	int count = 0;
+
+	switch(shape.type)
+	{
+		case ShapeType::SPHERE:
+			feature[0] = shape.position + direction*h.x;
+			return 1;
+		case ShapeType::CYLINDER:
+		{
+			const float radial = std::sqrt(local.x*local.x + local.z*local.z);
+			const float capY = local.y < 0 ? -h.y : h.y;
+			if(radial < epsilon)
+			{
+				// Cap, approximated by an octagon
+				for(int k=0; k<8; k++)
+				{
+					const float angle = k*0.785398163f;
+					feature[count++] = {h.x*std::cos(angle), capY, h.x*std::sin(angle)};
+				}
+			}
+			else
+			{
+				const glm::vec3 rim = glm::vec3(local.x, 0, local.z)*(h.x/radial);
+				if(glm::abs(local.y) < epsilon)
+				{
+					// Side line
+					feature[count++] = rim + glm::vec3(0, h.y, 0);
+					feature[count++] = rim - glm::vec3(0, h.y, 0);
+				}
+				else
+					feature[count++] = rim + glm::vec3(0, capY, 0);
+			}
+			break;
+		}
+		case ShapeType::BOX:
+		case ShapeType::PLANE:
+		default:
+		{
+			const glm::vec3 corner = {local.x < 0 ? -h.x : h.x, local.y < 0 ? -h.y : h.y, local.z < 0 ? -h.z : h.z};
+			int freeAxes[3];
+			int freeCount = 0;
+			for(int k=0; k<3; k++)
+				if(glm::abs(local[k]) < epsilon)
+					freeAxes[freeCount++] = k;
+
+			if(freeCount == 0)
+				feature[count++] = corner;
+			else if(freeCount == 1)
+			{
+				glm::vec3 p = corner;
+				feature[count++] = p;
+				p[freeAxes[0]] = -p[freeAxes[0]];
+				feature[count++] = p;
+			}
+			else
+			{
+				// Face of the dominant axis, in winding order
+				int axis = 0;
+				for(int k=1; k<3; k++)
+					if(glm::abs(local[k]) > glm::abs(local[axis]))
+						axis = k;
+				const int u = (axis+1)%3;
+				const int v = (axis+2)%3;
+				const float signs[4][2] = {{1,1}, {-1,1}, {-1,-1}, {1,-1}};
+				for(int k=0; k<4; k++)
+				{
+					glm::vec3 p = corner;
+					p[u] = signs[k][0]*h[u];
+					p[v] = signs[k][1]*h[v];
+					feature[count++] = p;
+				}
+			}
+			break;
+		}
+	}
+
+	for(int k=0; k<count; k++)
+		feature[k] = shape.position + shape.rotation*feature[k];
+	return count;
+}
+
+//---------------------------------------------//
+//------------------ Helpers ------------------//
+//---------------------------------------------//
+int CollisionAlgorithms::clipPolygon(const ClipVertex* input, int count, glm::vec3 normal, float offset, uint32_t planeId, ClipVertex* output)
+{
+	// Clipped points get an id from the plane and the edge that was cut
+	auto clippedId = [planeId](uint32_t edge) { return 0x100u | (planeId<<4) | edge; };
+
+	int outCount = 0;
+	if(count == 2)
+	{
+		// Segment (no closing edge)
+		const float d0 = glm::dot(normal, input[0].position) - offset;
+		const float d1 = glm::dot(normal, input[1].position) - offset;
+		if(d0 > 0 && d1 > 0)
+			return 0;
+		output[0] = input[0];
+		output[1] = input[1];
+		if(d0 > 0)
+			output[0] = {input[0].position + (input[1].position-input[0].position)*(d0/(d0-d1)), clippedId(0)};
+		else if(d1 > 0)
+			output[1] = {input[0].position + (input[1].position-input[0].position)*(d0/(d0-d1)), clippedId(0)};
+		return 2;
+	}
+
+	for(int i=0; i<count; i++)
+	{
+		const ClipVertex& current = input[i];
+		const ClipVertex& next = input[(i+1)%count];
+		const float dc = glm::dot(normal, current.position) - offset;
+		const float dn = glm::dot(normal, next.position) - offset;
+
+		if(dc <= 0)
+			output[outCount++] = current;
+		if((dc <= 0) != (dn <= 0))
+			output[outCount++] = {current.position + (next.position-current.position)*(dc/(dc-dn)), clippedId(i)};
+	}
+	return outCount;
+}
+
+bool CollisionAlgorithms::insidePlane(const ShapeInstance& plane, glm::vec3 point)
+{
+	// Planes without size are infinite
+	const glm::vec3 h = plane.halfExtents;
+	if(h.x <= 0 && h.z <= 0)
+		return true;
+
+	const glm::vec3 local = glm::transpose(plane.rotation)*(point - plane.position);
+	return glm::abs(local.x) <= h.x && glm::abs(local.z) <= h.z;
+}
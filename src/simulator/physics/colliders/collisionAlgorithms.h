@@ -0,0 +1,48 @@
+//--------------------------------------------------
+// Robot Simulator
+// collisionAlgorithms.h
+// Date: 2020-11-12
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef COLLISION_ALGORITHMS_H
+#define COLLISION_ALGORITHMS_H
+
+#include "glm.h"
+#include "shape.h"
+#include "contactManifold.h"
+
+// Contact generation routines, the first shape type is always
+// the smaller one in the ShapeType order (the narrowphase swaps the pair).
+// They fill the normal and points of the manifold and return false when
+// the shapes are not touching.
+class CollisionAlgorithms
+{
+	public:
+		typedef bool (*CollideFunction)(const ShapeInstance& a, const ShapeInstance& b, ContactManifold& manifold);
+
+		static bool sphereSphere(const ShapeInstance& a, const ShapeInstance& b, ContactManifold& manifold);
+		static bool sphereBox(const ShapeInstance& a, const ShapeInstance& b, ContactManifold& manifold);
+		static bool spherePlane(const ShapeInstance& a, const ShapeInstance& b, ContactManifold& manifold);
+		// Separating axis test on the 15 axes, face contacts are clipped (up to 8 points before reduction)
+		static bool boxBox(const ShapeInstance& a, const ShapeInstance& b, ContactManifold& manifold);
+		static bool boxPlane(const ShapeInstance& a, const ShapeInstance& b, ContactManifold& manifold);
+		static bool cylinderPlane(const ShapeInstance& a, const ShapeInstance& b, ContactManifold& manifold);
+		// GJK/EPA for the normal, the points come from clipping the support features
+		static bool convexConvex(const ShapeInstance& a, const ShapeInstance& b, ContactManifold& manifold);
+
+		// Vertices of the face/edge/vertex of the shape that is extreme in the direction (returns the count)
+		static int getSupportFeature(const ShapeInstance& shape, glm::vec3 direction, glm::vec3 feature[8]);
+
+	private:
+		struct ClipVertex
+		{
+			glm::vec3 position;
+			uint32_t featureId;
+		};
+
+		// Keep the part of the polygon with dot(normal, p) <= offset (Sutherland-Hodgman)
+		static int clipPolygon(const ClipVertex* input, int count, glm::vec3 normal, float offset, uint32_t planeId, ClipVertex* output);
+		static bool insidePlane(const ShapeInstance& plane, glm::vec3 point);
+};
+
+#endif// COLLISION_ALGORITHMS_H
@@ -0,0 +1,88 @@
+//--------------------------------------------------
+// Robot Simulator
+// contactManifold.cpp
+// Date: 2020-11-12
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#include "contactManifold.h"
+
+void ContactManifold::reduce(const Candidates& candidates)
+{
+	if(candidates.count <= MAX_POINTS)
+	{
+		for(int i=0; i<candidates.count; i++)
+			points[i] = candidates.points[i];
+		pointCount = candidates.count;
+		return;
+	}
+
+	const ContactPoint* c = candidates.points;
+	int chosen[MAX_POINTS];
+
+	// Deepest point
+	chosen[0] = 0;
+	for(int i=1; i<candidates.count; i++)
+		if(c[i].penetration > c[chosen[0]].penetration)
+			chosen[0] = i;
+
+	// Farthest from the deepest
+	chosen[1] = chosen[0];
+	float best = -1.0f;
+	for(int i=0; i<candidates.count; i++)
+	{
+		const glm::vec3 d = c[i].position - c[chosen[0]].position;
+		const float dist2 = glm::dot(d, d);
+		if(dist2 > best)
+		{
+			best = dist2;
+			chosen[1] = i;
+		}
+	}
+
+	// Largest triangle (the sign tells on which side of the first edge the point is)
+	const glm::vec3 p0 = c[chosen[0]].position;
+	const glm::vec3 p1 = c[chosen[1]].position;
+	chosen[2] = chosen[0];
+	best = -1.0f;
+	float side = 1.0f;
+	for(int i=0; i<candidates.count; i++)
+	{
+		const float area = glm::dot(glm::cross(p1-p0, c[i].position-p0), normal);
+		if(glm::abs(area) > best)
+		{
+			best = glm::abs(area);
+			side = area < 0 ? -1.0f : 1.0f;
+			chosen[2] = i;
+		}
+	}
+
+	// Point that adds more area outside the triangle
+	const glm::vec3 triangle[3] = {p0, p1, c[chosen[2]].position};
+	chosen[3] = chosen[0];
+	best = 0.0f;
+	for(int i=0; i<candidates.count; i++)
+	{
+		for(int e=0; e<3; e++)
+		{
+			const glm::vec3 a = triangle[e];
+			const glm::vec3 b = triangle[(e+1)%3];
+			const float area = -side*glm::dot(glm::cross(b-a, c[i].position-a), normal);
+			if(area > best)
+			{
+				best = area;
+				chosen[3] = i;
+			}
+		}
+	}
+
+	pointCount = 0;
+	for(int i=0; i<MAX_POINTS; i++)
+	{
+		// Degenerate sets can choose the same point twice
+		bool repeated = false;
+		for(int j=0; j<i; j++)
+			repeated |= chosen[j] == chosen[i];
+		if(!repeated)
+			points[pointCount++] = c[chosen[i]];
+	}
+}
@@ -0,0 +1,54 @@
+//--------------------------------------------------
+// Robot Simulator
+// contactManifold.h
+// Date: 2020-11-12
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef CONTACT_MANIFOLD_H
+#define CONTACT_MANIFOLD_H
+
+#include <cstdint>
+#include "glm.h"
+#include "../bodyStore.h"
+
+struct ContactPoint
+{
+	// World position (halfway between both surfaces)
+	glm::vec3 position;
+	// Positive when the shapes overlap
+	float penetration;
+	// Identifies the features that generated the point (used to match points between steps)
+	uint32_t featureId;
+};
+
+// Contact points between two bodies sharing the same normal
+struct ContactManifold
+{
+	static const int MAX_POINTS = 4;
+
+	BodyStore::BodyId a;
+	BodyStore::BodyId b;
+	// Points from a to b (b must move along the normal to separate)
+	glm::vec3 normal;
+	ContactPoint points[MAX_POINTS];
+	int pointCount;
+
+	// Candidate points used before the reduction
+	struct Candidates
+	{
+		static const int MAX_CANDIDATES = 16;
+		ContactPoint points[MAX_CANDIDATES];
+		int count = 0;
+
+		void add(glm::vec3 position, float penetration, uint32_t featureId)
+		{
+			if(count < MAX_CANDIDATES)
+				points[count++] = {position, penetration, featureId};
+		}
+	};
+
+	// Keep up to MAX_POINTS candidates: the deepest one and the ones that maximize the contact area
+	void reduce(const Candidates& candidates);
+};
+
+#endif// CONTACT_MANIFOLD_H
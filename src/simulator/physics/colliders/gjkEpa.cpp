@@ -0,0 +1,344 @@
+//--------------------------------------------------
+// Robot Simulator
+// gjkEpa.cpp
+// Date: 2020-11-12
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#include "gjkEpa.h"
+#include <cmath>
+#include <utility>
+
+glm::vec3 GjkEpa::support(const ShapeInstance& shape, glm::vec3 direction)
+{
+	const glm::vec3 local = glm::transpose(shape.rotation)*direction;
+	const glm::vec3 h = shape.halfExtents;
+	glm::vec3 point;
+	switch(shape.type)
+	{
+		case ShapeType::SPHERE:
+		{
+			const float length = glm::length(direction);
+			return shape.position + (length > 0 ? direction*(h.x/length) : glm::vec3(0));
+		}
+		case ShapeType::CYLINDER:
+		{
+			const float radial = std::sqrt(local.x*local.x + local.z*local.z);
+			point.x = radial > 0 ? local.x*h.x/radial : 0;
+			point.y = local.y < 0 ? -h.y : h.y;
+			point.z = radial > 0 ? local.z*h.x/radial : 0;
+			break;
+		}
+		case ShapeType::BOX:
+		case ShapeType::PLANE:
+		default:
+			point.x = local.x < 0 ? -h.x : h.x;
+			point.y = local.y < 0 ? -h.y : h.y;
+			point.z = local.z < 0 ? -h.z : h.z;
+			break;
+	}
+	return shape.position + shape.rotation*point;
+}
+
+GjkEpa::SupportPoint GjkEpa::minkowskiSupport(const ShapeInstance& a, const ShapeInstance& b, glm::vec3 direction)
+{
+	SupportPoint point;
+	point.a = support(a, direction);
+	point.b = support(b, -direction);
+	point.v = point.a - point.b;
+	return point;
+}
+
+bool GjkEpa::penetration(const ShapeInstance& a, const ShapeInstance& b, Result& result)
+{
+	SupportPoint simplex[4];
+	if(!gjk(a, b, simplex))
+		return false;
+	return epa(a, b, simplex, result);
+}
+
+//---------------------------------------------//
+//-------------------- GJK --------------------//
+//---------------------------------------------//
+// Any vector perpendicular to v
+static glm::vec3 perpendicular(glm::vec3 v)
+{
+	return glm::abs(v.x) < 0.57f ? glm::cross(v, glm::vec3(1,0,0)) : glm::cross(v, glm::vec3(0,1,0));
+}
+
+bool GjkEpa::gjk(const ShapeInstance& a, const ShapeInstance& b, SupportPoint simplex[4])
+{
+	const int maxIterations = 32;
+
+	glm::vec3 direction = b.position - a.position;
+	if(glm::dot(direction, direction) < 1e-12f)
+		direction = glm::vec3(1,0,0);
+
+	simplex[0] = minkowskiSupport(a, b, direction);
+	int count = 1;
+	direction = -simplex[0].v;
+
+	for(int i=0; i<maxIterations; i++)
+	{
+		if(glm::dot(direction, direction) < 1e-12f)
+			direction = perpendicular(simplex[count-1].v);
+
+		const SupportPoint point = minkowskiSupport(a, b, direction);
+		// The new point did not pass the origin, the shapes are separated
+		if(glm::dot(point.v, direction) <= 0)
+			return false;
+
+		simplex[count++] = point;
+		if(updateSimplex(simplex, count, direction))
+			return true;
+	}
+	return false;
+}
+
+bool GjkEpa::updateSimplex(SupportPoint simplex[4], int& count, glm::vec3& direction)
+{
+	// The newest point is always simplex[count-1]
+	if(count == 4)
+	{
+		const SupportPoint A = simplex[3];
+		const SupportPoint B = simplex[2];
+		const SupportPoint C = simplex[1];
+		const SupportPoint D = simplex[0];
+		const glm::vec3 AO = -A.v;
+
+		// Faces containing A, with their opposite vertex
+		const SupportPoint faces[3][3] = {{A, B, C}, {A, C, D}, {A, D, B}};
+		const glm::vec3 opposite[3] = {D.v, B.v, C.v};
+		bool inside = true;
+		for(int f=0; f<3 && inside; f++)
+		{
+			glm::vec3 normal = glm::cross(faces[f][1].v-A.v, faces[f][2].v-A.v);
+			if(glm::dot(normal, opposite[f]-A.v) > 0)
+				normal = -normal;
+			if(glm::dot(normal, AO) > 0)
+			{
+				// Origin outside this face, continue with the triangle
+				simplex[0] = faces[f][2];
+				simplex[1] = faces[f][1];
+				simplex[2] = A;
+				count = 3;
+				inside = false;
+			}
+		}
+		if(inside)
+			return true;
+	}
+
+	if(count == 3)
+	{
+		const SupportPoint A = simplex[2];
+		const SupportPoint B = simplex[1];
+		const SupportPoint C = simplex[0];
+		const glm::vec3 AB = B.v - A.v;
+		const glm::vec3 AC = C.v - A.v;
+		const glm::vec3 AO = -A.v;
+		const glm::vec3 ABC = glm::cross(AB, AC);
+
+		if(glm::dot(glm::cross(ABC, AC), AO) > 0)
+		{
+			if(glm::dot(AC, AO) > 0)
+			{
+				simplex[0] = C;
+				simplex[1] = A;
+				count = 2;
+				direction = glm::cross(glm::cross(AC, AO), AC);
+				return false;
+			}
+			simplex[0] = B;
+			simplex[1] = A;
+			count = 2;
+		}
+		else if(glm::dot(glm::cross(AB, ABC), AO) > 0)
+		{
+			simplex[0] = B;
+			simplex[1] = A;
+			count = 2;
+		}
+		else
+		{
+			if(glm::dot(ABC, AO) > 0)
+				direction = ABC;
+			else
+			{
+				// Keep the origin above the triangle
+				simplex[0] = B;
+				simplex[1] = C;
+				direction = -ABC;
+			}
+			return false;
+		}
+	}
+
+	// Line
+	const SupportPoint A = simplex[1];
+	const glm::vec3 AB = simplex[0].v - A.v;
+	const glm::vec3 AO = -A.v;
+	if(glm::dot(AB, AO) > 0)
+	{
+		direction = glm::cross(glm::cross(AB, AO), AB);
+		// Origin on the line
+		if(glm::dot(direction, direction) < 1e-12f)
+			direction = perpendicular(AB);
+	}
+	else
+	{
+		simplex[0] = A;
+		count = 1;
+		direction = AO;
+	}
+	return false;
+}
+
+//---------------------------------------------//
+//-------------------- EPA --------------------//
+//---------------------------------------------//
+bool GjkEpa::epa(const ShapeInstance& a, const ShapeInstance& b, const SupportPoint simplex[4], Result& result)
+{
+	const int maxIterations = 32;
+	const int maxVertices = 4+maxIterations;
+	const int maxFaces = 128;
+	const int maxEdges = 64;
+	const float tolerance = 1e-4f;
+
+	struct Face
+	{
+		int v[3];
+		glm::vec3 normal;
+		float distance;
+	};
+
+	SupportPoint vertices[maxVertices];
+	Face faces[maxFaces];
+	int edges[maxEdges][2];
+	int vertexCount = 4;
+	int faceCount = 0;
+
+	for(int i=0; i<4; i++)
+		vertices[i] = simplex[i];
+
+	// Outward oriented face, returns false if degenerate
+	auto makeFace = [&vertices](int i, int j, int k, Face& face)
+	{
+		const glm::vec3 normal = glm::cross(vertices[j].v-vertices[i].v, vertices[k].v-vertices[i].v);
+		const float length = glm::length(normal);
+		if(length < 1e-10f)
+			return false;
+		face.v[0] = i;
+		face.v[1] = j;
+		face.v[2] = k;
+		face.normal = normal/length;
+		face.distance = glm::dot(face.normal, vertices[i].v);
+		return true;
+	};
+
+	const int tetrahedron[4][4] = {{0,1,2,3}, {0,3,1,2}, {0,2,3,1}, {1,3,2,0}};
+	for(int f=0; f<4; f++)
+	{
+		int i = tetrahedron[f][0];
+		int j = tetrahedron[f][1];
+		int k = tetrahedron[f][2];
+		const int opposite = tetrahedron[f][3];
+		if(glm::dot(glm::cross(vertices[j].v-vertices[i].v, vertices[k].v-vertices[i].v), vertices[opposite].v-vertices[i].v) > 0)
+			std::swap(j, k);
+		if(!makeFace(i, j, k, faces[faceCount]))
+			return false;
+		faceCount++;
+	}
+
+	int closest = 0;
+	for(int iteration=0; iteration<maxIterations; iteration++)
+	{
+		closest = 0;
+		for(int f=1; f<faceCount; f++)
+			if(faces[f].distance < faces[closest].distance)
+				closest = f;
+
+		const Face face = faces[closest];
+		const SupportPoint point = minkowskiSupport(a, b, face.normal);
+		if(glm::dot(point.v, face.normal) - face.distance < tolerance || vertexCount == maxVertices)
+			break;
+
+		// Remove the faces that can see the new point and keep the horizon edges
+		const int newVertex = vertexCount++;
+		vertices[newVertex] = point;
+		int edgeCount = 0;
+		for(int f=0; f<faceCount;)
+		{
+			if(glm::dot(faces[f].normal, point.v-vertices[faces[f].v[0]].v) > 0)
+			{
+				for(int e=0; e<3; e++)
+				{
+					const int e0 = faces[f].v[e];
+					const int e1 = faces[f].v[(e+1)%3];
+					// Shared edges are seen in opposite order, they are not in the horizon
+					bool shared = false;
+					for(int k=0; k<edgeCount; k++)
+					{
+						if(edges[k][0] == e1 && edges[k][1] == e0)
+						{
+							edges[k][0] = edges[edgeCount-1][0];
+							edges[k][1] = edges[edgeCount-1][1];
+							edgeCount--;
+							shared = true;
+							break;
+						}
+					}
+					if(!shared && edgeCount < maxEdges)
+					{
+						edges[edgeCount][0] = e0;
+						edges[edgeCount][1] = e1;
+						edgeCount++;
+					}
+				}
+				faces[f] = faces[--faceCount];
+			}
+			else
+				f++;
+		}
+
+		for(int e=0; e<edgeCount && faceCount<maxFaces; e++)
+			if(makeFace(edges[e][0], edges[e][1], newVertex, faces[faceCount]))
+				faceCount++;
+
+		if(faceCount == 0)
+			return false;
+	}
+
+	closest = 0;
+	for(int f=1; f<faceCount; f++)
+		if(faces[f].distance < faces[closest].distance)
+			closest = f;
+	const Face& face = faces[closest];
+
+	// Barycentric coordinates of the origin projected on the closest face
+	const SupportPoint& v0 = vertices[face.v[0]];
+	const SupportPoint& v1 = vertices[face.v[1]];
+	const SupportPoint& v2 = vertices[face.v[2]];
+	const glm::vec3 p = face.normal*face.distance;
+	const glm::vec3 e0 = v1.v - v0.v;
+	const glm::vec3 e1 = v2.v - v0.v;
+	const glm::vec3 e2 = p - v0.v;
+	const float d00 = glm::dot(e0, e0);
+	const float d01 = glm::dot(e0, e1);
+	const float d11 = glm::dot(e1, e1);
+	const float d20 = glm::dot(e2, e0);
+	const float d21 = glm::dot(e2, e1);
+	const float denominator = d00*d11 - d01*d01;
+	float u = 1.0f/3, v = 1.0f/3, w = 1.0f/3;
+	if(denominator > 1e-12f)
+	{
+		v = (d11*d20 - d01*d21)/denominator;
+		w = (d00*d21 - d01*d20)/denominator;
+		u = 1.0f - v - w;
+	}
+
+	result.normal = face.normal;
+	result.depth = glm::max(face.distance, 0.0f);
+	result.pointA = v0.a*u + v1.a*v + v2.a*w;
+	result.pointB = v0.b*u + v1.b*v + v2.b*w;
+	return true;
+}
@@ -0,0 +1,52 @@
+//--------------------------------------------------
+// Robot Simulator
+// gjkEpa.h
+// Date: 2020-11-12
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef GJK_EPA_H
+#define GJK_EPA_H
+
+#include "glm.h"
+#include "shape.h"
+
+// Generic convex penetration test.
+// GJK finds a simplex of the Minkowski difference (A-B) enclosing the origin,
+// EPA expands it to find the penetration normal and depth.
+class GjkEpa
+{
+	public:
+		struct Result
+		{
+			// Points from a to b
+			glm::vec3 normal;
+			float depth;
+			// Deepest points of each shape
+			glm::vec3 pointA;
+			glm::vec3 pointB;
+		};
+
+		// Returns false when the shapes do not overlap
+		static bool penetration(const ShapeInstance& a, const ShapeInstance& b, Result& result);
+
+		// Farthest point of the shape in the direction
+		static glm::vec3 support(const ShapeInstance& shape, glm::vec3 direction);
+
+	private:
+		struct SupportPoint
+		{
+			// v = a - b
+			glm::vec3 v;
+			glm::vec3 a;
+			glm::vec3 b;
+		};
+
+		static SupportPoint minkowskiSupport(const ShapeInstance& a, const ShapeInstance& b, glm::vec3 direction);
+		static bool gjk(const ShapeInstance& a, const ShapeInstance& b, SupportPoint simplex[4]);
+		static bool epa(const ShapeInstance& a, const ShapeInstance& b, const SupportPoint simplex[4], Result& result);
+
+		// Simplex update, returns true when the origin is inside the tetrahedron
+		static bool updateSimplex(SupportPoint simplex[4], int& count, glm::vec3& direction);
+};
+
+#endif// GJK_EPA_H
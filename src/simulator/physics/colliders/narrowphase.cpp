@@ -0,0 +1,84 @@
+//--------------------------------------------------
+// Robot Simulator
+// narrowphase.cpp
+// Date: 2020-11-12
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#include "narrowphase.h"
+
+// Rows: type of a, columns: type of b (SPHERE, BOX, CYLINDER, PLANE)
+const Narrowphase::DispatchEntry Narrowphase::_dispatchTable[(int)ShapeType::COUNT][(int)ShapeType::COUNT] =
+{
+	{{CollisionAlgorithms::sphereSphere, false}, {CollisionAlgorithms::sphereBox, false}, {CollisionAlgorithms::convexConvex, false}, {CollisionAlgorithms::spherePlane, false}},
+	{{CollisionAlgorithms::sphereBox, true}, {CollisionAlgorithms::boxBox, false}, {CollisionAlgorithms::convexConvex, false}, {CollisionAlgorithms::boxPlane, false}},
+	{{CollisionAlgorithms::convexConvex, false}, {CollisionAlgorithms::convexConvex, false}, {CollisionAlgorithms::convexConvex, false}, {CollisionAlgorithms::cylinderPlane, false}},
+	{{CollisionAlgorithms::spherePlane, true}, {CollisionAlgorithms::boxPlane, true}, {CollisionAlgorithms::cylinderPlane, true}, {nullptr, false}}
+};
+
+Narrowphase::Narrowphase(BodyStore* bodyStore):
+	_bodyStore(bodyStore)
+{
+}
+
+Narrowphase::~Narrowphase()
+{
+}
+
+void Narrowphase::update(const std::vector<Broadphase::Pair>& pairs)
+{
+	// Manifolds are written in place to avoid reallocations between steps
+	_manifolds.resize(pairs.size());
+	size_t count = 0;
+	const uint32_t activeCount = _bodyStore->getActiveCount();
+	for(const auto& pair : pairs)
+	{
+		// Pairs without an awake body do not move, the cost follows the active set
+		const uint32_t indexA = _bodyStore->getIndex(pair.a);
+		const uint32_t indexB = _bodyStore->getIndex(pair.b);
+		if(indexA >= activeCount && indexB >= activeCount)
+			continue;
+		if(!_ignoredPairs.empty() && _ignoredPairs.count(pairKey(pair.a, pair.b)) != 0)
+			continue;
+
+		const DispatchEntry& entry = _dispatchTable[(int)_bodyStore->getShapeTypeByIndex(indexA)][(int)_bodyStore->getShapeTypeByIndex(indexB)];
+		if(entry.function == nullptr)
+			continue;
+
+		const ShapeInstance a = _bodyStore->getShapeInstanceByIndex(indexA);
+		const ShapeInstance b = _bodyStore->getShapeInstanceByIndex(indexB);
+		ContactManifold& manifold = _manifolds[count];
+		manifold.a = entry.swap ? pair.b : pair.a;
+		manifold.b = entry.swap ? pair.a : pair.b;
+		manifold.pointCount = 0;
+		if(entry.swap ? entry.function(b, a, manifold) : entry.function(a, b, manifold))
+			count++;
+	}
+	_manifolds.resize(count);
+}
+
+void Narrowphase::removeBody(BodyStore::BodyId id)
+{
+	for(auto it = _ignoredPairs.begin(); it != _ignoredPairs.end();)
+	{
+		if((BodyStore::BodyId)(*it>>32) == id || (BodyStore::BodyId)(*it&0xFFFFFFFF) == id)
+			it = _ignoredPairs.erase(it);
+		else
+			it++;
+	}
+}
+
+bool Narrowphase::collide(const ShapeInstance& a, const ShapeInstance& b, ContactManifold& manifold)
+{
+	const DispatchEntry& entry = _dispatchTable[(int)a.type][(int)b.type];
+	if(entry.function == nullptr)
+		return false;
+
+	manifold.pointCount = 0;
+	if(!entry.swap)
+		return entry.function(a, b, manifold);
+
+	if(!entry.function(b, a, manifold))
+		return false;
+	manifold.normal = -manifold.normal;
+	return true;
+}
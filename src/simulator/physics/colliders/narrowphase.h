@@ -0,0 +1,63 @@
+//--------------------------------------------------
+// Robot Simulator
+// narrowphase.h
+// Date: 2020-11-12
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef NARROWPHASE_H
+#define NARROWPHASE_H
+
+#include <vector>
+#include <unordered_set>
+#include "../bodyStore.h"
+#include "../stateSnapshot.h"
+#include "../broadphase/broadphase.h"
+#include "shape.h"
+#include "contactManifold.h"
+#include "collisionAlgorithms.h"
+
+// Generates the contact manifolds of the broadphase pairs.
+// The collision routine is chosen from a table indexed by the shape types
+// of the pair, so there are no virtual calls in the pair loop.
+class Narrowphase
+{
+	public:
+		Narrowphase(BodyStore* bodyStore);
+		~Narrowphase();
+
+		void update(const std::vector<Broadphase::Pair>& pairs);
+
+		// Pairs that never collide (bodies connected by a joint)
+		void addIgnoredPair(BodyStore::BodyId a, BodyStore::BodyId b) { _ignoredPairs.insert(pairKey(a, b)); }
+		void removeIgnoredPair(BodyStore::BodyId a, BodyStore::BodyId b) { _ignoredPairs.erase(pairKey(a, b)); }
+		bool isIgnoredPair(BodyStore::BodyId a, BodyStore::BodyId b) const { return _ignoredPairs.count(pairKey(a, b)) != 0; }
+		// Drop the ignored pairs of a removed body
+		void removeBody(BodyStore::BodyId id);
+		// Manifolds of the last update
+		void saveState(StateSnapshot& snapshot) const { snapshot.writeArray(_manifolds); }
+		void restoreState(StateSnapshot::Reader& reader) { reader.readArray(_manifolds); }
+
+		// Contact between two shapes (normal from a to b), false when not touching
+		static bool collide(const ShapeInstance& a, const ShapeInstance& b, ContactManifold& manifold);
+
+		//---------- Getters ----------//
+		const std::vector<ContactManifold>& getManifolds() const { return _manifolds; }
+
+	private:
+		struct DispatchEntry
+		{
+			CollisionAlgorithms::CollideFunction function;
+			// The routine expects the shapes in the opposite order
+			bool swap;
+		};
+		static const DispatchEntry _dispatchTable[(int)ShapeType::COUNT][(int)ShapeType::COUNT];
+
+		// Order independent
+		static uint64_t pairKey(BodyStore::BodyId a, BodyStore::BodyId b) { return a < b ? ((uint64_t)a<<32)|b : ((uint64_t)b<<32)|a; }
+
+		BodyStore* _bodyStore;
+		std::vector<ContactManifold> _manifolds;
+		std::unordered_set<uint64_t> _ignoredPairs;
+};
+
+#endif// NARROWPHASE_H
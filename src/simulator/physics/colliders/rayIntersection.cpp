@@ -0,0 +1,178 @@
+//--------------------------------------------------
+// Robot Simulator
+// rayIntersection.cpp
+// Date: 2020-11-22
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#include "rayIntersection.h"
+#include <cfloat>
+#include <cmath>
+#include <utility>
+
+bool RayIntersection::intersect(const ShapeInstance& shape, glm::vec3 origin, glm::vec3 direction, float maxT, float& t, glm::vec3& normal)
+{
+	switch(shape.type)
+	{
+		case ShapeType::SPHERE:
+			return sphere(shape, origin, direction, maxT, t, normal);
+		case ShapeType::BOX:
+			return box(shape, origin, direction, maxT, t, normal);
+		case ShapeType::CYLINDER:
+			return cylinder(shape, origin, direction, maxT, t, normal);
+		case ShapeType::PLANE:
+			return plane(shape, origin, direction, maxT, t, normal);
+		default:
+			return false;
+	}
+}
+
+bool RayIntersection::sphere(const ShapeInstance& shape, glm::vec3 origin, glm::vec3 direction, float maxT, float& t, glm::vec3& normal)
+{
+	const float radius = shape.halfExtents.x;
+	const glm::vec3 m = origin - shape.position;
+	const float b = glm::dot(m, direction);
+	const float c = glm::dot(m, m) - radius*radius;
+	// Inside, or outside and pointing away
+	if(c <= 0 || b > 0)
+		return false;
+
+	const float discriminant = b*b - c;
+	if(discriminant < 0)
+		return false;
+
+	t = -b - std::sqrt(discriminant);
+	if(t > maxT)
+		return false;
+	normal = (origin + direction*t - shape.position)/radius;
+	return true;
+}
+
+bool RayIntersection::box(const ShapeInstance& shape, glm::vec3 origin, glm::vec3 direction, float maxT, float& t, glm::vec3& normal)
+{
+	// Slab test in the box frame
+	const glm::mat3 toLocal = glm::transpose(shape.rotation);
+	const glm::vec3 o = toLocal*(origin - shape.position);
+	const glm::vec3 d = toLocal*direction;
+	const glm::vec3 h = shape.halfExtents;
+	if(glm::abs(o.x) <= h.x && glm::abs(o.y) <= h.y && glm::abs(o.z) <= h.z)
+		return false;
+
+	float tMin = -FLT_MAX;
+	float tMax = FLT_MAX;
+	int axis = 0;
+	float side = 1.0f;
+	for(int i=0; i<3; i++)
+	{
+		if(glm::abs(d[i]) < 1e-8f)
+		{
+			// Parallel to the slab
+			if(glm::abs(o[i]) > h[i])
+				return false;
+			continue;
+		}
+
+		const float inv = 1.0f/d[i];
+		float t1 = (-h[i] - o[i])*inv;
+		float t2 = (h[i] - o[i])*inv;
+		// Entering through the face opposite to the ray direction
+		const float s = d[i] > 0 ? -1.0f : 1.0f;
+		if(t1 > t2)
+			std::swap(t1, t2);
+		if(t1 > tMin)
+		{
+			tMin = t1;
+			axis = i;
+			side = s;
+		}
+		tMax = glm::min(tMax, t2);
+		if(tMin > tMax)
+			return false;
+	}
+
+	if(tMin < 0 || tMin > maxT)
+		return false;
+	t = tMin;
+	normal = shape.rotation[axis]*side;
+	return true;
+}
+
+bool RayIntersection::cylinder(const ShapeInstance& shape, glm::vec3 origin, glm::vec3 direction, float maxT, float& t, glm::vec3& normal)
+{
+	const glm::mat3 toLocal = glm::transpose(shape.rotation);
+	const glm::vec3 o = toLocal*(origin - shape.position);
+	const glm::vec3 d = toLocal*direction;
+	const float radius = shape.halfExtents.x;
+	const float halfHeight = shape.halfExtents.y;
+	if(o.x*o.x + o.z*o.z <= radius*radius && glm::abs(o.y) <= halfHeight)
+		return false;
+
+	float best = FLT_MAX;
+	glm::vec3 localNormal = glm::vec3(0);
+
+	// Side, circle in the XZ plane
+	const float a = d.x*d.x + d.z*d.z;
+	if(a > 1e-12f)
+	{
+		const float b = o.x*d.x + o.z*d.z;
+		const float c = o.x*o.x + o.z*o.z - radius*radius;
+		const float discriminant = b*b - a*c;
+		if(discriminant >= 0)
+		{
+			const float tSide = (-b - std::sqrt(discriminant))/a;
+			const float y = o.y + d.y*tSide;
+			if(tSide >= 0 && glm::abs(y) <= halfHeight)
+			{
+				best = tSide;
+				localNormal = glm::vec3(o.x + d.x*tSide, 0, o.z + d.z*tSide)/radius;
+			}
+		}
+	}
+
+	// Caps
+	if(glm::abs(d.y) > 1e-8f)
+	{
+		for(float s : {-1.0f, 1.0f})
+		{
+			const float tCap = (s*halfHeight - o.y)/d.y;
+			if(tCap < 0 || tCap >= best)
+				continue;
+			const float x = o.x + d.x*tCap;
+			const float z = o.z + d.z*tCap;
+			if(x*x + z*z <= radius*radius)
+			{
+				best = tCap;
+				localNormal = glm::vec3(0, s, 0);
+			}
+		}
+	}
+
+	if(best > maxT)
+		return false;
+	t = best;
+	normal = shape.rotation*localNormal;
+	return true;
+}
+
+bool RayIntersection::plane(const ShapeInstance& shape, glm::vec3 origin, glm::vec3 direction, float maxT, float& t, glm::vec3& normal)
+{
+	const glm::vec3 planeNormal = shape.rotation[1];
+	const float denominator = glm::dot(direction, planeNormal);
+	const float distance = glm::dot(origin - shape.position, planeNormal);
+	if(denominator >= 0 || distance < 0)
+		return false;
+
+	t = -distance/denominator;
+	if(t > maxT)
+		return false;
+
+	// Planes without size are infinite
+	const glm::vec3 h = shape.halfExtents;
+	if(h.x > 0 || h.z > 0)
+	{
+		const glm::vec3 local = glm::transpose(shape.rotation)*(origin + direction*t - shape.position);
+		if(glm::abs(local.x) > h.x || glm::abs(local.z) > h.z)
+			return false;
+	}
+	normal = planeNormal;
+	return true;
+}
@@ -0,0 +1,29 @@
+//--------------------------------------------------
+// Robot Simulator
+// rayIntersection.h
+// Date: 2020-11-22
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef RAY_INTERSECTION_H
+#define RAY_INTERSECTION_H
+
+#include "glm.h"
+#include "shape.h"
+
+// Exact ray against shape tests. The direction must be normalized, so t is
+// the distance along the ray. Rays that start inside a shape do not hit it
+// (a sensor inside its own body sees the world around it).
+class RayIntersection
+{
+	public:
+		// Dispatch by shape type, normal is the world space surface normal at the hit
+		static bool intersect(const ShapeInstance& shape, glm::vec3 origin, glm::vec3 direction, float maxT, float& t, glm::vec3& normal);
+
+		static bool sphere(const ShapeInstance& shape, glm::vec3 origin, glm::vec3 direction, float maxT, float& t, glm::vec3& normal);
+		static bool box(const ShapeInstance& shape, glm::vec3 origin, glm::vec3 direction, float maxT, float& t, glm::vec3& normal);
+		static bool cylinder(const ShapeInstance& shape, glm::vec3 origin, glm::vec3 direction, float maxT, float& t, glm::vec3& normal);
+		// Only the front (+Y) side is hit
+		static bool plane(const ShapeInstance& shape, glm::vec3 origin, glm::vec3 direction, float maxT, float& t, glm::vec3& normal);
+};
+
+#endif// RAY_INTERSECTION_H
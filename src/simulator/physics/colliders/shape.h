@@ -0,0 +1,37 @@
+//--------------------------------------------------
+// Robot Simulator
+// shape.h
+// Date: 2020-11-12
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef SHAPE_H
+#define SHAPE_H
+
+#include <cstdint>
+#include "glm.h"
+
+// Collision shape of a body, the dimensions come from the body half extents:
+// - SPHERE: radius = halfExtents.x
+// - BOX: halfExtents
+// - CYLINDER: radius = halfExtents.x, half height = halfExtents.y (local Y axis)
+// - PLANE: local +Y normal, limited to halfExtents.x/halfExtents.z
+enum class ShapeType : uint8_t
+{
+	SPHERE = 0,
+	BOX,
+	CYLINDER,
+	PLANE,
+	COUNT
+};
+
+// Shape in world space, gathered once per step for the narrowphase
+struct ShapeInstance
+{
+	ShapeType type;
+	glm::vec3 halfExtents;
+	glm::vec3 position;
+	// Local to world rotation
+	glm::mat3 rotation;
+};
+
+#endif// SHAPE_H
@@ -7,7 +7,7 @@
 #include "constraint.h"
 
 Constraint::Constraint():
-	_objA(nullptr), _objB(nullptr)
+	_objA(nullptr), _objB(nullptr), _articulation(nullptr), _link(-1)
 {
 }
 
@@ -10,18 +10,32 @@
 #include <string>
 #include "../objectPhysics.h"
 
+class Articulation;
+
 class Constraint
 {
 	public:
 		Constraint();
-		~Constraint();
+		virtual ~Constraint();
 
+		//---------- Getters ----------//
 		std::string getType() const { return _type; };
+		ObjectPhysics* getObjectA() const { return _objA; }
+		ObjectPhysics* getObjectB() const { return _objB; }
+		// Articulation simulating the joint (nullptr if it is not linked)
+		Articulation* getArticulation() const { return _articulation; }
+		int getLink() const { return _link; }
+
+		//---------- Setters ----------//
+		void setObjects(ObjectPhysics* objA, ObjectPhysics* objB) { _objA = objA; _objB = objB; }
+		void setArticulation(Articulation* articulation, int link) { _articulation = articulation; _link = link; }
 
 	protected:
 		std::string _type;
 		ObjectPhysics* _objA;
 		ObjectPhysics* _objB;
+		Articulation* _articulation;
+		int _link;
 };
 
 #endif// CONSTRAINT_H
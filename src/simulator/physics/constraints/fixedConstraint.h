@@ -11,9 +11,14 @@
 class FixedConstraint : public Constraint
 {
 	public:
+		// Pose of the child relative to the parent (rotation in degrees)
 		FixedConstraint(glm::vec3 position, glm::vec3 rotation);
 		~FixedConstraint();
 
+		//---------- Getters ----------//
+		glm::vec3 getPosition() const { return _position; }
+		glm::vec3 getRotation() const { return _rotation; }
+
 	private:
 		glm::vec3 _position;
 		glm::vec3 _rotation;
@@ -5,9 +5,10 @@
 // By Breno Cunha Queiroz
 //--------------------------------------------------
 #include "hingeConstraint.h"
+#include "../articulations/articulation.h"
 
 HingeConstraint::HingeConstraint(glm::vec3 position, glm::vec3 rotation):
-	_position(position), _rotation(rotation)
+	_position(position), _rotation(rotation), _axis(0,1,0), _motorEnabled(false)
 {
 	_type = "HingeConstraint";
 }
@@ -15,3 +16,90 @@ HingeConstraint::HingeConstraint(glm::vec3 position, glm::vec3 rotation):
 HingeConstraint::~HingeConstraint()
 {
 }
+
+void HingeConstraint::addTorque(float torque)
+{
+	if(_articulation != nullptr)
+		_articulation->addJointTorque(_link, torque);
+}
+
+float HingeConstraint::getAngle() const
+{
+	return _articulation != nullptr ? _articulation->getJointPosition(_link) : 0.0f;
+}
+
+float HingeConstraint::getAngularVelocity() const
+{
+	return _articulation != nullptr ? _articulation->getJointVelocity(_link) : 0.0f;
+}
+
+void HingeConstraint::setAngle(float angle)
+{
+	if(_articulation != nullptr)
+		_articulation->setJointPosition(_link, angle);
+}
+
+void HingeConstraint::setAngularVelocity(float angularVelocity)
+{
+	if(_articulation != nullptr)
+		_articulation->setJointVelocity(_link, angularVelocity);
+}
+
+void HingeConstraint::setMotorTorque(float torque)
+{
+	_motor.mode = JointMotors::Mode::TORQUE;
+	_motor.torque = torque;
+	updateMotor();
+}
+
+void HingeConstraint::setMotorVelocity(float targetVelocity)
+{
+	_motor.mode = JointMotors::Mode::VELOCITY;
+	_motor.torque = 0.0f;
+	_motor.targetVelocity = targetVelocity;
+	updateMotor();
+}
+
+void HingeConstraint::setMotorPosition(float targetPosition, float targetVelocity)
+{
+	_motor.mode = JointMotors::Mode::POSITION;
+	_motor.torque = 0.0f;
+	_motor.targetPosition = targetPosition;
+	_motor.targetVelocity = targetVelocity;
+	updateMotor();
+}
+
+void HingeConstraint::setMotorGains(float stiffness, float damping)
+{
+	_motor.stiffness = stiffness;
+	_motor.damping = damping;
+	if(_motorEnabled)
+		updateMotor();
+}
+
+void HingeConstraint::setMotorLimits(float maxTorque, float maxVelocity)
+{
+	_motor.maxTorque = maxTorque;
+	_motor.maxVelocity = maxVelocity;
+	if(_motorEnabled)
+		updateMotor();
+}
+
+void HingeConstraint::disableMotor()
+{
+	_motorEnabled = false;
+	if(_articulation != nullptr)
+		_articulation->removeJointMotor(_link);
+}
+
+float HingeConstraint::getMotorTorque() const
+{
+	return _articulation != nullptr ? _articulation->getJointMotorTorque(_link) : 0.0f;
+}
+
+void HingeConstraint::updateMotor()
+{
+	_motorEnabled = true;
+	if(_articulation != nullptr)
+		_articulation->setJointMotor(_link, _motor);
+}
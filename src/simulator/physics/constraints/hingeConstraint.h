@@ -7,16 +7,56 @@
 #ifndef HINGE_CONSTRAINT_H
 #define HINGE_CONSTRAINT_H
 #include "constraint.h"
+#include "../articulations/jointMotors.h"
 
 class HingeConstraint : public Constraint
 {
 	public:
+		// Pose of the child relative to the parent at angle 0 (rotation in degrees)
 		HingeConstraint(glm::vec3 position, glm::vec3 rotation);
 		~HingeConstraint();
 
+		// Joint torque applied in the next step (only when linked)
+		void addTorque(float torque);
+
+		// Joint motor, evaluated every step with the other motors. The settings are kept
+		// until the hinge is linked. Each call switches the motor mode.
+		void setMotorTorque(float torque);
+		void setMotorVelocity(float targetVelocity);
+		void setMotorPosition(float targetPosition, float targetVelocity = 0.0f);
+		void disableMotor();
+
+		//---------- Getters ----------//
+		glm::vec3 getPosition() const { return _position; }
+		glm::vec3 getRotation() const { return _rotation; }
+		// Rotation axis in the child frame
+		glm::vec3 getAxis() const { return _axis; }
+		// Joint state (radians), 0 when the hinge is not linked
+		float getAngle() const;
+		float getAngularVelocity() const;
+		bool isMotorEnabled() const { return _motorEnabled; }
+		const JointMotors::Motor& getMotor() const { return _motor; }
+		// Torque applied by the motor in the last step
+		float getMotorTorque() const;
+
+		//---------- Setters ----------//
+		void setAxis(glm::vec3 axis) { _axis = axis; }
+		void setAngle(float angle);
+		void setAngularVelocity(float angularVelocity);
+		// PD gains of the velocity and position modes
+		void setMotorGains(float stiffness, float damping);
+		// Effort (torque) and speed limits
+		void setMotorLimits(float maxTorque, float maxVelocity);
+
 	private:
+		// Forward the motor settings to the articulation
+		void updateMotor();
+
 		glm::vec3 _position;
 		glm::vec3 _rotation;
+		glm::vec3 _axis;
+		bool _motorEnabled;
+		JointMotors::Motor _motor;
 };
 
 #endif// HINGE_CONSTRAINT_H
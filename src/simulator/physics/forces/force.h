@@ -10,11 +10,15 @@
 #include "glm.h"
 #include "../objectPhysics.h"
 
+// Custom force, called once per registration every step. The built-in forces of the
+// ForceGenerator (gravity, drag, springs, buoyancy) run as bulk kernels instead.
 class Force
 {
 	public:
+		virtual ~Force() {}
+
 		// Overload this method to update the force applied to an object
-		virtual void updateForce(ObjectPhysics* object, float dt);
+		virtual void updateForce(ObjectPhysics* object, float dt) = 0;
 
 	private:
 };
@@ -5,8 +5,21 @@
 // By Breno Cunha Queiroz
 //--------------------------------------------------
 #include "forceGenerator.h"
+#include <algorithm>
+#include <cmath>
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
-ForceGenerator::ForceGenerator()
+template <typename T>
+static void swapRemove(std::vector<T>& v, size_t i)
+{
+	v[i] = v.back();
+	v.pop_back();
+}
+
+ForceGenerator::ForceGenerator(BodyStore* bodyStore):
+	_bodyStore(bodyStore), _gravity(0,-9.81f,0)
 {
 
 }
@@ -18,23 +31,521 @@ ForceGenerator::~ForceGenerator()
 
 void ForceGenerator::add(ObjectPhysics* object, Force* force)
 {
+	if(object == nullptr || force == nullptr)
+		return;
 
+	_registrations.push_back({object, force});
 }
 
 void ForceGenerator::remove(ObjectPhysics* object, Force* force)
 {
+	for(size_t i=0; i<_registrations.size(); i++)
+	{
+		if(_registrations[i].object == object && _registrations[i].force == force)
+		{
+			_registrations.erase(_registrations.begin() + i);
+			return;
+		}
+	}
+}
+
+void ForceGenerator::addDrag(ObjectPhysics* object, float k1, float k2)
+{
+	if(object == nullptr || !object->isAttached())
+		return;
+
+	_drag.ids.push_back(object->getId());
+	_drag.k1.push_back(k1);
+	_drag.k2.push_back(k2);
+}
+
+void ForceGenerator::addSpring(ObjectPhysics* object, glm::vec3 anchor, float stiffness, float restLength, float damping)
+{
+	if(object == nullptr || !object->isAttached())
+		return;
+
+	_anchoredSprings.ids.push_back(object->getId());
+	_anchoredSprings.anchorX.push_back(anchor.x);
+	_anchoredSprings.anchorY.push_back(anchor.y);
+	_anchoredSprings.anchorZ.push_back(anchor.z);
+	_anchoredSprings.stiffness.push_back(stiffness);
+	_anchoredSprings.restLength.push_back(restLength);
+	_anchoredSprings.damping.push_back(damping);
+}
+
+void ForceGenerator::addSpring(ObjectPhysics* objectA, ObjectPhysics* objectB, float stiffness, float restLength, float damping)
+{
+	if(objectA == nullptr || objectB == nullptr || !objectA->isAttached() || !objectB->isAttached())
+		return;
+
+	_springs.idsA.push_back(objectA->getId());
+	_springs.idsB.push_back(objectB->getId());
+	_springs.stiffness.push_back(stiffness);
+	_springs.restLength.push_back(restLength);
+	_springs.damping.push_back(damping);
+}
+
+void ForceGenerator::addBuoyancy(ObjectPhysics* object, float maxDepth, float volume, float waterHeight, float liquidDensity)
+{
+	if(object == nullptr || !object->isAttached() || maxDepth <= 0)
+		return;
+
+	_buoyancy.ids.push_back(object->getId());
+	_buoyancy.maxDepth.push_back(maxDepth);
+	_buoyancy.volume.push_back(volume);
+	_buoyancy.waterHeight.push_back(waterHeight);
+	_buoyancy.density.push_back(liquidDensity);
+}
+
+void ForceGenerator::remove(ObjectPhysics* object)
+{
+	if(object == nullptr)
+		return;
+
+	_registrations.erase(std::remove_if(_registrations.begin(), _registrations.end(),
+				[object](const ForceRegistration& r){ return r.object == object; }), _registrations.end());
+	if(object->isAttached())
+		removeBody(object->getId());
+}
+
+void ForceGenerator::removeBody(BodyStore::BodyId id)
+{
+	for(size_t i=_drag.ids.size(); i-- > 0;)
+	{
+		if(_drag.ids[i] != id)
+			continue;
+		swapRemove(_drag.ids, i);
+		swapRemove(_drag.k1, i);
+		swapRemove(_drag.k2, i);
+	}
+
+	AnchoredSprings& anchored = _anchoredSprings;
+	for(size_t i=anchored.ids.size(); i-- > 0;)
+	{
+		if(anchored.ids[i] != id)
+			continue;
+		swapRemove(anchored.ids, i);
+		swapRemove(anchored.anchorX, i);
+		swapRemove(anchored.anchorY, i);
+		swapRemove(anchored.anchorZ, i);
+		swapRemove(anchored.stiffness, i);
+		swapRemove(anchored.restLength, i);
+		swapRemove(anchored.damping, i);
+	}
+
+	for(size_t i=_springs.idsA.size(); i-- > 0;)
+	{
+		if(_springs.idsA[i] != id && _springs.idsB[i] != id)
+			continue;
+		swapRemove(_springs.idsA, i);
+		swapRemove(_springs.idsB, i);
+		swapRemove(_springs.stiffness, i);
+		swapRemove(_springs.restLength, i);
+		swapRemove(_springs.damping, i);
+	}
 
+	for(size_t i=_buoyancy.ids.size(); i-- > 0;)
+	{
+		if(_buoyancy.ids[i] != id)
+			continue;
+		swapRemove(_buoyancy.ids, i);
+		swapRemove(_buoyancy.maxDepth, i);
+		swapRemove(_buoyancy.volume, i);
+		swapRemove(_buoyancy.waterHeight, i);
+		swapRemove(_buoyancy.density, i);
+	}
 }
 
 void ForceGenerator::clear()
 {
+	_registrations.clear();
+	_drag = DragForces();
+	_anchoredSprings = AnchoredSprings();
+	_springs = Springs();
+	_buoyancy = BuoyancyForces();
+}
 
+size_t ForceGenerator::getRegistrationCount() const
+{
+	return _registrations.size() + _drag.ids.size() + _anchoredSprings.ids.size() +
+		_springs.idsA.size() + _buoyancy.ids.size();
 }
-		
+
 void ForceGenerator::updateForces(float dt)
 {
+	applyGravity();
+	applyDrag();
+	applyAnchoredSprings();
+	applySprings();
+	applyBuoyancy();
+
+	// Slow path
 	for(auto r : _registrations)
 	{
 		r.force->updateForce(r.object, dt);
 	}
 }
+
+//---------- Built-in forces ----------//
+void ForceGenerator::applyGravity()
+{
+	// Gravity is an acceleration, so the force is scaled by the mass
+	const uint32_t n = _bodyStore->getActiveCount();
+	const float* inverseMass = _bodyStore->getInverseMasses();
+	float* fx = _bodyStore->getForceX();
+	float* fy = _bodyStore->getForceY();
+	float* fz = _bodyStore->getForceZ();
+	uint32_t i = 0;
+
+	// Immovable bodies get no force (1/0 is masked out)
+#if defined(__AVX__)
+	const __m256 gx = _mm256_set1_ps(_gravity.x);
+	const __m256 gy = _mm256_set1_ps(_gravity.y);
+	const __m256 gz = _mm256_set1_ps(_gravity.z);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	for(; i+8<=n; i+=8)
+	{
+		const __m256 invMass = _mm256_loadu_ps(&inverseMass[i]);
+		const __m256 movable = _mm256_cmp_ps(invMass, zero, _CMP_GT_OQ);
+		const __m256 mass = _mm256_and_ps(movable, _mm256_div_ps(one, invMass));
+		_mm256_storeu_ps(&fx[i], _mm256_add_ps(_mm256_loadu_ps(&fx[i]), _mm256_mul_ps(gx, mass)));
+		_mm256_storeu_ps(&fy[i], _mm256_add_ps(_mm256_loadu_ps(&fy[i]), _mm256_mul_ps(gy, mass)));
+		_mm256_storeu_ps(&fz[i], _mm256_add_ps(_mm256_loadu_ps(&fz[i]), _mm256_mul_ps(gz, mass)));
+	}
+#elif defined(__SSE2__)
+	const __m128 gx = _mm_set1_ps(_gravity.x);
+	const __m128 gy = _mm_set1_ps(_gravity.y);
+	const __m128 gz = _mm_set1_ps(_gravity.z);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	for(; i+4<=n; i+=4)
+	{
+		const __m128 invMass = _mm_loadu_ps(&inverseMass[i]);
+		const __m128 movable = _mm_cmpgt_ps(invMass, zero);
+		const __m128 mass = _mm_and_ps(movable, _mm_div_ps(one, invMass));
+		_mm_storeu_ps(&fx[i], _mm_add_ps(_mm_loadu_ps(&fx[i]), _mm_mul_ps(gx, mass)));
+		_mm_storeu_ps(&fy[i], _mm_add_ps(_mm_loadu_ps(&fy[i]), _mm_mul_ps(gy, mass)));
+		_mm_storeu_ps(&fz[i], _mm_add_ps(_mm_loadu_ps(&fz[i]), _mm_mul_ps(gz, mass)));
+	}
+#endif
+
+	for(; i<n; i++)
+	{
+		if(inverseMass[i] <= 0)
+			continue;
+		const float mass = 1.0f/inverseMass[i];
+		fx[i] += _gravity.x*mass;
+		fy[i] += _gravity.y*mass;
+		fz[i] += _gravity.z*mass;
+	}
+}
+
+void ForceGenerator::applyDrag()
+{
+	const uint32_t n = (uint32_t)_drag.ids.size();
+	if(n == 0)
+		return;
+
+	gather(_drag.ids, _indicesA);
+	const float* vx = _bodyStore->getVelocityX();
+	const float* vy = _bodyStore->getVelocityY();
+	const float* vz = _bodyStore->getVelocityZ();
+	for(uint32_t k=0; k<n; k++)
+	{
+		const uint32_t i = _indicesA[k];
+		_dvx[k] = vx[i];
+		_dvy[k] = vy[i];
+		_dvz[k] = vz[i];
+	}
+
+	dragKernel(_dvx.data(), _dvy.data(), _dvz.data(), _drag.k1.data(), _drag.k2.data(),
+			_fx.data(), _fy.data(), _fz.data(), n);
+	scatter(_indicesA, 1.0f);
+}
+
+void ForceGenerator::applyAnchoredSprings()
+{
+	const AnchoredSprings& springs = _anchoredSprings;
+	const uint32_t n = (uint32_t)springs.ids.size();
+	if(n == 0)
+		return;
+
+	gather(springs.ids, _indicesA);
+	const float* px = _bodyStore->getPositionX();
+	const float* py = _bodyStore->getPositionY();
+	const float* pz = _bodyStore->getPositionZ();
+	const float* vx = _bodyStore->getVelocityX();
+	const float* vy = _bodyStore->getVelocityY();
+	const float* vz = _bodyStore->getVelocityZ();
+	for(uint32_t k=0; k<n; k++)
+	{
+		const uint32_t i = _indicesA[k];
+		_dx[k] = px[i] - springs.anchorX[k];
+		_dy[k] = py[i] - springs.anchorY[k];
+		_dz[k] = pz[i] - springs.anchorZ[k];
+		_dvx[k] = vx[i];
+		_dvy[k] = vy[i];
+		_dvz[k] = vz[i];
+	}
+
+	springKernel(_dx.data(), _dy.data(), _dz.data(), _dvx.data(), _dvy.data(), _dvz.data(),
+			springs.stiffness.data(), springs.restLength.data(), springs.damping.data(),
+			_fx.data(), _fy.data(), _fz.data(), n);
+	scatter(_indicesA, 1.0f);
+}
+
+void ForceGenerator::applySprings()
+{
+	const uint32_t n = (uint32_t)_springs.idsA.size();
+	if(n == 0)
+		return;
+
+	gather(_springs.idsA, _indicesA);
+	gather(_springs.idsB, _indicesB);
+	const float* px = _bodyStore->getPositionX();
+	const float* py = _bodyStore->getPositionY();
+	const float* pz = _bodyStore->getPositionZ();
+	const float* vx = _bodyStore->getVelocityX();
+	const float* vy = _bodyStore->getVelocityY();
+	const float* vz = _bodyStore->getVelocityZ();
+	for(uint32_t k=0; k<n; k++)
+	{
+		const uint32_t a = _indicesA[k];
+		const uint32_t b = _indicesB[k];
+		_dx[k] = px[a] - px[b];
+		_dy[k] = py[a] - py[b];
+		_dz[k] = pz[a] - pz[b];
+		_dvx[k] = vx[a] - vx[b];
+		_dvy[k] = vy[a] - vy[b];
+		_dvz[k] = vz[a] - vz[b];
+	}
+
+	springKernel(_dx.data(), _dy.data(), _dz.data(), _dvx.data(), _dvy.data(), _dvz.data(),
+			_springs.stiffness.data(), _springs.restLength.data(), _springs.damping.data(),
+			_fx.data(), _fy.data(), _fz.data(), n);
+	// Equal and opposite
+	scatter(_indicesA, 1.0f);
+	scatter(_indicesB, -1.0f);
+}
+
+void ForceGenerator::applyBuoyancy()
+{
+	const uint32_t n = (uint32_t)_buoyancy.ids.size();
+	if(n == 0)
+		return;
+
+	gather(_buoyancy.ids, _indicesA);
+	const float* py = _bodyStore->getPositionY();
+	for(uint32_t k=0; k<n; k++)
+		_dy[k] = py[_indicesA[k]];
+
+	std::fill(_fx.begin(), _fx.end(), 0.0f);
+	std::fill(_fz.begin(), _fz.end(), 0.0f);
+	buoyancyKernel(_dy.data(), _buoyancy.maxDepth.data(), _buoyancy.volume.data(),
+			_buoyancy.waterHeight.data(), _buoyancy.density.data(), glm::length(_gravity), _fy.data(), n);
+	scatter(_indicesA, 1.0f);
+}
+
+void ForceGenerator::gather(const std::vector<BodyStore::BodyId>& ids, std::vector<uint32_t>& indices)
+{
+	const uint32_t n = (uint32_t)ids.size();
+	resizeScratch(n);
+	indices.resize(n);
+	for(uint32_t k=0; k<n; k++)
+		indices[k] = _bodyStore->getIndex(ids[k]);
+}
+
+void ForceGenerator::resizeScratch(uint32_t n)
+{
+	if(_fx.size() == n)
+		return;
+
+	for(auto array : {&_dx, &_dy, &_dz, &_dvx, &_dvy, &_dvz, &_fx, &_fy, &_fz})
+		array->resize(n);
+}
+
+void ForceGenerator::scatter(const std::vector<uint32_t>& indices, float sign)
+{
+	const uint32_t active = _bodyStore->getActiveCount();
+	float* fx = _bodyStore->getForceX();
+	float* fy = _bodyStore->getForceY();
+	float* fz = _bodyStore->getForceZ();
+	for(uint32_t k=0; k<(uint32_t)indices.size(); k++)
+	{
+		const uint32_t i = indices[k];
+		if(i >= active)
+			continue;
+		fx[i] += sign*_fx[k];
+		fy[i] += sign*_fy[k];
+		fz[i] += sign*_fz[k];
+	}
+}
+
+//---------- Kernels ----------//
+void ForceGenerator::dragKernel(const float* vx, const float* vy, const float* vz,
+		const float* k1, const float* k2, float* fx, float* fy, float* fz, uint32_t n)
+{
+	uint32_t i = 0;
+#if defined(__AVX__)
+	const __m256 zero = _mm256_setzero_ps();
+	for(; i+8<=n; i+=8)
+	{
+		const __m256 x = _mm256_loadu_ps(&vx[i]);
+		const __m256 y = _mm256_loadu_ps(&vy[i]);
+		const __m256 z = _mm256_loadu_ps(&vz[i]);
+		const __m256 speed = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z)));
+		const __m256 coefficient = _mm256_sub_ps(zero, _mm256_add_ps(_mm256_loadu_ps(&k1[i]), _mm256_mul_ps(_mm256_loadu_ps(&k2[i]), speed)));
+		_mm256_storeu_ps(&fx[i], _mm256_mul_ps(x, coefficient));
+		_mm256_storeu_ps(&fy[i], _mm256_mul_ps(y, coefficient));
+		_mm256_storeu_ps(&fz[i], _mm256_mul_ps(z, coefficient));
+	}
+#elif defined(__SSE2__)
+	const __m128 zero = _mm_setzero_ps();
+	for(; i+4<=n; i+=4)
+	{
+		const __m128 x = _mm_loadu_ps(&vx[i]);
+		const __m128 y = _mm_loadu_ps(&vy[i]);
+		const __m128 z = _mm_loadu_ps(&vz[i]);
+		const __m128 speed = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+		const __m128 coefficient = _mm_sub_ps(zero, _mm_add_ps(_mm_loadu_ps(&k1[i]), _mm_mul_ps(_mm_loadu_ps(&k2[i]), speed)));
+		_mm_storeu_ps(&fx[i], _mm_mul_ps(x, coefficient));
+		_mm_storeu_ps(&fy[i], _mm_mul_ps(y, coefficient));
+		_mm_storeu_ps(&fz[i], _mm_mul_ps(z, coefficient));
+	}
+#endif
+
+	for(; i<n; i++)
+	{
+		const float speed = std::sqrt(vx[i]*vx[i] + vy[i]*vy[i] + vz[i]*vz[i]);
+		const float coefficient = -(k1[i] + k2[i]*speed);
+		fx[i] = vx[i]*coefficient;
+		fy[i] = vy[i]*coefficient;
+		fz[i] = vz[i]*coefficient;
+	}
+}
+
+void ForceGenerator::springKernel(const float* dx, const float* dy, const float* dz,
+		const float* dvx, const float* dvy, const float* dvz,
+		const float* stiffness, const float* restLength, const float* damping,
+		float* fx, float* fy, float* fz, uint32_t n)
+{
+	// Hooke's law along the spring plus damping of the relative velocity along it,
+	// a zero length spring has no direction and gives no force
+	const float minLength = 1e-6f;
+	uint32_t i = 0;
+#if defined(__AVX__)
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 vMinLength = _mm256_set1_ps(minLength);
+	for(; i+8<=n; i+=8)
+	{
+		const __m256 x = _mm256_loadu_ps(&dx[i]);
+		const __m256 y = _mm256_loadu_ps(&dy[i]);
+		const __m256 z = _mm256_loadu_ps(&dz[i]);
+		const __m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z)));
+		const __m256 valid = _mm256_cmp_ps(length, vMinLength, _CMP_GT_OQ);
+		const __m256 invLength = _mm256_and_ps(valid, _mm256_div_ps(one, length));
+		const __m256 nx = _mm256_mul_ps(x, invLength);
+		const __m256 ny = _mm256_mul_ps(y, invLength);
+		const __m256 nz = _mm256_mul_ps(z, invLength);
+
+		const __m256 speed = _mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(_mm256_loadu_ps(&dvx[i]), nx),
+					_mm256_mul_ps(_mm256_loadu_ps(&dvy[i]), ny)),
+					_mm256_mul_ps(_mm256_loadu_ps(&dvz[i]), nz));
+		const __m256 stretch = _mm256_sub_ps(length, _mm256_loadu_ps(&restLength[i]));
+		const __m256 magnitude = _mm256_sub_ps(zero, _mm256_add_ps(
+					_mm256_mul_ps(_mm256_loadu_ps(&stiffness[i]), stretch),
+					_mm256_mul_ps(_mm256_loadu_ps(&damping[i]), speed)));
+		_mm256_storeu_ps(&fx[i], _mm256_mul_ps(nx, magnitude));
+		_mm256_storeu_ps(&fy[i], _mm256_mul_ps(ny, magnitude));
+		_mm256_storeu_ps(&fz[i], _mm256_mul_ps(nz, magnitude));
+	}
+#elif defined(__SSE2__)
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 vMinLength = _mm_set1_ps(minLength);
+	for(; i+4<=n; i+=4)
+	{
+		const __m128 x = _mm_loadu_ps(&dx[i]);
+		const __m128 y = _mm_loadu_ps(&dy[i]);
+		const __m128 z = _mm_loadu_ps(&dz[i]);
+		const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+		const __m128 valid = _mm_cmpgt_ps(length, vMinLength);
+		const __m128 invLength = _mm_and_ps(valid, _mm_div_ps(one, length));
+		const __m128 nx = _mm_mul_ps(x, invLength);
+		const __m128 ny = _mm_mul_ps(y, invLength);
+		const __m128 nz = _mm_mul_ps(z, invLength);
+
+		const __m128 speed = _mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(_mm_loadu_ps(&dvx[i]), nx),
+					_mm_mul_ps(_mm_loadu_ps(&dvy[i]), ny)),
+					_mm_mul_ps(_mm_loadu_ps(&dvz[i]), nz));
+		const __m128 stretch = _mm_sub_ps(length, _mm_loadu_ps(&restLength[i]));
+		const __m128 magnitude = _mm_sub_ps(zero, _mm_add_ps(
+					_mm_mul_ps(_mm_loadu_ps(&stiffness[i]), stretch),
+					_mm_mul_ps(_mm_loadu_ps(&damping[i]), speed)));
+		_mm_storeu_ps(&fx[i], _mm_mul_ps(nx, magnitude));
+		_mm_storeu_ps(&fy[i], _mm_mul_ps(ny, magnitude));
+		_mm_storeu_ps(&fz[i], _mm_mul_ps(nz, magnitude));
+	}
+#endif
+
+	for(; i<n; i++)
+	{
+		const float length = std::sqrt(dx[i]*dx[i] + dy[i]*dy[i] + dz[i]*dz[i]);
+		const float invLength = length > minLength ? 1.0f/length : 0.0f;
+		const float nx = dx[i]*invLength;
+		const float ny = dy[i]*invLength;
+		const float nz = dz[i]*invLength;
+		const float speed = dvx[i]*nx + dvy[i]*ny + dvz[i]*nz;
+		const float magnitude = -(stiffness[i]*(length - restLength[i]) + damping[i]*speed);
+		fx[i] = nx*magnitude;
+		fy[i] = ny*magnitude;
+		fz[i] = nz*magnitude;
+	}
+}
+
+void ForceGenerator::buoyancyKernel(const float* y, const float* maxDepth, const float* volume,
+		const float* waterHeight, const float* density, float gravity, float* fy, uint32_t n)
+{
+	// Archimedes with the submerged fraction going linearly from 0 (center maxDepth
+	// above the surface) to 1 (center maxDepth below it)
+	uint32_t i = 0;
+#if defined(__AVX__)
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 half = _mm256_set1_ps(0.5f);
+	const __m256 g = _mm256_set1_ps(gravity);
+	for(; i+8<=n; i+=8)
+	{
+		const __m256 depth = _mm256_loadu_ps(&maxDepth[i]);
+		const __m256 below = _mm256_sub_ps(_mm256_add_ps(_mm256_loadu_ps(&waterHeight[i]), depth), _mm256_loadu_ps(&y[i]));
+		__m256 submerged = _mm256_div_ps(_mm256_mul_ps(below, half), depth);
+		submerged = _mm256_min_ps(_mm256_max_ps(submerged, zero), one);
+		const __m256 displaced = _mm256_mul_ps(_mm256_loadu_ps(&density[i]), _mm256_loadu_ps(&volume[i]));
+		_mm256_storeu_ps(&fy[i], _mm256_mul_ps(_mm256_mul_ps(displaced, g), submerged));
+	}
+#elif defined(__SSE2__)
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 g = _mm_set1_ps(gravity);
+	for(; i+4<=n; i+=4)
+	{
+		const __m128 depth = _mm_loadu_ps(&maxDepth[i]);
+		const __m128 below = _mm_sub_ps(_mm_add_ps(_mm_loadu_ps(&waterHeight[i]), depth), _mm_loadu_ps(&y[i]));
+		__m128 submerged = _mm_div_ps(_mm_mul_ps(below, half), depth);
+		submerged = _mm_min_ps(_mm_max_ps(submerged, zero), one);
+		const __m128 displaced = _mm_mul_ps(_mm_loadu_ps(&density[i]), _mm_loadu_ps(&volume[i]));
+		_mm_storeu_ps(&fy[i], _mm_mul_ps(_mm_mul_ps(displaced, g), submerged));
+	}
+#endif
+
+	for(; i<n; i++)
+	{
+		const float submerged = glm::clamp((waterHeight[i] + maxDepth[i] - y[i])*0.5f/maxDepth[i], 0.0f, 1.0f);
+		fy[i] = density[i]*volume[i]*gravity*submerged;
+	}
+}
@@ -9,8 +9,17 @@
 
 #include "force.h"
 #include "../objectPhysics.h"
+#include "../bodyStore.h"
 #include <vector>
 
+// Accumulates the forces of every body before the velocity integration.
+// The built-in forces are stored by kind in flat arrays and applied by SIMD
+// kernels (gather the body state, compute, scatter the forces). Custom Force
+// objects are a slower path with one virtual call per registration.
+//
+// Forces only act on awake bodies, and the bodies must be in the physics engine
+// when registered. The built-in forces of removed bodies are dropped by removeBody,
+// the custom ones (keyed by object) by remove(object) when the body is removed.
 class ForceGenerator
 {
 	public:
@@ -20,17 +29,99 @@ class ForceGenerator
 			Force* force;
 		};
 
-		ForceGenerator();
+		ForceGenerator(BodyStore* bodyStore);
 		~ForceGenerator();
 
+		// Custom force (not owned)
 		void add(ObjectPhysics* object, Force* force);
 		void remove(ObjectPhysics* object, Force* force);
+
+		// Built-in forces
+		// Drag against the velocity: -v*(k1 + k2*|v|)
+		void addDrag(ObjectPhysics* object, float k1, float k2);
+		// Spring between the body and a fixed world point
+		void addSpring(ObjectPhysics* object, glm::vec3 anchor, float stiffness, float restLength, float damping = 0.0f);
+		// Spring between two bodies
+		void addSpring(ObjectPhysics* objectA, ObjectPhysics* objectB, float stiffness, float restLength, float damping = 0.0f);
+		// Liquid surface at waterHeight (Y), fully submerged when the center is maxDepth below it
+		void addBuoyancy(ObjectPhysics* object, float maxDepth, float volume, float waterHeight, float liquidDensity = 1000.0f);
+
+		// Every force of the body (custom and built-in)
+		void remove(ObjectPhysics* object);
+		void removeBody(BodyStore::BodyId id);
 		void clear();
-		
+
 		void updateForces(float dt);
+
+		//---------- Getters ----------//
+		glm::vec3 getGravity() const { return _gravity; }
+		size_t getRegistrationCount() const;
+
+		//---------- Setters ----------//
+		// Applied to every dynamic body
+		void setGravity(glm::vec3 gravity) { _gravity = gravity; }
+
 	private:
+		struct DragForces
+		{
+			std::vector<BodyStore::BodyId> ids;
+			std::vector<float> k1, k2;
+		};
+
+		struct AnchoredSprings
+		{
+			std::vector<BodyStore::BodyId> ids;
+			std::vector<float> anchorX, anchorY, anchorZ;
+			std::vector<float> stiffness, restLength, damping;
+		};
+
+		struct Springs
+		{
+			std::vector<BodyStore::BodyId> idsA, idsB;
+			std::vector<float> stiffness, restLength, damping;
+		};
+
+		struct BuoyancyForces
+		{
+			std::vector<BodyStore::BodyId> ids;
+			std::vector<float> maxDepth, volume, waterHeight, density;
+		};
+
+		void applyGravity();
+		void applyDrag();
+		void applyAnchoredSprings();
+		void applySprings();
+		void applyBuoyancy();
+		// Dense indices of the bodies and scratch space for n registrations
+		void gather(const std::vector<BodyStore::BodyId>& ids, std::vector<uint32_t>& indices);
+		void resizeScratch(uint32_t n);
+		// Add the scratch forces to the awake bodies (sign -1 for the second body of a spring)
+		void scatter(const std::vector<uint32_t>& indices, float sign);
+
+		// Kernels over flat arrays
+		static void dragKernel(const float* vx, const float* vy, const float* vz,
+				const float* k1, const float* k2, float* fx, float* fy, float* fz, uint32_t n);
+		static void springKernel(const float* dx, const float* dy, const float* dz,
+				const float* dvx, const float* dvy, const float* dvz,
+				const float* stiffness, const float* restLength, const float* damping,
+				float* fx, float* fy, float* fz, uint32_t n);
+		static void buoyancyKernel(const float* y, const float* maxDepth, const float* volume,
+				const float* waterHeight, const float* density, float gravity, float* fy, uint32_t n);
+
+		BodyStore* _bodyStore;
+		glm::vec3 _gravity;
+
 		std::vector<ForceRegistration> _registrations;
-		
+		DragForces _drag;
+		AnchoredSprings _anchoredSprings;
+		Springs _springs;
+		BuoyancyForces _buoyancy;
+
+		// Scratch (reused every step)
+		std::vector<uint32_t> _indicesA, _indicesB;
+		std::vector<float> _dx, _dy, _dz;
+		std::vector<float> _dvx, _dvy, _dvz;
+		std::vector<float> _fx, _fy, _fz;
 };
 
 #endif// FORCE_GENERATOR_H
@@ -7,47 +7,192 @@
 #include "objectPhysics.h"
 
 ObjectPhysics::ObjectPhysics(glm::vec3 position, glm::vec3 rotation, float mass):
-	_position(position)
+	_store(nullptr), _id(BodyStore::INVALID_ID)
 {
+	_state.position = position;
+	// Euler angles in degrees, same order as the model matrix (z, y, x)
+	_state.orientation = glm::angleAxis(glm::radians(rotation.z), glm::vec3(0,0,1))*
+		glm::angleAxis(glm::radians(rotation.y), glm::vec3(0,1,0))*
+		glm::angleAxis(glm::radians(rotation.x), glm::vec3(1,0,0));
 	if(mass > 0)
-		_inverseMass = 1/mass;
+		_state.inverseMass = 1/mass;
 	else
-		_inverseMass = 0;
+		_state.inverseMass = 0;
 
-	_damping = 0.99;
-	_velocity = glm::vec3(0,0,0);
-	_acceleration = glm::vec3(0,0,0);
-	_forceAccum = glm::vec3(0,0,0);
+	_state.damping = 0.99;
+	_state.velocity = glm::vec3(0,0,0);
+	_state.acceleration = glm::vec3(0,0,0);
+	_state.forceAccum = glm::vec3(0,0,0);
 }
 
 ObjectPhysics::~ObjectPhysics()
 {
+	if(_store != nullptr)
+	{
+		_store->remove(_id);
+		_store = nullptr;
+	}
 }
 
-void ObjectPhysics::addForce(glm::vec3 force)
+void ObjectPhysics::attach(BodyStore* store)
 {
-	_forceAccum += force;
+	if(_store == store)
+		return;
+
+	if(_store != nullptr)
+		_store->remove(_id);
+
+	_store = store;
+	_id = _store->add(this, _state);
 }
 
-void ObjectPhysics::integrate(float dt)
+void ObjectPhysics::detach()
 {
-	if(_inverseMass<=0)
+	if(_store == nullptr)
 		return;
 
-	// Update position
-	_position += _velocity*dt;
+	const BodyStore::BodyState state = _store->getState(_id);
+	_store->remove(_id);
+	detach(state);
+}
+
+void ObjectPhysics::detach(const BodyStore::BodyState& state)
+{
+	_state = state;
+	_store = nullptr;
+	_id = BodyStore::INVALID_ID;
+}
+
+void ObjectPhysics::addForce(glm::vec3 force)
+{
+	if(_store != nullptr)
+		_store->addForce(_id, force);
+	else
+		_state.forceAccum += force;
+}
+
+void ObjectPhysics::addTorque(glm::vec3 torque)
+{
+	if(_store != nullptr)
+		_store->addTorque(_id, torque);
+	else
+		_state.torqueAccum += torque;
+}
+
+void ObjectPhysics::addForceAtPoint(glm::vec3 force, glm::vec3 point)
+{
+	if(_store != nullptr)
+		_store->addForceAtPoint(_id, force, point);
+	else
+	{
+		_state.forceAccum += force;
+		_state.torqueAccum += glm::cross(point-_state.position, force);
+	}
+}
+
+glm::mat4 ObjectPhysics::getRenderTransform() const
+{
+	if(_store != nullptr)
+		return _store->getTransform(_id);
+
+	glm::mat4 transform = glm::mat4_cast(_state.orientation);
+	transform[3] = glm::vec4(_state.position, 1.0f);
+	return transform;
+}
+
+void ObjectPhysics::setPosition(glm::vec3 position)
+{
+	if(_store != nullptr)
+		_store->teleport(_id, position);
+	else
+		_state.position = position;
+}
+
+void ObjectPhysics::setVelocity(glm::vec3 velocity)
+{
+	if(_store != nullptr)
+		_store->setVelocity(_id, velocity);
+	else
+		_state.velocity = velocity;
+}
+
+void ObjectPhysics::setAngularVelocity(glm::vec3 angularVelocity)
+{
+	if(_store != nullptr)
+		_store->setAngularVelocity(_id, angularVelocity);
+	else
+		_state.angularVelocity = angularVelocity;
+}
 
-	// Calculate acceleration
-	glm::vec3 resultingAcc = _acceleration;
-	resultingAcc += _forceAccum*_inverseMass;
+void ObjectPhysics::setAcceleration(glm::vec3 acceleration)
+{
+	if(_store != nullptr)
+		_store->setAcceleration(_id, acceleration);
+	else
+		_state.acceleration = acceleration;
+}
 
-	_velocity += resultingAcc*dt;
-	_velocity *= powf(_damping, dt);
+void ObjectPhysics::setMass(float mass)
+{
+	const float inverseMass = mass>0 ? 1/mass : 0;
+	if(_store != nullptr)
+		_store->setInverseMass(_id, inverseMass);
+	else
+		_state.inverseMass = inverseMass;
+}
+
+void ObjectPhysics::setDamping(float damping)
+{
+	if(_store != nullptr)
+		_store->setDamping(_id, damping);
+	else
+		_state.damping = damping;
+}
 
-	clearAccumulator();
+void ObjectPhysics::setHalfExtents(glm::vec3 halfExtents)
+{
+	if(_store != nullptr)
+		_store->setHalfExtents(_id, halfExtents);
+	else
+		_state.halfExtents = halfExtents;
 }
 
-void ObjectPhysics::clearAccumulator()
+void ObjectPhysics::setOrientation(glm::quat orientation)
 {
-	_forceAccum = glm::vec3(0,0,0);
+	if(_store != nullptr)
+		_store->teleport(_id, _store->getPosition(_id), orientation);
+	else
+		_state.orientation = orientation;
+}
+
+void ObjectPhysics::setShapeType(ShapeType shapeType)
+{
+	if(_store != nullptr)
+		_store->setShapeType(_id, shapeType);
+	else
+		_state.shapeType = shapeType;
+}
+
+void ObjectPhysics::setFriction(float friction)
+{
+	if(_store != nullptr)
+		_store->setFriction(_id, friction);
+	else
+		_state.friction = friction;
+}
+
+void ObjectPhysics::setRestitution(float restitution)
+{
+	if(_store != nullptr)
+		_store->setRestitution(_id, restitution);
+	else
+		_state.restitution = restitution;
+}
+
+void ObjectPhysics::setCcdEnabled(bool enabled)
+{
+	if(_store != nullptr)
+		_store->setCcdEnabled(_id, enabled);
+	else
+		_state.ccd = enabled;
 }
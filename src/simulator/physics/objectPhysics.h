@@ -8,7 +8,10 @@
 #define OBJECT_PHYSICS_H
 
 #include "glm.h"
+#include "bodyStore.h"
 
+// Lightweight handle to a body in the physics engine BodyStore.
+// Before being added to the engine the state is kept locally.
 class ObjectPhysics
 {
 	public:
@@ -16,39 +19,69 @@ class ObjectPhysics
 		~ObjectPhysics();
 
 		void addForce(glm::vec3 force);
-		void integrate(float dt);
+		void addTorque(glm::vec3 torque);
+		// World space point, also adds the torque around the center of mass
+		void addForceAtPoint(glm::vec3 force, glm::vec3 point);
+
+		// Move the body state to the store
+		void attach(BodyStore* store);
+		// Move the body state out of the store (the body leaves the simulation)
+		void detach();
 
 		//---------- Getters ----------//
-		glm::vec3 getPosition() const { return _position; };
-		glm::vec3 getVelocity() const { return _velocity; };
-		glm::vec3 getAcceleration() const { return _acceleration; };
-		float getInverseMass() const { return _inverseMass; }
-		float getMass() const { return _inverseMass<=0 ? 0 : _inverseMass; };
-		float getDamping() const { return _damping; };
+		glm::vec3 getPosition() const { return _store ? _store->getPosition(_id) : _state.position; };
+		glm::vec3 getVelocity() const { return _store ? _store->getVelocity(_id) : _state.velocity; };
+		glm::vec3 getAcceleration() const { return _store ? _store->getAcceleration(_id) : _state.acceleration; };
+		glm::vec3 getAngularVelocity() const { return _store ? _store->getAngularVelocity(_id) : _state.angularVelocity; };
+		float getInverseMass() const { return _store ? _store->getInverseMass(_id) : _state.inverseMass; }
+		float getMass() const { float inv = getInverseMass(); return inv<=0 ? 0 : 1/inv; };
+		float getDamping() const { return _store ? _store->getDamping(_id) : _state.damping; };
+		glm::vec3 getHalfExtents() const { return _store ? _store->getHalfExtents(_id) : _state.halfExtents; };
+		glm::quat getOrientation() const { return _store ? _store->getOrientation(_id) : _state.orientation; };
+		float getFriction() const { return _store ? _store->getFriction(_id) : _state.friction; };
+		float getRestitution() const { return _store ? _store->getRestitution(_id) : _state.restitution; };
+		ShapeType getShapeType() const { return _store ? _store->getShapeType(_id) : _state.shapeType; };
+		bool isCcdEnabled() const { return _store ? _store->isCcdEnabled(_id) : _state.ccd; }
+		BodyStore::BodyId getId() const { return _id; }
+		bool isAttached() const { return _store != nullptr; }
+		bool isAwake() const { return _store ? _store->isAwake(_id) : true; }
+		// Pose interpolated between the last two physics steps
+		glm::vec3 getRenderPosition() const { return _store ? _store->getInterpolatedPosition(_id) : _state.position; }
+		glm::quat getRenderOrientation() const { return _store ? _store->getInterpolatedOrientation(_id) : _state.orientation; }
+		// Render pose as a matrix (cached by the engine once per frame)
+		glm::mat4 getRenderTransform() const;
 
 		//---------- Setters ----------//
-		void setPosition(glm::vec3 position) { _position = position; };
-		void setVelocity(glm::vec3 velocity) { _velocity = velocity; };
-		void setAcceleration(glm::vec3 acceleration) { _acceleration = acceleration; };
-		void setMass(float mass) { _inverseMass = mass>0 ? 1/mass : 0; };
+		void setPosition(glm::vec3 position);
+		void setVelocity(glm::vec3 velocity);
+		// World space (rad/s)
+		void setAngularVelocity(glm::vec3 angularVelocity);
+		void setAcceleration(glm::vec3 acceleration);
+		void setMass(float mass);
+		void setDamping(float damping);
+		void setHalfExtents(glm::vec3 halfExtents);
+		void setOrientation(glm::quat orientation);
+		void setShapeType(ShapeType shapeType);
+		void setFriction(float friction);
+		void setRestitution(float restitution);
+		// Continuous collision detection for small fast bodies that could pass through thin
+		// shapes in one step. Only the flagged bodies pay for it.
+		void setCcdEnabled(bool enabled);
 
 	private:
-		// Clear the forces
-		void clearAccumulator();
+		friend class BodyStore;
+		// Called by the store when it is destroyed
+		void detach(const BodyStore::BodyState& state);
 
-		glm::vec3 _position;
-		glm::vec3 _velocity;
-		glm::vec3 _acceleration;
-		
-		glm::vec3 _forceAccum;
+		BodyStore* _store;
+		BodyStore::BodyId _id;
 
+		// Only used while the body is not in a store
 		// Damping is required to remove energy added 
 		// through numerical instability in the integrator
-		float _damping;
-
 		// Inverse mass is more useful because integration is simpler
 		// Immovable objects have zero inverseMass (infinity mass)
-		float _inverseMass;
+		BodyStore::BodyState _state;
 };
 
 #endif// OBJECT_PHYSICS_H
@@ -5,10 +5,25 @@
 // By Breno Cunha Queiroz
 //--------------------------------------------------
 #include "physicsEngine.h"
+#include "broadphase/sweepAndPrune.h"
+#include "broadphase/aabbTreeBroadphase.h"
+#include "colliders/rayIntersection.h"
+#include <algorithm>
 
-PhysicsEngine::PhysicsEngine()
+PhysicsEngine::PhysicsEngine():
+	_fixedTimeStep(0.001f), _maxSubsteps(64),
+	_accumulator(0), _substepCount(0), _droppedTime(0),
+	_deterministic(false), _stepCount(0), _stateHash(0), _revision(0)
 {
-	_forceGenerator = new ForceGenerator();
+	_bodyStore = new BodyStore();
+	_forceGenerator = new ForceGenerator(_bodyStore);
+	_jointMotors = new JointMotors();
+	_broadphase = new AabbTreeBroadphase(_bodyStore);
+	_narrowphase = new Narrowphase(_bodyStore);
+	_contactSolver = new ContactSolver(_bodyStore);
+	_islandManager = new IslandManager(_bodyStore);
+	_threadPool = new ThreadPool();
+	_contactSolver->setThreadPool(_threadPool);
 }
 
 PhysicsEngine::~PhysicsEngine()
@@ -18,25 +33,573 @@ PhysicsEngine::~PhysicsEngine()
 		delete _forceGenerator;
 		_forceGenerator = nullptr;
 	}
+
+	if(_jointMotors != nullptr)
+	{
+		delete _jointMotors;
+		_jointMotors = nullptr;
+	}
+
+	if(_threadPool != nullptr)
+	{
+		delete _threadPool;
+		_threadPool = nullptr;
+	}
+
+	if(_islandManager != nullptr)
+	{
+		delete _islandManager;
+		_islandManager = nullptr;
+	}
+
+	if(_contactSolver != nullptr)
+	{
+		delete _contactSolver;
+		_contactSolver = nullptr;
+	}
+
+	if(_narrowphase != nullptr)
+	{
+		delete _narrowphase;
+		_narrowphase = nullptr;
+	}
+
+	if(_broadphase != nullptr)
+	{
+		delete _broadphase;
+		_broadphase = nullptr;
+	}
+
+	if(_bodyStore != nullptr)
+	{
+		delete _bodyStore;
+		_bodyStore = nullptr;
+	}
+}
+
+void PhysicsEngine::update(float frameTime)
+{
+	if(frameTime <= 0 || _fixedTimeStep <= 0)
+		return;
+
+	// Spiral-of-death guard: when the steps take longer than the frame,
+	// the time that does not fit in maxSubsteps is dropped (the simulation slows down)
+	_accumulator += frameTime;
+	const float maxTime = _fixedTimeStep*_maxSubsteps;
+	if(_accumulator > maxTime)
+	{
+		_droppedTime += _accumulator - maxTime;
+		_accumulator = maxTime;
+	}
+
+	_substepCount = 0;
+	while(_accumulator >= _fixedTimeStep)
+	{
+		stepPhysics(_fixedTimeStep);
+		_accumulator -= _fixedTimeStep;
+		_substepCount++;
+	}
+
+	// The renderer shows the pose between the last two steps
+	_bodyStore->setInterpolationAlpha(_accumulator/_fixedTimeStep);
+	_bodyStore->updateTransforms();
 }
 
 void PhysicsEngine::stepPhysics(float dt)
 {
-	dt/=10.f;
-	for(auto object : _objectsPhysics)
+	_bodyStore->savePreviousState();
+
+	// Collision detection
+	syncBroadphase();
+	_broadphase->update();
+	_narrowphase->update(getOrderedPairs());
+	wakeContacts();
+
+	// Islands of the bodies connected by contacts or constraints
+	_jointPairs.clear();
+	for(auto constraint : _constraints)
+	{
+		ObjectPhysics* objA = constraint->getObjectA();
+		ObjectPhysics* objB = constraint->getObjectB();
+		if(objA != nullptr && objB != nullptr && objA->isAttached() && objB->isAttached())
+			_jointPairs.push_back({objA->getId(), objB->getId()});
+	}
+	for(auto articulation : _articulations)
+		for(int link=1; link<articulation->getLinkCount(); link++)
+			_jointPairs.push_back({articulation->getLinkBody(articulation->getParent(link))->getId(), articulation->getLinkBody(link)->getId()});
+	_islandManager->build(_narrowphase->getManifolds(), _jointPairs);
+
+	// Contacts are solved between the velocity and position integration.
+	// The articulations move their links in joint space and solve the contacts of their links.
+	collectArticulationManifolds();
+	_forceGenerator->updateForces(dt);
+	_jointMotors->update(dt);
+	for(auto articulation : _articulations)
+		articulation->integrateVelocities(dt);
+	_bodyStore->integrateVelocities(dt);
+	_contactSolver->solveVelocities(_narrowphase->getManifolds(), dt, _islandManager);
+	for(auto articulation : _articulations)
+		articulation->solveContacts(_narrowphase->getManifolds(), _contactSolver, dt);
+	_bodyStore->integratePositions(dt);
+	for(auto articulation : _articulations)
+		articulation->integratePositions(dt);
+	solveContinuousCollisions();
+	_contactSolver->solvePositions(dt);
+	for(auto articulation : _articulations)
+		articulation->solveContactPositions(_contactSolver, dt);
+
+	_islandManager->updateSleep(dt);
+
+	_stepCount++;
+	if(_deterministic)
+	{
+		_stateHash = computeStateHash();
+		if(onStepHash)
+			onStepHash(_stepCount, _stateHash);
+	}
+}
+
+void PhysicsEngine::syncBroadphase()
+{
+	for(auto id : _bodyStore->getRemovedIds())
+		_broadphase->removeBody(id);
+	for(auto id : _bodyStore->getAddedIds())
+		if(_bodyStore->isValid(id))
+			_broadphase->addBody(id);
+	for(auto id : _bodyStore->getTeleportedIds())
+		if(_bodyStore->isValid(id))
+			_broadphase->touchBody(id);
+	for(auto id : _bodyStore->getRemovedIds())
+	{
+		_islandManager->removeBody(id);
+		_forceGenerator->removeBody(id);
+		_narrowphase->removeBody(id);
+	}
+	for(auto id : _bodyStore->getWakeRequests())
+		_islandManager->wakeIsland(id);
+	_bodyStore->clearEvents();
+}
+
+void PhysicsEngine::wakeContacts()
+{
+	// The narrowphase only keeps pairs with an awake body
+	bool woken = false;
+	for(const auto& manifold : _narrowphase->getManifolds())
+	{
+		const BodyStore::BodyId ids[2] = {manifold.a, manifold.b};
+		for(auto id : ids)
+		{
+			if(!_bodyStore->isAwake(id) && _bodyStore->getInverseMass(id) > 0)
+			{
+				_islandManager->wakeIsland(id);
+				woken = true;
+			}
+		}
+	}
+
+	// The woken bodies can touch other sleeping bodies
+	if(woken)
+		_narrowphase->update(getOrderedPairs());
+}
+
+const std::vector<Broadphase::Pair>& PhysicsEngine::getOrderedPairs()
+{
+	// The order of the broadphase pairs depends on the history of the tree/axis lists
+	if(!_deterministic)
+		return _broadphase->getPairs();
+
+	_sortedPairs = _broadphase->getPairs();
+	std::sort(_sortedPairs.begin(), _sortedPairs.end(), [](const Broadphase::Pair& x, const Broadphase::Pair& y)
+	{
+		return x.a != y.a ? x.a < y.a : x.b < y.b;
+	});
+	return _sortedPairs;
+}
+
+void PhysicsEngine::setDeterministic(bool deterministic)
+{
+	_deterministic = deterministic;
+	_contactSolver->setDeterministic(deterministic);
+}
+
+uint64_t PhysicsEngine::computeStateHash() const
+{
+	uint64_t hash = _bodyStore->computeStateHash();
+	for(auto articulation : _articulations)
+	{
+		for(int link=1; link<articulation->getLinkCount(); link++)
+		{
+			const float state[2] = {articulation->getJointPosition(link), articulation->getJointVelocity(link)};
+			const uint8_t* bytes = (const uint8_t*)state;
+			for(size_t i=0; i<sizeof(state); i++)
+				hash = (hash ^ bytes[i])*1099511628211ull;
+		}
+	}
+	return hash;
+}
+
+void PhysicsEngine::saveState(StateSnapshot& snapshot) const
+{
+	snapshot.clear();
+	snapshot.setRevision(getRevision());
+	_bodyStore->saveState(snapshot);
+	_narrowphase->saveState(snapshot);
+	_contactSolver->saveState(snapshot);
+	_islandManager->saveState(snapshot);
+	_jointMotors->saveState(snapshot);
+	for(auto articulation : _articulations)
+		articulation->saveState(snapshot);
+
+	snapshot.write(_accumulator);
+	snapshot.write(_substepCount);
+	snapshot.write(_droppedTime);
+	snapshot.write(_stepCount);
+	snapshot.write(_stateHash);
+}
+
+bool PhysicsEngine::restoreState(const StateSnapshot& snapshot)
+{
+	if(snapshot.isEmpty() || snapshot.getRevision() != getRevision())
+		return false;
+
+	StateSnapshot::Reader reader(snapshot);
+	_bodyStore->restoreState(reader);
+	_narrowphase->restoreState(reader);
+	_contactSolver->restoreState(reader);
+	_islandManager->restoreState(reader);
+	_jointMotors->restoreState(reader);
+	for(auto articulation : _articulations)
+		articulation->restoreState(reader);
+
+	reader.read(_accumulator);
+	reader.read(_substepCount);
+	reader.read(_droppedTime);
+	reader.read(_stepCount);
+	reader.read(_stateHash);
+
+	// Sleeping bodies are only moved in the broadphase when touched
+	for(uint32_t i=_bodyStore->getActiveCount(); i<_bodyStore->size(); i++)
+		if(_bodyStore->getInverseMasses()[i] > 0)
+			_broadphase->touchBody(_bodyStore->getId(i));
+	return true;
+}
+
+void PhysicsEngine::setBroadphaseType(BroadphaseType type)
+{
+	// The removed ids and wake requests also go to the islands, forces and narrowphase
+	syncBroadphase();
+
+	delete _broadphase;
+	switch(type)
 	{
-		object->addForce({0,9.8,0});
-		object->integrate(dt);
+		case BroadphaseType::SWEEP_AND_PRUNE:
+			_broadphase = new SweepAndPrune(_bodyStore);
+			break;
+		case BroadphaseType::AABB_TREE:
+			_broadphase = new AabbTreeBroadphase(_bodyStore);
+			break;
 	}
+
+	for(uint32_t i=0; i<_bodyStore->size(); i++)
+		_broadphase->addBody(_bodyStore->getId(i));
+}
+
+void PhysicsEngine::setThreadCount(int threadCount)
+{
+	delete _threadPool;
+	_threadPool = new ThreadPool(threadCount);
+	_contactSolver->setThreadPool(_threadPool);
+}
+
+std::vector<ObjectPhysics*> PhysicsEngine::queryAabb(const Aabb& aabb)
+{
+	syncBroadphase();
+
+	std::vector<ObjectPhysics*> result;
+	_broadphase->query(aabb, [this, &aabb, &result](BodyStore::BodyId id)
+	{
+		// Tree proxies are fat, test the tight box
+		if(_bodyStore->getAabb(id).overlaps(aabb))
+			result.push_back(_bodyStore->getOwner(_bodyStore->getIndex(id)));
+		return true;
+	});
+	return result;
 }
 
 void PhysicsEngine::addObjectPhysics(ObjectPhysics* objectPhysics)
 {
+	if(objectPhysics == nullptr)
+		return;
+
+	objectPhysics->attach(_bodyStore);
 	_objectsPhysics.push_back(objectPhysics);
 }
 
-bool PhysicsEngine::raycast(glm::vec3 startPosition, glm::vec3 direction)
+void PhysicsEngine::removeObjectPhysics(ObjectPhysics* objectPhysics)
+{
+	auto it = std::find(_objectsPhysics.begin(), _objectsPhysics.end(), objectPhysics);
+	if(it == _objectsPhysics.end())
+		return;
+
+	_objectsPhysics.erase(it);
+	// Custom forces point to the object, they can't wait for the removed ids
+	_forceGenerator->remove(objectPhysics);
+	// The broadphase, islands and contacts drop it in the next step (removed ids of the store)
+	objectPhysics->detach();
+}
+
+void PhysicsEngine::addConstraint(Constraint* constraint)
+{
+	if(constraint == nullptr)
+		return;
+	_constraints.push_back(constraint);
+	_revision++;
+
+	// A new constraint changes the islands
+	ObjectPhysics* objects[2] = {constraint->getObjectA(), constraint->getObjectB()};
+	for(auto object : objects)
+		if(object != nullptr && object->isAttached())
+			_islandManager->wakeIsland(object->getId());
+}
+
+void PhysicsEngine::removeConstraint(Constraint* constraint)
+{
+	auto it = std::find(_constraints.begin(), _constraints.end(), constraint);
+	if(it == _constraints.end())
+		return;
+	_constraints.erase(it);
+	_revision++;
+
+	ObjectPhysics* objects[2] = {constraint->getObjectA(), constraint->getObjectB()};
+	for(auto object : objects)
+		if(object != nullptr && object->isAttached())
+			_islandManager->wakeIsland(object->getId());
+}
+
+void PhysicsEngine::addArticulation(Articulation* articulation)
+{
+	if(articulation == nullptr)
+		return;
+	for(int link=0; link<articulation->getLinkCount(); link++)
+		if(!articulation->getLinkBody(link)->isAttached())
+			return;
+	_articulations.push_back(articulation);
+	_revision++;
+
+	// Links are moved to the joint positions
+	articulation->attach(_bodyStore, _jointMotors);
+	for(int link=0; link<articulation->getLinkCount(); link++)
+		_linkArticulations[articulation->getLinkBody(link)->getId()] = articulation;
+	setLinkPairsIgnored(articulation, true);
+}
+
+void PhysicsEngine::removeArticulation(Articulation* articulation)
+{
+	auto it = std::find(_articulations.begin(), _articulations.end(), articulation);
+	if(it == _articulations.end())
+		return;
+	_articulations.erase(it);
+	_revision++;
+
+	for(int link=0; link<articulation->getLinkCount(); link++)
+		_linkArticulations.erase(articulation->getLinkBody(link)->getId());
+	setLinkPairsIgnored(articulation, false);
+	_islandManager->wakeIsland(articulation->getLinkBody(0)->getId());
+	articulation->detach();
+}
+
+void PhysicsEngine::setLinkPairsIgnored(Articulation* articulation, bool ignored)
 {
+	// Connected links never collide, the other pairs only with self collision
+	const int n = articulation->getLinkCount();
+	for(int i=1; i<n; i++)
+		for(int j=0; j<i; j++)
+		{
+			if(articulation->isSelfCollisionEnabled() && articulation->getParent(i) != j)
+				continue;
+			const BodyStore::BodyId a = articulation->getLinkBody(i)->getId();
+			const BodyStore::BodyId b = articulation->getLinkBody(j)->getId();
+			if(ignored)
+				_narrowphase->addIgnoredPair(a, b);
+			else
+				_narrowphase->removeIgnoredPair(a, b);
+		}
+}
+
+void PhysicsEngine::collectArticulationManifolds()
+{
+	if(_articulations.empty())
+		return;
+	for(auto articulation : _articulations)
+		articulation->clearManifolds();
+
+	const std::vector<ContactManifold>& manifolds = _narrowphase->getManifolds();
+	for(uint32_t i=0; i<manifolds.size(); i++)
+	{
+		auto itA = _linkArticulations.find(manifolds[i].a);
+		auto itB = _linkArticulations.find(manifolds[i].b);
+		if(itA != _linkArticulations.end())
+			itA->second->addManifold(i);
+		// Self contacts are added once
+		if(itB != _linkArticulations.end() && (itA == _linkArticulations.end() || itA->second != itB->second))
+			itB->second->addManifold(i);
+	}
+}
+
+void PhysicsEngine::solveContinuousCollisions()
+{
+	if(_bodyStore->getCcdCount() == 0)
+		return;
+
+	// The largest sphere inside the body is swept along the step motion against the shapes
+	// grown by its radius (exact for spheres, conservative for the others). A body that moved
+	// less than half the radius is caught by the discrete collision detection.
+	const uint8_t* ccd = _bodyStore->getCcdFlags();
+	const float* inverseMass = _bodyStore->getInverseMasses();
+	const uint32_t n = _bodyStore->getActiveCount();
+	for(uint32_t i=0; i<n; i++)
+	{
+		if(!ccd[i] || inverseMass[i] <= 0)
+			continue;
+
+		const ShapeInstance shape = _bodyStore->getShapeInstanceByIndex(i);
+		float radius = shape.halfExtents.x;
+		if(shape.type == ShapeType::BOX)
+			radius = std::min(std::min(shape.halfExtents.x, shape.halfExtents.y), shape.halfExtents.z);
+		else if(shape.type == ShapeType::CYLINDER)
+			radius = std::min(shape.halfExtents.x, shape.halfExtents.y);
+		else if(shape.type == ShapeType::PLANE)
+			continue;
+
+		const glm::vec3 start = _bodyStore->getPreviousPositionByIndex(i);
+		const glm::vec3 motion = shape.position - start;
+		const float distance = glm::length(motion);
+		if(distance <= radius*0.5f)
+			continue;
+		const glm::vec3 direction = motion/distance;
+
+		const BodyStore::BodyId id = _bodyStore->getId(i);
+		Aabb sweep;
+		sweep.min = glm::min(start, shape.position) - glm::vec3(radius);
+		sweep.max = glm::max(start, shape.position) + glm::vec3(radius);
+		float impact = distance;
+		glm::vec3 impactNormal;
+		_broadphase->query(sweep, [&](BodyStore::BodyId other)
+		{
+			if(other == id || _narrowphase->isIgnoredPair(id, other))
+				return true;
+
+			// Minkowski sum of the shape and the sphere (grown box for boxes and cylinders)
+			ShapeInstance grown = _bodyStore->getShapeInstanceByIndex(_bodyStore->getIndex(other));
+			switch(grown.type)
+			{
+				case ShapeType::SPHERE:
+					grown.halfExtents.x += radius;
+					break;
+				case ShapeType::PLANE:
+					grown.position += grown.rotation*glm::vec3(0,radius,0);
+					grown.halfExtents += glm::vec3(radius, 0, radius);
+					break;
+				default:
+					grown.halfExtents += glm::vec3(radius);
+					break;
+			}
+
+			float t;
+			glm::vec3 normal;
+			if(RayIntersection::intersect(grown, start, direction, impact, t, normal))
+			{
+				impact = t;
+				impactNormal = normal;
+			}
+			return true;
+		});
+		if(impact >= distance)
+			continue;
+
+		// Slightly inside the other shape, so the contact is found by the next step
+		const glm::vec3 position = start + direction*impact - impactNormal*_contactSolver->getLinearSlop();
+		if(_bodyStore->getArticulatedFlags()[i])
+		{
+			auto it = _linkArticulations.find(id);
+			if(it != _linkArticulations.end())
+				it->second->translate(position - shape.position);
+		}
+		else
+			_bodyStore->setPositionByIndex(i, position);
+	}
+}
+
+bool PhysicsEngine::raycast(glm::vec3 startPosition, glm::vec3 direction, RayResult& result, float maxDistance)
+{
+	syncBroadphase();
+
+	result = RayResult();
+	const float length = glm::length(direction);
+	if(length <= 0)
+		return false;
+	direction /= length;
+
+	_broadphase->raycast(startPosition, direction, maxDistance, [&](BodyStore::BodyId id, float maxT)
+	{
+		return traceShape(id, startPosition, direction, maxT, result);
+	});
+	return result.hit;
+}
+
+void PhysicsEngine::raycastBatch(const std::vector<Ray>& rays, std::vector<RayResult>& results)
+{
+	syncBroadphase();
+
+	const uint32_t count = (uint32_t)rays.size();
+	results.assign(count, RayResult());
+	// Scratch arrays keep their capacity, sensors casting every frame do not allocate
+	_rayOrigins.resize(count);
+	_rayDirections.resize(count);
+	_rayMaxT.resize(count);
+	glm::vec3* origins = _rayOrigins.data();
+	glm::vec3* directions = _rayDirections.data();
+	float* maxT = _rayMaxT.data();
+	for(uint32_t i=0; i<count; i++)
+	{
+		const float length = glm::length(rays[i].direction);
+		origins[i] = rays[i].origin;
+		directions[i] = length > 0 ? rays[i].direction/length : glm::vec3(0,1,0);
+		// Invalid rays never hit
+		maxT[i] = length > 0 ? rays[i].maxDistance : -1.0f;
+	}
+
+	// Work is split in whole packets so the coherent rays stay together
+	const uint32_t packetSize = DynamicAabbTree::PACKET_SIZE;
+	const uint32_t packetCount = (count+packetSize-1)/packetSize;
+	_threadPool->parallelFor(packetCount, 8, [&](uint32_t begin, uint32_t end)
+	{
+		const uint32_t first = begin*packetSize;
+		const uint32_t last = std::min(end*packetSize, count);
+		_broadphase->raycastBatch(&origins[first], &directions[first], &maxT[first], last-first,
+				[&, first](BodyStore::BodyId id, uint32_t ray, float rayMaxT)
+				{
+					const uint32_t i = first+ray;
+					return traceShape(id, origins[i], directions[i], rayMaxT, results[i]);
+				});
+	});
+}
+
+float PhysicsEngine::traceShape(BodyStore::BodyId id, glm::vec3 origin, glm::vec3 direction, float maxT, RayResult& result) const
+{
+	const uint32_t index = _bodyStore->getIndex(id);
+	float t;
+	glm::vec3 normal;
+	if(!RayIntersection::intersect(_bodyStore->getShapeInstanceByIndex(index), origin, direction, maxT, t, normal))
+		return maxT;
+
+	result.hit = true;
+	result.body = _bodyStore->getOwner(index);
+	result.id = id;
+	result.hitPoint = origin + direction*t;
+	result.normal = normal;
+	result.distance = t;
+	return t;
 }
 
 //---------- Static functions ----------//
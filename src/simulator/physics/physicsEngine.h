@@ -8,27 +8,181 @@
 #define PHYSICS_ENGINE_H
 
 #include <vector>
+#include <cfloat>
+#include <functional>
+#include <unordered_map>
 #include "glm.h"
 #include "objectPhysics.h"
+#include "bodyStore.h"
+#include "stateSnapshot.h"
 #include "forces/forceGenerator.h"
+#include "broadphase/broadphase.h"
+#include "colliders/narrowphase.h"
+#include "solver/contactSolver.h"
+#include "solver/islandManager.h"
+#include "constraints/constraint.h"
+#include "articulations/articulation.h"
+#include "simulator/helpers/threadPool.h"
 
 class PhysicsEngine
 {
 	public:
+		enum class BroadphaseType
+		{
+			SWEEP_AND_PRUNE,
+			AABB_TREE
+		};
+
+		struct Ray
+		{
+			glm::vec3 origin;
+			// Does not need to be normalized
+			glm::vec3 direction;
+			float maxDistance = FLT_MAX;
+		};
+
+		struct RayResult
+		{
+			bool hit = false;
+			// Handle of the body that was hit (nullptr if the body has no handle)
+			ObjectPhysics* body = nullptr;
+			BodyStore::BodyId id = BodyStore::INVALID_ID;
+			glm::vec3 hitPoint = {0,0,0};
+			glm::vec3 normal = {0,0,0};
+			float distance = 0.0f;
+		};
+
 		PhysicsEngine();
 		~PhysicsEngine();
 
+		// Advance the simulation by the frame time in fixed steps (also updates the render transforms)
+		void update(float frameTime);
+		// Single step of dt seconds
 		void stepPhysics(float dt);
 		void addObjectPhysics(ObjectPhysics* objectPhysics);
+		// The body leaves the world with its last state (not deleted). Its constraints and
+		// articulation must be removed before.
+		void removeObjectPhysics(ObjectPhysics* objectPhysics);
+		// Constraints connect the islands of their bodies (not owned by the engine)
+		void addConstraint(Constraint* constraint);
+		void removeConstraint(Constraint* constraint);
+		// The links must already be in the engine (not owned by the engine)
+		void addArticulation(Articulation* articulation);
+		void removeArticulation(Articulation* articulation);
+
+		// Closest hit along the ray (rays starting inside a shape ignore it)
+		bool raycast(glm::vec3 startPosition, glm::vec3 direction, RayResult& result, float maxDistance=FLT_MAX);
+		// One result per ray. The rays are traced in packets of coherent rays over the
+		// worker threads, consecutive rays should be close to each other (sensor scans).
+		// Like raycast, it must not run at the same time as stepPhysics (or another batch).
+		void raycastBatch(const std::vector<Ray>& rays, std::vector<RayResult>& results);
+		// Bodies whose (broadphase) bounds overlap the box
+		std::vector<ObjectPhysics*> queryAabb(const Aabb& aabb);
+
+		// Complete dynamic state (bodies, contact and sleep caches, joints and motors, step
+		// counters) copied to the snapshot arena, reused between saves. Used to roll the world
+		// back, e.g. to run many rollouts from the same state. The configuration (gravity,
+		// forces, solver parameters) is not saved. Not while the physics thread is running.
+		void saveState(StateSnapshot& snapshot) const;
+		// Back to a saved state of the same world, false (and nothing changes) if bodies,
+		// constraints or articulations were added or removed since the save. The broadphase
+		// is refitted instead of restored: restored runs repeat the original run bit by bit
+		// only in deterministic mode.
+		bool restoreState(const StateSnapshot& snapshot);
 
-		bool raycast(glm::vec3 startPosition, glm::vec3 direction);
 		//---------- Getters ----------//
+		BodyStore* getBodyStore() const { return _bodyStore; }
+		Broadphase* getBroadphase() const { return _broadphase; }
+		Narrowphase* getNarrowphase() const { return _narrowphase; }
+		const std::vector<ContactManifold>& getContactManifolds() const { return _narrowphase->getManifolds(); }
+		ContactSolver* getContactSolver() const { return _contactSolver; }
+		IslandManager* getIslandManager() const { return _islandManager; }
+		int getThreadCount() const { return _threadPool->getThreadCount(); }
+		glm::vec3 getGravity() const { return _forceGenerator->getGravity(); }
+		ForceGenerator* getForceGenerator() const { return _forceGenerator; }
+		// Motors of the articulation joints (set through the articulations)
+		JointMotors* getJointMotors() const { return _jointMotors; }
+		float getFixedTimeStep() const { return _fixedTimeStep; }
+		int getMaxSubsteps() const { return _maxSubsteps; }
+		// Steps run by the last update
+		int getSubstepCount() const { return _substepCount; }
+		// Simulation time dropped by the spiral-of-death guard
+		float getDroppedTime() const { return _droppedTime; }
+		bool isDeterministic() const { return _deterministic; }
+		// Steps run since the engine was created
+		uint64_t getStepCount() const { return _stepCount; }
+		// Hash of the state after the last step (deterministic mode only)
+		uint64_t getStateHash() const { return _stateHash; }
+		// Hash of the body and joint states, equal states give equal hashes
+		uint64_t computeStateHash() const;
+		// Incremented when bodies, constraints or articulations are added or removed
+		uint64_t getRevision() const { return _revision + _bodyStore->getRevision(); }
+
+		//---------- Setters ----------//
+		void setBroadphaseType(BroadphaseType type);
+		void setGravity(glm::vec3 gravity) { _forceGenerator->setGravity(gravity); }
+		void setFixedTimeStep(float fixedTimeStep) { _fixedTimeStep = fixedTimeStep; }
+		// Steps per update, the frame time above maxSubsteps*fixedTimeStep is dropped
+		void setMaxSubsteps(int maxSubsteps) { _maxSubsteps = maxSubsteps; }
+		void setSolverIterations(int iterations) { _contactSolver->setIterations(iterations); }
+		void setSleepingEnabled(bool sleepingEnabled) { _islandManager->setSleepingEnabled(sleepingEnabled); }
+		// Threads used to solve the islands, including the caller (0 uses all the cores)
+		void setThreadCount(int threadCount);
+		// Bit-exact trajectories across runs and thread counts for the same sequence of steps
+		// and calls (same binary): the broadphase pairs are sorted and the contact solve order
+		// does not depend on the threads. Every step hashes its state (see onStepHash).
+		void setDeterministic(bool deterministic);
+
+		//---------- Callbacks ----------//
+		// Called after each step in deterministic mode with the step number and the state hash
+		std::function<void(uint64_t step, uint64_t hash)> onStepHash;
 
 		//------- Static helpers ------//
 		static glm::vec3 getMouseClickRay(int x, int y, int width, int height, glm::vec3 camPos, glm::vec3 camForward, glm::vec3 camUp);
 	private:
+		// Forward bodies added/removed from the store to the broadphase
+		// and wake the islands of the bodies that were touched by the user
+		void syncBroadphase();
+		// Wake the sleeping bodies touched by an awake body
+		void wakeContacts();
+		// Exact test of a broadphase candidate, returns the new maxT of the ray
+		float traceShape(BodyStore::BodyId id, glm::vec3 origin, glm::vec3 direction, float maxT, RayResult& result) const;
+		// Link pairs of the articulation that do not collide
+		void setLinkPairsIgnored(Articulation* articulation, bool ignored);
+		// Give each articulation the manifolds of its links
+		void collectArticulationManifolds();
+		// Move the fast CCD bodies back to their first impact in the step
+		void solveContinuousCollisions();
+		// Broadphase pairs, sorted by id in deterministic mode
+		const std::vector<Broadphase::Pair>& getOrderedPairs();
+
 		std::vector<ObjectPhysics*> _objectsPhysics;
+		BodyStore* _bodyStore;
+		Broadphase* _broadphase;
+		Narrowphase* _narrowphase;
+		ContactSolver* _contactSolver;
+		IslandManager* _islandManager;
+		ThreadPool* _threadPool;
+		std::vector<Constraint*> _constraints;
+		std::vector<Articulation*> _articulations;
+		std::unordered_map<BodyStore::BodyId, Articulation*> _linkArticulations;
+		std::vector<Broadphase::Pair> _jointPairs;
+		// Normalized rays of the last batch
+		std::vector<glm::vec3> _rayOrigins;
+		std::vector<glm::vec3> _rayDirections;
+		std::vector<float> _rayMaxT;
+		float _fixedTimeStep;
+		int _maxSubsteps;
+		float _accumulator;
+		int _substepCount;
+		float _droppedTime;
+		bool _deterministic;
+		uint64_t _stepCount;
+		uint64_t _stateHash;
+		uint64_t _revision;
+		std::vector<Broadphase::Pair> _sortedPairs;
 		ForceGenerator* _forceGenerator;
+		JointMotors* _jointMotors;
 
 };
 
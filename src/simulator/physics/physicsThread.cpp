@@ -0,0 +1,108 @@
+//--------------------------------------------------
+// Robot Simulator
+// physicsThread.cpp
+// Date: 2020-11-30
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#include "physicsThread.h"
+#include <chrono>
+#include <algorithm>
+
+PhysicsThread::PhysicsThread(PhysicsEngine* engine):
+	_engine(engine), _running(false), _droppedSteps(0), _time(0.0)
+{
+
+}
+
+PhysicsThread::~PhysicsThread()
+{
+	stop();
+}
+
+void PhysicsThread::start()
+{
+	if(_running.load() || _engine == nullptr)
+		return;
+
+	// The reader has a complete snapshot before the first step
+	publish();
+	_running.store(true);
+	_thread = std::thread(&PhysicsThread::loop, this);
+}
+
+void PhysicsThread::stop()
+{
+	_running.store(false);
+	if(_thread.joinable())
+		_thread.join();
+
+	// Commands posted after the last step run on the caller thread
+	runCommands();
+}
+
+void PhysicsThread::post(std::function<void()> command)
+{
+	std::lock_guard<std::mutex> lock(_commandMutex);
+	_pendingCommands.push_back(std::move(command));
+}
+
+void PhysicsThread::loop()
+{
+	typedef std::chrono::steady_clock Clock;
+	const float dt = _engine->getFixedTimeStep();
+	const Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(dt));
+	// Behind by more than maxSubsteps steps the thread gives up catching up
+	const Clock::duration maxDelay = period*std::max(_engine->getMaxSubsteps(), 1);
+	Clock::time_point next = Clock::now();
+
+	while(_running.load(std::memory_order_relaxed))
+	{
+		runCommands();
+		if(onPreStep)
+			onPreStep(dt);
+		_engine->stepPhysics(dt);
+		_time += dt;
+		if(onPostStep)
+			onPostStep(dt);
+		publish();
+
+		// Fixed rate in wall clock time
+		next += period;
+		const Clock::time_point now = Clock::now();
+		if(now - next > maxDelay)
+		{
+			_droppedSteps.fetch_add((now - next)/period, std::memory_order_relaxed);
+			next = now;
+		}
+		std::this_thread::sleep_until(next);
+	}
+}
+
+void PhysicsThread::runCommands()
+{
+	{
+		std::lock_guard<std::mutex> lock(_commandMutex);
+		_commands.swap(_pendingCommands);
+	}
+	for(auto& command : _commands)
+		command();
+	_commands.clear();
+}
+
+void PhysicsThread::publish()
+{
+	const BodyStore* store = _engine->getBodyStore();
+	PhysicsSnapshot& snapshot = _snapshots.getWriteBuffer();
+	snapshot.step = _engine->getStepCount();
+	snapshot.time = _time;
+	snapshot.transforms.assign(store->getIdCapacity(), glm::mat4(1.0f));
+
+	const uint32_t n = store->size();
+	for(uint32_t i=0; i<n; i++)
+	{
+		glm::mat4 transform = glm::mat4_cast(store->getOrientationByIndex(i));
+		transform[3] = glm::vec4(store->getPositionByIndex(i), 1.0f);
+		snapshot.transforms[store->getId(i)] = transform;
+	}
+	_snapshots.publish();
+}
@@ -0,0 +1,80 @@
+//--------------------------------------------------
+// Robot Simulator
+// physicsThread.h
+// Date: 2020-11-30
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef PHYSICS_THREAD_H
+#define PHYSICS_THREAD_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include "glm.h"
+#include "physicsEngine.h"
+#include "simulator/helpers/tripleBuffer.h"
+
+// Body poses after a step, published by the physics thread
+struct PhysicsSnapshot
+{
+	uint64_t step = 0;
+	// Simulation time (seconds)
+	double time = 0.0;
+	// World transform of each body, by id (identity for unused ids)
+	std::vector<glm::mat4> transforms;
+};
+
+// Runs the physics engine (and the robot controllers, through the callbacks)
+// on its own thread at the fixed timestep, paced by the wall clock. The state
+// after each step is published in a triple buffer, so the render thread reads
+// the latest complete snapshot without locks and a slow frame never delays the
+// simulation.
+//
+// While running, the engine and the bodies belong to the physics thread: the
+// other threads only read snapshots and post commands.
+class PhysicsThread
+{
+	public:
+		PhysicsThread(PhysicsEngine* engine);
+		~PhysicsThread();
+
+		void start();
+		// Waits for the current step to finish
+		void stop();
+		// Run on the physics thread before the next step (thread safe)
+		void post(std::function<void()> command);
+		// Latest snapshot (only called by one reader thread)
+		const PhysicsSnapshot& getSnapshot() { return _snapshots.read(); }
+
+		//---------- Getters ----------//
+		bool isRunning() const { return _running.load(); }
+		PhysicsEngine* getPhysicsEngine() const { return _engine; }
+		// Steps skipped because the physics thread could not keep up with the wall clock
+		uint64_t getDroppedSteps() const { return _droppedSteps.load(); }
+
+		//---------- Callbacks ----------//
+		// Called on the physics thread before and after each step (controllers, sensors)
+		std::function<void(float dt)> onPreStep;
+		std::function<void(float dt)> onPostStep;
+
+	private:
+		void loop();
+		void runCommands();
+		void publish();
+
+		PhysicsEngine* _engine;
+		std::thread _thread;
+		std::atomic<bool> _running;
+		std::atomic<uint64_t> _droppedSteps;
+		double _time;
+
+		std::mutex _commandMutex;
+		std::vector<std::function<void()>> _commands;
+		std::vector<std::function<void()>> _pendingCommands;
+
+		TripleBuffer<PhysicsSnapshot> _snapshots;
+};
+
+#endif// PHYSICS_THREAD_H
@@ -0,0 +1,604 @@
+//--------------------------------------------------
+// Robot Simulator
+// contactSolver.cpp
+// Date: 2020-11-15
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#include "contactSolver.h"
+#include <cmath>
+#include <algorithm>
+
+ContactSolver::ContactSolver(BodyStore* bodyStore):
+	_bodyStore(bodyStore), _iterations(10), _positionIterations(4), _tolerance(0.0f),
+	_warmStarting(true), _positionCorrection(PositionCorrection::SPLIT_IMPULSE),
+	_baumgarte(0.2f), _linearSlop(0.005f), _restitutionThreshold(1.0f),
+	_threadPool(nullptr), _coloringThreshold(256), _deterministic(false)
+{
+}
+
+ContactSolver::~ContactSolver()
+{
+}
+
+void ContactSolver::solveVelocities(const std::vector<ContactManifold>& manifolds, float dt, const IslandManager* islandManager)
+{
+	_residuals.clear();
+	_constraints.clear();
+	_smallIslands.clear();
+	_largeIslands.clear();
+	_batches.clear();
+	if(manifolds.empty() || dt <= 0)
+	{
+		_cache.clear();
+		return;
+	}
+
+	// Gather the velocities of the bodies in contact only
+	const float* velX = _bodyStore->getVelocityX();
+	const float* velY = _bodyStore->getVelocityY();
+	const float* velZ = _bodyStore->getVelocityZ();
+	const float* angVelX = _bodyStore->getAngularVelocityX();
+	const float* angVelY = _bodyStore->getAngularVelocityY();
+	const float* angVelZ = _bodyStore->getAngularVelocityZ();
+	_velocities.resize(_bodyStore->size());
+	_angularVelocities.resize(_bodyStore->size());
+	for(const auto& manifold : manifolds)
+	{
+		const uint32_t indices[2] = {_bodyStore->getIndex(manifold.a), _bodyStore->getIndex(manifold.b)};
+		for(uint32_t index : indices)
+		{
+			_velocities[index] = {velX[index], velY[index], velZ[index]};
+			_angularVelocities[index] = {angVelX[index], angVelY[index], angVelZ[index]};
+		}
+	}
+
+	// Constraints are created in island order, the cache is only read here
+	buildIslands(manifolds, islandManager);
+	_constraints.resize(_manifoldOrder.size());
+	auto prepareRange = [&](uint32_t begin, uint32_t end)
+	{
+		for(uint32_t i=begin; i<end; i++)
+			prepareConstraint(manifolds[_manifoldOrder[i]], _constraints[i], dt);
+	};
+	if(_threadPool != nullptr)
+		_threadPool->parallelFor((uint32_t)_constraints.size(), 64, prepareRange);
+	else
+		prepareRange(0, (uint32_t)_constraints.size());
+
+	for(auto& island : _largeIslands)
+		colorIsland(island);
+
+	// Small islands, each one is solved by a single thread
+	_islandResiduals.assign(_smallIslands.size()*_iterations, 0.0f);
+	_islandIterations.assign(_smallIslands.size(), 0);
+	auto solveSmallIslands = [&](uint32_t begin, uint32_t end)
+	{
+		for(uint32_t i=begin; i<end; i++)
+		{
+			const Range& island = _smallIslands[i];
+			if(_warmStarting)
+				for(uint32_t c=island.start; c<island.start+island.count; c++)
+					warmStartConstraint(_constraints[c]);
+
+			for(int it=0; it<_iterations; it++)
+			{
+				float residual = 0.0f;
+				for(uint32_t c=island.start; c<island.start+island.count; c++)
+					residual = glm::max(residual, solveConstraint(_constraints[c]));
+				_islandResiduals[i*_iterations + it] = residual;
+				_islandIterations[i] = it+1;
+				if(residual < _tolerance)
+					break;
+			}
+		}
+	};
+	if(_threadPool != nullptr)
+		_threadPool->parallelFor((uint32_t)_smallIslands.size(), 4, solveSmallIslands);
+	else
+		solveSmallIslands(0, (uint32_t)_smallIslands.size());
+
+	// Largest residual of each iteration over the islands that were still iterating
+	for(uint32_t i=0; i<_smallIslands.size(); i++)
+	{
+		if(_residuals.size() < (size_t)_islandIterations[i])
+			_residuals.resize(_islandIterations[i], 0.0f);
+		for(int it=0; it<_islandIterations[i]; it++)
+			_residuals[it] = glm::max(_residuals[it], _islandResiduals[i*_iterations + it]);
+	}
+
+	// Large islands, the constraints of each color are solved in parallel
+	for(const auto& island : _largeIslands)
+	{
+		if(_warmStarting)
+		{
+			for(uint32_t b=0; b<island.batchCount; b++)
+			{
+				const bool parallel = !(island.overflow && b == island.batchCount-1);
+				forEachInBatch(_batches[island.batchStart+b], parallel, [this](Constraint& c){ warmStartConstraint(c); });
+			}
+		}
+
+		for(int it=0; it<_iterations; it++)
+		{
+			std::atomic<float> residual(0.0f);
+			for(uint32_t b=0; b<island.batchCount; b++)
+			{
+				const bool parallel = !(island.overflow && b == island.batchCount-1);
+				forEachInBatch(_batches[island.batchStart+b], parallel, [this, &residual](Constraint& c)
+				{
+					atomicMax(residual, solveConstraint(c));
+				});
+			}
+
+			if(_residuals.size() <= (size_t)it)
+				_residuals.push_back(0.0f);
+			_residuals[it] = glm::max(_residuals[it], residual.load());
+			if(residual.load() < _tolerance)
+				break;
+		}
+	}
+
+	storeImpulses();
+
+	// Scatter velocities of the bodies that were solved
+	const float* inverseMass = _bodyStore->getInverseMasses();
+	for(const auto& c : _constraints)
+	{
+		const uint32_t indices[2] = {c.indexA, c.indexB};
+		for(uint32_t index : indices)
+		{
+			if(inverseMass[index] <= 0)
+				continue;
+			_bodyStore->setVelocityByIndex(index, _velocities[index]);
+			_bodyStore->setAngularVelocityByIndex(index, _angularVelocities[index]);
+		}
+	}
+}
+
+void ContactSolver::buildIslands(const std::vector<ContactManifold>& manifolds, const IslandManager* islandManager)
+{
+	// The colored order does not depend on the threads, so it is also used by the deterministic mode
+	const bool coloring = _threadPool != nullptr && (_deterministic || _threadPool->getThreadCount() > 1);
+	auto addIsland = [this, coloring](Range range)
+	{
+		if(range.count == 0)
+			return;
+		if(coloring && range.count >= _coloringThreshold)
+			_largeIslands.push_back({range, 0, 0, false});
+		else
+			_smallIslands.push_back(range);
+	};
+
+	if(islandManager == nullptr)
+	{
+		_manifoldOrder.resize(manifolds.size());
+		for(uint32_t i=0; i<manifolds.size(); i++)
+			_manifoldOrder[i] = i;
+		addIsland({0, (uint32_t)manifolds.size()});
+		return;
+	}
+
+	_manifoldOrder = islandManager->getIslandManifolds();
+	for(const auto& island : islandManager->getIslands())
+		addIsland({island.manifoldStart, island.manifoldCount});
+}
+
+void ContactSolver::colorIsland(LargeIsland& island)
+{
+	// Greedy coloring, each body keeps a mask of the colors of its constraints.
+	// Static bodies are never written by the solver, so they do not need colors.
+	const uint32_t colorCount = 64;
+	const float* inverseMass = _bodyStore->getInverseMasses();
+	_colorMasks.resize(_bodyStore->size());
+	_colors.resize(island.constraints.count);
+	for(uint32_t i=0; i<island.constraints.count; i++)
+	{
+		const Constraint& c = _constraints[island.constraints.start+i];
+		_colorMasks[c.indexA] = 0;
+		_colorMasks[c.indexB] = 0;
+	}
+
+	uint32_t counts[colorCount+1] = {0};
+	for(uint32_t i=0; i<island.constraints.count; i++)
+	{
+		const Constraint& c = _constraints[island.constraints.start+i];
+		const bool dynamicA = inverseMass[c.indexA] > 0;
+		const bool dynamicB = inverseMass[c.indexB] > 0;
+		const uint64_t used = (dynamicA ? _colorMasks[c.indexA] : 0) | (dynamicB ? _colorMasks[c.indexB] : 0);
+
+		// Constraints of bodies with every color used go to the serial overflow batch
+		uint32_t color = colorCount;
+		if(~used != 0)
+		{
+			color = __builtin_ctzll(~used);
+			if(dynamicA)
+				_colorMasks[c.indexA] |= 1ull<<color;
+			if(dynamicB)
+				_colorMasks[c.indexB] |= 1ull<<color;
+		}
+		_colors[i] = (uint8_t)color;
+		counts[color]++;
+	}
+
+	// Counting sort of the constraints by color
+	uint32_t offsets[colorCount+1];
+	uint32_t offset = 0;
+	island.batchStart = (uint32_t)_batches.size();
+	for(uint32_t color=0; color<=colorCount; color++)
+	{
+		offsets[color] = offset;
+		if(counts[color] > 0)
+			_batches.push_back({island.constraints.start+offset, counts[color]});
+		offset += counts[color];
+	}
+	island.batchCount = (uint32_t)_batches.size() - island.batchStart;
+	island.overflow = counts[colorCount] > 0;
+
+	_sortedConstraints.resize(island.constraints.count);
+	for(uint32_t i=0; i<island.constraints.count; i++)
+		_sortedConstraints[offsets[_colors[i]]++] = _constraints[island.constraints.start+i];
+	std::copy(_sortedConstraints.begin(), _sortedConstraints.end(), _constraints.begin()+island.constraints.start);
+}
+
+void ContactSolver::forEachInBatch(const Range& batch, bool parallel, const std::function<void(Constraint&)>& function)
+{
+	auto run = [&](uint32_t begin, uint32_t end)
+	{
+		for(uint32_t i=batch.start+begin; i<batch.start+end; i++)
+			function(_constraints[i]);
+	};
+	if(parallel && _threadPool != nullptr)
+		_threadPool->parallelFor(batch.count, 32, run);
+	else
+		run(0, batch.count);
+}
+
+void ContactSolver::prepareConstraint(const ContactManifold& manifold, Constraint& c, float dt)
+{
+	const float* inverseMass = _bodyStore->getInverseMasses();
+	const float* friction = _bodyStore->getFrictions();
+	const float* restitution = _bodyStore->getRestitutions();
+
+	c.indexA = _bodyStore->getIndex(manifold.a);
+	c.indexB = _bodyStore->getIndex(manifold.b);
+	const uint8_t* articulated = _bodyStore->getArticulatedFlags();
+	if(articulated[c.indexA] || articulated[c.indexB])
+	{
+		// Empty constraint, only the body indices are used
+		c.invMassA = c.invMassB = 0.0f;
+		c.pointCount = 0;
+		c.key = pairKey(manifold.a, manifold.b);
+		return;
+	}
+	c.invMassA = inverseMass[c.indexA];
+	c.invMassB = inverseMass[c.indexB];
+	c.invInertiaA = _bodyStore->getInverseInertiaWorldByIndex(c.indexA);
+	c.invInertiaB = _bodyStore->getInverseInertiaWorldByIndex(c.indexB);
+	c.normal = manifold.normal;
+	c.friction = std::sqrt(friction[c.indexA]*friction[c.indexB]);
+	c.pointCount = manifold.pointCount;
+	c.key = pairKey(manifold.a, manifold.b);
+
+	const glm::vec3 positionA = _bodyStore->getPosition(manifold.a);
+	const glm::vec3 positionB = _bodyStore->getPosition(manifold.b);
+	const glm::vec3 vA = _velocities[c.indexA];
+	const glm::vec3 vB = _velocities[c.indexB];
+	const glm::vec3 wA = _angularVelocities[c.indexA];
+	const glm::vec3 wB = _angularVelocities[c.indexB];
+	for(int p=0; p<c.pointCount; p++)
+	{
+		c.points[p].rA = manifold.points[p].position - positionA;
+		c.points[p].rB = manifold.points[p].position - positionB;
+	}
+
+	// Friction directions, the first one follows the sliding velocity at the first point
+	const glm::vec3 dv = vB + glm::cross(wB, c.points[0].rB) - vA - glm::cross(wA, c.points[0].rA);
+	const glm::vec3 vt = dv - c.normal*glm::dot(dv, c.normal);
+	const float vtLength = glm::length(vt);
+	if(vtLength > 1e-3f)
+		c.tangent[0] = vt/vtLength;
+	else
+		c.tangent[0] = glm::normalize(glm::abs(c.normal.x) < 0.57f ?
+				glm::cross(c.normal, glm::vec3(1,0,0)) : glm::cross(c.normal, glm::vec3(0,1,0)));
+	c.tangent[1] = glm::cross(c.normal, c.tangent[0]);
+
+	const float e = glm::max(restitution[c.indexA], restitution[c.indexB]);
+	const CachedManifold* cached = nullptr;
+	if(_warmStarting)
+	{
+		auto it = _cache.find(c.key);
+		if(it != _cache.end())
+			cached = &it->second;
+	}
+
+	for(int p=0; p<c.pointCount; p++)
+	{
+		ConstraintPoint& point = c.points[p];
+		point.featureId = manifold.points[p].featureId;
+		point.penetration = manifold.points[p].penetration;
+		point.normalMass = effectiveMass(c, point, c.normal);
+		point.tangentMass[0] = effectiveMass(c, point, c.tangent[0]);
+		point.tangentMass[1] = effectiveMass(c, point, c.tangent[1]);
+		point.normalImpulse = 0;
+		point.tangentImpulse[0] = 0;
+		point.tangentImpulse[1] = 0;
+		point.positionImpulse = 0;
+
+		// Restitution only for impacts, resting contacts would jitter
+		const float vn = glm::dot(vB + glm::cross(wB, point.rB) - vA - glm::cross(wA, point.rA), c.normal);
+		point.velocityBias = vn < -_restitutionThreshold ? -e*vn : 0.0f;
+		if(_positionCorrection == PositionCorrection::BAUMGARTE)
+			point.velocityBias = glm::max(point.velocityBias, _baumgarte/dt*glm::max(point.penetration-_linearSlop, 0.0f));
+
+		if(cached != nullptr)
+		{
+			for(int k=0; k<cached->pointCount; k++)
+			{
+				if(cached->points[k].featureId == point.featureId)
+				{
+					point.normalImpulse = cached->points[k].normalImpulse;
+					point.tangentImpulse[0] = glm::dot(cached->points[k].tangentImpulse, c.tangent[0]);
+					point.tangentImpulse[1] = glm::dot(cached->points[k].tangentImpulse, c.tangent[1]);
+					break;
+				}
+			}
+		}
+	}
+}
+
+float ContactSolver::effectiveMass(const Constraint& c, const ConstraintPoint& point, glm::vec3 direction)
+{
+	const glm::vec3 rnA = glm::cross(point.rA, direction);
+	const glm::vec3 rnB = glm::cross(point.rB, direction);
+	const float k = c.invMassA + c.invMassB + glm::dot(rnA, c.invInertiaA*rnA) + glm::dot(rnB, c.invInertiaB*rnB);
+	return k > 0 ? 1.0f/k : 0.0f;
+}
+
+void ContactSolver::warmStartConstraint(const Constraint& c)
+{
+	glm::vec3 vA = _velocities[c.indexA];
+	glm::vec3 vB = _velocities[c.indexB];
+	glm::vec3 wA = _angularVelocities[c.indexA];
+	glm::vec3 wB = _angularVelocities[c.indexB];
+	for(int p=0; p<c.pointCount; p++)
+	{
+		const ConstraintPoint& point = c.points[p];
+		const glm::vec3 impulse = c.normal*point.normalImpulse + c.tangent[0]*point.tangentImpulse[0] + c.tangent[1]*point.tangentImpulse[1];
+		vA -= impulse*c.invMassA;
+		wA -= c.invInertiaA*glm::cross(point.rA, impulse);
+		vB += impulse*c.invMassB;
+		wB += c.invInertiaB*glm::cross(point.rB, impulse);
+	}
+
+	// Static bodies are shared between islands, they are never written
+	if(c.invMassA > 0)
+	{
+		_velocities[c.indexA] = vA;
+		_angularVelocities[c.indexA] = wA;
+	}
+	if(c.invMassB > 0)
+	{
+		_velocities[c.indexB] = vB;
+		_angularVelocities[c.indexB] = wB;
+	}
+}
+
+float ContactSolver::solveConstraint(Constraint& c)
+{
+	float residual = 0.0f;
+	glm::vec3 vA = _velocities[c.indexA];
+	glm::vec3 vB = _velocities[c.indexB];
+	glm::vec3 wA = _angularVelocities[c.indexA];
+	glm::vec3 wB = _angularVelocities[c.indexB];
+
+	// Friction first, the non-penetration is more important and is solved last
+	for(int p=0; p<c.pointCount; p++)
+	{
+		ConstraintPoint& point = c.points[p];
+		const glm::vec3 dv = vB + glm::cross(wB, point.rB) - vA - glm::cross(wA, point.rA);
+		const float lambda0 = -point.tangentMass[0]*glm::dot(dv, c.tangent[0]);
+		const float lambda1 = -point.tangentMass[1]*glm::dot(dv, c.tangent[1]);
+
+		// Project the accumulated impulse onto the friction cone
+		const float maxFriction = c.friction*point.normalImpulse;
+		float new0 = point.tangentImpulse[0] + lambda0;
+		float new1 = point.tangentImpulse[1] + lambda1;
+		const float length2 = new0*new0 + new1*new1;
+		if(length2 > maxFriction*maxFriction)
+		{
+			const float scale = length2 > 0 ? maxFriction/std::sqrt(length2) : 0.0f;
+			new0 *= scale;
+			new1 *= scale;
+		}
+		const float delta0 = new0 - point.tangentImpulse[0];
+		const float delta1 = new1 - point.tangentImpulse[1];
+		point.tangentImpulse[0] = new0;
+		point.tangentImpulse[1] = new1;
+
+		const glm::vec3 impulse = c.tangent[0]*delta0 + c.tangent[1]*delta1;
+		vA -= impulse*c.invMassA;
+		wA -= c.invInertiaA*glm::cross(point.rA, impulse);
+		vB += impulse*c.invMassB;
+		wB += c.invInertiaB*glm::cross(point.rB, impulse);
+		residual = glm::max(residual, glm::max(glm::abs(delta0), glm::abs(delta1)));
+	}
+
+	for(int p=0; p<c.pointCount; p++)
+	{
+		ConstraintPoint& point = c.points[p];
+		const float vn = glm::dot(vB + glm::cross(wB, point.rB) - vA - glm::cross(wA, point.rA), c.normal);
+		const float lambda = -point.normalMass*(vn - point.velocityBias);
+		const float newImpulse = glm::max(point.normalImpulse + lambda, 0.0f);
+		const float delta = newImpulse - point.normalImpulse;
+		point.normalImpulse = newImpulse;
+
+		const glm::vec3 impulse = c.normal*delta;
+		vA -= impulse*c.invMassA;
+		wA -= c.invInertiaA*glm::cross(point.rA, impulse);
+		vB += impulse*c.invMassB;
+		wB += c.invInertiaB*glm::cross(point.rB, impulse);
+		residual = glm::max(residual, glm::abs(delta));
+	}
+
+	if(c.invMassA > 0)
+	{
+		_velocities[c.indexA] = vA;
+		_angularVelocities[c.indexA] = wA;
+	}
+	if(c.invMassB > 0)
+	{
+		_velocities[c.indexB] = vB;
+		_angularVelocities[c.indexB] = wB;
+	}
+	return residual;
+}
+
+void ContactSolver::storeImpulses()
+{
+	// Cached manifolds that stopped touching are dropped
+	_cache.clear();
+	for(const auto& c : _constraints)
+	{
+		CachedManifold& cached = _cache[c.key];
+		cached.pointCount = c.pointCount;
+		for(int p=0; p<c.pointCount; p++)
+		{
+			const ConstraintPoint& point = c.points[p];
+			cached.points[p].featureId = point.featureId;
+			cached.points[p].normalImpulse = point.normalImpulse;
+			cached.points[p].tangentImpulse = c.tangent[0]*point.tangentImpulse[0] + c.tangent[1]*point.tangentImpulse[1];
+		}
+	}
+}
+
+void ContactSolver::solvePositions(float dt)
+{
+	if(_positionCorrection != PositionCorrection::SPLIT_IMPULSE || _constraints.empty() || dt <= 0)
+		return;
+
+	// Pseudo velocities only exist during this solve, they move the
+	// bodies out of penetration without adding kinetic energy
+	_pseudoVelocities.resize(_bodyStore->size());
+	_pseudoAngularVelocities.resize(_bodyStore->size());
+	for(const auto& c : _constraints)
+	{
+		_pseudoVelocities[c.indexA] = glm::vec3(0);
+		_pseudoVelocities[c.indexB] = glm::vec3(0);
+		_pseudoAngularVelocities[c.indexA] = glm::vec3(0);
+		_pseudoAngularVelocities[c.indexB] = glm::vec3(0);
+	}
+
+	auto solveSmallIslands = [&](uint32_t begin, uint32_t end)
+	{
+		for(uint32_t i=begin; i<end; i++)
+		{
+			const Range& island = _smallIslands[i];
+			for(int it=0; it<_positionIterations; it++)
+				for(uint32_t c=island.start; c<island.start+island.count; c++)
+					solvePositionConstraint(_constraints[c], dt);
+		}
+	};
+	if(_threadPool != nullptr)
+		_threadPool->parallelFor((uint32_t)_smallIslands.size(), 4, solveSmallIslands);
+	else
+		solveSmallIslands(0, (uint32_t)_smallIslands.size());
+
+	for(const auto& island : _largeIslands)
+	{
+		for(int it=0; it<_positionIterations; it++)
+		{
+			for(uint32_t b=0; b<island.batchCount; b++)
+			{
+				const bool parallel = !(island.overflow && b == island.batchCount-1);
+				forEachInBatch(_batches[island.batchStart+b], parallel, [this, dt](Constraint& c){ solvePositionConstraint(c, dt); });
+			}
+		}
+	}
+
+	// Each body is moved once, even if it is in many constraints
+	const float* inverseMass = _bodyStore->getInverseMasses();
+	for(const auto& c : _constraints)
+	{
+		const uint32_t indices[2] = {c.indexA, c.indexB};
+		for(uint32_t index : indices)
+		{
+			if(inverseMass[index] <= 0 || (_pseudoVelocities[index] == glm::vec3(0) && _pseudoAngularVelocities[index] == glm::vec3(0)))
+				continue;
+			const BodyStore::BodyId id = _bodyStore->getId(index);
+			_bodyStore->setPositionByIndex(index, _bodyStore->getPosition(id) + _pseudoVelocities[index]*dt);
+			const glm::vec3 w = _pseudoAngularVelocities[index];
+			if(w != glm::vec3(0))
+			{
+				const glm::quat q = _bodyStore->getOrientationByIndex(index);
+				_bodyStore->setOrientationByIndex(index, glm::normalize(q + glm::quat(0, w*(0.5f*dt))*q));
+			}
+			_pseudoVelocities[index] = glm::vec3(0);
+			_pseudoAngularVelocities[index] = glm::vec3(0);
+		}
+	}
+}
+
+void ContactSolver::solvePositionConstraint(Constraint& c, float dt)
+{
+	glm::vec3 vA = _pseudoVelocities[c.indexA];
+	glm::vec3 vB = _pseudoVelocities[c.indexB];
+	glm::vec3 wA = _pseudoAngularVelocities[c.indexA];
+	glm::vec3 wB = _pseudoAngularVelocities[c.indexB];
+	for(int p=0; p<c.pointCount; p++)
+	{
+		ConstraintPoint& point = c.points[p];
+		const float bias = _baumgarte/dt*glm::max(point.penetration-_linearSlop, 0.0f);
+		const float vn = glm::dot(vB + glm::cross(wB, point.rB) - vA - glm::cross(wA, point.rA), c.normal);
+		const float lambda = -point.normalMass*(vn - bias);
+		const float newImpulse = glm::max(point.positionImpulse + lambda, 0.0f);
+		const glm::vec3 impulse = c.normal*(newImpulse - point.positionImpulse);
+		point.positionImpulse = newImpulse;
+
+		vA -= impulse*c.invMassA;
+		wA -= c.invInertiaA*glm::cross(point.rA, impulse);
+		vB += impulse*c.invMassB;
+		wB += c.invInertiaB*glm::cross(point.rB, impulse);
+	}
+
+	if(c.invMassA > 0)
+	{
+		_pseudoVelocities[c.indexA] = vA;
+		_pseudoAngularVelocities[c.indexA] = wA;
+	}
+	if(c.invMassB > 0)
+	{
+		_pseudoVelocities[c.indexB] = vB;
+		_pseudoAngularVelocities[c.indexB] = wB;
+	}
+}
+
+void ContactSolver::atomicMax(std::atomic<float>& value, float other)
+{
+	float current = value.load(std::memory_order_relaxed);
+	while(other > current && !value.compare_exchange_weak(current, other, std::memory_order_relaxed));
+}
+
+void ContactSolver::saveState(StateSnapshot& snapshot) const
+{
+	snapshot.write((uint64_t)_cache.size());
+	for(const auto& entry : _cache)
+	{
+		snapshot.write(entry.first);
+		snapshot.write(entry.second);
+	}
+}
+
+void ContactSolver::restoreState(StateSnapshot::Reader& reader)
+{
+	uint64_t count = 0;
+	reader.read(count);
+	_cache.clear();
+	for(uint64_t i=0; i<count; i++)
+	{
+		uint64_t key = 0;
+		CachedManifold cached;
+		reader.read(key);
+		reader.read(cached);
+		_cache[key] = cached;
+	}
+}
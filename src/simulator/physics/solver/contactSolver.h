@@ -0,0 +1,197 @@
+//--------------------------------------------------
+// Robot Simulator
+// contactSolver.h
+// Date: 2020-11-15
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef CONTACT_SOLVER_H
+#define CONTACT_SOLVER_H
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <atomic>
+#include "glm.h"
+#include "../bodyStore.h"
+#include "../stateSnapshot.h"
+#include "../colliders/contactManifold.h"
+#include "islandManager.h"
+#include "simulator/helpers/threadPool.h"
+
+// Sequential impulse (projected Gauss-Seidel) contact solver.
+// Accumulated impulses are clamped (normal >= 0, friction inside the cone)
+// and cached between steps to warm start the next solve.
+// Contacts of articulation links are skipped, the articulation solves them.
+// Islands do not share dynamic bodies, so they are solved in parallel when a
+// thread pool is set. Large islands are split into colors (batches of
+// constraints without common dynamic bodies) that are solved in parallel.
+class ContactSolver
+{
+	public:
+		enum class PositionCorrection
+		{
+			// Position error is fed back as a velocity bias (adds energy)
+			BAUMGARTE,
+			// Position error is solved with pseudo velocities that are discarded after the step
+			SPLIT_IMPULSE
+		};
+
+		ContactSolver(BodyStore* bodyStore);
+		~ContactSolver();
+
+		// Called after the velocities are integrated (without islands everything is solved as one island)
+		void solveVelocities(const std::vector<ContactManifold>& manifolds, float dt, const IslandManager* islandManager=nullptr);
+		// Called after the positions are integrated (only used by SPLIT_IMPULSE)
+		void solvePositions(float dt);
+		// Warm starting impulses of the last step
+		void saveState(StateSnapshot& snapshot) const;
+		void restoreState(StateSnapshot::Reader& reader);
+
+		//---------- Getters ----------//
+		int getIterations() const { return _iterations; }
+		int getPositionIterations() const { return _positionIterations; }
+		PositionCorrection getPositionCorrection() const { return _positionCorrection; }
+		float getBaumgarte() const { return _baumgarte; }
+		float getLinearSlop() const { return _linearSlop; }
+		float getRestitutionThreshold() const { return _restitutionThreshold; }
+		// Largest impulse change of each velocity iteration in the last step
+		const std::vector<float>& getResiduals() const { return _residuals; }
+		float getResidual() const { return _residuals.empty() ? 0.0f : _residuals.back(); }
+		size_t getConstraintCount() const { return _constraints.size(); }
+		// Number of colors of the islands split in the last step
+		size_t getBatchCount() const { return _batches.size(); }
+		ThreadPool* getThreadPool() const { return _threadPool; }
+		bool isDeterministic() const { return _deterministic; }
+
+		//---------- Setters ----------//
+		void setIterations(int iterations) { _iterations = iterations; }
+		void setPositionIterations(int iterations) { _positionIterations = iterations; }
+		// The iterations stop early when the residual is below the tolerance
+		void setTolerance(float tolerance) { _tolerance = tolerance; }
+		void setWarmStarting(bool warmStarting) { _warmStarting = warmStarting; }
+		void setPositionCorrection(PositionCorrection positionCorrection) { _positionCorrection = positionCorrection; }
+		void setBaumgarte(float baumgarte) { _baumgarte = baumgarte; }
+		void setLinearSlop(float linearSlop) { _linearSlop = linearSlop; }
+		void setRestitutionThreshold(float threshold) { _restitutionThreshold = threshold; }
+		// Not owned, nullptr solves on the calling thread
+		void setThreadPool(ThreadPool* threadPool) { _threadPool = threadPool; }
+		// Islands with at least this number of constraints are colored
+		void setColoringThreshold(uint32_t threshold) { _coloringThreshold = threshold; }
+		// Same solve order with any number of threads (the large islands are always colored)
+		void setDeterministic(bool deterministic) { _deterministic = deterministic; }
+
+	private:
+		struct ConstraintPoint
+		{
+			float normalImpulse;
+			float tangentImpulse[2];
+			float normalMass;
+			float tangentMass[2];
+			float velocityBias;
+			float penetration;
+			float positionImpulse;
+			uint32_t featureId;
+			// Contact point relative to the center of mass of each body
+			glm::vec3 rA;
+			glm::vec3 rB;
+		};
+
+		struct Constraint
+		{
+			uint32_t indexA;
+			uint32_t indexB;
+			float invMassA;
+			float invMassB;
+			// World space inverse inertia (zero for static bodies)
+			glm::mat3 invInertiaA;
+			glm::mat3 invInertiaB;
+			glm::vec3 normal;
+			glm::vec3 tangent[2];
+			float friction;
+			ConstraintPoint points[ContactManifold::MAX_POINTS];
+			int pointCount;
+			uint64_t key;
+		};
+
+		// Impulses of the previous step, matched by feature id
+		struct CachedPoint
+		{
+			uint32_t featureId;
+			float normalImpulse;
+			// World space so it survives a change in the tangent basis
+			glm::vec3 tangentImpulse;
+		};
+		struct CachedManifold
+		{
+			CachedPoint points[ContactManifold::MAX_POINTS];
+			int pointCount;
+		};
+
+		struct Range
+		{
+			uint32_t start;
+			uint32_t count;
+		};
+
+		struct LargeIsland
+		{
+			Range constraints;
+			// Range in _batches, the last batch may hold the constraints that did not fit in a color
+			uint32_t batchStart;
+			uint32_t batchCount;
+			bool overflow;
+		};
+
+		// Constraint ranges of the islands (constraints are sorted by island)
+		void buildIslands(const std::vector<ContactManifold>& manifolds, const IslandManager* islandManager);
+		// Sort the constraints of the island by color
+		void colorIsland(LargeIsland& island);
+		void prepareConstraint(const ContactManifold& manifold, Constraint& c, float dt);
+		void warmStartConstraint(const Constraint& c);
+		float solveConstraint(Constraint& c);
+		void solvePositionConstraint(Constraint& c, float dt);
+		// 1/(mA + mB + angular terms) of an impulse along the direction at the point
+		static float effectiveMass(const Constraint& c, const ConstraintPoint& point, glm::vec3 direction);
+		// Run the function over the batch, in parallel unless it is the overflow batch
+		void forEachInBatch(const Range& batch, bool parallel, const std::function<void(Constraint&)>& function);
+		void storeImpulses();
+
+		static uint64_t pairKey(BodyStore::BodyId a, BodyStore::BodyId b) { return ((uint64_t)a<<32)|b; }
+		static void atomicMax(std::atomic<float>& value, float other);
+
+		BodyStore* _bodyStore;
+		std::vector<Constraint> _constraints;
+		std::unordered_map<uint64_t, CachedManifold> _cache;
+		// Body velocities during the solve (dense index)
+		std::vector<glm::vec3> _velocities;
+		std::vector<glm::vec3> _angularVelocities;
+		std::vector<glm::vec3> _pseudoVelocities;
+		std::vector<glm::vec3> _pseudoAngularVelocities;
+		std::vector<float> _residuals;
+
+		std::vector<uint32_t> _manifoldOrder;
+		std::vector<Range> _smallIslands;
+		std::vector<LargeIsland> _largeIslands;
+		std::vector<Range> _batches;
+		// Coloring scratch
+		std::vector<uint64_t> _colorMasks;
+		std::vector<uint8_t> _colors;
+		std::vector<Constraint> _sortedConstraints;
+		// Residual of each iteration of the small islands
+		std::vector<float> _islandResiduals;
+		std::vector<int> _islandIterations;
+
+		int _iterations;
+		int _positionIterations;
+		float _tolerance;
+		bool _warmStarting;
+		PositionCorrection _positionCorrection;
+		float _baumgarte;
+		float _linearSlop;
+		float _restitutionThreshold;
+		ThreadPool* _threadPool;
+		uint32_t _coloringThreshold;
+		bool _deterministic;
+};
+
+#endif// CONTACT_SOLVER_H
@@ -0,0 +1,262 @@
+//--------------------------------------------------
+// Robot Simulator
+// islandManager.cpp
+// Date: 2020-11-18
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#include "islandManager.h"
+
+const uint32_t IslandManager::NO_ISLAND;
+
+IslandManager::IslandManager(BodyStore* bodyStore):
+	_bodyStore(bodyStore), _nextSleepingIsland(0),
+	_sleepingEnabled(true), _linearSleepThreshold(0.05f), _angularSleepThreshold(0.05f), _timeToSleep(0.5f)
+{
+}
+
+IslandManager::~IslandManager()
+{
+}
+
+uint32_t IslandManager::find(uint32_t i)
+{
+	// Path halving
+	while(_parent[i] != i)
+	{
+		_parent[i] = _parent[_parent[i]];
+		i = _parent[i];
+	}
+	return i;
+}
+
+void IslandManager::unite(uint32_t a, uint32_t b)
+{
+	a = find(a);
+	b = find(b);
+	if(a == b)
+		return;
+
+	// Union by rank
+	if(_rank[a] < _rank[b])
+		std::swap(a, b);
+	_parent[b] = a;
+	if(_rank[a] == _rank[b])
+		_rank[a]++;
+}
+
+void IslandManager::build(const std::vector<ContactManifold>& manifolds, const std::vector<Broadphase::Pair>& joints)
+{
+	const uint32_t n = _bodyStore->getActiveCount();
+	_parent.resize(n);
+	_rank.assign(n, 0);
+	for(uint32_t i=0; i<n; i++)
+		_parent[i] = i;
+
+	// Only awake bodies are joined, static bodies would merge everything on the ground
+	auto link = [this, n](BodyStore::BodyId a, BodyStore::BodyId b)
+	{
+		const uint32_t ia = _bodyStore->getIndex(a);
+		const uint32_t ib = _bodyStore->getIndex(b);
+		if(ia < n && ib < n)
+			unite(ia, ib);
+	};
+	for(const auto& manifold : manifolds)
+		link(manifold.a, manifold.b);
+	for(const auto& joint : joints)
+		link(joint.a, joint.b);
+
+	// Island of each root
+	_rootIsland.assign(n, NO_ISLAND);
+	_islands.clear();
+	for(uint32_t i=0; i<n; i++)
+	{
+		const uint32_t root = find(i);
+		if(_rootIsland[root] == NO_ISLAND)
+		{
+			_rootIsland[root] = (uint32_t)_islands.size();
+			_islands.push_back({0, 0, 0, 0});
+		}
+		_islands[_rootIsland[root]].bodyCount++;
+	}
+
+	// Manifold counts, a manifold belongs to the island of its awake body
+	auto manifoldIsland = [this, n](const ContactManifold& manifold)
+	{
+		uint32_t index = _bodyStore->getIndex(manifold.a);
+		if(index >= n)
+			index = _bodyStore->getIndex(manifold.b);
+		return index < n ? _rootIsland[find(index)] : NO_ISLAND;
+	};
+	for(const auto& manifold : manifolds)
+	{
+		const uint32_t island = manifoldIsland(manifold);
+		if(island != NO_ISLAND)
+			_islands[island].manifoldCount++;
+	}
+
+	// Offsets (counting sort)
+	uint32_t bodyOffset = 0;
+	uint32_t manifoldOffset = 0;
+	for(auto& island : _islands)
+	{
+		island.bodyStart = bodyOffset;
+		island.manifoldStart = manifoldOffset;
+		bodyOffset += island.bodyCount;
+		manifoldOffset += island.manifoldCount;
+		island.bodyCount = 0;
+		island.manifoldCount = 0;
+	}
+
+	_islandBodies.resize(bodyOffset);
+	for(uint32_t i=0; i<n; i++)
+	{
+		Island& island = _islands[_rootIsland[find(i)]];
+		_islandBodies[island.bodyStart + island.bodyCount++] = _bodyStore->getId(i);
+	}
+
+	_islandManifolds.resize(manifoldOffset);
+	for(uint32_t m=0; m<manifolds.size(); m++)
+	{
+		const uint32_t islandIndex = manifoldIsland(manifolds[m]);
+		if(islandIndex == NO_ISLAND)
+			continue;
+		Island& island = _islands[islandIndex];
+		_islandManifolds[island.manifoldStart + island.manifoldCount++] = m;
+	}
+}
+
+void IslandManager::updateSleep(float dt)
+{
+	if(!_sleepingEnabled)
+		return;
+
+	const float linearThreshold2 = _linearSleepThreshold*_linearSleepThreshold;
+	const float angularThreshold2 = _angularSleepThreshold*_angularSleepThreshold;
+	std::vector<uint32_t> restingIslands;
+	for(uint32_t i=0; i<_islands.size(); i++)
+	{
+		const Island& island = _islands[i];
+		float minRestTime = _timeToSleep;
+		for(uint32_t b=0; b<island.bodyCount; b++)
+		{
+			const BodyStore::BodyId id = _islandBodies[island.bodyStart + b];
+			ensureBodyCapacity(id);
+
+			const glm::vec3 velocity = _bodyStore->getVelocity(id);
+			const glm::vec3 angularVelocity = _bodyStore->getAngularVelocity(id);
+			if(glm::dot(velocity, velocity) > linearThreshold2 || glm::dot(angularVelocity, angularVelocity) > angularThreshold2)
+				_restTime[id] = 0;
+			else
+				_restTime[id] += dt;
+			minRestTime = glm::min(minRestTime, _restTime[id]);
+		}
+
+		if(minRestTime >= _timeToSleep)
+			restingIslands.push_back(i);
+	}
+
+	// Sleeping changes the dense indices, so it is done after reading the islands
+	for(uint32_t i : restingIslands)
+	{
+		const Island& island = _islands[i];
+		const uint32_t key = _nextSleepingIsland++;
+		std::vector<BodyStore::BodyId>& members = _sleepingIslands[key];
+		members.assign(_islandBodies.begin()+island.bodyStart, _islandBodies.begin()+island.bodyStart+island.bodyCount);
+		for(auto id : members)
+		{
+			_sleepingIsland[id] = key;
+			_bodyStore->sleep(id);
+		}
+	}
+}
+
+void IslandManager::wakeIsland(BodyStore::BodyId id)
+{
+	if(!_bodyStore->isValid(id) || _bodyStore->isAwake(id) || _bodyStore->getInverseMass(id) <= 0)
+		return;
+
+	ensureBodyCapacity(id);
+	const uint32_t key = _sleepingIsland[id];
+	if(key == NO_ISLAND)
+	{
+		_bodyStore->wake(id);
+		_restTime[id] = 0;
+		return;
+	}
+
+	auto it = _sleepingIslands.find(key);
+	for(auto member : it->second)
+	{
+		// Removed bodies (or reused ids) are no longer in the island
+		if(!_bodyStore->isValid(member) || _sleepingIsland[member] != key)
+			continue;
+		_bodyStore->wake(member);
+		_sleepingIsland[member] = NO_ISLAND;
+		_restTime[member] = 0;
+	}
+	_sleepingIslands.erase(it);
+}
+
+void IslandManager::removeBody(BodyStore::BodyId id)
+{
+	ensureBodyCapacity(id);
+	_sleepingIsland[id] = NO_ISLAND;
+	_restTime[id] = 0;
+}
+
+void IslandManager::setSleepingEnabled(bool sleepingEnabled)
+{
+	_sleepingEnabled = sleepingEnabled;
+	if(!sleepingEnabled)
+	{
+		while(!_sleepingIslands.empty())
+		{
+			const auto& members = _sleepingIslands.begin()->second;
+			size_t i = 0;
+			while(i < members.size() && (!_bodyStore->isValid(members[i]) || _sleepingIsland[members[i]] != _sleepingIslands.begin()->first))
+				i++;
+			if(i < members.size())
+				wakeIsland(members[i]);
+			else
+				_sleepingIslands.erase(_sleepingIslands.begin());
+		}
+	}
+}
+
+void IslandManager::ensureBodyCapacity(BodyStore::BodyId id)
+{
+	if(id >= _restTime.size())
+	{
+		_restTime.resize(id+1, 0.0f);
+		_sleepingIsland.resize(id+1, NO_ISLAND);
+	}
+}
+
+void IslandManager::saveState(StateSnapshot& snapshot) const
+{
+	snapshot.writeArray(_restTime);
+	snapshot.writeArray(_sleepingIsland);
+	snapshot.write(_nextSleepingIsland);
+	snapshot.write((uint64_t)_sleepingIslands.size());
+	for(const auto& island : _sleepingIslands)
+	{
+		snapshot.write(island.first);
+		snapshot.writeArray(island.second);
+	}
+}
+
+void IslandManager::restoreState(StateSnapshot::Reader& reader)
+{
+	reader.readArray(_restTime);
+	reader.readArray(_sleepingIsland);
+	reader.read(_nextSleepingIsland);
+	uint64_t count = 0;
+	reader.read(count);
+	_sleepingIslands.clear();
+	for(uint64_t i=0; i<count; i++)
+	{
+		uint32_t island = 0;
+		reader.read(island);
+		reader.readArray(_sleepingIslands[island]);
+	}
+}
@@ -0,0 +1,93 @@
+//--------------------------------------------------
+// Robot Simulator
+// islandManager.h
+// Date: 2020-11-18
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef ISLAND_MANAGER_H
+#define ISLAND_MANAGER_H
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "../bodyStore.h"
+#include "../stateSnapshot.h"
+#include "../broadphase/broadphase.h"
+#include "../colliders/contactManifold.h"
+
+// Groups the awake bodies connected by contacts or joints (union-find) and
+// puts to sleep the islands that stay at rest. Static bodies do not connect islands.
+// A sleeping island is woken as a whole.
+class IslandManager
+{
+	public:
+		struct Island
+		{
+			// Ranges in getIslandBodies() and getIslandManifolds()
+			uint32_t bodyStart;
+			uint32_t bodyCount;
+			uint32_t manifoldStart;
+			uint32_t manifoldCount;
+		};
+
+		IslandManager(BodyStore* bodyStore);
+		~IslandManager();
+
+		// Build the islands of the active bodies (joints are body pairs)
+		void build(const std::vector<ContactManifold>& manifolds, const std::vector<Broadphase::Pair>& joints);
+		// Update the rest timers and put to sleep the islands at rest (after the integration)
+		void updateSleep(float dt);
+
+		// Wake the sleeping island of the body (no effect if awake or static)
+		void wakeIsland(BodyStore::BodyId id);
+		void removeBody(BodyStore::BodyId id);
+		// Rest timers and sleeping islands (the islands are rebuilt every step)
+		void saveState(StateSnapshot& snapshot) const;
+		void restoreState(StateSnapshot::Reader& reader);
+
+		//---------- Getters ----------//
+		const std::vector<Island>& getIslands() const { return _islands; }
+		const std::vector<BodyStore::BodyId>& getIslandBodies() const { return _islandBodies; }
+		// Manifold indices sorted by island
+		const std::vector<uint32_t>& getIslandManifolds() const { return _islandManifolds; }
+		size_t getSleepingIslandCount() const { return _sleepingIslands.size(); }
+		bool getSleepingEnabled() const { return _sleepingEnabled; }
+
+		//---------- Setters ----------//
+		void setSleepingEnabled(bool sleepingEnabled);
+		void setLinearSleepThreshold(float threshold) { _linearSleepThreshold = threshold; }
+		// rad/s
+		void setAngularSleepThreshold(float threshold) { _angularSleepThreshold = threshold; }
+		void setTimeToSleep(float timeToSleep) { _timeToSleep = timeToSleep; }
+
+	private:
+		static const uint32_t NO_ISLAND = 0xFFFFFFFF;
+
+		uint32_t find(uint32_t i);
+		void unite(uint32_t a, uint32_t b);
+		void ensureBodyCapacity(BodyStore::BodyId id);
+
+		BodyStore* _bodyStore;
+
+		// Union-find over the active dense indices
+		std::vector<uint32_t> _parent;
+		std::vector<uint32_t> _rank;
+		std::vector<uint32_t> _rootIsland;
+
+		std::vector<Island> _islands;
+		std::vector<BodyStore::BodyId> _islandBodies;
+		std::vector<uint32_t> _islandManifolds;
+
+		// Indexed by body id
+		std::vector<float> _restTime;
+		std::vector<uint32_t> _sleepingIsland;
+		std::unordered_map<uint32_t, std::vector<BodyStore::BodyId>> _sleepingIslands;
+		uint32_t _nextSleepingIsland;
+
+		bool _sleepingEnabled;
+		float _linearSleepThreshold;
+		float _angularSleepThreshold;
+		float _timeToSleep;
+};
+
+#endif// ISLAND_MANAGER_H
@@ -0,0 +1,103 @@
+//--------------------------------------------------
+// Robot Simulator
+// stateSnapshot.h
+// Date: 2020-12-05
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef STATE_SNAPSHOT_H
+#define STATE_SNAPSHOT_H
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+
+// Byte arena with the dynamic state of a physics engine (see PhysicsEngine::saveState).
+// Every part of the engine appends its arrays and reads them back in the same order.
+// The memory is kept between saves, saving the same world again does not allocate.
+class StateSnapshot
+{
+	public:
+		class Reader
+		{
+			public:
+				Reader(const StateSnapshot& snapshot): _snapshot(snapshot), _offset(0) {}
+
+				template <typename T>
+				void read(T& value)
+				{
+					static_assert(std::is_trivially_copyable<T>::value, "Snapshots only hold plain data");
+					readBytes(&value, sizeof(T));
+				}
+
+				// The array is resized to the saved size (no allocation when it already has that size)
+				template <typename T>
+				void readArray(std::vector<T>& array)
+				{
+					static_assert(std::is_trivially_copyable<T>::value, "Snapshots only hold plain data");
+					uint64_t size = 0;
+					read(size);
+					array.resize(size);
+					readBytes(array.data(), size*sizeof(T));
+				}
+
+			private:
+				void readBytes(void* data, size_t size)
+				{
+					if(size == 0)
+						return;
+					memcpy(data, _snapshot._data.data()+_offset, size);
+					_offset += size;
+				}
+
+				const StateSnapshot& _snapshot;
+				size_t _offset;
+		};
+
+		StateSnapshot(): _size(0), _revision(0) {}
+
+		// Start a new save (keeps the memory)
+		void clear() { _size = 0; }
+
+		template <typename T>
+		void write(const T& value)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "Snapshots only hold plain data");
+			writeBytes(&value, sizeof(T));
+		}
+
+		template <typename T>
+		void writeArray(const std::vector<T>& array)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "Snapshots only hold plain data");
+			write((uint64_t)array.size());
+			writeBytes(array.data(), array.size()*sizeof(T));
+		}
+
+		//---------- Getters ----------//
+		size_t getSize() const { return _size; }
+		bool isEmpty() const { return _size == 0; }
+		// Structure of the engine that was saved (bodies, constraints and articulations)
+		uint64_t getRevision() const { return _revision; }
+
+		//---------- Setters ----------//
+		void setRevision(uint64_t revision) { _revision = revision; }
+
+	private:
+		void writeBytes(const void* data, size_t size)
+		{
+			if(size == 0)
+				return;
+			if(_size + size > _data.size())
+				_data.resize(std::max(_size + size, 2*_data.size()));
+			memcpy(_data.data()+_size, data, size);
+			_size += size;
+		}
+
+		std::vector<uint8_t> _data;
+		size_t _size;
+		uint64_t _revision;
+};
+
+#endif// STATE_SNAPSHOT_H
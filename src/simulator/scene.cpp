@@ -7,39 +7,67 @@
 #include "scene.h"
 #include <memory>
 #include <cstring>
+#include <algorithm>
+#ifndef HEADLESS
 #include "vulkan/vertex.h"
 #include "vulkan/material.h"
 #include "vulkan/buffer.h"
 #include "vulkan/device.h"
 #include "vulkan/stagingBuffer.h"
+#endif
 #include "physics/constraints/fixedConstraint.h"
+#include "physics/constraints/hingeConstraint.h"
 #include "helpers/drawHelper.h"
-#include "objects/basic/box.h"
-#include "objects/basic/cylinder.h"
-#include "objects/basic/sphere.h"
+#include "objects/sensors/lidar/lidar.h"
 
-Scene::Scene():
-	_maxLineCount(9999), _maxRTInstanceCount(1000)
+Scene::Scene()
 {
-	_device = nullptr;
 	_physicsEngine = new PhysicsEngine();
-	_commandPool = nullptr;
+	_physicsThread = nullptr;
+	_entities = new EntityStore();
 
-	// Load basic models to the memory
-	_models.push_back(new Model("plane"));
-	_models.push_back(new Model("box"));
-	_models.push_back(new Model("sphere"));
-	_models.push_back(new Model("cylinder"));
+#ifndef HEADLESS
+	_maxLineCount = 9999;
+	_device = nullptr;
+	_commandPool = nullptr;
+	_vertexBuffer = nullptr;
+	_indexBuffer = nullptr;
+	_materialBuffer = nullptr;
+	_offsetBuffer = nullptr;
+	_instanceBuffer = nullptr;
+	_aabbBuffer = nullptr;
+	_proceduralBuffer = nullptr;
+	_lineVertexBuffer = nullptr;
+	_lineIndexBuffer = nullptr;
+	// The models are loaded when the first object that uses them is added
+	_modelRegistry = new ModelRegistry();
+#endif
 }
 
 Scene::~Scene()
 {
+	if(_physicsThread != nullptr)
+	{
+		delete _physicsThread;
+		_physicsThread = nullptr;
+	}
+
+	// The physics thread is stopped
+	for(auto articulation : _articulations)
+	{
+		if(_physicsEngine != nullptr)
+			_physicsEngine->removeArticulation(articulation);
+		delete articulation;
+		articulation = nullptr;
+	}
+
 	if(_physicsEngine != nullptr)
 	{
 		delete _physicsEngine;
 		_physicsEngine = nullptr;
 	}
 
+#ifndef HEADLESS
 	if(_vertexBuffer != nullptr)
 	{
 		delete _vertexBuffer;
@@ -94,11 +122,9 @@ Scene::~Scene()
 		_lineIndexBuffer = nullptr;
 	}
 
-	for(auto model : _models)
-	{
-		delete model;
-		model = nullptr;
-	}
+	_models.clear();
+	_meshes.clear();
+#endif
 
 	for(auto object : _objects)
 	{
@@ -106,72 +132,257 @@ Scene::~Scene()
 		object = nullptr;
 	}
 
+#ifndef HEADLESS
+	// After the objects (they have model handles)
+	if(_modelRegistry != nullptr)
+	{
+		delete _modelRegistry;
+		_modelRegistry = nullptr;
+	}
+#endif
+
+	if(_entities != nullptr)
+	{
+		delete _entities;
+		_entities = nullptr;
+	}
+
+#ifndef HEADLESS
 	// TODO delete when texture isnt deleted by the model
 	for(auto texture : _textures)
 	{
 		delete texture;
 		texture = nullptr;
 	}
+#endif
 }
 
+#ifndef HEADLESS
 void Scene::loadObject(std::string fileName)
 {
-	// Load model to memory
-	_models.push_back(new Model(fileName));
+	// Load model to memory (kept when no object uses it)
+	_models.push_back(_modelRegistry->acquire(fileName));
 }
+#endif
 
 void Scene::addObject(Object* object)
 {
 	_objects.push_back(object);
-	_physicsEngine->addObjectPhysics(_objects.back()->getObjectPhysics());
+	addEntity(object, EntityStore::INVALID_ID);
 }
 
 void Scene::addComplexObject(Object* object)
 {
 	_objects.push_back(object);
-	_physicsEngine->addObjectPhysics(_objects.back()->getObjectPhysics());
+	Object* parent = object->getParent();
+	addEntity(object, parent != nullptr ? parent->getEntity() : EntityStore::INVALID_ID);
 	for(auto child : object->getChildren())
 	{
 		addComplexObject(child);
 	}
 }
 
-void Scene::createBuffers(CommandPool* commandPool)
+void Scene::addEntity(Object* object, EntityStore::EntityId parent)
 {
-	_commandPool = commandPool;
-	_device = commandPool->getDevice();
-	_proceduralBuffer = nullptr;
+	const EntityStore::EntityId entity = _entities->create(object);
+	_entities->setParent(entity, parent);
+	object->setEntity(_entities, entity);
+
+	// The pose of a mounted lidar is relative to the body, the entity is drawn as a child that
+	// follows it (the sensor only reads the body on the physics thread)
+	const ObjectPhysics* mountBody = nullptr;
+	if(object->getType() == "Lidar" && object->getParent() != nullptr)
+		mountBody = object->getParent()->getObjectPhysics();
+	if(mountBody != nullptr && parent != EntityStore::INVALID_ID)
+	{
+		const Lidar* lidar = (Lidar*)object;
+		const EntityStore::Transform& parentTransform = _entities->get<EntityStore::Transform>(parent);
+		const glm::quat orientation = parentTransform.worldOrientation*lidar->getMountOrientation();
+		_entities->setWorldTransform(entity, parentTransform.worldPosition + parentTransform.worldOrientation*lidar->getMountPosition(),
+				orientation, _entities->get<EntityStore::Transform>(entity).scale);
+	}
 
-	_textures.push_back(new Texture(_device, _commandPool, "assets/models/cube_multi/cube_multi.png"));
+	attachObjectPhysics(object, entity);
 
-	// Concatenate all the models
-	std::vector<Vertex> vertices;
-	std::vector<uint32_t> indices;
-	std::vector<Material> materials;
-	std::vector<glm::uvec2> offsets;
-	std::vector<std::pair<glm::vec3, glm::vec3>> aabbs;
-	std::vector<glm::vec4> procedurals;
+#ifndef HEADLESS
+	if(!object->getModelName().empty())
+	{
+		const ModelRegistry::Handle model = _modelRegistry->acquire(object->getModelName());
+		object->setModel(model);
+
+		EntityStore::RenderMesh mesh;
+		mesh.modelIndex = model.getId();
+		_entities->add(entity, mesh);
+		_entities->add(entity, EntityStore::Color{object->getColor()});
+		acquireMesh(model);
+		// Added while running
+		if(_instanceBuffer != nullptr)
+			addInstance(entity);
+	}
+#endif
+
+	// Sensors updated after each step (on the physics thread, which doesn't read the object tree)
+	if(object->getType() == "Lidar")
+	{
+		Lidar* lidar = (Lidar*)object;
+		runOnPhysicsThread([this, lidar, mountBody]()
+		{
+			lidar->setMountBody(mountBody);
+			_lidars.push_back(lidar);
+		});
+	}
+}
+
+void Scene::attachObjectPhysics(Object* object, EntityStore::EntityId entity)
+{
+	ObjectPhysics* physics = object->getObjectPhysics();
+	if(physics == nullptr)
+		return;
+
+	// The id is known after the attach, the physics thread can be stepping the engine
+	_entities->add(entity, EntityStore::PhysicsBody{physics, BodyStore::INVALID_ID});
+	{
+		std::lock_guard<std::mutex> lock(_attachedMutex);
+		_bodyObjects[physics] = object;
+	}
+	runOnPhysicsThread([this, physics, entity]()
+	{
+		_physicsEngine->addObjectPhysics(physics);
+		std::lock_guard<std::mutex> lock(_attachedMutex);
+		_attachedBodies.push_back({entity, physics, physics->getId()});
+	});
+	// Already attached when not threaded
+	if(!isPhysicsThreaded())
+		updateAttachedBodies();
+}
+
+void Scene::updateAttachedBodies()
+{
+	std::lock_guard<std::mutex> lock(_attachedMutex);
+	for(const auto& attached : _attachedBodies)
+	{
+		// Removed meanwhile (its entries are erased by removeObject)
+		if(!_entities->isValid(attached.entity) || !_entities->has<EntityStore::PhysicsBody>(attached.entity))
+			continue;
+		EntityStore::PhysicsBody& physics = _entities->get<EntityStore::PhysicsBody>(attached.entity);
+		if(physics.body == attached.body)
+			physics.id = attached.id;
+	}
+	_attachedBodies.clear();
+}
+
+std::vector<Articulation*> Scene::getArticulations() const
+{
+	std::lock_guard<std::mutex> lock(_articulationMutex);
+	return _articulations;
+}
+
+void Scene::removeObject(Object* object)
+{
+	if(std::find(_objects.begin(), _objects.end(), object) == _objects.end())
+		return;
+
+	// Children first (copy, removeChild changes the list)
+	const std::vector<Object*> children = object->getChildren();
+	for(auto child : children)
+		removeObject(child);
+	if(object->getParent() != nullptr)
+		object->getParent()->removeChild(object);
 
-	for(const auto model : _models)
+	_objects.erase(std::find(_objects.begin(), _objects.end(), object));
+
+	const EntityStore::EntityId entity = object->getEntity();
+	if(_entities->isValid(entity))
 	{
-		// Remember the index, vertex offsets.
-		const uint32_t indexOffset = static_cast<uint32_t>(indices.size());
-		const uint32_t vertexOffset = static_cast<uint32_t>(vertices.size());
-		const auto materialOffset = static_cast<uint32_t>(materials.size());
+#ifndef HEADLESS
+		if(_entities->has<EntityStore::RenderMesh>(entity))
+		{
+			const EntityStore::RenderMesh& mesh = _entities->get<EntityStore::RenderMesh>(entity);
+			if(mesh.instance != EntityStore::INVALID_ID)
+				_instanceBuffer->free(mesh.instance, 1);
+			releaseMesh(mesh.modelIndex);
+		}
+#endif
+		_entities->destroy(entity);
 
-		offsets.emplace_back(indexOffset, vertexOffset);
+		// Attached but not yet in the entities
+		std::lock_guard<std::mutex> lock(_attachedMutex);
+		_attachedBodies.erase(std::remove_if(_attachedBodies.begin(), _attachedBodies.end(),
+			[entity](const AttachedBody& attached){ return attached.entity == entity; }), _attachedBodies.end());
+	}
 
-		// Copy model data one after the other.
-		vertices.insert(vertices.end(), model->getVertices().begin(), model->getVertices().end());
-		indices.insert(indices.end(), model->getIndices().begin(), model->getIndices().end());
-		materials.insert(materials.end(), model->getMaterials().begin(), model->getMaterials().end());
+	// The physics thread can be using the body (the articulations are also created there)
+	ObjectPhysics* physics = object->getObjectPhysics();
+	if(physics != nullptr)
+	{
+		std::lock_guard<std::mutex> lock(_attachedMutex);
+		_bodyObjects.erase(physics);
+	}
+	runOnPhysicsThread([this, object, physics]()
+	{
+		auto lidar = std::find(_lidars.begin(), _lidars.end(), (Lidar*)object);
+		if(lidar != _lidars.end())
+			_lidars.erase(lidar);
 
-		// Adjust the material id.
-		for(size_t i = vertexOffset; i != vertices.size(); i++)
+		// Articulation of the body (its links are not owned by it)
+		Articulation* articulation = nullptr;
 		{
-			vertices[i].materialIndex += materialOffset;
+			std::lock_guard<std::mutex> lock(_articulationMutex);
+			for(auto it = _articulations.begin(); physics != nullptr && it != _articulations.end(); it++)
+			{
+				for(int link = 0; link < (*it)->getLinkCount(); link++)
+					if((*it)->getLinkBody(link) == physics)
+					{
+						articulation = *it;
+						break;
+					}
+				if(articulation != nullptr)
+				{
+					_articulations.erase(it);
+					break;
+				}
+			}
 		}
 
+		if(articulation != nullptr)
+		{
+			_physicsEngine->removeArticulation(articulation);
+			delete articulation;
+		}
+		if(physics != nullptr)
+			_physicsEngine->removeObjectPhysics(physics);
+		delete object;
+	});
+}
+
+#ifndef HEADLESS
+void Scene::createBuffers(CommandPool* commandPool)
+{
+	_commandPool = commandPool;
+	_device = commandPool->getDevice();
+	_proceduralBuffer = nullptr;
+
+	_textures.push_back(new Texture(_device, _commandPool, "assets/models/cube_multi/cube_multi.png"));
+
+	// Initial capacity for the models used until now, grows when objects are added
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+	uint32_t materialCount = 0;
+	for(const auto& mesh : _meshes)
+	{
+		if(mesh.model.get() == nullptr)
+			continue;
+		vertexCount += mesh.model->getVertices().size();
+		indexCount += mesh.model->getIndices().size();
+		materialCount += mesh.model->getMaterials().size();
+	}
+
+	// One per model id
+	std::vector<std::pair<glm::vec3, glm::vec3>> aabbs;
+	std::vector<glm::vec4> procedurals;
+	const uint32_t modelCount = std::max(_modelRegistry->getModelCount(), 1u);
+	for(uint32_t i=0; i<modelCount; i++)
+	{
 		// Add optional procedurals
 		//const auto sphere = dynamic_cast<const Sphere*>(model->getProcedural());
 		//if (sphere != nullptr)
@@ -193,57 +404,255 @@ void Scene::createBuffers(CommandPool* commandPool)
 	genGridLines();
 	_lineIndexCount = _hostLineIndex.size();
 	_indexGridCount = _lineIndexCount;
-	// TODO limit 1000 objects (ray tracing)
-	std::vector<InstanceInfo> instances(_maxRTInstanceCount);
 
-	createSceneBuffer(_vertexBuffer, 		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT|flag, vertices);
-	createSceneBuffer(_indexBuffer, 		VK_BUFFER_USAGE_INDEX_BUFFER_BIT|flag, 	indices);
-	createSceneBuffer(_materialBuffer, 		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,		materials);
-	createSceneBuffer(_offsetBuffer, 		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 	offsets);
+	_vertexBuffer = new DynamicBuffer(_device, _commandPool, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT|flag, sizeof(Vertex), vertexCount);
+	_indexBuffer = new DynamicBuffer(_device, _commandPool, VK_BUFFER_USAGE_INDEX_BUFFER_BIT|flag, sizeof(uint32_t), indexCount);
+	_materialBuffer = new DynamicBuffer(_device, _commandPool, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sizeof(Material), materialCount);
+	_offsetBuffer = new DynamicBuffer(_device, _commandPool, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sizeof(glm::uvec2), _meshes.size());
+	_instanceBuffer = new DynamicBuffer(_device, _commandPool, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sizeof(InstanceInfo), _entities->size());
 	createSceneBuffer(_aabbBuffer, 			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 	aabbs);
 	createSceneBuffer(_proceduralBuffer, 	VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 	procedurals);
 	createSceneBuffer(_lineVertexBuffer, 	VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, 	_hostLineVertex, _maxLineCount*2);
 	createSceneBuffer(_lineIndexBuffer, 	VK_BUFFER_USAGE_INDEX_BUFFER_BIT, 	_hostLineIndex, _maxLineCount*2);
-	createSceneBuffer(_instanceBuffer, 		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 	instances);
+
+	// Meshes of the objects added until now
+	for(int i=0; i<(int)_meshes.size(); i++)
+		if(_meshes[i].users > 0)
+			uploadMesh(i);
+	std::vector<EntityStore::EntityId> meshEntities;
+	_entities->forEach<EntityStore::RenderMesh>(
+		[&meshEntities](EntityStore::EntityId entity, const EntityStore::RenderMesh&)
+		{
+			meshEntities.push_back(entity);
+		});
+	for(auto entity : meshEntities)
+		addInstance(entity);
+
+	// Before the first frame (the ray tracing structures are built from them)
+	VkCommandBuffer commandBuffer = _commandPool->beginSingleTimeCommands();
+	updateBuffers(commandBuffer, 0);
+	_commandPool->endSingleTimeCommands(commandBuffer);
 }
 
-void Scene::updateRayTracingBuffers()
+void Scene::updateBuffers(VkCommandBuffer commandBuffer, uint32_t frame)
 {
-	std::vector<InstanceInfo> instances;
-	for(auto object : _objects)
-	{
-		InstanceInfo instanceInfo;
-		instanceInfo.transform = object->getModelMat();
-		instanceInfo.transformIT = glm::transpose(glm::inverse(object->getModelMat()));
-		// Set object color
-		instanceInfo.diffuse = glm::vec4(-1,-1,-1,1);
-		if(object->getType() == "Box")
-			instanceInfo.diffuse = glm::vec4(((Box*)object)->getColor(),1);
-		if(object->getType() == "Cylinder")
-			instanceInfo.diffuse = glm::vec4(((Cylinder*)object)->getColor(),1);
-		if(object->getType() == "Sphere")
-			instanceInfo.diffuse = glm::vec4(((Sphere*)object)->getColor(),1);
+	if(_commandPool == nullptr)
+		return;
 
-		instances.push_back(instanceInfo);
-	}
+	_vertexBuffer->flush(commandBuffer, frame);
+	_indexBuffer->flush(commandBuffer, frame);
+	_materialBuffer->flush(commandBuffer, frame);
+	_offsetBuffer->flush(commandBuffer, frame);
+	_instanceBuffer->flush(commandBuffer, frame);
+}
+
+uint32_t Scene::getBufferRevision() const
+{
+	return _vertexBuffer->getRevision() + _indexBuffer->getRevision() + _materialBuffer->getRevision() +
+		_offsetBuffer->getRevision() + _instanceBuffer->getRevision();
+}
 
-	// Update buffer
-	if(_commandPool==nullptr)
+void Scene::acquireMesh(const ModelRegistry::Handle& model)
+{
+	const int modelIndex = model.getId();
+	if(modelIndex >= (int)_meshes.size())
+		_meshes.resize(modelIndex+1);
+
+	MeshRange& mesh = _meshes[modelIndex];
+	if(mesh.users == 0)
+		mesh.model = model;
+	mesh.users++;
+	if(_vertexBuffer != nullptr && !mesh.uploaded)
+		uploadMesh(modelIndex);
+}
+
+void Scene::releaseMesh(int modelIndex)
+{
+	MeshRange& mesh = _meshes[modelIndex];
+	mesh.users--;
+	if(mesh.users > 0)
 		return;
-	//printf("Command pool OK\n");
-	Device* device = _commandPool->getDevice();
-	StagingBuffer* stagingBuffer = new StagingBuffer(device, instances.data(), sizeof(InstanceInfo)*instances.size());
-	_instanceBuffer->copyFrom(_commandPool, stagingBuffer->handle(), sizeof(InstanceInfo)*instances.size());
-	delete stagingBuffer;
-	stagingBuffer = nullptr;
+
+	// The registry deletes the model if the scene didn't load it (loadObject)
+	mesh.model.reset();
+	if(!mesh.uploaded)
+		return;
+	_vertexBuffer->free(mesh.vertexOffset, mesh.vertexCount);
+	_indexBuffer->free(mesh.indexOffset, mesh.indexCount);
+	_materialBuffer->free(mesh.materialOffset, mesh.materialCount);
+	mesh.uploaded = false;
 }
 
+void Scene::uploadMesh(int modelIndex)
+{
+	MeshRange& mesh = _meshes[modelIndex];
+	const Model* model = mesh.model.get();
+	if(model == nullptr)
+		return;
+
+	mesh.vertexCount = model->getVertices().size();
+	mesh.indexCount = model->getIndices().size();
+	mesh.materialCount = model->getMaterials().size();
+	mesh.vertexOffset = _vertexBuffer->allocate(mesh.vertexCount);
+	mesh.indexOffset = _indexBuffer->allocate(mesh.indexCount);
+	mesh.materialOffset = _materialBuffer->allocate(mesh.materialCount);
+
+	// Adjust the material id
+	std::vector<Vertex> vertices = model->getVertices();
+	for(auto& vertex : vertices)
+		vertex.materialIndex += mesh.materialOffset;
+
+	_vertexBuffer->write(mesh.vertexOffset, vertices);
+	_indexBuffer->write(mesh.indexOffset, model->getIndices());
+	_materialBuffer->write(mesh.materialOffset, model->getMaterials());
+
+	// Read by the ray tracing shaders (gl_InstanceCustomIndexNV is the model index)
+	const glm::uvec2 offsets(mesh.indexOffset, mesh.vertexOffset);
+	_offsetBuffer->reserve(modelIndex+1);
+	_offsetBuffer->write(modelIndex, &offsets, 1);
+	mesh.uploaded = true;
+}
+
+void Scene::addInstance(EntityStore::EntityId entity)
+{
+	EntityStore::RenderMesh& renderMesh = _entities->get<EntityStore::RenderMesh>(entity);
+	const MeshRange& mesh = _meshes[renderMesh.modelIndex];
+	renderMesh.vertexOffset = mesh.vertexOffset;
+	renderMesh.indexOffset = mesh.indexOffset;
+	renderMesh.indexCount = mesh.indexCount;
+	renderMesh.instance = _instanceBuffer->allocate(1);
+	writeInstance(entity);
+}
+
+void Scene::writeInstance(EntityStore::EntityId entity)
+{
+	const EntityStore::Transform& transform = _entities->get<EntityStore::Transform>(entity);
+	const EntityStore::Color& color = _entities->get<EntityStore::Color>(entity);
+
+	InstanceInfo instanceInfo;
+	instanceInfo.transform = transform.world;
+	instanceInfo.transformIT = transform.worldIT;
+	// -1 uses the material color
+	if(color.value == glm::vec3(0))
+		instanceInfo.diffuse = glm::vec4(-1,-1,-1,1);
+	else
+		instanceInfo.diffuse = glm::vec4(color.value,1);
+	_instanceBuffer->write(_entities->get<EntityStore::RenderMesh>(entity).instance, &instanceInfo, 1);
+}
+#endif
+
 void Scene::updatePhysics(float dt)
+{
+	if(!isPhysicsThreaded())
+	{
+		_physicsEngine->update(dt);
+		updateSensors(dt);
+	}
+	updateTransforms();
+}
+
+void Scene::updateTransforms()
+{
+	// Bodies attached by the physics thread since the last frame
+	updateAttachedBodies();
+
+	if(!isPhysicsThreaded())
+	{
+		// Interpolated between the last two fixed steps, so the motion is smooth at any frame rate
+		const BodyStore* store = _physicsEngine->getBodyStore();
+		_entities->forEach<EntityStore::Transform, EntityStore::PhysicsBody>(
+			[this, store](EntityStore::EntityId entity, EntityStore::Transform&, const EntityStore::PhysicsBody& physics)
+			{
+				if(store->isValid(physics.id))
+					_entities->setPhysicsPose(entity, store->getTransform(physics.id));
+			});
+	}
+	else
+	{
+		// Latest complete step, the physics thread keeps running while the frame renders
+		const PhysicsSnapshot& snapshot = _physicsThread->getSnapshot();
+		_entities->forEach<EntityStore::Transform, EntityStore::PhysicsBody>(
+			[this, &snapshot](EntityStore::EntityId entity, EntityStore::Transform&, const EntityStore::PhysicsBody& physics)
+			{
+				if(physics.id < snapshot.transforms.size())
+					_entities->setPhysicsPose(entity, snapshot.transforms[physics.id]);
+			});
+	}
+
+	_entities->updateTransforms();
+#ifndef HEADLESS
+	// Only the instances that moved are written
+	if(_instanceBuffer != nullptr)
+		for(auto entity : _entities->getChangedEntities())
+			if(_entities->has<EntityStore::RenderMesh>(entity))
+				writeInstance(entity);
+#endif
+
+	// Bodies moved by the user (or with some moved ancestor)
+	for(auto entity : _entities->getMovedBodies())
+	{
+		const EntityStore::Transform& transform = _entities->get<EntityStore::Transform>(entity);
+		ObjectPhysics* body = _entities->get<EntityStore::PhysicsBody>(entity).body;
+		const glm::vec3 position = transform.worldPosition;
+		const glm::quat orientation = transform.worldOrientation;
+		runOnPhysicsThread([body, position, orientation]()
+		{
+			body->setOrientation(orientation);
+			body->setPosition(position);
+		});
+	}
+}
+
+void Scene::stepPhysics(float dt)
 {
 	_physicsEngine->stepPhysics(dt);
+	updateSensors(dt);
 }
 
+void Scene::updateSensors(float dt)
+{
+	for(auto lidar : _lidars)
+		lidar->update(_physicsEngine, dt);
+}
 
+void Scene::startPhysicsThread()
+{
+	if(_physicsThread == nullptr)
+	{
+		_physicsThread = new PhysicsThread(_physicsEngine);
+		_physicsThread->onPostStep = [this](float dt){ updateSensors(dt); };
+	}
+	_physicsThread->start();
+}
+
+void Scene::stopPhysicsThread()
+{
+	if(_physicsThread == nullptr)
+		return;
+	_physicsThread->stop();
+	// Bodies attached by the last commands
+	updateAttachedBodies();
+}
+
+void Scene::runOnPhysicsThread(std::function<void()> command)
+{
+	if(isPhysicsThreaded())
+		_physicsThread->post(command);
+	else
+		command();
+}
+
+Object* Scene::getObjectFromPhysicsBody(ObjectPhysics* body) const
+{
+	if(body == nullptr)
+		return nullptr;
+
+	std::lock_guard<std::mutex> lock(_attachedMutex);
+	auto it = _bodyObjects.find(body);
+	return it != _bodyObjects.end() ? it->second : nullptr;
+}
+
+#ifndef HEADLESS
 template <class T>
 void Scene::createSceneBuffer(Buffer*& buffer,
 		const VkBufferUsageFlags usage, 
@@ -396,17 +805,103 @@ void Scene::genGridLines()
 		addLine(pos1, pos2, gridColor);
 	}
 }
+#endif
 
 void Scene::linkObjects()
 {
-	//for(auto object : _objects)
-	//{
-	//	Constraint* constraint = object->getParentConstraint();
-	//	if(constraint != nullptr)
-	//	{
-	//		ObjectPhysics* childPhysics = object->getObjectPhysics();
-	//		ObjectPhysics* parentPhysics = object->getParent()->getObjectPhysics();
-	//		_physicsEngine->getWorld()->addConstraint(constraint->createConstraint(childPhysics, parentPhysics), true);
-	//	}
-	//}
+	// The object trees belong to this thread, the bodies to the physics thread
+	std::vector<ArticulationLink> links;
+	for(auto object : _objects)
+	{
+		// Roots are the objects not linked to their parent
+		ObjectPhysics* physics = object->getObjectPhysics();
+		if(physics == nullptr)
+			continue;
+		Object* parent = object->getParent();
+		if(parent != nullptr && parent->getObjectPhysics() != nullptr && object->getParentConstraint() != nullptr)
+			continue;
+
+		links.push_back({physics, nullptr, -1});
+		addArticulationLinks(links, object, (int)links.size()-1);
+	}
+
+	runOnPhysicsThread([this, links]()
+	{
+		createArticulations(links);
+	});
+}
+
+void Scene::addArticulationLinks(std::vector<ArticulationLink>& links, Object* object, int parent)
+{
+	for(auto child : object->getChildren())
+	{
+		Constraint* constraint = child->getParentConstraint();
+		ObjectPhysics* physics = child->getObjectPhysics();
+		if(constraint == nullptr || physics == nullptr)
+			continue;
+
+		links.push_back({physics, constraint, parent});
+		addArticulationLinks(links, child, (int)links.size()-1);
+	}
+}
+
+void Scene::createArticulations(const std::vector<ArticulationLink>& links)
+{
+	// Link of each element in its articulation (-1 when it is not linked, nor its subtree)
+	std::vector<int> linkIndices(links.size(), -1);
+	Articulation* articulation = nullptr;
+	for(size_t i = 0; i <= links.size(); i++)
+	{
+		if(i == links.size() || links[i].parent < 0)
+		{
+			// Previous tree done
+			if(articulation != nullptr && articulation->getLinkCount() > 1)
+			{
+				_physicsEngine->addArticulation(articulation);
+				std::lock_guard<std::mutex> lock(_articulationMutex);
+				_articulations.push_back(articulation);
+			}
+			else if(articulation != nullptr)
+				delete articulation;
+			articulation = nullptr;
+
+			if(i < links.size() && links[i].body->isAttached())
+			{
+				articulation = new Articulation(links[i].body);
+				linkIndices[i] = 0;
+			}
+			continue;
+		}
+
+		const ArticulationLink& link = links[i];
+		const int parentLink = linkIndices[link.parent];
+		ObjectPhysics* physics = link.body;
+		if(articulation == nullptr || parentLink < 0 || !physics->isAttached() || physics->getInverseMass() <= 0)
+			continue;
+
+		int childLink = -1;
+		HingeConstraint* hinge = nullptr;
+		Constraint* constraint = link.constraint;
+		if(constraint->getType() == "HingeConstraint")
+		{
+			hinge = (HingeConstraint*)constraint;
+			childLink = articulation->addLink(physics, parentLink, Articulation::JointType::REVOLUTE,
+					hinge->getPosition(), glm::quat(glm::radians(hinge->getRotation())), hinge->getAxis());
+		}
+		else if(constraint->getType() == "FixedConstraint")
+		{
+			FixedConstraint* fixed = (FixedConstraint*)constraint;
+			childLink = articulation->addLink(physics, parentLink, Articulation::JointType::FIXED,
+					fixed->getPosition(), glm::quat(glm::radians(fixed->getRotation())));
+		}
+		if(childLink < 0)
+			continue;
+
+		constraint->setObjects(links[link.parent].body, physics);
+		constraint->setArticulation(articulation, childLink);
+		// Motors set before linking
+		if(hinge != nullptr && hinge->isMotorEnabled())
+			articulation->setJointMotor(childLink, hinge->getMotor());
+		linkIndices[i] = childLink;
+	}
 }
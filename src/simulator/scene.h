@@ -9,42 +9,102 @@
 
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <map>
 #include "defines.h"
 #include "physics/physicsEngine.h"
+#include "physics/physicsThread.h"
+#ifndef HEADLESS
 #include "vulkan/model.h"
+#include "vulkan/modelRegistry.h"
 #include "vulkan/texture.h"
 #include "vulkan/buffer.h"
+#include "vulkan/dynamicBuffer.h"
 #include "vulkan/commandPool.h"
 #include "vulkan/material.h"
 #include "vulkan/helpers.h"
+#endif
 #include "object.h"
+#include "entityStore.h"
 
+class Lidar;
+
+// Objects, physics and (except in HEADLESS builds) the render buffers of the simulation
 class Scene
 {
 	public:
 		Scene();
 		~Scene();
 
+#ifndef HEADLESS
 		void loadObject(std::string fileName);
+		void createBuffers(CommandPool* commandPool);
+#endif
+		// Objects can be added and removed at any time (also after createBuffers), only
+		// the buffer ranges of the object are written. The bodies are attached on the physics
+		// thread, their poses are used from the next frame after that.
 		void addObject(Object* object);
 		void addComplexObject(Object* object);
-		void createBuffers(CommandPool* commandPool);
+		// Removes and deletes the object and its children. Removing a link of an articulation
+		// removes the articulation (the other links become free bodies).
+		void removeObject(Object* object);
 
+		// Object trees connected by constraints become articulations (built on the physics thread)
 		void linkObjects();
+		// Steps the physics (when not threaded) and updates the object poses, once per frame
 		void updatePhysics(float dt);
+		// Single step of dt seconds of the physics and the sensors, without render
+		// transforms (headless runs, as fast as the CPU allows)
+		void stepPhysics(float dt);
+		// Physics and sensors run on their own thread at the fixed timestep, the
+		// frames only read the last published poses (after linkObjects)
+		void startPhysicsThread();
+		void stopPhysicsThread();
+		// Runs on the physics thread before its next step (immediately when not threaded)
+		void runOnPhysicsThread(std::function<void()> command);
 
 		//--------- Getters ----------//
 		PhysicsEngine* getPhysicsEngine() const { return _physicsEngine; }
+		PhysicsThread* getPhysicsThread() const { return _physicsThread; }
+		// Components of the objects, iterated by the per-frame passes
+		EntityStore* getEntityStore() const { return _entities; }
+		bool isPhysicsThreaded() const { return _physicsThread != nullptr && _physicsThread->isRunning(); }
+		// Safe from the physics thread (nullptr once the object is being removed)
+		Object* getObjectFromPhysicsBody(ObjectPhysics* body) const;
 		//----- Simulation specific ------//
 		std::vector<Object*> getObjects() const { return _objects; };
-		std::vector<Model*> getModels() const { return _models; };
+		std::vector<Articulation*> getArticulations() const;
+#ifndef HEADLESS
+		// Range of a model in the vertex, index and material buffers
+		struct MeshRange
+		{
+			// Kept while some entity uses it
+			ModelRegistry::Handle model;
+			uint32_t vertexOffset = 0;
+			uint32_t vertexCount = 0;
+			uint32_t indexOffset = 0;
+			uint32_t indexCount = 0;
+			uint32_t materialOffset = 0;
+			uint32_t materialCount = 0;
+			// Entities using it, the ranges are freed when it reaches zero
+			uint32_t users = 0;
+			bool uploaded = false;
+		};
+
+		// Models shared by the objects
+		ModelRegistry* getModelRegistry() const { return _modelRegistry; }
 		std::vector<Texture*> getTextures() const { return _textures; };
-
-		Buffer* getVertexBuffer() const { return _vertexBuffer; }
-		Buffer* getIndexBuffer() const { return _indexBuffer; }
-		Buffer* getMaterialBuffer() const { return _materialBuffer; }
-		Buffer* getOffsetBuffer() const { return _offsetBuffer; }
-		Buffer* getInstanceBuffer() const { return _instanceBuffer; }
+		// Indexed by the model index
+		const MeshRange& getMeshRange(int modelIndex) const { return _meshes[modelIndex]; }
+		uint32_t getMeshCount() const { return (uint32_t)_meshes.size(); }
+		// Elements of the instance buffer in use (some can be free)
+		uint32_t getInstanceCount() const { return _instanceBuffer->getUsedEnd(); }
+
+		Buffer* getVertexBuffer() const { return _vertexBuffer->getBuffer(); }
+		Buffer* getIndexBuffer() const { return _indexBuffer->getBuffer(); }
+		Buffer* getMaterialBuffer() const { return _materialBuffer->getBuffer(); }
+		Buffer* getOffsetBuffer() const { return _offsetBuffer->getBuffer(); }
+		Buffer* getInstanceBuffer() const { return _instanceBuffer->getBuffer(); }
 		Buffer* getAabbBuffer() const { return _aabbBuffer; }
 		Buffer* getProceduralBuffer() const { return _proceduralBuffer; }
 		bool hasProcedurals() const { return static_cast<bool>(_proceduralBuffer); }
@@ -60,10 +120,16 @@ class Scene
 		Buffer* getLineIndexBuffer() const { return _lineIndexBuffer; }
 		uint32_t getLineIndexCount() const {return _lineIndexCount; }
 
-		//--- Ray tracing ---//
-		void updateRayTracingBuffers();
+		//--- Render buffers ---//
+		// Records the copies of the geometry and instances written since the last frame at the
+		// start of the command buffer of the frame (its last command buffer must be done)
+		void updateBuffers(VkCommandBuffer commandBuffer, uint32_t frame);
+		// Changes when some buffer is recreated (the descriptor sets must be updated)
+		uint32_t getBufferRevision() const;
+#endif
 
 	private:
+#ifndef HEADLESS
 		template <class T>
 		void createSceneBuffer(Buffer*& buffer,
 			const VkBufferUsageFlags usage, 
@@ -75,34 +141,94 @@ class Scene
 
 		void genGridLines();
 
+		// Entity users of the mesh, uploaded by the first one (when the buffers exist)
+		void acquireMesh(const ModelRegistry::Handle& model);
+		void releaseMesh(int modelIndex);
+		void uploadMesh(int modelIndex);
+		// Mesh ranges and instance element of the entity (after createBuffers)
+		void addInstance(EntityStore::EntityId entity);
+		void writeInstance(EntityStore::EntityId entity);
+#endif
+
+		// Entity with the components of the object (and its children)
+		void addEntity(Object* object, EntityStore::EntityId parent);
+		// Attaches the body on the physics thread, the body id of the entity is set by
+		// updateAttachedBodies once it is known
+		void attachObjectPhysics(Object* object, EntityStore::EntityId entity);
+		void updateAttachedBodies();
+		// Poses of the physics objects (interpolated or published by the physics thread), then
+		// the world transforms of the changed subtrees. The bodies moved by the user are teleported.
+		void updateTransforms();
+
 		// Objects in the scene
 		std::vector<Object*> _objects;
+		EntityStore* _entities;
+		// Updated by the physics thread
+		std::vector<Lidar*> _lidars;
+#ifndef HEADLESS
 		// Models and textures loaded to the memory
-		std::vector<Model*> _models;
+		ModelRegistry* _modelRegistry;
+		// Kept loaded by loadObject
+		std::vector<ModelRegistry::Handle> _models;
 		std::vector<Texture*> _textures;
 
 		Device* _device;
 		CommandPool* _commandPool;
-		Buffer* _vertexBuffer;
-		Buffer* _indexBuffer;
-		Buffer* _materialBuffer;
-		Buffer* _offsetBuffer;
-		Buffer* _instanceBuffer;
+		// Suballocated per mesh (offsets indexed by the model index)
+		DynamicBuffer* _vertexBuffer;
+		DynamicBuffer* _indexBuffer;
+		DynamicBuffer* _materialBuffer;
+		DynamicBuffer* _offsetBuffer;
+		// One element per entity with a mesh
+		DynamicBuffer* _instanceBuffer;
+		std::vector<MeshRange> _meshes;
 		Buffer* _aabbBuffer;
 		Buffer* _proceduralBuffer;
 
 		// Simulator specific
 		uint32_t _maxLineCount;// Maximum number of lines that can be store in memory
-		uint32_t _maxRTInstanceCount;// Maximum number of lines that can be store in memory
 		uint32_t _lineIndexCount;// Current index count (line count*2)
 		uint32_t _indexGridCount;// Number of lines in the grid
 		Buffer* _lineVertexBuffer;
 		Buffer* _lineIndexBuffer;
 		std::vector<Vertex> _hostLineVertex;
 		std::vector<uint32_t> _hostLineIndex;
+#endif
 
 		//---------- Physics ----------//
+		// Body of an object tree to link, parents before their children
+		struct ArticulationLink
+		{
+			ObjectPhysics* body;
+			// Constraint to the parent (nullptr for the roots)
+			Constraint* constraint;
+			// Parent element in the list (-1 for the roots)
+			int parent;
+		};
+		struct AttachedBody
+		{
+			EntityStore::EntityId entity;
+			ObjectPhysics* body;
+			BodyStore::BodyId id;
+		};
+
+		// Add the children of the object (and their children) to the list
+		void addArticulationLinks(std::vector<ArticulationLink>& links, Object* object, int parent);
+		// On the physics thread, one articulation per root of the list
+		void createArticulations(const std::vector<ArticulationLink>& links);
+		// Sensors see the state after the step
+		void updateSensors(float dt);
+
 		PhysicsEngine* _physicsEngine;
+		PhysicsThread* _physicsThread;
+		// Changed by the physics thread commands
+		std::vector<Articulation*> _articulations;
+		mutable std::mutex _articulationMutex;
+		// Attached by the physics thread, not yet in the entities
+		std::vector<AttachedBody> _attachedBodies;
+		// Object of each body (the objects are changed by the render thread)
+		std::map<const ObjectPhysics*, Object*> _bodyObjects;
+		mutable std::mutex _attachedMutex;
 };
 
 #endif// SCENE_H
@@ -13,6 +13,7 @@
 #include "objects/basic/cylinder.h"
 #include "physics/constraints/fixedConstraint.h"
 #include "physics/constraints/hingeConstraint.h"
+#include "helpers/log.h"
 
 Simulator::Simulator()
 {
@@ -24,6 +25,7 @@ Simulator::Simulator()
 	Box* ground = new Box("Ground", {0,-1,0}, {0,0,0}, {200, 2, 200}, 0.0f, {0.8,0.8,0.8});
 	Cylinder* test1 = new Cylinder("Cylinder", {0,1,0}, {0,0,0}, {0.5, 0.5,0.5}, 1.1f, {0.8,0.8,0.8});
 	Sphere* test2 = new Sphere("Sphere", {0,0.5,0}, {0,0,0}, 0.2, 1.1f, {0.8,0.5,0.2});
+	test2->getObjectPhysics()->setCcdEnabled(true);
 
 	// Create demo robot (ttzinho)
 	_ttzinho = new Ttzinho();
@@ -33,6 +35,8 @@ Simulator::Simulator()
 	_scene->addObject((Object*)test1);// Add a simple object
 	_scene->addObject((Object*)test2);// Add a simple object
 	_scene->linkObjects();
+	// The frame rate does not slow down the simulation
+	_scene->startPhysicsThread();
 
 	_debugDrawer = new DebugDrawer(_scene);
 
@@ -43,6 +47,10 @@ Simulator::Simulator()
 
 Simulator::~Simulator()
 {
+	// The physics thread uses the objects and the callbacks of the simulator
+	if(_scene != nullptr)
+		_scene->stopPhysicsThread();
+
 	if(_vulkanApp != nullptr)
 	{
 		delete _vulkanApp;
@@ -82,18 +90,17 @@ void Simulator::onDrawFrame(float dt)
 
 void Simulator::onRaycastClick(glm::vec3 pos, glm::vec3 ray)
 {
-	//_scene->addLine(pos, pos+ray, {rand()%255/255.f,rand()%255/255.f,rand()%255/255.f});
-
-	//PhysicsEngine::RayResult result;
-	//if(!_scene->getPhysicsEngine()->raycast(pos, ray, result))
-	//	return;
-
-	//Object* object = _scene->getObjectFromPhysicsBody(result.body);
-	//
-	//if(object != nullptr)
-	//{
-	//	printf("Hit something! %s (%f, %f, %f)\n", object->getName().c_str(), result.hitPoint.x, result.hitPoint.y, result.hitPoint.z);
-	//	fflush(stdout);
-	//}
+	// The ray is the far point under the cursor (traced between two steps, the hit
+	// object can't be deleted meanwhile, it is also deleted by the physics thread)
+	_scene->runOnPhysicsThread([this, pos, ray]()
+	{
+		PhysicsEngine::RayResult result;
+		if(!_scene->getPhysicsEngine()->raycast(pos, ray-pos, result))
+			return;
+
+		Object* object = _scene->getObjectFromPhysicsBody(result.body);
+		if(object != nullptr)
+			Log::debug("Simulator", "Clicked " + object->getName());
+	});
 }
 
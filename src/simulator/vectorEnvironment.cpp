@@ -0,0 +1,191 @@
+//--------------------------------------------------
+// Robot Simulator
+// vectorEnvironment.cpp
+// Date: 2020-12-03
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#include "vectorEnvironment.h"
+#include <cmath>
+#include <algorithm>
+#include "objects/basic/box.h"
+#include "objects/basic/cylinder.h"
+#include "helpers/log.h"
+
+VectorEnvironment::VectorEnvironment(Config config):
+	_config(config), _totalSteps(0)
+{
+	_config.envCount = std::max(_config.envCount, 1);
+	_config.frameSkip = std::max(_config.frameSkip, 1);
+	const int n = _config.envCount;
+
+	_actions.assign(n*ACTION_SIZE, 0.0f);
+	_observations.assign(n*OBSERVATION_SIZE, 0.0f);
+	_rewards.assign(n, 0.0f);
+	_dones.assign(n, 0);
+	_episodeSteps.assign(n, 0);
+
+	_environments.resize(n);
+	for(auto& environment : _environments)
+		createArena(environment);
+
+	_threadPool = new ThreadPool(_config.threadCount);
+	reset();
+}
+
+VectorEnvironment::~VectorEnvironment()
+{
+	if(_threadPool != nullptr)
+	{
+		delete _threadPool;
+		_threadPool = nullptr;
+	}
+
+	for(auto& environment : _environments)
+	{
+		if(environment.scene != nullptr)
+		{
+			delete environment.scene;
+			environment.scene = nullptr;
+		}
+
+		if(environment.robot != nullptr)
+		{
+			delete environment.robot;
+			environment.robot = nullptr;
+		}
+	}
+}
+
+void VectorEnvironment::createArena(Environment& environment)
+{
+	environment.scene = new Scene();
+	environment.robot = new Ttzinho();
+	environment.time = 0.0f;
+
+	// The environments already run in parallel
+	PhysicsEngine* engine = environment.scene->getPhysicsEngine();
+	engine->setFixedTimeStep(_config.timeStep);
+	engine->setThreadCount(1);
+	engine->setDeterministic(_config.deterministic);
+
+	// 4x4m arena with an obstacle
+	Scene* scene = environment.scene;
+	scene->addObject(new Box("Ground", {0,-1,0}, {0,0,0}, {6, 2, 6}, 0.0f, {0.8,0.8,0.8}));
+	scene->addObject(new Box("Wall", {2,0.15,0}, {0,0,0}, {0.1, 0.3, 4}, 0.0f, {0.5,0.5,0.5}));
+	scene->addObject(new Box("Wall", {-2,0.15,0}, {0,0,0}, {0.1, 0.3, 4}, 0.0f, {0.5,0.5,0.5}));
+	scene->addObject(new Box("Wall", {0,0.15,2}, {0,0,0}, {4, 0.3, 0.1}, 0.0f, {0.5,0.5,0.5}));
+	scene->addObject(new Box("Wall", {0,0.15,-2}, {0,0,0}, {4, 0.3, 0.1}, 0.0f, {0.5,0.5,0.5}));
+	scene->addObject(new Cylinder("Obstacle", {1,0.25,1}, {0,0,0}, {0.3, 0.5, 0.3}, 0.0f, {0.8,0.5,0.2}));
+	scene->addComplexObject(environment.robot->getObject());
+	scene->linkObjects();
+
+	// Initial state restored by the resets
+	engine->saveState(environment.initialState);
+}
+
+void VectorEnvironment::reset()
+{
+	_threadPool->parallelFor(getEnvCount(), 1, [this](uint32_t begin, uint32_t end)
+	{
+		for(uint32_t env=begin; env<end; env++)
+			resetEnvironment(env);
+	});
+}
+
+void VectorEnvironment::reset(int env)
+{
+	resetEnvironment(env);
+}
+
+void VectorEnvironment::step()
+{
+	_threadPool->parallelFor(getEnvCount(), 1, [this](uint32_t begin, uint32_t end)
+	{
+		for(uint32_t env=begin; env<end; env++)
+			stepEnvironment(env);
+	});
+	_totalSteps += getEnvCount();
+}
+
+void VectorEnvironment::resetEnvironment(int env)
+{
+	Environment& environment = _environments[env];
+
+	// Also the warm start, manifolds, sleep timers and accumulator of the last episode
+	if(!environment.scene->getPhysicsEngine()->restoreState(environment.initialState))
+		Log::error("VectorEnvironment", "The arena changed, the initial state can't be restored");
+
+	environment.robot->setWheelVelocities(0.0f, 0.0f);
+	environment.robot->getLidar()->reset();
+	environment.time = 0.0f;
+	_episodeSteps[env] = 0;
+
+	if(onReset)
+		onReset(env, environment.scene);
+	writeObservation(env);
+}
+
+void VectorEnvironment::stepEnvironment(int env)
+{
+	Environment& environment = _environments[env];
+	const float* action = &_actions[env*ACTION_SIZE];
+	ObjectPhysics* body = environment.robot->getObject()->getObjectPhysics();
+	const glm::vec3 start = body->getPosition();
+
+	environment.robot->setWheelVelocities(action[0], action[1]);
+	for(int i=0; i<_config.frameSkip; i++)
+		environment.scene->stepPhysics(_config.timeStep);
+	environment.time += _config.frameSkip*_config.timeStep;
+	_episodeSteps[env]++;
+
+	writeObservation(env);
+	const float* observation = &_observations[env*OBSERVATION_SIZE];
+	if(onReward)
+		_rewards[env] = onReward(env, observation, action);
+	else
+	{
+		const glm::vec3 motion = body->getPosition() - start;
+		_rewards[env] = std::sqrt(motion.x*motion.x + motion.z*motion.z);
+	}
+
+	// Flipped robot or time limit
+	const glm::vec3 up = body->getOrientation()*glm::vec3(0,1,0);
+	_dones[env] = up.y < 0.3f || environment.time >= _config.maxEpisodeTime;
+	if(_dones[env])
+		resetEnvironment(env);
+}
+
+void VectorEnvironment::writeObservation(int env)
+{
+	const Environment& environment = _environments[env];
+	const ObjectPhysics* body = environment.robot->getObject()->getObjectPhysics();
+	float* observation = &_observations[env*OBSERVATION_SIZE];
+
+	const glm::vec3 position = body->getPosition();
+	const glm::quat orientation = body->getOrientation();
+	const glm::vec3 velocity = body->getVelocity();
+	const glm::vec3 angularVelocity = body->getAngularVelocity();
+	const float state[15] = {
+		position.x, position.y, position.z,
+		orientation.x, orientation.y, orientation.z, orientation.w,
+		velocity.x, velocity.y, velocity.z,
+		angularVelocity.x, angularVelocity.y, angularVelocity.z,
+		environment.robot->getWheelVelocityLeft(), environment.robot->getWheelVelocityRight()};
+	std::copy(state, state+15, observation);
+
+	// Closest return of each sector of the last scan
+	const Lidar* lidar = environment.robot->getLidar();
+	const Lidar::Config config = lidar->getConfig();
+	const Lidar::Scan* scan = lidar->getScan();
+	float* sectors = observation+15;
+	std::fill(sectors, sectors+LIDAR_SECTORS, config.maxRange);
+	if(scan == nullptr)
+		return;
+	for(uint32_t i=0; i<scan->pointCount; i++)
+	{
+		const float range = scan->ranges[i];
+		const int sector = (int)(i/config.channels)*LIDAR_SECTORS/config.columns;
+		if(range > 0)
+			sectors[sector] = std::min(sectors[sector], range);
+	}
+}
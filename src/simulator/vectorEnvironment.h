@@ -0,0 +1,111 @@
+//--------------------------------------------------
+// Robot Simulator
+// vectorEnvironment.h
+// Date: 2020-12-03
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef VECTOR_ENVIRONMENT_H
+#define VECTOR_ENVIRONMENT_H
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include "scene.h"
+#include "helpers/threadPool.h"
+#include "physics/stateSnapshot.h"
+#include "demo/ttzinho/ttzinho.h"
+
+// N independent copies of a Ttzinho arena stepped by a single call, for reinforcement
+// learning (built with HEADLESS, so no model is loaded). The actions, observations,
+// rewards and done flags are contiguous arrays (environment major) allocated once.
+//
+// Each environment owns its scene and steps its physics on one thread, the
+// environments are spread over the worker threads. Resets restore the physics snapshot
+// saved after the arena was built (bodies, contact and sleep caches, joints, step
+// counters), the first steps of an episode don't depend on the previous one.
+class VectorEnvironment
+{
+	public:
+		// Wheel speed targets (rad/s), left then right
+		static const int ACTION_SIZE = 2;
+		// Lidar ranges in the observation (closest return of each sector, max range without return)
+		static const int LIDAR_SECTORS = 36;
+		// Position (3), orientation (4, xyzw), velocity (3), angular velocity (3),
+		// wheel speeds (2) and the lidar sectors
+		static const int OBSERVATION_SIZE = 15 + LIDAR_SECTORS;
+
+		struct Config
+		{
+			int envCount = 16;
+			float timeStep = 0.001f;
+			// Physics steps per environment step (the actions are held meanwhile)
+			int frameSkip = 20;
+			// Threads stepping the environments, including the caller (0 uses all the cores)
+			int threadCount = 0;
+			// Episodes are truncated after this simulated time (s)
+			float maxEpisodeTime = 20.0f;
+			bool deterministic = false;
+		};
+
+		VectorEnvironment(Config config);
+		~VectorEnvironment();
+
+		// Restore the initial state and write the observations
+		void reset();
+		void reset(int env);
+		// Apply the actions, run frameSkip physics steps in every environment and write
+		// the observations, rewards and done flags. Finished environments are reset in the
+		// same call, their observation is the first one of the next episode.
+		void step();
+
+		//---------- Getters ----------//
+		int getEnvCount() const { return (int)_environments.size(); }
+		Config getConfig() const { return _config; }
+		// envCount*ACTION_SIZE, written by the caller before each step
+		float* getActions() { return _actions.data(); }
+		// envCount*OBSERVATION_SIZE
+		const float* getObservations() const { return _observations.data(); }
+		const float* getRewards() const { return _rewards.data(); }
+		// 1 when the episode ended in the last step (robot flipped or time limit)
+		const uint8_t* getDones() const { return _dones.data(); }
+		// Steps of the current episode
+		const uint32_t* getEpisodeSteps() const { return _episodeSteps.data(); }
+		// Environment steps since the creation (all the environments)
+		uint64_t getTotalSteps() const { return _totalSteps; }
+		Scene* getScene(int env) const { return _environments[env].scene; }
+		Ttzinho* getRobot(int env) const { return _environments[env].robot; }
+
+		//---------- Callbacks ----------//
+		// Reward of an environment step, called by the worker threads (the default is the
+		// planar distance travelled by the robot)
+		std::function<float(int env, const float* observation, const float* action)> onReward;
+		// Called by the worker threads after an environment is reset (e.g. to randomize the arena)
+		std::function<void(int env, Scene* scene)> onReset;
+
+	private:
+		struct Environment
+		{
+			Scene* scene;
+			Ttzinho* robot;
+			// Physics state after the arena was built
+			StateSnapshot initialState;
+			float time;
+		};
+
+		void createArena(Environment& environment);
+		void resetEnvironment(int env);
+		void stepEnvironment(int env);
+		void writeObservation(int env);
+
+		Config _config;
+		std::vector<Environment> _environments;
+		ThreadPool* _threadPool;
+		std::vector<float> _actions;
+		std::vector<float> _observations;
+		std::vector<float> _rewards;
+		std::vector<uint8_t> _dones;
+		std::vector<uint32_t> _episodeSteps;
+		uint64_t _totalSteps;
+};
+
+#endif// VECTOR_ENVIRONMENT_H
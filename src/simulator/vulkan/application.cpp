@@ -5,12 +5,7 @@
 // By Breno Cunha Queiroz
 //--------------------------------------------------
 #include "application.h"
-#include "../objects/basic/importedObject.h"
-#include "../objects/basic/plane.h"
-#include "../objects/basic/box.h"
-#include "../objects/basic/sphere.h"
-#include "../objects/basic/cylinder.h"
-#include "../objects/others/displays/displayTFT144.h"
+#include <algorithm>
 #include "../physics/physicsEngine.h"
 #include "simulator/helpers/log.h"
 
@@ -27,6 +22,7 @@ Application::Application(Scene* scene):
 
 	//---------- Scene ----------//
 	_scene->createBuffers(_commandPool);
+	_sceneBufferRevision = _scene->getBufferRevision();
 
 	//---------- Swap Chain ----------//
 	_swapChain = new SwapChain(_device, _window);
@@ -38,6 +34,7 @@ Application::Application(Scene* scene):
 	{
 		_uniformBuffers[i] = new UniformBuffer(_device, bufferSize);
     }
+	createInstanceBuffers();
 
 	//---------- Pipelines ----------//
 	createPipelines();
@@ -131,7 +128,7 @@ void Application::createPipelines()
 	_colorBuffer = new ColorBuffer(_device, _swapChain, _swapChain->getExtent());
 	_depthBuffer = new DepthBuffer(_device, _commandPool, _swapChain->getExtent());
 	_renderPass = new RenderPass(_device, _swapChain, _depthBuffer, _colorBuffer);
-	_graphicsPipeline = new GraphicsPipeline(_device, _swapChain, _renderPass, _uniformBuffers, _scene);
+	_graphicsPipeline = new GraphicsPipeline(_device, _swapChain, _renderPass, _uniformBuffers, _instanceBuffers, _scene);
 	_linePipeline = new LinePipeline(_device, _swapChain, _renderPass, _uniformBuffers, _scene);
 }
 
@@ -189,6 +186,12 @@ void Application::cleanupSwapChain()
 		uniformBuffer = nullptr;
     }
 
+	for(auto& instanceBuffer : _instanceBuffers)
+	{
+		delete instanceBuffer;
+		instanceBuffer = nullptr;
+	}
+
 	delete _descriptorPool;
 	_descriptorPool = nullptr;
 }
@@ -208,6 +211,9 @@ void Application::recreateSwapChain()
 	{
 		_uniformBuffers[i] = new UniformBuffer(_device, (int)sizeof(UniformBufferObject));
     }
+	createInstanceBuffers();
+	// The device is idle
+	_imagesInFlight.assign(_swapChain->getImages().size(), VK_NULL_HANDLE);
 
 	createPipelines();
 	_frameBuffers.resize(_swapChain->getImageViews().size());
@@ -258,7 +264,14 @@ void Application::drawFrame()
 	// Update line buffer
 	_scene->updateLineBuffer();
 	// Update physics
-	//_scene->updatePhysics(timeDelta);
+	_scene->updatePhysics(timeDelta);
+	// Objects added or removed since the last frame
+	if(_scene->getBufferRevision() != _sceneBufferRevision)
+	{
+		// Some buffer grew, the descriptor sets use the old one
+		_sceneBufferRevision = _scene->getBufferRevision();
+		recreateSwapChain();
+	}
 
 	bool cameraUpdated = _modelViewController->updateCamera(timeDelta);
 
@@ -281,9 +294,17 @@ void Application::drawFrame()
 		exit(1);
 	}
 
+	// The buffers of the image are written while recording, its last frame must be done
+	if(_imagesInFlight[imageIndex] != VK_NULL_HANDLE)
+		vkWaitForFences(_device->handle(), 1, &_imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+	_imagesInFlight[imageIndex] = _inFlightFences[_currentFrame]->handle();
+
 	//---------- Start recording to command buffer ----------//
 	VkCommandBuffer commandBuffer = _commandBuffers->begin(imageIndex);
 	{
+		// Objects added, removed or moved since the last frame (staging of the image)
+		_scene->updateBuffers(commandBuffer, imageIndex);
+
 		if(_enableRayTracing || _splitRender)
 		{
 			// Recreate raytracing swapChain
@@ -363,6 +384,9 @@ void Application::drawFrame()
 
 void Application::render(VkCommandBuffer commandBuffer, int imageIndex)
 {
+	// Before binding the descriptor set (it changes if the instance buffer grows)
+	updateInstanceBuffer(imageIndex);
+
 	std::array<VkClearValue, 2> clearValues{};
 	clearValues[0].color = {0.3f, 0.3f, 0.3f, 1.0f};
 	clearValues[1].depthStencil = {1.0f, 0};
@@ -392,51 +416,15 @@ void Application::render(VkCommandBuffer commandBuffer, int imageIndex)
 			vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
 			vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
 
-			for(auto abstractPtr : _scene->getObjects())
+			// One draw per mesh, the number of objects only changes the instance count
+			for(uint32_t modelIndex = 0; modelIndex < (uint32_t)_meshDraws.size(); modelIndex++)
 			{
-				Model* model;
-				if(abstractPtr->getType() == "ImportedObject")
-					model = ((ImportedObject*)abstractPtr)->getModel();
-				else if(abstractPtr->getType() == "Plane")
-					model = ((Plane*)abstractPtr)->getModel();
-				else if(abstractPtr->getType() == "Box")
-					model = ((Box*)abstractPtr)->getModel();
-				else if(abstractPtr->getType() == "Sphere")
-					model = ((Sphere*)abstractPtr)->getModel();
-				else if(abstractPtr->getType() == "Cylinder")
-					model = ((Cylinder*)abstractPtr)->getModel();
-				else if(abstractPtr->getType() == "Display")
-					model = ((DisplayTFT144*)abstractPtr)->getModel();
-				else continue;
-
-				ObjectInfo objectInfo;
-				objectInfo.modelMatrix = abstractPtr->getModelMat();
-				if(abstractPtr->getType() == "Plane")
-					objectInfo.color = ((Plane*)abstractPtr)->getColor();
-				else if(abstractPtr->getType() == "Box")
-					objectInfo.color = ((Box*)abstractPtr)->getColor();
-				else if(abstractPtr->getType() == "Sphere")
-					objectInfo.color = ((Sphere*)abstractPtr)->getColor();
-				else if(abstractPtr->getType() == "Cylinder")
-					objectInfo.color = ((Cylinder*)abstractPtr)->getColor();
-				else 
-					objectInfo.color = {0,0,0};
-
-
-				vkCmdPushConstants(
-						commandBuffer,
-						_graphicsPipeline->getPipelineLayout()->handle(),
-						VK_SHADER_STAGE_VERTEX_BIT,
-						0,
-						sizeof(ObjectInfo),
-						&objectInfo);
-
-				const uint32_t vertexCount = model->getVerticesSize();
-				const uint32_t indexCount = model->getIndicesSize();
-				const uint32_t vertexOffset = model->getVertexOffset();
-				const uint32_t indexOffset = model->getIndexOffset();
-
-				vkCmdDrawIndexed(commandBuffer, indexCount, 1, indexOffset, vertexOffset, 0);
+				const MeshDraw& draw = _meshDraws[modelIndex];
+				if(draw.instanceCount == 0)
+					continue;
+
+				const Scene::MeshRange& mesh = _scene->getMeshRange(modelIndex);
+				vkCmdDrawIndexed(commandBuffer, mesh.indexCount, draw.instanceCount, mesh.indexOffset, mesh.vertexOffset, draw.firstInstance);
 			}
 		}
 
@@ -490,6 +478,60 @@ void Application::updateUniformBuffer(uint32_t currentImage)
 	_uniformBuffers[currentImage]->setValue(ubo);
 }
 
+void Application::createInstanceBuffers()
+{
+	// Grows in updateInstanceBuffer when objects are added
+	const VkDeviceSize size = std::max(_scene->getInstanceCount(), 1u)*sizeof(RasterInstance);
+	_instanceBuffers.resize(_swapChain->getImages().size());
+	for(size_t i = 0; i < _instanceBuffers.size(); i++)
+		_instanceBuffers[i] = new StorageBuffer(_device, size);
+}
+
+void Application::updateInstanceBuffer(uint32_t imageIndex)
+{
+	EntityStore* entities = _scene->getEntityStore();
+
+	// Counting sort by model index: instances of each mesh, then its first instance
+	_meshDraws.assign(_scene->getMeshCount(), MeshDraw{0, 0});
+	entities->forEach<EntityStore::Transform, EntityStore::RenderMesh, EntityStore::Color>(
+		[this](EntityStore::EntityId, const EntityStore::Transform&, const EntityStore::RenderMesh& mesh, const EntityStore::Color&)
+		{
+			_meshDraws[mesh.modelIndex].instanceCount++;
+		});
+
+	uint32_t instanceCount = 0;
+	for(auto& draw : _meshDraws)
+	{
+		draw.firstInstance = instanceCount;
+		instanceCount += draw.instanceCount;
+		// Counted again while writing
+		draw.instanceCount = 0;
+	}
+
+	StorageBuffer*& instanceBuffer = _instanceBuffers[imageIndex];
+	const VkDeviceSize size = (VkDeviceSize)instanceCount*sizeof(RasterInstance);
+	if(size > instanceBuffer->getSize())
+	{
+		// Doubled, the image is not in flight
+		const VkDeviceSize newSize = std::max(instanceBuffer->getSize()*2, size);
+		delete instanceBuffer;
+		instanceBuffer = new StorageBuffer(_device, newSize);
+		_graphicsPipeline->setInstanceBuffer(imageIndex, instanceBuffer);
+	}
+
+	// World transforms computed by the entity store, only copied
+	RasterInstance* instances = static_cast<RasterInstance*>(instanceBuffer->getData());
+	entities->forEach<EntityStore::Transform, EntityStore::RenderMesh, EntityStore::Color>(
+		[this, instances](EntityStore::EntityId, const EntityStore::Transform& transform, const EntityStore::RenderMesh& mesh, const EntityStore::Color& color)
+		{
+			MeshDraw& draw = _meshDraws[mesh.modelIndex];
+			RasterInstance& instance = instances[draw.firstInstance + draw.instanceCount++];
+			instance.modelMatrix = transform.world;
+			instance.normalMatrix = transform.worldIT;
+			instance.color = glm::vec4(color.value, 1.0f);
+		});
+}
+
 void Application::createDescriptorPool()
 {
 	int size = _swapChain->getImages().size();
@@ -35,6 +35,7 @@
 #include "descriptorPool.h"
 #include "descriptorSets.h"
 #include "uniformBuffer.h"
+#include "storageBuffer.h"
 #include "texture.h"
 #include "depthBuffer.h"
 #include "colorBuffer.h"
@@ -64,6 +65,9 @@ class Application
 		void recreateSwapChain();
 		void framebufferResizeCallback() {_framebufferResized = true;}
 		void updateUniformBuffer(uint32_t currentImage);
+		void createInstanceBuffers();
+		// Instances of the entities grouped by mesh (one instanced draw per mesh)
+		void updateInstanceBuffer(uint32_t imageIndex);
 		void createDescriptorPool();
 		void render(VkCommandBuffer commandBuffer, int imageIndex);
 
@@ -104,9 +108,20 @@ class Application
 		RayTracing* _rayTracing;
 
 		Scene* _scene;
+		// Buffers used by the descriptor sets
+		uint32_t _sceneBufferRevision;
 
 		std::vector<FrameBuffer*> _frameBuffers;
 		std::vector<UniformBuffer*> _uniformBuffers;
+		std::vector<StorageBuffer*> _instanceBuffers;
+
+		// Instances of each mesh in the instance buffer of the frame (indexed by the model index)
+		struct MeshDraw
+		{
+			uint32_t firstInstance;
+			uint32_t instanceCount;
+		};
+		std::vector<MeshDraw> _meshDraws;
 
 		std::vector<Semaphore*> _imageAvailableSemaphores;
 		std::vector<Semaphore*> _renderFinishedSemaphores;
@@ -0,0 +1,165 @@
+//--------------------------------------------------
+// Robot Simulator
+// dynamicBuffer.cpp
+// Date: 2020-12-09
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#include "dynamicBuffer.h"
+#include <cstring>
+#include <algorithm>
+
+DynamicBuffer::DynamicBuffer(Device* device, CommandPool* commandPool, VkBufferUsageFlags usage, uint32_t elementSize, uint32_t capacity):
+	_device(device), _commandPool(commandPool), _elementSize(elementSize), _revision(0),
+	_buffer(nullptr)
+{
+	// Also copied to itself when it grows
+	_usage = usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	resize(std::max(capacity, 1u));
+}
+
+DynamicBuffer::~DynamicBuffer()
+{
+	for(auto& staging : _staging)
+		if(staging.buffer != nullptr)
+		{
+			staging.buffer->unmapMemory();
+			delete staging.buffer;
+			staging.buffer = nullptr;
+		}
+
+	if(_buffer != nullptr)
+	{
+		delete _buffer;
+		_buffer = nullptr;
+	}
+}
+
+uint32_t DynamicBuffer::allocate(uint32_t count)
+{
+	if(count == 0)
+		return 0;
+
+	uint32_t offset = _ranges.allocate(count);
+	if(offset == RangeAllocator::INVALID_OFFSET)
+	{
+		// Doubled, the cost of the copies is amortized over the allocations
+		resize(std::max(getCapacity()*2, getCapacity() + count));
+		offset = _ranges.allocate(count);
+	}
+	return offset;
+}
+
+void DynamicBuffer::free(uint32_t offset, uint32_t count)
+{
+	_ranges.free(offset, count);
+}
+
+void DynamicBuffer::reserve(uint32_t capacity)
+{
+	if(capacity > getCapacity())
+		resize(std::max(getCapacity()*2, capacity));
+}
+
+void DynamicBuffer::write(uint32_t offset, const void* data, uint32_t count)
+{
+	const VkDeviceSize size = (VkDeviceSize)count*_elementSize;
+	if(size == 0)
+		return;
+
+	const VkDeviceSize srcOffset = _pendingData.size();
+	_pendingData.resize(srcOffset + size);
+	std::memcpy(_pendingData.data() + srcOffset, data, size);
+
+	// Consecutive writes are one copy
+	const VkDeviceSize dstOffset = (VkDeviceSize)offset*_elementSize;
+	if(!_pendingCopies.empty())
+	{
+		VkBufferCopy& last = _pendingCopies.back();
+		if(last.srcOffset + last.size == srcOffset && last.dstOffset + last.size == dstOffset)
+		{
+			last.size += size;
+			return;
+		}
+	}
+
+	VkBufferCopy copyRegion{};
+	copyRegion.srcOffset = srcOffset;
+	copyRegion.dstOffset = dstOffset;
+	copyRegion.size = size;
+	_pendingCopies.push_back(copyRegion);
+}
+
+void DynamicBuffer::flush(VkCommandBuffer commandBuffer, uint32_t frame)
+{
+	if(_pendingCopies.empty())
+		return;
+
+	reserveStaging(frame, _pendingData.size());
+	const Staging& staging = _staging[frame];
+	std::memcpy(staging.data, _pendingData.data(), _pendingData.size());
+
+	// After the frames that read the buffer, before the next ones
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	vkCmdCopyBuffer(commandBuffer, staging.buffer->handle(), _buffer->handle(), (uint32_t)_pendingCopies.size(), _pendingCopies.data());
+
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	_pendingCopies.clear();
+	_pendingData.clear();
+}
+
+void DynamicBuffer::resize(uint32_t capacity)
+{
+	Buffer* buffer = new Buffer(_device, capacity*_elementSize, _usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	if(_buffer != nullptr)
+	{
+		// The queued writes keep their offsets, they go to the new buffer
+		VkCommandBuffer commandBuffer = _commandPool->beginSingleTimeCommands();
+		{
+			VkBufferCopy copyRegion{};
+			copyRegion.size = (VkDeviceSize)getCapacity()*_elementSize;
+			vkCmdCopyBuffer(commandBuffer, _buffer->handle(), buffer->handle(), 1, &copyRegion);
+		}
+		// Waits the queue, the frames that used the old buffer are done
+		_commandPool->endSingleTimeCommands(commandBuffer);
+
+		delete _buffer;
+	}
+
+	_buffer = buffer;
+	_ranges.grow(capacity);
+	_revision++;
+}
+
+void DynamicBuffer::reserveStaging(uint32_t frame, VkDeviceSize size)
+{
+	if(frame >= _staging.size())
+		_staging.resize(frame+1, Staging{nullptr, nullptr, 0});
+
+	// Not in use by the GPU, it can be recreated
+	Staging& staging = _staging[frame];
+	if(size <= staging.size)
+		return;
+
+	if(staging.buffer != nullptr)
+	{
+		staging.buffer->unmapMemory();
+		delete staging.buffer;
+	}
+
+	size = std::max(staging.size*2, size);
+	staging.buffer = new Buffer(_device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	staging.data = (uint8_t*)staging.buffer->mapMemory(0, size);
+	staging.size = size;
+}
@@ -0,0 +1,81 @@
+//--------------------------------------------------
+// Robot Simulator
+// dynamicBuffer.h
+// Date: 2020-12-09
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef DYNAMIC_BUFFER_H
+#define DYNAMIC_BUFFER_H
+
+#include <iostream>
+#include <vector>
+#include "defines.h"
+#include "device.h"
+#include "commandPool.h"
+#include "buffer.h"
+#include "../helpers/rangeAllocator.h"
+
+// Device local buffer of elements that grows when it is full. Ranges of elements are
+// allocated with free lists and keep their offset when the buffer grows (the old content is
+// copied by the GPU to the new buffer).
+// The writes are queued on the host and flush records them in the command buffer of the
+// frame, copying from a staging buffer of that frame (reused once its fence is signaled),
+// so adding an element costs a memcpy and the queue is only waited when the buffer grows.
+class DynamicBuffer
+{
+	public:
+		DynamicBuffer(Device* device, CommandPool* commandPool, VkBufferUsageFlags usage, uint32_t elementSize, uint32_t capacity=1);
+		~DynamicBuffer();
+
+		// First element of a range of count elements (the buffer grows if no free range fits)
+		uint32_t allocate(uint32_t count);
+		void free(uint32_t offset, uint32_t count);
+		// At least capacity elements (buffers indexed by id instead of allocated)
+		void reserve(uint32_t capacity);
+
+		// Queue count elements to be written at the offset in the next flush
+		void write(uint32_t offset, const void* data, uint32_t count);
+		template <class T>
+		void write(uint32_t offset, const std::vector<T>& content) { write(offset, content.data(), (uint32_t)content.size()); }
+		// Records the copies of the queued writes in the command buffer. The staging buffer
+		// of the frame must not be in use (the last command buffer of the frame is done)
+		void flush(VkCommandBuffer commandBuffer, uint32_t frame);
+
+		//---------- Getters ----------//
+		Buffer* getBuffer() const { return _buffer; }
+		uint32_t getCapacity() const { return _ranges.getCapacity(); }
+		uint32_t getElementSize() const { return _elementSize; }
+		// End of the last allocated range
+		uint32_t getUsedEnd() const { return _ranges.getUsedEnd(); }
+		// Incremented when the buffer is recreated (the descriptors that use it must be updated)
+		uint32_t getRevision() const { return _revision; }
+
+	private:
+		// New buffer with the content of the old one
+		void resize(uint32_t capacity);
+		void reserveStaging(uint32_t frame, VkDeviceSize size);
+
+		Device* _device;
+		CommandPool* _commandPool;
+		VkBufferUsageFlags _usage;
+		uint32_t _elementSize;
+		uint32_t _revision;
+
+		Buffer* _buffer;
+		RangeAllocator _ranges;
+
+		// One per frame, persistently mapped
+		struct Staging
+		{
+			Buffer* buffer;
+			uint8_t* data;
+			VkDeviceSize size;
+		};
+		std::vector<Staging> _staging;
+
+		// Source offsets are in the pending data
+		std::vector<uint8_t> _pendingData;
+		std::vector<VkBufferCopy> _pendingCopies;
+};
+
+#endif// DYNAMIC_BUFFER_H
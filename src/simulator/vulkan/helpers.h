@@ -51,6 +51,14 @@ struct ObjectInfo
 	glm::vec3 color;
 };
 
+// Per instance data of the rasterization (graphics pipeline), read by gl_InstanceIndex
+struct RasterInstance
+{
+	glm::mat4 modelMatrix;
+	glm::mat4 normalMatrix;// Inverse transpose
+	glm::vec4 color;// Zero uses the material color
+};
+
 // TLAS instances (Ray tracing)
 struct InstanceInfo
 {
@@ -9,44 +9,12 @@
 #include <glm/gtc/matrix_inverse.hpp>
 
 int Model::textureId = 0;
-int Model::qtyModels = 0;
-std::vector<std::string> Model::currentModels = {};
-std::vector<uint32_t> Model::vertexOffsets = {0};
-std::vector<uint32_t> Model::indexOffsets = {0};
-std::vector<uint32_t> Model::verticesSize = {};
-std::vector<uint32_t> Model::indicesSize = {};
-
-Model::Model(std::string fileName):
-	_fileName(fileName), _procedural(nullptr)
-{
-	// Check if model was previously loaded
-	_modelIndex = -1;
-	for(int i=0; i<(int)Model::currentModels.size(); i++)
-	{
-		if(Model::currentModels[i] == _fileName)
-		{
-			_modelIndex = i;
-			break;
-		}
-	}
 
-	// Load model file if it is the first time it is used
-	if(_modelIndex == -1)
-	{
-		std::cout << std::endl << BOLDGREEN << "[Model]" << RESET << GREEN << " Loading model " << WHITE << fileName << RESET << std::endl;
-		_modelIndex = Model::qtyModels++;
-		loadModel();
-
-		Model::currentModels.push_back(_fileName);
-
-		uint32_t lastV = Model::vertexOffsets.size() > 0 ? Model::vertexOffsets.back() : 0;
-		uint32_t lastI = Model::indexOffsets.size() > 0 ? Model::indexOffsets.back() : 0;
-
-		Model::vertexOffsets.push_back(lastV + _vertices.size());
-		Model::indexOffsets.push_back(lastI + _indices.size());
-		Model::verticesSize.push_back(_vertices.size());
-		Model::indicesSize.push_back(_indices.size());
-	}
+Model::Model(std::string fileName, int modelIndex):
+	_procedural(nullptr), _fileName(fileName), _modelIndex(modelIndex)
+{
+	std::cout << std::endl << BOLDGREEN << "[Model]" << RESET << GREEN << " Loading model " << WHITE << fileName << RESET << std::endl;
+	loadModel();
 }
 
 Model::Model(std::vector<Vertex>&& vertices, std::vector<uint32_t>&& indices, std::vector<Material>&& materials, Procedural* procedural):
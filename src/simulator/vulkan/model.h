@@ -22,10 +22,12 @@
 #include "material.h"
 #include "procedural.h"
 
+// Geometry and materials of a model file. Loaded once per file and shared by the objects
+// through the ModelRegistry of the scene.
 class Model
 {
 	public:
-		Model(std::string fileName);
+		Model(std::string fileName, int modelIndex);
 		~Model();
 
 		void transform(const glm::mat4& transform);
@@ -36,11 +38,8 @@ class Model
 		const std::vector<Material>& getMaterials() const { return _materials; };
 		const std::vector<Texture*> getTextures(Device* device, CommandPool* commandPool);
 		Procedural* getProcedural() const { return  _procedural; }
+		// Id of the file in the registry
 		int getModelIndex() const { return _modelIndex; }
-		uint32_t getVertexOffset() const { return Model::vertexOffsets[_modelIndex]; }
-		uint32_t getIndexOffset() const { return Model::indexOffsets[_modelIndex]; }
-		uint32_t getVerticesSize() const { return Model::verticesSize[_modelIndex]; }
-		uint32_t getIndicesSize() const { return Model::indicesSize[_modelIndex]; }
 		std::string getFileName() const { return _fileName; }
 
 	private:
@@ -52,16 +51,8 @@ class Model
 		std::string _fileName;
 		int _modelIndex;
 
-		// Info about models already added
 		static int textureId;
-		static int qtyModels;
-		static std::vector<std::string> currentModels;
-		static std::vector<uint32_t> vertexOffsets;
-		static std::vector<uint32_t> indexOffsets;
-		static std::vector<uint32_t> verticesSize;
-		static std::vector<uint32_t> indicesSize;
 
-		// Helpers (Only used first time the object is added)
 		std::vector<Vertex> _vertices;
 		std::vector<uint32_t> _indices;
 		std::vector<Material> _materials;
@@ -0,0 +1,132 @@
+//--------------------------------------------------
+// Robot Simulator
+// modelRegistry.cpp
+// Date: 2020-12-10
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#include "modelRegistry.h"
+#include <utility>
+
+//---------- Handle ----------//
+ModelRegistry::Handle::Handle(const Handle& other):
+	_registry(other._registry), _entry(other._entry)
+{
+	if(_entry != nullptr)
+		_entry->refCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+ModelRegistry::Handle::Handle(Handle&& other):
+	_registry(other._registry), _entry(other._entry)
+{
+	other._registry = nullptr;
+	other._entry = nullptr;
+}
+
+ModelRegistry::Handle& ModelRegistry::Handle::operator=(Handle other)
+{
+	std::swap(_registry, other._registry);
+	std::swap(_entry, other._entry);
+	return *this;
+}
+
+ModelRegistry::Handle::~Handle()
+{
+	reset();
+}
+
+void ModelRegistry::Handle::reset()
+{
+	if(_entry != nullptr)
+		_registry->release(_entry);
+	_registry = nullptr;
+	_entry = nullptr;
+}
+
+//---------- Registry ----------//
+ModelRegistry::ModelRegistry():
+	_loadedCount(0)
+{
+}
+
+ModelRegistry::~ModelRegistry()
+{
+	for(auto entry : _ids)
+	{
+		if(entry->model != nullptr)
+			delete entry->model;
+		delete entry;
+	}
+	_ids.clear();
+	_entries.clear();
+}
+
+ModelRegistry::Handle ModelRegistry::acquire(const std::string& fileName)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	Entry* entry;
+	auto it = _entries.find(fileName);
+	if(it != _entries.end())
+		entry = it->second;
+	else
+	{
+		entry = new Entry();
+		entry->fileName = fileName;
+		entry->id = (ModelId)_ids.size();
+		entry->refCount = 0;
+		entry->model = nullptr;
+		entry->loading = false;
+		_entries[fileName] = entry;
+		_ids.push_back(entry);
+	}
+
+	// Counted before the model is checked, a release at the same time keeps it
+	entry->refCount.fetch_add(1, std::memory_order_relaxed);
+	if(entry->model == nullptr && !entry->loading)
+	{
+		// Loaded without the lock, other files can be loaded at the same time
+		entry->loading = true;
+		lock.unlock();
+		Model* model = new Model(fileName, (int)entry->id);
+		lock.lock();
+
+		entry->model = model;
+		entry->loading = false;
+		_loadedCount++;
+		_loaded.notify_all();
+	}
+	else
+		_loaded.wait(lock, [entry](){ return !entry->loading; });
+
+	return Handle(this, entry);
+}
+
+void ModelRegistry::release(Entry* entry)
+{
+	if(entry->refCount.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		return;
+
+	// Last reference, unless it was acquired again before the lock
+	Model* model = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if(entry->refCount.load(std::memory_order_relaxed) != 0 || entry->loading || entry->model == nullptr)
+			return;
+		model = entry->model;
+		entry->model = nullptr;
+		_loadedCount--;
+	}
+	delete model;
+}
+
+uint32_t ModelRegistry::getModelCount() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return (uint32_t)_ids.size();
+}
+
+uint32_t ModelRegistry::getLoadedCount() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _loadedCount;
+}
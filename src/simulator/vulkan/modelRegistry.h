@@ -0,0 +1,94 @@
+//--------------------------------------------------
+// Robot Simulator
+// modelRegistry.h
+// Date: 2020-12-10
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef MODEL_REGISTRY_H
+#define MODEL_REGISTRY_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include "model.h"
+
+// Models of the scene, one per file. The files are interned in a hash map of their paths,
+// the objects get handles that count the references: the model is loaded by the first
+// handle and deleted with the last one (a scene with 10k boxes has one box model).
+// The ids are kept when the model is deleted, a file always has the same id.
+//
+// Thread-safe, the loaders can run in parallel (different files are loaded at the same
+// time, the threads asking for a file being loaded wait for it).
+class ModelRegistry
+{
+	public:
+		typedef uint32_t ModelId;
+		static const ModelId INVALID_ID = 0xFFFFFFFF;
+
+	private:
+		struct Entry
+		{
+			std::string fileName;
+			ModelId id;
+			std::atomic<uint32_t> refCount;
+			// nullptr while loading or not referenced
+			Model* model;
+			bool loading;
+		};
+
+	public:
+		// Reference to a loaded model, copied by value (one atomic increment)
+		class Handle
+		{
+			public:
+				Handle(): _registry(nullptr), _entry(nullptr) {}
+				Handle(const Handle& other);
+				Handle(Handle&& other);
+				Handle& operator=(Handle other);
+				~Handle();
+
+				void reset();
+
+				//---------- Getters ----------//
+				Model* get() const { return _entry != nullptr ? _entry->model : nullptr; }
+				Model* operator->() const { return get(); }
+				ModelId getId() const { return _entry != nullptr ? _entry->id : INVALID_ID; }
+				bool isValid() const { return _entry != nullptr; }
+
+			private:
+				friend class ModelRegistry;
+				// The reference is already counted
+				Handle(ModelRegistry* registry, Entry* entry): _registry(registry), _entry(entry) {}
+
+				ModelRegistry* _registry;
+				Entry* _entry;
+		};
+
+		ModelRegistry();
+		// The handles must be destroyed before
+		~ModelRegistry();
+
+		// Loads the file the first time (or after its last handle was destroyed)
+		Handle acquire(const std::string& fileName);
+
+		//---------- Getters ----------//
+		// Files with an id (loaded or not)
+		uint32_t getModelCount() const;
+		// Models in memory
+		uint32_t getLoadedCount() const;
+
+	private:
+		void release(Entry* entry);
+
+		mutable std::mutex _mutex;
+		std::condition_variable _loaded;
+		std::unordered_map<std::string, Entry*> _entries;
+		// Indexed by the model id
+		std::vector<Entry*> _ids;
+		uint32_t _loadedCount;
+};
+
+#endif// MODEL_REGISTRY_H
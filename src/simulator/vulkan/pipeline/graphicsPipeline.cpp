@@ -11,6 +11,7 @@ GraphicsPipeline::GraphicsPipeline(
 			SwapChain* swapChain, 
 			RenderPass* renderPass, 
 			std::vector<UniformBuffer*> uniformBuffers, 
+			std::vector<StorageBuffer*> instanceBuffers, 
 			Scene* scene):
 	Pipeline(device, swapChain, renderPass, uniformBuffers, scene)
 {
@@ -138,7 +139,8 @@ GraphicsPipeline::GraphicsPipeline(
 	{
 		{0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT},
 		{1, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT},
-		{2, static_cast<uint32_t>(scene->getTextures().size()), VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT}
+		{2, static_cast<uint32_t>(scene->getTextures().size()), VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT},
+		{3, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT}
 	};
 
 	_descriptorSetManager = new DescriptorSetManager(_device, descriptorBindings, uniformBuffers.size());
@@ -167,11 +169,17 @@ GraphicsPipeline::GraphicsPipeline(
 			imageInfo.sampler = _scene->getTextures()[t]->getSampler()->handle();
 		}
 
+		// Instance buffer
+		VkDescriptorBufferInfo instanceBufferInfo = {};
+		instanceBufferInfo.buffer = instanceBuffers[i]->handle();
+		instanceBufferInfo.range = VK_WHOLE_SIZE;
+
 		const std::vector<VkWriteDescriptorSet> descriptorWrites =
 		{
 			descriptorSets->bind(i, 0, uniformBufferInfo),
 			descriptorSets->bind(i, 1, materialBufferInfo),
-			descriptorSets->bind(i, 2, *imageInfos.data(), static_cast<uint32_t>(imageInfos.size()))
+			descriptorSets->bind(i, 2, *imageInfos.data(), static_cast<uint32_t>(imageInfos.size())),
+			descriptorSets->bind(i, 3, instanceBufferInfo)
 		};
 
 		descriptorSets->updateDescriptors(i, descriptorWrites);
@@ -213,3 +221,13 @@ GraphicsPipeline::GraphicsPipeline(
 GraphicsPipeline::~GraphicsPipeline()
 {
 }
+
+void GraphicsPipeline::setInstanceBuffer(uint32_t index, StorageBuffer* instanceBuffer)
+{
+	VkDescriptorBufferInfo instanceBufferInfo = {};
+	instanceBufferInfo.buffer = instanceBuffer->handle();
+	instanceBufferInfo.range = VK_WHOLE_SIZE;
+
+	DescriptorSets* descriptorSets = _descriptorSetManager->getDescriptorSets();
+	descriptorSets->updateDescriptors(index, { descriptorSets->bind(index, 3, instanceBufferInfo) });
+}
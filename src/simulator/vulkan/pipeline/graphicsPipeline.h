@@ -12,6 +12,7 @@
 #include <string.h>
 
 #include "pipeline.h"
+#include "../storageBuffer.h"
 
 class GraphicsPipeline : public Pipeline
 {
@@ -20,9 +21,13 @@ class GraphicsPipeline : public Pipeline
 				SwapChain* swapChain, 
 				RenderPass* renderPass, 
 				std::vector<UniformBuffer*> uniformBuffers, 
+				std::vector<StorageBuffer*> instanceBuffers, 
 				Scene* scene);
 		~GraphicsPipeline();
 
+		// The instance buffer of the image was recreated (the image must not be in flight)
+		void setInstanceBuffer(uint32_t index, StorageBuffer* instanceBuffer);
+
 	private:
 };
 
@@ -30,7 +30,8 @@ RayTracing::~RayTracing()
 
 	for(auto blas : _blas)
 	{
-		delete blas;
+		if(blas != nullptr)
+			delete blas;
 		blas = nullptr;
 	}
 
@@ -48,16 +49,17 @@ RayTracing::~RayTracing()
 	}
 
 	// BLAS buffers
-	if(_bottomBuffer!=nullptr)
+	for(auto buffer : _bottomBuffers)
 	{
-		delete _bottomBuffer;
-		_bottomBuffer = nullptr;
+		if(buffer != nullptr)
+			delete buffer;
+		buffer = nullptr;
 	}
 
-	if(_bottomScratchBuffer!=nullptr)
+	for(auto buffer : _bottomScratchBuffers)
 	{
-		delete _bottomScratchBuffer;
-		_bottomScratchBuffer = nullptr;
+		delete buffer;
+		buffer = nullptr;
 	}
 
 	// TLAS buffers
@@ -154,6 +156,7 @@ void RayTracing::createAccelerationStructures()
 		createTopLevelStructures(commandBuffer);
 	}
 	_commandPool->endSingleTimeCommands(commandBuffer);
+	releaseBottomLevelStructures();
 
 	const auto elapsed = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - timer).count();
 	std::cout << WHITE << elapsed << "ms" << RESET << std::endl;
@@ -192,14 +195,15 @@ void RayTracing::recreateTopLevelStructures()
 		_instancesBuffer = nullptr;
 	}
 
-	// Update instance buffer
-	_scene->updateRayTracingBuffers();
-	// Create tlas
+	// Create tlas (and the blas of the models added since the last frame)
 	VkCommandBuffer commandBuffer = _commandPool->beginSingleTimeCommands();
 	{
+		createBottomLevelStructures(commandBuffer);
+		AccelerationStructure::memoryBarrier(commandBuffer);
 		createTopLevelStructures(commandBuffer);
 	}
 	_commandPool->endSingleTimeCommands(commandBuffer);
+	releaseBottomLevelStructures();
 
 	const auto elapsed = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - timer).count();
 	std::cout << WHITE << elapsed << "ms" << RESET << std::endl;
@@ -282,70 +286,78 @@ void RayTracing::createBottomLevelStructures(VkCommandBuffer commandBuffer)
 {
 	// Bottom level acceleration structure
 	// Triangles via vertex buffers. Procedurals via AABBs.
-	uint32_t aabbOffset = 0;
-
 	std::vector<AccelerationStructure::MemoryRequirements> requirements;
-	std::vector<int> indexesGenerated = {};
-
-	// Create blas object with memory requirements for each model
-	for(Model* model : _scene->getModels())
+	std::vector<BottomLevelAccelerationStructure*> generated;
+
+	// Create blas object with memory requirements for each model in the buffers without one
+	// (kept while the model has users, the structure has its own copy of the geometry)
+	const int meshCount = _scene->getMeshCount();
+	_blas.resize(meshCount, nullptr);
+	_bottomBuffers.resize(meshCount, nullptr);
+	std::vector<int> generatedModels;
+	for(int modelIndex=0; modelIndex<meshCount; modelIndex++)
 	{
-		int modelIndex = model->getModelIndex();
-		// Generate only one per model
-		bool found = false;
-		for(auto index : indexesGenerated)
-			if(index == modelIndex)
-			{
-				found = true;
-				break;
-			}
-		if(found)
+		const Scene::MeshRange& mesh = _scene->getMeshRange(modelIndex);
+		if(_blas[modelIndex] != nullptr || !mesh.uploaded)
 			continue;
-		indexesGenerated.push_back(modelIndex);
 
-		const uint32_t vertexCount = model->getVerticesSize();
-		const uint32_t indexCount = model->getIndicesSize();
-		const uint32_t vertexOffset = model->getVertexOffset()*sizeof(Vertex);
-		const uint32_t indexOffset = model->getIndexOffset()*sizeof(uint32_t);
+		// One aabb per model loaded by the scene
+		const uint32_t aabbOffset = modelIndex * sizeof(glm::vec3) * 2;
+		const uint32_t vertexOffset = mesh.vertexOffset*sizeof(Vertex);
+		const uint32_t indexOffset = mesh.indexOffset*sizeof(uint32_t);
 		const std::vector<VkGeometryNV> geometries =
 		{
-			model->getProcedural()
+			mesh.model->getProcedural()
 				? BottomLevelAccelerationStructure::createGeometryAabb(_scene, aabbOffset, 1, true)
-				: BottomLevelAccelerationStructure::createGeometry(_scene, vertexOffset, vertexCount, indexOffset, indexCount, true)
+				: BottomLevelAccelerationStructure::createGeometry(_scene, vertexOffset, mesh.vertexCount, indexOffset, mesh.indexCount, true)
 		};
 
 		BottomLevelAccelerationStructure* blas = new BottomLevelAccelerationStructure(_deviceProcedures, geometries, false);
-		_blas.push_back(blas);
-		requirements.push_back(_blas.back()->getMemoryRequirements());
-
-		aabbOffset += sizeof(glm::vec3) * 2;
+		_blas[modelIndex] = blas;
+		generated.push_back(blas);
+		generatedModels.push_back(modelIndex);
+		requirements.push_back(blas->getMemoryRequirements());
 	}
+	if(generated.empty())
+		return;
 
-	// Allocate the structure memory
-
-	// Calculate total memory size to allocate
+	// Allocate the structure memory (one buffer per blas, released with it) and the
+	// scratch memory of the builds (released once they are done)
 	AccelerationStructure::MemoryRequirements total{};
 	for(const auto req : requirements)
-	{
-		total.result.size += req.result.size;
 		total.build.size += req.build.size;
-		total.update.size += req.update.size;
-	}
 
-	_bottomBuffer = new Buffer(_device, total.result.size, VK_BUFFER_USAGE_RAY_TRACING_BIT_NV, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-	_bottomScratchBuffer = new Buffer(_device, total.build.size, VK_BUFFER_USAGE_RAY_TRACING_BIT_NV, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	Buffer* bottomScratchBuffer = new Buffer(_device, total.build.size, VK_BUFFER_USAGE_RAY_TRACING_BIT_NV, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	_bottomScratchBuffers.push_back(bottomScratchBuffer);
 
 	// Generate the structures
-	VkDeviceSize resultOffset = 0;
 	VkDeviceSize scratchOffset = 0;
-
-	for(size_t i = 0; i != _blas.size(); i++)
+	for(size_t i = 0; i != generated.size(); i++)
 	{
-		_blas[i]->generate(commandBuffer, _bottomBuffer, resultOffset, _bottomScratchBuffer, scratchOffset, false);
-		resultOffset += requirements[i].result.size;
+		Buffer* bottomBuffer = new Buffer(_device, requirements[i].result.size, VK_BUFFER_USAGE_RAY_TRACING_BIT_NV, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		_bottomBuffers[generatedModels[i]] = bottomBuffer;
+		generated[i]->generate(commandBuffer, bottomBuffer, 0, bottomScratchBuffer, scratchOffset, false);
 		scratchOffset += requirements[i].build.size;
 	}
-	// TODO after generating the BLAS it is possible to reduce the memory usage using a more fitted buffer
+}
+
+void RayTracing::releaseBottomLevelStructures()
+{
+	for(auto buffer : _bottomScratchBuffers)
+		delete buffer;
+	_bottomScratchBuffers.clear();
+
+	// Not in the new tlas (no entity uses the model) and the frames that used it are done
+	for(int modelIndex=0; modelIndex<(int)_blas.size(); modelIndex++)
+	{
+		if(_blas[modelIndex] == nullptr || _scene->getMeshRange(modelIndex).users > 0)
+			continue;
+
+		delete _blas[modelIndex];
+		_blas[modelIndex] = nullptr;
+		delete _bottomBuffers[modelIndex];
+		_bottomBuffers[modelIndex] = nullptr;
+	}
 }
 
 void RayTracing::createTopLevelStructures(VkCommandBuffer commandBuffer)
@@ -356,18 +368,31 @@ void RayTracing::createTopLevelStructures(VkCommandBuffer commandBuffer)
 
 	// Hit group 0: triangles
 	// Hit group 1: procedurals
-	for(Object* object : _scene->getObjects())
+	// Same index as the instance buffer element of the entity (gl_InstanceID), the free
+	// elements are invisible instances (mask 0)
+	EntityStore* entities = _scene->getEntityStore();
+	// Some blas that is kept after the build (see releaseBottomLevelStructures)
+	BottomLevelAccelerationStructure* anyBlas = nullptr;
+	for(int modelIndex=0; modelIndex<(int)_blas.size(); modelIndex++)
+		if(_blas[modelIndex] != nullptr && _scene->getMeshRange(modelIndex).users > 0)
+			anyBlas = _blas[modelIndex];
+	if(anyBlas != nullptr)
 	{
-		Model* model = object->getModel();
-		// glm::mat4 to expected by nvidia
-		glm::mat4 transformation = glm::transpose(object->getModelMat());
-
-		//_blas[model->getModelIndex()]->getDevice();
-		//std::cout << "INDEX: " << model->getModelIndex() << std::endl;
-		//std::cout << "Size: " << _blas.size() << std::endl;
-		geometryInstances.push_back(TopLevelAccelerationStructure::createGeometryInstance(
-			_blas[model->getModelIndex()], transformation, model->getModelIndex(), model->getProcedural()?1:0));
+		VkGeometryInstance freeInstance = TopLevelAccelerationStructure::createGeometryInstance(anyBlas, glm::mat4(1), 0, 0);
+		freeInstance.mask = 0;
+		geometryInstances.resize(_scene->getInstanceCount(), freeInstance);
 	}
+	entities->forEach<EntityStore::Transform, EntityStore::RenderMesh, EntityStore::Color>(
+		[&](EntityStore::EntityId id, const EntityStore::Transform& transform, const EntityStore::RenderMesh& mesh, const EntityStore::Color&)
+		{
+			if(mesh.instance >= geometryInstances.size() || _blas[mesh.modelIndex] == nullptr)
+				return;
+			const bool procedural = entities->getObject(id)->getModel()->getProcedural() != nullptr;
+			// glm::mat4 to expected by nvidia
+			glm::mat4 transformation = glm::transpose(transform.world);
+			geometryInstances[mesh.instance] = TopLevelAccelerationStructure::createGeometryInstance(
+				_blas[mesh.modelIndex], transformation, mesh.modelIndex, procedural?1:0);
+		});
 
 	TopLevelAccelerationStructure* tlas = new TopLevelAccelerationStructure(_deviceProcedures, geometryInstances, false);
 	_tlas.push_back(tlas);
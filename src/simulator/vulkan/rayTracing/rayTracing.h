@@ -39,6 +39,9 @@ class RayTracing
 		void getRTProperties();
 		void createAccelerationStructures();
 		void createBottomLevelStructures(VkCommandBuffer commandBuffer);
+		// After the builds are done (the queue is idle): frees the scratch memory and the
+		// structures of the models without users
+		void releaseBottomLevelStructures();
 		void createTopLevelStructures(VkCommandBuffer commandBuffer);
 		void createOutputImage();
 
@@ -51,6 +54,7 @@ class RayTracing
 		VkPhysicalDeviceRayTracingPropertiesNV _props = {};
 		DeviceProcedures* _deviceProcedures;
 
+		// Indexed by the model index (nullptr until the mesh is used)
 		std::vector<BottomLevelAccelerationStructure*> _blas;
 		std::vector<TopLevelAccelerationStructure*> _tlas;
 		RayTracingPipeline* _rayTracingPipeline;
@@ -61,8 +65,10 @@ class RayTracing
 		Image* _outputImage;
 		ImageView* _outputImageView;
 		
-		Buffer* _bottomBuffer;
-		Buffer* _bottomScratchBuffer;
+		// Memory of each blas, indexed by the model index
+		std::vector<Buffer*> _bottomBuffers;
+		// Used by the builds of the current command buffer
+		std::vector<Buffer*> _bottomScratchBuffers;
 		Buffer* _topBuffer;
 		Buffer* _topScratchBuffer;
 		Buffer* _instancesBuffer;
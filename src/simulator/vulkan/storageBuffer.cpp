@@ -0,0 +1,23 @@
+//--------------------------------------------------
+// Robot Simulator
+// storageBuffer.cpp
+// Date: 2020-12-11
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#include "storageBuffer.h"
+
+StorageBuffer::StorageBuffer(Device* device, VkDeviceSize size):
+	Buffer(device, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT),
+	_size(size)
+{
+	_data = mapMemory(0, size);
+}
+
+StorageBuffer::~StorageBuffer()
+{
+	if(_data != nullptr)
+	{
+		unmapMemory();
+		_data = nullptr;
+	}
+}
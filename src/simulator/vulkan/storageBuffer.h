@@ -0,0 +1,33 @@
+//--------------------------------------------------
+// Robot Simulator
+// storageBuffer.h
+// Date: 2020-12-11
+// By Breno Cunha Queiroz
+//--------------------------------------------------
+#ifndef STORAGE_BUFFER_H
+#define STORAGE_BUFFER_H
+
+#include <iostream>
+#include <string.h>
+#include "defines.h"
+#include "device.h"
+#include "buffer.h"
+
+// Host visible storage buffer that stays mapped, written directly by the CPU every frame
+// (one per swap chain image, the frames in flight use the other ones)
+class StorageBuffer : public Buffer
+{
+	public:
+		StorageBuffer(Device* device, VkDeviceSize size);
+		~StorageBuffer();
+
+		//---------- Getters ----------//
+		void* getData() const { return _data; }
+		VkDeviceSize getSize() const { return _size; }
+
+	private:
+		void* _data;
+		VkDeviceSize _size;
+};
+
+#endif// STORAGE_BUFFER_H
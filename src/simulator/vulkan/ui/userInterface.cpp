@@ -338,7 +338,7 @@ void UserInterface::helpMarker(std::string text)
 void UserInterface::createSceneTreeNode(Object* object)
 {
 	std::string objectName = object->getName();
-	std::vector<Object*> children = object->getChildren();
+	const std::vector<Object*>& children = object->getChildren();
 
 	if(children.size() == 0)
 	{